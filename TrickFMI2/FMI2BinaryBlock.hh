@@ -0,0 +1,162 @@
+/*!
+@file FMI2BinaryBlock.hh
+@ingroup FMITrickInterface
+@brief Helpers for writing and reading blocks of the binary model
+description cache.
+
+A block is a 64-bit byte count followed by the bytes, padded to an 8 byte
+boundary so that every block in a mapped cache file is aligned for any of
+the array element types.  Blocks contain no pointers and so the cache is
+position independent.
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+
+*/
+
+#ifndef FMI2_BINARY_BLOCK_HH_
+#define FMI2_BINARY_BLOCK_HH_
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// TrickFMI namespace is used for everything in the TrickFMI repo
+namespace TrickFMI {
+
+/*!
+ * @brief Append a block of bytes to a binary buffer.
+ *
+ * @param [inout] buffer Buffer to append the block to.
+ * @param [in]    data   Block contents.
+ * @param [in]    size   Size of the block contents in bytes.
+ */
+inline void write_binary_block(
+         std::string & buffer,
+   const void        * data,
+         size_t        size   )
+{
+   uint64_t block_size = size;
+   buffer.append( (const char *)&block_size, sizeof(block_size) );
+   buffer.append( (const char *)data, size );
+   buffer.append( (8 - (size & 7)) & 7, '\0' );
+   return;
+}
+
+/*!
+ * @brief Append an array block to a binary buffer.
+ *
+ * @param [inout] buffer Buffer to append the block to.
+ * @param [in]    values Array to write.
+ */
+template <class T>
+inline void write_binary_block(
+         std::string      & buffer,
+   const std::vector<T>   & values )
+{
+   write_binary_block( buffer, values.empty() ? NULL : &values[0],
+                       values.size() * sizeof(T) );
+   return;
+}
+
+/*!
+ * @brief Append a string block to a binary buffer.
+ *
+ * @param [inout] buffer Buffer to append the block to.
+ * @param [in]    value  String to write.
+ */
+inline void write_binary_block(
+         std::string & buffer,
+   const std::string & value   )
+{
+   write_binary_block( buffer, value.data(), value.size() );
+   return;
+}
+
+/*!
+ * @brief Get the next block from a binary buffer.
+ *
+ * @return Returns true on success or false if the block runs past the end
+ * of the buffer.
+ * @param [inout] data  Read position, moved past the block.
+ * @param [in]    end   End of the buffer.
+ * @param [out]   block Start of the block contents.
+ * @param [out]   size  Size of the block contents in bytes.
+ */
+inline bool read_binary_block(
+   const char ** data,
+   const char  * end,
+   const char ** block,
+   size_t      * size )
+{
+   uint64_t block_size;
+   uint64_t padded_size;
+
+   if ( (size_t)(end - *data) < sizeof(block_size) ) { return( false ); }
+   memcpy( &block_size, *data, sizeof(block_size) );
+   padded_size = (block_size + 7) & ~(uint64_t)7;
+   if ( (padded_size < block_size)
+        || (padded_size > (uint64_t)(end - *data) - sizeof(block_size)) ) {
+      return( false );
+   }
+   *block = *data + sizeof(block_size);
+   *size  = (size_t)block_size;
+   *data  = *block + padded_size;
+   return( true );
+}
+
+/*!
+ * @brief Read an array block from a binary buffer.
+ *
+ * The array is filled with a single copy of the block contents.
+ *
+ * @return Returns true on success or false if the block is truncated or is
+ * not a whole number of array elements.
+ * @param [inout] data   Read position, moved past the block.
+ * @param [in]    end    End of the buffer.
+ * @param [out]   values Array to fill.
+ */
+template <class T>
+inline bool read_binary_block(
+   const char           ** data,
+   const char            * end,
+         std::vector<T>  & values )
+{
+   const char * block;
+   size_t size;
+
+   if ( !read_binary_block( data, end, &block, &size ) || (size % sizeof(T)) ) {
+      return( false );
+   }
+   values.resize( size / sizeof(T) );
+   if ( size > 0 ) { memcpy( &values[0], block, size ); }
+   return( true );
+}
+
+/*!
+ * @brief Read a string block from a binary buffer.
+ *
+ * @return Returns true on success or false if the block is truncated.
+ * @param [inout] data  Read position, moved past the block.
+ * @param [in]    end   End of the buffer.
+ * @param [out]   value String to fill.
+ */
+inline bool read_binary_block(
+   const char        ** data,
+   const char         * end,
+         std::string  & value )
+{
+   const char * block;
+   size_t size;
+
+   if ( !read_binary_block( data, end, &block, &size ) ) { return( false ); }
+   value.assign( block, size );
+   return( true );
+}
+
+} // End TrickFMI namespace.
+
+#endif /* FMI2_BINARY_BLOCK_HH_ */
@@ -0,0 +1,590 @@
+/**
+@file FMI2CallProfile.cc
+@ingroup FMITrickInterface
+@brief Method implementations for the FMI2CallProfile class
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+*/
+
+#include <iomanip>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "FMI2CallProfile.hh"
+
+//! Number of bits of a latency kept by a histogram bin.
+#define SUB_BIN_BITS 4
+
+//! Number of histogram bins per power of two.
+#define SUB_BINS (1 << SUB_BIN_BITS)
+
+//! Largest latency shift with its own bins (about 20 minutes).
+#define MAX_SHIFT 36
+
+//! Number of histogram bins.
+#define NUM_BINS ((MAX_SHIFT + 2) * SUB_BINS)
+
+//! Names of the FMI functions in the order of FMI2Call.
+static const char * call_names[TrickFMI::FMI2CallCount] = {
+   "fmi2GetTypesPlatform", "fmi2GetVersion", "fmi2SetDebugLogging",
+   "fmi2Instantiate", "fmi2FreeInstance", "fmi2SetupExperiment",
+   "fmi2EnterInitializationMode", "fmi2ExitInitializationMode",
+   "fmi2Terminate", "fmi2Reset",
+   "fmi2GetReal", "fmi2GetInteger", "fmi2GetBoolean", "fmi2GetString",
+   "fmi2SetReal", "fmi2SetInteger", "fmi2SetBoolean", "fmi2SetString",
+   "fmi2GetFMUstate", "fmi2SetFMUstate", "fmi2FreeFMUstate",
+   "fmi2SerializedFMUstateSize", "fmi2SerializeFMUstate",
+   "fmi2DeSerializeFMUstate", "fmi2GetDirectionalDerivative",
+   "fmi2EnterEventMode", "fmi2NewDiscreteStates",
+   "fmi2EnterContinuousTimeMode", "fmi2CompletedIntegratorStep",
+   "fmi2SetTime", "fmi2SetContinuousStates", "fmi2GetDerivatives",
+   "fmi2GetEventIndicators", "fmi2GetContinuousStates",
+   "fmi2GetNominalsOfContinuousStates",
+   "fmi2SetRealInputDerivatives", "fmi2GetRealOutputDerivatives",
+   "fmi2DoStep", "fmi2CancelStep", "fmi2GetStatus", "fmi2GetRealStatus",
+   "fmi2GetIntegerStatus", "fmi2GetBooleanStatus", "fmi2GetStringStatus" };
+
+//! Names of the hardware events in the order of FMI2HardwareEvent.
+static const char * event_names[TrickFMI::FMI2HardwareEventCount] = {
+   "cycles", "instructions", "cache references", "cache misses",
+   "branches", "branch misses" };
+
+namespace {
+
+//! Hardware event counter group of one thread; shared by all its profiles.
+struct ThreadCounters {
+   int fds[TrickFMI::FMI2HardwareEventCount]; //!< Counter handles; the first leads the group.
+};
+
+} // End anonymous namespace.
+
+//! Counter group of the calling thread.
+static __thread ThreadCounters * thread_counters = NULL;
+
+//! Key closing the counter group of a thread when it exits.
+static pthread_key_t counters_key;
+
+//! Creates the counters key once.
+static pthread_once_t counters_key_once = PTHREAD_ONCE_INIT;
+
+
+/*!
+ * @brief Close the hardware event counters of a thread.
+ * @param [in] counters_ptr The ThreadCounters of the thread.
+ */
+static void close_thread_counters( void * counters_ptr )
+{
+   ThreadCounters * counters = (ThreadCounters *)counters_ptr;
+   int iinc;
+
+   for ( iinc = TrickFMI::FMI2HardwareEventCount - 1 ; iinc >= 0 ; iinc-- ) {
+      if ( counters->fds[iinc] != -1 ) {
+         close( counters->fds[iinc] );
+      }
+   }
+   delete counters;
+   return;
+}
+
+
+//! Create the key closing the thread counter groups.
+static void create_counters_key()
+{
+   pthread_key_create( &counters_key, close_thread_counters );
+   return;
+}
+
+
+/*!
+ * @brief Get the hardware event counters of the calling thread.
+ *
+ * The events are opened as one group on the first call from a thread so
+ * they are counted over the same intervals.  Only user space events are
+ * counted.  The group is closed when the thread exits.
+ *
+ * @return Returns the counter group; its leading handle is -1 if the
+ * counters could not be opened.
+ * @param [in] name Name of the profile opening the counters.
+ */
+static ThreadCounters * get_thread_counters( const std::string & name )
+{
+   ThreadCounters * counters = thread_counters;
+   int iinc;
+
+   if ( counters != NULL ) {
+      return( counters );
+   }
+
+   counters = new ThreadCounters;
+   for ( iinc = 0 ; iinc < TrickFMI::FMI2HardwareEventCount ; iinc++ ) {
+      counters->fds[iinc] = -1;
+   }
+   pthread_once( &counters_key_once, create_counters_key );
+   pthread_setspecific( counters_key, counters );
+   thread_counters = counters;
+
+#if defined(__linux__)
+   static const uint64_t event_configs[TrickFMI::FMI2HardwareEventCount] = {
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_REFERENCES, PERF_COUNT_HW_CACHE_MISSES,
+      PERF_COUNT_HW_BRANCH_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES };
+   struct perf_event_attr attr;
+
+   for ( iinc = 0 ; iinc < TrickFMI::FMI2HardwareEventCount ; iinc++ ) {
+      memset( &attr, 0, sizeof( attr ) );
+      attr.size           = sizeof( attr );
+      attr.type           = PERF_TYPE_HARDWARE;
+      attr.config         = event_configs[iinc];
+      attr.read_format    =   PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED
+                            | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv     = 1;
+      counters->fds[iinc] = syscall( SYS_perf_event_open, &attr, 0, -1,
+                                     (iinc == 0) ? -1 : counters->fds[0],
+                                     PERF_FLAG_FD_CLOEXEC );
+      if ( counters->fds[iinc] == -1 ) {
+         std::cerr << "Hardware event counters are not available for " << name
+                   << ": " << event_names[iinc] << ": " << strerror( errno ) << std::endl;
+         for ( ; iinc >= 0 ; iinc-- ) {
+            if ( counters->fds[iinc] != -1 ) {
+               close( counters->fds[iinc] );
+               counters->fds[iinc] = -1;
+            }
+         }
+         break;
+      }
+   }
+#else
+   std::cerr << "Hardware event counters are not available on this platform." << std::endl;
+#endif
+
+   return( counters );
+}
+
+
+//! Default constructor.
+TrickFMI::FMI2CallProfile::FMI2CallProfile()
+: enabled(false), count_hardware_events(false), print_on_terminate(false)
+{
+   clear();
+}
+
+
+//! Destructor.
+TrickFMI::FMI2CallProfile::~FMI2CallProfile()
+{
+}
+
+
+//! Remove all the recorded calls.
+void TrickFMI::FMI2CallProfile::clear()
+{
+   int iinc;
+
+   for ( iinc = 0 ; iinc < FMI2CallCount ; iinc++ ) {
+      stats[iinc].count = 0;
+      stats[iinc].total = 0;
+      stats[iinc].max   = 0;
+      stats[iinc].bins.clear();
+      stats[iinc].counted = 0;
+      stats[iinc].multiplexed = 0;
+      memset( stats[iinc].events, 0, sizeof( stats[iinc].events ) );
+   }
+
+   return;
+}
+
+
+/*!
+ * @brief Record a call.
+ *
+ * @param [in] call    FMI function called.
+ * @param [in] latency Call latency in nanoseconds.
+ */
+void TrickFMI::FMI2CallProfile::record(
+   FMI2Call call,
+   uint64_t latency )
+{
+   CallStats & call_stats = stats[call];
+
+   if ( call_stats.bins.empty() ) {
+      call_stats.bins.resize( NUM_BINS, 0 );
+   }
+   call_stats.bins[bin_index( latency )]++;
+   call_stats.count++;
+   call_stats.total += latency;
+   if ( latency > call_stats.max ) {
+      call_stats.max = latency;
+   }
+
+   return;
+}
+
+
+/*!
+ * @brief Get the number of calls to an FMI function.
+ *
+ * @return Number of recorded calls.
+ * @param [in] call FMI function.
+ */
+uint64_t TrickFMI::FMI2CallProfile::get_count( FMI2Call call ) const
+{
+   return( stats[call].count );
+}
+
+
+/*!
+ * @brief Get the total time spent in an FMI function.
+ *
+ * @return Total latency of the recorded calls in seconds.
+ * @param [in] call FMI function.
+ */
+double TrickFMI::FMI2CallProfile::get_total_time( FMI2Call call ) const
+{
+   return( (double)stats[call].total * 1.0e-9 );
+}
+
+
+/*!
+ * @brief Get the longest call to an FMI function.
+ *
+ * @return Largest latency of the recorded calls in seconds.
+ * @param [in] call FMI function.
+ */
+double TrickFMI::FMI2CallProfile::get_max_time( FMI2Call call ) const
+{
+   return( (double)stats[call].max * 1.0e-9 );
+}
+
+
+/*!
+ * @brief Get a latency percentile of an FMI function.
+ *
+ * @return Latency in seconds that the given percentage of the recorded
+ * calls did not exceed, or zero if there are no calls.
+ * @param [in] call    FMI function.
+ * @param [in] percent Percentage of calls (0 to 100).
+ */
+double TrickFMI::FMI2CallProfile::get_percentile(
+   FMI2Call call,
+   double   percent ) const
+{
+   const CallStats & call_stats = stats[call];
+   uint64_t target;
+   uint64_t seen = 0;
+   uint64_t value;
+   size_t iinc;
+
+   if ( call_stats.count == 0 ) {
+      return( 0.0 );
+   }
+
+   // Find the bin holding the target call.
+   target = (uint64_t)( percent * 0.01 * (double)call_stats.count + 0.5 );
+   if ( target < 1 ) { target = 1; }
+   if ( target > call_stats.count ) { target = call_stats.count; }
+   for ( iinc = 0 ; iinc < call_stats.bins.size() ; iinc++ ) {
+      seen += call_stats.bins[iinc];
+      if ( seen >= target ) {
+         break;
+      }
+   }
+
+   value = bin_upper_value( iinc );
+   if ( value > call_stats.max ) {
+      value = call_stats.max;
+   }
+
+   return( (double)value * 1.0e-9 );
+}
+
+
+/*!
+ * @brief Get the number of calls to an FMI function with hardware events.
+ *
+ * @return Number of calls whose hardware events were counted.
+ * @param [in] call FMI function.
+ */
+uint64_t TrickFMI::FMI2CallProfile::get_counted_calls( FMI2Call call ) const
+{
+   return( stats[call].counted );
+}
+
+
+/*!
+ * @brief Get the hardware events counted in an FMI function.
+ *
+ * @return Total count of the event over the counted calls.
+ * @param [in] call  FMI function.
+ * @param [in] event Hardware event.
+ */
+uint64_t TrickFMI::FMI2CallProfile::get_event_count(
+   FMI2Call          call,
+   FMI2HardwareEvent event ) const
+{
+   return( stats[call].events[event] );
+}
+
+
+/*!
+ * @brief Get the number of calls to an FMI function that were not counted.
+ *
+ * @return Number of calls during which the hardware event counters were
+ * multiplexed with other events.
+ * @param [in] call FMI function.
+ */
+uint64_t TrickFMI::FMI2CallProfile::get_multiplexed_calls( FMI2Call call ) const
+{
+   return( stats[call].multiplexed );
+}
+
+
+/*!
+ * @brief Read the hardware event counters of the calling thread.
+ *
+ * The counters are opened on the first read from a thread.  If they can
+ * not be opened, @ref count_hardware_events is cleared.
+ *
+ * @return Returns true if the counts were read.  They are not read while
+ * the counters have never been scheduled on the CPU.
+ * @param [out] counts Event counts and counter times.
+ */
+bool TrickFMI::FMI2CallProfile::read_hardware_events(
+   FMI2HardwareEventCounts & counts )
+{
+   // Number of events, time enabled, time running and event counts.
+   uint64_t buffer[3 + FMI2HardwareEventCount];
+   ThreadCounters * counters = get_thread_counters( name );
+   int iinc;
+
+   if ( counters->fds[0] == -1 ) {
+      count_hardware_events = false;
+      return( false );
+   }
+   if (    (read( counters->fds[0], buffer, sizeof( buffer ) ) != (ssize_t)sizeof( buffer ))
+        || (buffer[2] == 0) ) {
+      return( false );
+   }
+   counts.time_enabled = buffer[1];
+   counts.time_running = buffer[2];
+   for ( iinc = 0 ; iinc < FMI2HardwareEventCount ; iinc++ ) {
+      counts.counts[iinc] = buffer[3 + iinc];
+   }
+
+   return( true );
+}
+
+
+/*!
+ * @brief Record the hardware events of a call.
+ *
+ * A call during which the counters were not counting for the whole time
+ * they were enabled was multiplexed with other events; its counts are
+ * partial and are not recorded.
+ *
+ * @param [in] call  FMI function called.
+ * @param [in] start Event counts at the start of the call.
+ * @param [in] end   Event counts at the end of the call.
+ */
+void TrickFMI::FMI2CallProfile::record_hardware_events(
+         FMI2Call                  call,
+   const FMI2HardwareEventCounts & start,
+   const FMI2HardwareEventCounts & end    )
+{
+   CallStats & call_stats = stats[call];
+   int iinc;
+
+   if (    (end.time_running - start.time_running)
+        != (end.time_enabled - start.time_enabled) ) {
+      call_stats.multiplexed++;
+      return;
+   }
+   for ( iinc = 0 ; iinc < FMI2HardwareEventCount ; iinc++ ) {
+      call_stats.events[iinc] += end.counts[iinc] - start.counts[iinc];
+   }
+   call_stats.counted++;
+
+   return;
+}
+
+
+/*!
+ * @brief Print the profile of the called FMI functions.
+ *
+ * @param [in] stream Output stream to print to.
+ */
+void TrickFMI::FMI2CallProfile::print( std::ostream & stream ) const
+{
+   FMI2Call call;
+   int iinc;
+
+   stream << "FMI call profile: " << name << std::endl;
+   stream << "   " << std::left << std::setw( 34 ) << "function" << std::right
+          << std::setw( 12 ) << "count" << std::setw( 12 ) << "total (s)"
+          << std::setw( 11 ) << "mean (us)" << std::setw( 11 ) << "p50 (us)"
+          << std::setw( 11 ) << "p99 (us)" << std::setw( 11 ) << "max (us)"
+          << std::endl;
+   for ( iinc = 0 ; iinc < FMI2CallCount ; iinc++ ) {
+      call = (FMI2Call)iinc;
+      if ( stats[call].count == 0 ) {
+         continue;
+      }
+      stream << "   " << std::left << std::setw( 34 ) << call_names[call]
+             << std::right << std::setw( 12 ) << stats[call].count
+             << std::fixed << std::setprecision( 6 )
+             << std::setw( 12 ) << get_total_time( call )
+             << std::setprecision( 3 )
+             << std::setw( 11 ) << get_total_time( call ) * 1.0e6 / stats[call].count
+             << std::setw( 11 ) << get_percentile( call, 50.0 ) * 1.0e6
+             << std::setw( 11 ) << get_percentile( call, 99.0 ) * 1.0e6
+             << std::setw( 11 ) << get_max_time( call ) * 1.0e6 << std::endl;
+   }
+   print_hardware_events( stream );
+
+   return;
+}
+
+
+/*!
+ * @brief Print the hardware events of the called FMI functions.
+ *
+ * Nothing is printed if no hardware events were counted.  The last line
+ * totals the events over all the functions; the calls not counted because
+ * the counters were multiplexed are reported after it.
+ *
+ * @param [in] stream Output stream to print to.
+ */
+void TrickFMI::FMI2CallProfile::print_hardware_events( std::ostream & stream ) const
+{
+   uint64_t totals[FMI2HardwareEventCount] = { 0 };
+   uint64_t total_counted = 0;
+   uint64_t total_multiplexed = 0;
+   const uint64_t * events;
+   uint64_t counted;
+   int iinc, jinc;
+
+   for ( iinc = 0 ; iinc < FMI2CallCount ; iinc++ ) {
+      for ( jinc = 0 ; jinc < FMI2HardwareEventCount ; jinc++ ) {
+         totals[jinc] += stats[iinc].events[jinc];
+      }
+      total_counted += stats[iinc].counted;
+      total_multiplexed += stats[iinc].multiplexed;
+   }
+   if ( (total_counted == 0) && (total_multiplexed == 0) ) {
+      return;
+   }
+
+   stream << "FMI call hardware events: " << name << std::endl;
+   stream << "   " << std::left << std::setw( 34 ) << "function" << std::right
+          << std::setw( 12 ) << "counted" << std::setw( 16 ) << "cycles"
+          << std::setw( 16 ) << "instructions" << std::setw( 8 ) << "IPC"
+          << std::setw( 14 ) << "cache miss %" << std::setw( 15 ) << "branch miss %"
+          << std::endl;
+   for ( iinc = 0 ; iinc <= FMI2CallCount ; iinc++ ) {
+      if ( iinc < FMI2CallCount ) {
+         events  = stats[iinc].events;
+         counted = stats[iinc].counted;
+         if ( counted == 0 ) { continue; }
+      }
+      else {
+         events  = totals;
+         counted = total_counted;
+      }
+      stream << "   " << std::left << std::setw( 34 )
+             << ( (iinc < FMI2CallCount) ? call_names[iinc] : "total" )
+             << std::right << std::setw( 12 ) << counted
+             << std::setw( 16 ) << events[FMI2Cycles]
+             << std::setw( 16 ) << events[FMI2Instructions]
+             << std::fixed << std::setprecision( 2 ) << std::setw( 8 )
+             << ( (events[FMI2Cycles] > 0) ?
+                  (double)events[FMI2Instructions] / events[FMI2Cycles] : 0.0 )
+             << std::setw( 14 )
+             << ( (events[FMI2CacheReferences] > 0) ?
+                  100.0 * events[FMI2CacheMisses] / events[FMI2CacheReferences] : 0.0 )
+             << std::setw( 15 )
+             << ( (events[FMI2Branches] > 0) ?
+                  100.0 * events[FMI2BranchMisses] / events[FMI2Branches] : 0.0 )
+             << std::endl;
+   }
+   if ( total_multiplexed > 0 ) {
+      stream << "   " << total_multiplexed
+             << " calls not counted: the counters were multiplexed." << std::endl;
+   }
+
+   return;
+}
+
+
+/*!
+ * @brief Get the name of an FMI function.
+ *
+ * @return FMI function name.
+ * @param [in] call FMI function.
+ */
+const char * TrickFMI::FMI2CallProfile::get_call_name( FMI2Call call )
+{
+   return( call_names[call] );
+}
+
+
+/*!
+ * @brief Get the name of a hardware event.
+ *
+ * @return Hardware event name.
+ * @param [in] event Hardware event.
+ */
+const char * TrickFMI::FMI2CallProfile::get_event_name( FMI2HardwareEvent event )
+{
+   return( event_names[event] );
+}
+
+
+/*!
+ * @brief Get the histogram bin of a latency.
+ *
+ * Latencies below 2 * SUB_BINS nanoseconds have a bin each.  Above that
+ * each power of two is split into SUB_BINS bins.
+ *
+ * @return Bin index.
+ * @param [in] latency Call latency in nanoseconds.
+ */
+size_t TrickFMI::FMI2CallProfile::bin_index( uint64_t latency )
+{
+   int shift;
+
+   if ( latency < 2 * SUB_BINS ) {
+      return( (size_t)latency );
+   }
+   shift = 63 - __builtin_clzll( latency ) - SUB_BIN_BITS;
+   if ( shift > MAX_SHIFT ) {
+      return( NUM_BINS - 1 );
+   }
+   return( (size_t)(shift + 1) * SUB_BINS + (size_t)((latency >> shift) - SUB_BINS) );
+}
+
+
+/*!
+ * @brief Get the largest latency of a histogram bin.
+ *
+ * @return Largest latency in nanoseconds that falls in the bin.
+ * @param [in] index Bin index.
+ */
+uint64_t TrickFMI::FMI2CallProfile::bin_upper_value( size_t index )
+{
+   int shift;
+
+   if ( index < 2 * SUB_BINS ) {
+      return( (uint64_t)index );
+   }
+   shift = (int)(index / SUB_BINS) - 1;
+   return( (((uint64_t)(index % SUB_BINS + SUB_BINS + 1)) << shift) - 1 );
+}
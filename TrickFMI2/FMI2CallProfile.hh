@@ -0,0 +1,325 @@
+/*******************************************************************************
+* Things that Trick looks for to trigger parsing and processing:
+* PURPOSE:
+* LIBRARY DEPENDENCY:
+*  ((FMI2CallProfile.o))
+********************************************************************************/
+/*!
+@file FMI2CallProfile.hh
+@ingroup FMITrickInterface
+@brief Definition of the FMI2CallProfile class.
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+
+*/
+
+#ifndef FMI2_CALL_PROFILE_HH_
+#define FMI2_CALL_PROFILE_HH_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "FMI2Trace.hh"
+
+// TrickFMI namespace is used for everything in the TrickFMI repo
+namespace TrickFMI {
+
+//! FMI function timed by the call profile.
+typedef enum {
+   FMI2CallGetTypesPlatform,
+   FMI2CallGetVersion,
+   FMI2CallSetDebugLogging,
+   FMI2CallInstantiate,
+   FMI2CallFreeInstance,
+   FMI2CallSetupExperiment,
+   FMI2CallEnterInitializationMode,
+   FMI2CallExitInitializationMode,
+   FMI2CallTerminate,
+   FMI2CallReset,
+   FMI2CallGetReal,
+   FMI2CallGetInteger,
+   FMI2CallGetBoolean,
+   FMI2CallGetString,
+   FMI2CallSetReal,
+   FMI2CallSetInteger,
+   FMI2CallSetBoolean,
+   FMI2CallSetString,
+   FMI2CallGetFMUstate,
+   FMI2CallSetFMUstate,
+   FMI2CallFreeFMUstate,
+   FMI2CallSerializedFMUstateSize,
+   FMI2CallSerializeFMUstate,
+   FMI2CallDeSerializeFMUstate,
+   FMI2CallGetDirectionalDerivative,
+   FMI2CallEnterEventMode,
+   FMI2CallNewDiscreteStates,
+   FMI2CallEnterContinuousTimeMode,
+   FMI2CallCompletedIntegratorStep,
+   FMI2CallSetTime,
+   FMI2CallSetContinuousStates,
+   FMI2CallGetDerivatives,
+   FMI2CallGetEventIndicators,
+   FMI2CallGetContinuousStates,
+   FMI2CallGetNominalsOfContinuousStates,
+   FMI2CallSetRealInputDerivatives,
+   FMI2CallGetRealOutputDerivatives,
+   FMI2CallDoStep,
+   FMI2CallCancelStep,
+   FMI2CallGetStatus,
+   FMI2CallGetRealStatus,
+   FMI2CallGetIntegerStatus,
+   FMI2CallGetBooleanStatus,
+   FMI2CallGetStringStatus,
+   FMI2CallCount
+} FMI2Call;
+
+//! Hardware event counted by the call profile.
+typedef enum {
+   FMI2Cycles,
+   FMI2Instructions,
+   FMI2CacheReferences,
+   FMI2CacheMisses,
+   FMI2Branches,
+   FMI2BranchMisses,
+   FMI2HardwareEventCount
+} FMI2HardwareEvent;
+
+//! Hardware event counter readings.
+typedef struct {
+   uint64_t time_enabled; //!< Time the counters were enabled in nanoseconds.
+   uint64_t time_running; //!< Time the counters were counting in nanoseconds.
+   uint64_t counts[FMI2HardwareEventCount]; //!< Event counts in the order of FMI2HardwareEvent.
+} FMI2HardwareEventCounts;
+
+/*!
+@class FMI2CallProfile
+@brief Defines the FMI2CallProfile class.
+
+The FMI2CallProfile class records the number of calls and a latency
+histogram for each FMI function called through a model object.  Each
+FMI2ModelBase has a profile; profiling is off until @ref enabled is set.
+When off, each call costs one test of the flag.  When on, each call costs
+two reads of the monotonic clock and a histogram update.
+
+The histograms are log-linear (HDR style): latencies are binned in
+nanoseconds with 16 bins per power of two, so percentiles are within about
+6% of the recorded latency up to about 20 minutes.  The maximum is exact.
+A histogram is only allocated for a function once it is called.
+
+When @ref count_hardware_events is also set, the CPU cycles, instructions,
+cache references and misses and branches and branch misses spent in each
+call are counted with the Linux perf_event_open interface.  The report
+adds the instructions per cycle and the cache and branch miss rates of each
+function, which separate memory bound models from compute bound ones.  The
+counters count user space events of the calling thread.  Each thread opens
+one group of counters on its first counted call and shares it with every
+profile counting on that thread, so profiling several model instances does
+not make the kernel multiplex their counters.  A call during which the
+counters were not counting the whole time (multiplexed with other perf
+users) is timed but not counted; the report gives the number of such
+calls.  Reading the counters is a system call, so counting costs about a
+microsecond per call.  If the counters can not be opened (see
+/proc/sys/kernel/perf_event_paranoid) a message is printed and only the
+latencies are recorded.
+
+The profile is printed by print() or print_profile() (for example from the
+Trick input file) and when the model terminates if @ref print_on_terminate
+is set.
+
+@trick_parse{everything}
+
+@tldh
+@trick_link_dependency{FMI2CallProfile.o}
+
+*/
+
+class FMI2CallProfile {
+
+  public:
+
+   bool enabled; /**< @trick_units{--} @n
+      Flag to indicate that the FMI calls are timed. */
+
+   bool count_hardware_events; /**< @trick_units{--} @n
+      Flag to indicate that hardware events are counted for the timed
+      calls (Linux only). */
+
+   bool print_on_terminate; /**< @trick_units{--} @n
+      Flag to indicate that the profile is printed when the model
+      terminates. */
+
+   std::string name; //!< @trick_units{--} Name of the profiled model instance.
+
+   // Default constructor.
+   FMI2CallProfile();
+
+   // Destructor.
+   ~FMI2CallProfile();
+
+   void clear();
+
+   void record( FMI2Call call, uint64_t latency );
+
+   uint64_t get_count( FMI2Call call ) const;
+   double get_total_time( FMI2Call call ) const;
+   double get_max_time( FMI2Call call ) const;
+   double get_percentile( FMI2Call call, double percent ) const;
+   uint64_t get_counted_calls( FMI2Call call ) const;
+   uint64_t get_event_count( FMI2Call call, FMI2HardwareEvent event ) const;
+
+   uint64_t get_multiplexed_calls( FMI2Call call ) const;
+   bool read_hardware_events( FMI2HardwareEventCounts & counts );
+   void record_hardware_events( FMI2Call                        call,
+                                const FMI2HardwareEventCounts & start,
+                                const FMI2HardwareEventCounts & end    );
+
+   void print( std::ostream & stream ) const;
+
+   /*!
+    * @brief Print the profile to standard out.
+    */
+   void print_profile() const { print( std::cout ); }
+
+   static const char * get_call_name( FMI2Call call );
+   static const char * get_event_name( FMI2HardwareEvent event );
+
+   /*!
+    * @brief Get the current monotonic clock time.
+    * @return Returns the monotonic clock time in nanoseconds.
+    */
+   static uint64_t get_ticks()
+   {
+      struct timespec now;
+      clock_gettime( CLOCK_MONOTONIC, &now );
+      return( (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec );
+   }
+
+  protected:
+
+   /*!
+   @brief Call statistics of one FMI function.
+   */
+   struct CallStats {
+      uint64_t count; /**< @trick_units{--} Number of calls. */
+      uint64_t total; /**< @trick_units{--} Total latency in nanoseconds. */
+      uint64_t max;   /**< @trick_units{--} Largest latency in nanoseconds. */
+      std::vector<uint64_t> bins; /**< @trick_io{**} Latency histogram. */
+      uint64_t counted; /**< @trick_units{--} Number of calls with hardware events. */
+      uint64_t multiplexed; /**< @trick_units{--} Number of calls not counted while the counters were multiplexed. */
+      uint64_t events[FMI2HardwareEventCount]; /**< @trick_io{**} Hardware event totals. */
+   };
+
+   CallStats stats[FMI2CallCount]; //!< @trick_io{**} Statistics of each FMI function.
+
+   void print_hardware_events( std::ostream & stream ) const;
+
+   static size_t bin_index( uint64_t latency );
+   static uint64_t bin_upper_value( size_t index );
+
+  private:
+
+   /*!
+    * @brief Copy constructor not implemented.
+    *
+    * The copy constructor is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2CallProfile (const FMI2CallProfile &);
+
+   /*!
+    * @brief Assignment operator not implemented.
+    *
+    * The assignment operator is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2CallProfile & operator= (const FMI2CallProfile &);
+
+};
+
+
+/*!
+@class FMI2CallTimer
+@brief Times one FMI call into a call profile.
+
+The latency is recorded when the timer goes out of scope, so a timer
+declared at the top of a call block times the whole block including its
+return expression.  When FMI2Trace is on, the call is also traced; the
+trace events are outside the timed latency.
+*/
+class FMI2CallTimer {
+
+  public:
+
+   /*!
+    * @brief Start timing a call if the profile is enabled.
+    * @param [inout] call_profile Profile to record the call in.
+    * @param [in]    timed_call   FMI function called.
+    */
+   FMI2CallTimer( FMI2CallProfile & call_profile, FMI2Call timed_call )
+   : profile( call_profile.enabled ? &call_profile : NULL ), call( timed_call ),
+     traced( FMI2Trace::enabled ? &call_profile : NULL ), counting( false ), start( 0 )
+   {
+      if ( traced != NULL ) {
+         FMI2Trace::add_event( traced, call, 'B' );
+      }
+      if ( profile != NULL ) {
+         start = FMI2CallProfile::get_ticks();
+         if ( profile->count_hardware_events ) {
+            counting = profile->read_hardware_events( start_events );
+         }
+      }
+   }
+
+   //! Record the call.
+   ~FMI2CallTimer()
+   {
+      FMI2HardwareEventCounts end_events;
+
+      if ( profile != NULL ) {
+         if ( counting && profile->read_hardware_events( end_events ) ) {
+            profile->record_hardware_events( call, start_events, end_events );
+         }
+         profile->record( call, FMI2CallProfile::get_ticks() - start );
+      }
+      if ( traced != NULL ) {
+         FMI2Trace::add_event( traced, call, 'E' );
+      }
+   }
+
+  private:
+
+   FMI2CallProfile * profile;  //!< @trick_io{**} Profile or NULL if not timing.
+   FMI2Call          call;     //!< @trick_io{**} FMI function called.
+   FMI2CallProfile * traced;   //!< @trick_io{**} Traced profile or NULL if not tracing.
+   bool              counting; //!< @trick_io{**} Hardware events are counted.
+   uint64_t          start;    //!< @trick_io{**} Call start time in nanoseconds.
+   FMI2HardwareEventCounts start_events; //!< @trick_io{**} Event counts at the call start.
+
+   /*!
+    * @brief Copy constructor not implemented.
+    *
+    * The copy constructor is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2CallTimer (const FMI2CallTimer &);
+
+   /*!
+    * @brief Assignment operator not implemented.
+    *
+    * The assignment operator is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2CallTimer & operator= (const FMI2CallTimer &);
+
+};
+
+} // End TrickFMI namespace.
+
+#endif /* FMI2_CALL_PROFILE_HH_ */
@@ -17,6 +17,7 @@ All Other Rights Reserved.
 
 
 TrickFMI::FMI2CoSimulationModel::FMI2CoSimulationModel()
+: current_time(0.0)
 {
 
    // Set the model use modality.
@@ -106,6 +107,7 @@ fmi2Status TrickFMI::FMI2CoSimulationModel::fmi2SetRealInputDerivatives(
 {
    /* Call the C FMU method if loaded. */
    if ( set_real_input_derivatives != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallSetRealInputDerivatives );
       return( set_real_input_derivatives( component, vr, nvr, order, value ) );
    }
    return( fmi2Fatal );
@@ -120,21 +122,57 @@ fmi2Status TrickFMI::FMI2CoSimulationModel::fmi2GetRealOutputDerivatives(
 {
    /* Call the C FMU method if loaded. */
    if ( set_real_output_derivatives != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallGetRealOutputDerivatives );
       return( set_real_output_derivatives( component, vr, nvr, order, value ) );
    }
    return( fmi2Fatal );
 }
 
 
+/*!
+ * @brief Set up the model experiment and record the start time.
+ */
+fmi2Status TrickFMI::FMI2CoSimulationModel::fmi2SetupExperiment(
+   fmi2Boolean toleranceDefined,
+   fmi2Real    tolerance,
+   fmi2Real    startTime,
+   fmi2Boolean stopTimeDefined,
+   fmi2Real    stopTime          )
+{
+   current_time = startTime;
+   return( FMI2ModelBase::fmi2SetupExperiment( toleranceDefined, tolerance,
+                                               startTime,
+                                               stopTimeDefined, stopTime ) );
+}
+
+
+/*!
+ * @brief Get the model time carried across an FMU swap.
+ *
+ * @return Returns the communication point reached by the last step.
+ */
+fmi2Real TrickFMI::FMI2CoSimulationModel::get_swap_time( void )
+{
+   return( current_time );
+}
+
+
 fmi2Status TrickFMI::FMI2CoSimulationModel::fmi2DoStep(
    fmi2Real    currentCommunicationPoint,
    fmi2Real    communicationStepSize,
    fmi2Boolean noSetFMUStatePriorToCurrentPoint )
 {
+   fmi2Status status;
+
    /* Call the C FMU method if loaded. */
    if ( do_step != NULL ) {
-      return( do_step( component, currentCommunicationPoint,
-                       communicationStepSize, noSetFMUStatePriorToCurrentPoint ) );
+      FMI2CallTimer timer( call_profile, FMI2CallDoStep );
+      status = do_step( component, currentCommunicationPoint,
+                        communicationStepSize, noSetFMUStatePriorToCurrentPoint );
+      if ( status <= fmi2Warning ) {
+         current_time = currentCommunicationPoint + communicationStepSize;
+      }
+      return( status );
    }
    return( fmi2Fatal );
 }
@@ -144,6 +182,7 @@ fmi2Status TrickFMI::FMI2CoSimulationModel::fmi2CancelStep()
 {
    /* Call the C FMU method if loaded. */
    if ( cancel_step != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallCancelStep );
       return( cancel_step( component ) );
    }
    return( fmi2Fatal );
@@ -156,6 +195,7 @@ fmi2Status TrickFMI::FMI2CoSimulationModel::fmi2GetStatus(
 {
    /* Call the C FMU method if loaded. */
    if ( get_status != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallGetStatus );
       return( get_status( component, s, value ) );
    }
    return( fmi2Fatal );
@@ -168,6 +208,7 @@ fmi2Status TrickFMI::FMI2CoSimulationModel::fmi2GetRealStatus(
 {
    /* Call the C FMU method if loaded. */
    if ( get_real_status != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallGetRealStatus );
       return( get_real_status( component, s, value ) );
    }
    return( fmi2Fatal );
@@ -180,6 +221,7 @@ fmi2Status TrickFMI::FMI2CoSimulationModel::fmi2GetIntegerStatus(
 {
    /* Call the C FMU method if loaded. */
    if ( get_integer_status != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallGetIntegerStatus );
       return( get_integer_status( component, s, value ) );
    }
    return( fmi2Fatal );
@@ -192,6 +234,7 @@ fmi2Status TrickFMI::FMI2CoSimulationModel::fmi2GetBooleanStatus(
 {
    /* Call the C FMU method if loaded. */
    if ( get_boolean_status != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallGetBooleanStatus );
       return( get_boolean_status( component, s, value ) );
    }
    return( fmi2Fatal );
@@ -203,6 +246,7 @@ fmi2Status TrickFMI::FMI2CoSimulationModel::fmi2GetStringStatus(
 {
    /* Call the C FMU method if loaded. */
    if ( get_string_status != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallGetStringStatus );
       return( get_string_status( component, s, value ) );
    }
    return( fmi2Fatal );
@@ -66,6 +66,13 @@ class FMI2CoSimulationModel: public TrickFMI::FMI2ModelBase
     */
    virtual void clean_up();
 
+   virtual fmi2Status fmi2SetupExperiment(
+      fmi2Boolean toleranceDefined,
+      fmi2Real    tolerance,
+      fmi2Real    startTime,
+      fmi2Boolean stopTimeDefined,
+      fmi2Real    stopTime          );
+
 
    //------------------------------------------------------------------------
    // The following functions are for the FMI 2 co-simulation modality.
@@ -122,8 +129,12 @@ class FMI2CoSimulationModel: public TrickFMI::FMI2ModelBase
 
   protected:
 
+   fmi2Real current_time; //!< @trick_units{s} Communication point reached by the last step.
+
    virtual fmi2Status bind_function_ptrs();
 
+   virtual fmi2Real get_swap_time( void );
+
    /*
     * C function pointers bound when the FMU is loaded.
     */
@@ -0,0 +1,252 @@
+/**
+@file FMI2DependencyGraph.cc
+@ingroup FMITrickInterface
+@brief Method implementations for the FMI2DependencyGraph class
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+*/
+
+#include <map>
+
+#include "FMI2BinaryBlock.hh"
+#include "FMI2DependencyGraph.hh"
+
+
+//! Default constructor.
+TrickFMI::FMI2DependencyGraph::FMI2DependencyGraph()
+{
+   clear();
+}
+
+
+//! Destructor.
+TrickFMI::FMI2DependencyGraph::~FMI2DependencyGraph()
+{
+}
+
+
+//! Remove all the unknowns from the graph.
+void TrickFMI::FMI2DependencyGraph::clear()
+{
+   unknowns.clear();
+   all_flags.clear();
+   row_offsets.assign( 1, 0 );
+   columns.clear();
+   kinds.clear();
+   levels.clear();
+   level_rows.clear();
+   level_offsets.clear();
+   return;
+}
+
+
+/*!
+ * @brief Add an unknown (row) to the graph.
+ *
+ * The dependencies of the unknown are then added with add_dependency().
+ *
+ * @return Returns the row of the unknown.
+ * @param [in] unknown          Model variable index of the unknown.
+ * @param [in] all_dependencies Unknown may depend on all the known variables.
+ */
+size_t TrickFMI::FMI2DependencyGraph::add_row(
+   int  unknown,
+   bool all_dependencies )
+{
+   unknowns.push_back( unknown );
+   all_flags.push_back( all_dependencies ? 1 : 0 );
+   row_offsets.push_back( columns.size() );
+   return( unknowns.size() - 1 );
+}
+
+
+/*!
+ * @brief Add a dependency to the last unknown added.
+ *
+ * @param [in] variable Model variable index of the dependency.
+ * @param [in] kind     Kind of the dependency.
+ */
+void TrickFMI::FMI2DependencyGraph::add_dependency(
+   int                variable,
+   FMI2DependencyKind kind     )
+{
+   columns.push_back( variable );
+   kinds.push_back( (unsigned char)kind );
+   row_offsets.back() = columns.size();
+   return;
+}
+
+
+/*!
+ * @brief Find the row of an unknown.
+ *
+ * @return Returns the row of the unknown or -1 if the variable is not an
+ * unknown in this graph.
+ * @param [in] variable Model variable index.
+ */
+int TrickFMI::FMI2DependencyGraph::find_row( int variable ) const
+{
+   size_t row;
+
+   for ( row = 0 ; row < unknowns.size() ; row++ ) {
+      if ( unknowns[row] == variable ) { return( (int)row ); }
+   }
+   return( -1 );
+}
+
+
+/*!
+ * @brief Compute the topological levels of the unknowns.
+ *
+ * The levels are computed with Kahn's algorithm over the dependencies of
+ * unknowns on other unknowns in the graph.  Rows are then grouped by level
+ * so that each level can be evaluated (for example, in a Gauss-Seidel
+ * sweep) after the levels before it.
+ *
+ * @return Returns false if the unknowns have cyclic dependencies.  In that
+ * case the rows in the cycles are not assigned a level (level -1).
+ */
+bool TrickFMI::FMI2DependencyGraph::compute_levels()
+{
+   std::map<int, size_t> row_of;
+   std::vector<size_t> in_degree( unknowns.size(), 0 );
+   std::vector<size_t> dependent_offsets( unknowns.size() + 1, 0 );
+   std::vector<size_t> dependents;
+   std::vector<size_t> fill;
+   std::map<int, size_t>::iterator row_iter;
+   size_t row, next, head, iinc;
+   size_t num_levels = 0;
+   size_t num_placed = 0;
+
+   levels.assign( unknowns.size(), -1 );
+   level_rows.clear();
+   level_offsets.clear();
+
+   for ( row = 0 ; row < unknowns.size() ; row++ ) {
+      row_of[ unknowns[row] ] = row;
+   }
+
+   // Build the reverse edges (unknown -> unknowns depending on it) in CSR.
+   for ( row = 0 ; row < unknowns.size() ; row++ ) {
+      for ( iinc = row_offsets[row] ; iinc < row_offsets[row+1] ; iinc++ ) {
+         row_iter = row_of.find( columns[iinc] );
+         if ( (row_iter != row_of.end()) && (row_iter->second != row) ) {
+            dependent_offsets[ row_iter->second + 1 ]++;
+            in_degree[row]++;
+         }
+      }
+   }
+   for ( row = 0 ; row < unknowns.size() ; row++ ) {
+      dependent_offsets[row+1] += dependent_offsets[row];
+   }
+   dependents.resize( dependent_offsets.back() );
+   fill.assign( dependent_offsets.begin(), dependent_offsets.end() - 1 );
+   for ( row = 0 ; row < unknowns.size() ; row++ ) {
+      for ( iinc = row_offsets[row] ; iinc < row_offsets[row+1] ; iinc++ ) {
+         row_iter = row_of.find( columns[iinc] );
+         if ( (row_iter != row_of.end()) && (row_iter->second != row) ) {
+            dependents[ fill[row_iter->second]++ ] = row;
+         }
+      }
+   }
+
+   // Peel off the levels.
+   for ( row = 0 ; row < unknowns.size() ; row++ ) {
+      if ( in_degree[row] == 0 ) {
+         levels[row] = 0;
+         level_rows.push_back( row );
+      }
+   }
+   head = 0;
+   while ( head < level_rows.size() ) {
+      size_t level_end = level_rows.size();
+      level_offsets.push_back( head );
+      num_levels++;
+      for ( ; head < level_end ; head++ ) {
+         row = level_rows[head];
+         num_placed++;
+         for ( iinc = dependent_offsets[row] ; iinc < dependent_offsets[row+1] ; iinc++ ) {
+            next = dependents[iinc];
+            if ( --in_degree[next] == 0 ) {
+               levels[next] = (int)num_levels;
+               level_rows.push_back( next );
+            }
+         }
+      }
+   }
+   level_offsets.push_back( level_rows.size() );
+
+   return( num_placed == unknowns.size() );
+}
+
+
+/*!
+ * @brief Append the graph to a binary model description cache buffer.
+ *
+ * @param [inout] buffer Buffer to append the graph to.
+ */
+void TrickFMI::FMI2DependencyGraph::write_binary( std::string & buffer ) const
+{
+   write_binary_block( buffer, unknowns );
+   write_binary_block( buffer, all_flags );
+   write_binary_block( buffer, row_offsets );
+   write_binary_block( buffer, columns );
+   write_binary_block( buffer, kinds );
+   write_binary_block( buffer, levels );
+   write_binary_block( buffer, level_rows );
+   write_binary_block( buffer, level_offsets );
+   return;
+}
+
+
+/*!
+ * @brief Restore the graph from a binary model description cache buffer.
+ *
+ * @return Returns true on success.  On failure the graph is empty.
+ * @param [inout] data Read position, moved past the graph.
+ * @param [in]    end  End of the buffer.
+ */
+bool TrickFMI::FMI2DependencyGraph::read_binary(
+   const char ** data,
+   const char  * end )
+{
+   size_t num_rows;
+   size_t iinc;
+   bool valid;
+
+   valid =    read_binary_block( data, end, unknowns )
+           && read_binary_block( data, end, all_flags )
+           && read_binary_block( data, end, row_offsets )
+           && read_binary_block( data, end, columns )
+           && read_binary_block( data, end, kinds )
+           && read_binary_block( data, end, levels )
+           && read_binary_block( data, end, level_rows )
+           && read_binary_block( data, end, level_offsets );
+
+   // Check the CSR structure.
+   num_rows = unknowns.size();
+   valid = valid
+           && (all_flags.size() == num_rows)
+           && (row_offsets.size() == num_rows + 1)
+           && (row_offsets[0] == 0)
+           && (row_offsets[num_rows] == columns.size())
+           && (kinds.size() == columns.size())
+           && (levels.empty() || (levels.size() == num_rows))
+           && (level_rows.size() <= num_rows)
+           && (level_offsets.empty() || (level_offsets.back() == level_rows.size()));
+   for ( iinc = 0 ; valid && (iinc < num_rows) ; iinc++ ) {
+      valid = (row_offsets[iinc] <= row_offsets[iinc+1]);
+   }
+   for ( iinc = 0 ; valid && (iinc < level_rows.size()) ; iinc++ ) {
+      valid = (level_rows[iinc] < num_rows);
+   }
+   for ( iinc = 1 ; valid && (iinc < level_offsets.size()) ; iinc++ ) {
+      valid = (level_offsets[iinc-1] <= level_offsets[iinc]);
+   }
+
+   if ( !valid ) { clear(); }
+   return( valid );
+}
@@ -0,0 +1,225 @@
+/*******************************************************************************
+* Things that Trick looks for to trigger parsing and processing:
+* PURPOSE:
+* LIBRARY DEPENDENCY:
+*  ((FMI2DependencyGraph.o))
+********************************************************************************/
+/*!
+@file FMI2DependencyGraph.hh
+@ingroup FMITrickInterface
+@brief Definition of the FMI2DependencyGraph class.
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+
+*/
+
+#ifndef FMI2_DEPENDENCY_GRAPH_HH_
+#define FMI2_DEPENDENCY_GRAPH_HH_
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// TrickFMI namespace is used for everything in the TrickFMI repo
+namespace TrickFMI {
+
+//! Kind of a ModelStructure dependency (the dependenciesKind values).
+typedef enum {
+   FMI2Dependent,
+   FMI2DependsConstant,
+   FMI2DependsFixed,
+   FMI2DependsTunable,
+   FMI2DependsDiscrete
+} FMI2DependencyKind;
+
+/*!
+@class FMI2DependencyGraph
+@brief Defines the FMI2DependencyGraph class.
+
+The FMI2DependencyGraph class holds one of the ModelStructure dependency
+lists (Outputs, Derivatives or InitialUnknowns) of an FMU model description
+as a compressed sparse row (CSR) matrix.  Each row is an unknown and its
+columns are the variables it depends on.  Unknowns and dependencies are
+model variable indices (0 based positions in ModelVariables, see
+FMI2VariableTable).
+
+An unknown without a dependencies attribute may depend on all the known
+variables; depends_on_all() is true for these rows and they have no
+columns.
+
+Topological levels order the unknowns by their dependencies on other
+unknowns in the same graph: level 0 unknowns depend on no other unknowns
+in the graph, and level n unknowns depend only on unknowns in levels less
+than n.
+
+@trick_parse{everything}
+
+@tldh
+@trick_link_dependency{FMI2DependencyGraph.o}
+
+*/
+
+class FMI2DependencyGraph {
+
+  public:
+
+   // Default constructor.
+   FMI2DependencyGraph();
+
+   // Destructor.
+   ~FMI2DependencyGraph();
+
+   /*
+    * Functions used to build the graph.
+    */
+   void clear();
+   size_t add_row( int unknown, bool all_dependencies );
+   void add_dependency( int variable, FMI2DependencyKind kind );
+   bool compute_levels();
+
+   /*
+    * Functions used to save and restore the graph in the binary model
+    * description cache.
+    */
+   void write_binary( std::string & buffer ) const;
+   bool read_binary( const char ** data, const char * end );
+
+   /*
+    * Functions used to query the graph.
+    */
+   /*!
+    * @brief Get the number of unknowns (rows) in the graph.
+    * @return Number of unknowns.
+    */
+   size_t get_number_of_unknowns() const { return( unknowns.size() ); }
+
+   /*!
+    * @brief Get the number of dependencies (nonzeros) in the graph.
+    * @return Number of dependencies.
+    */
+   size_t get_number_of_dependencies() const { return( columns.size() ); }
+
+   /*!
+    * @brief Get the variable index of an unknown.
+    * @return Model variable index of the unknown.
+    * @param [in] row Unknown row.
+    */
+   int get_unknown( size_t row ) const { return( unknowns[row] ); }
+
+   int find_row( int variable ) const;
+
+   /*!
+    * @brief Check if an unknown may depend on all the known variables.
+    * @return True if the unknown has no dependencies attribute.
+    * @param [in] row Unknown row.
+    */
+   bool depends_on_all( size_t row ) const { return( all_flags[row] != 0 ); }
+
+   /*!
+    * @brief Get the number of dependencies of an unknown.
+    * @return Number of dependencies.
+    * @param [in] row Unknown row.
+    */
+   size_t get_number_of_dependencies( size_t row ) const {
+      return( row_offsets[row+1] - row_offsets[row] );
+   }
+
+   /*!
+    * @brief Get the dependencies of an unknown.
+    * @return Pointer to the model variable indices the unknown depends on.
+    * @param [in] row Unknown row.
+    */
+   const int * get_dependencies( size_t row ) const {
+      return( columns.empty() ? NULL : &columns[0] + row_offsets[row] );
+   }
+
+   /*!
+    * @brief Get the dependency kinds of an unknown.
+    * @return Pointer to the FMI2DependencyKind of each dependency.
+    * @param [in] row Unknown row.
+    */
+   const unsigned char * get_dependency_kinds( size_t row ) const {
+      return( kinds.empty() ? NULL : &kinds[0] + row_offsets[row] );
+   }
+
+   /*
+    * Raw CSR arrays.
+    */
+   /*!
+    * @brief Get the CSR row offsets (number of unknowns + 1 entries).
+    * @return Pointer to the row offsets.
+    */
+   const size_t * get_row_offsets() const { return( &row_offsets[0] ); }
+
+   /*!
+    * @brief Get the CSR column indices (model variable indices).
+    * @return Pointer to the column indices.
+    */
+   const int * get_columns() const {
+      return( columns.empty() ? NULL : &columns[0] );
+   }
+
+   /*!
+    * @brief Get the number of topological levels.
+    * @return Number of levels (0 if the levels have not been computed).
+    */
+   size_t get_number_of_levels() const {
+      return( level_offsets.empty() ? 0 : level_offsets.size() - 1 );
+   }
+
+   /*!
+    * @brief Get the topological level of an unknown.
+    * @return Level of the unknown.
+    * @param [in] row Unknown row.
+    */
+   int get_level( size_t row ) const { return( levels[row] ); }
+
+   /*!
+    * @brief Get the unknowns in a topological level.
+    * @return Pointer to the rows in the level.
+    * @param [in]  level Topological level.
+    * @param [out] count Number of rows in the level.
+    */
+   const size_t * get_level_rows( size_t level, size_t * count ) const {
+      *count = level_offsets[level+1] - level_offsets[level];
+      return( &level_rows[0] + level_offsets[level] );
+   }
+
+  protected:
+
+   std::vector<int>           unknowns;    //!< @trick_io{**} Unknown variable index of each row.
+   std::vector<unsigned char> all_flags;   //!< @trick_io{**} Row depends on all knowns flags.
+   std::vector<size_t>        row_offsets; //!< @trick_io{**} CSR row offsets.
+   std::vector<int>           columns;     //!< @trick_io{**} CSR dependency variable indices.
+   std::vector<unsigned char> kinds;       //!< @trick_io{**} CSR FMI2DependencyKind values.
+
+   std::vector<int>    levels;        //!< @trick_io{**} Topological level of each row.
+   std::vector<size_t> level_rows;    //!< @trick_io{**} Rows sorted by level.
+   std::vector<size_t> level_offsets; //!< @trick_io{**} Offsets of each level in level_rows.
+
+  private:
+
+   /*!
+    * @brief Copy constructor not implemented.
+    *
+    * The copy constructor is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2DependencyGraph (const FMI2DependencyGraph &);
+
+   /*!
+    * @brief Assignment operator not implemented.
+    *
+    * The assignment operator is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2DependencyGraph & operator= (const FMI2DependencyGraph &);
+
+};
+
+} // End TrickFMI namespace.
+
+#endif /* FMI2_DEPENDENCY_GRAPH_HH_ */
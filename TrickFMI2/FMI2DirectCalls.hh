@@ -0,0 +1,251 @@
+/*!
+@file FMI2DirectCalls.hh
+@ingroup FMITrickInterface
+@brief Statically dispatched FMI calls for host integration loops.
+
+The FMI functions of FMI2ModelBase are virtual and check that the FMU
+function is bound on every call.  FMI2DirectCalls binds the FMU instance
+and the functions used in tight host loops once, checks them at bind time
+and provides non-virtual inline calls straight to the FMU functions.  The
+calls available depend on the model class the template is instantiated
+with; the Model Exchange specialization adds the continuous state calls.
+
+@code
+TrickFMI::FMI2DirectCalls< TrickFMI::FMI2ModelExchangeModel > direct;
+
+fmu.fmi2Instantiate( ... );
+if ( direct.bind( fmu ) != fmi2OK ) { ... }
+for ( ... ) {
+   direct.fmi2SetContinuousStates( x, nx );
+   direct.fmi2GetDerivatives( dx, nx );
+}
+@endcode
+
+Direct calls bypass the model object.  In particular the Model Exchange
+time is not set through them; use the model object for fmi2SetTime, event
+handling and fmi2DoStep.  The binding refers to the current FMU instance;
+bind again after the model is reloaded, reinstantiated or swapped (see
+FMI2ModelBase::swap_fmu()).
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+
+*/
+
+#ifndef FMI2_DIRECT_CALLS_HH_
+#define FMI2_DIRECT_CALLS_HH_
+
+#include <stddef.h>
+#include <iostream>
+
+#include "fmi2FunctionTypes.h"
+
+#include "FMI2ModelBase.hh"
+#include "FMI2ModelExchangeModel.hh"
+
+// TrickFMI namespace is used for everything in the TrickFMI repo
+namespace TrickFMI {
+
+/*!
+@class FMI2DirectCalls
+@brief Direct FMI calls common to all model classes.
+
+@tparam Model Model class the calls are bound from.
+*/
+template< class Model >
+class FMI2DirectCalls {
+
+  public:
+
+   //! Default constructor.
+   FMI2DirectCalls()
+   : component(NULL), get_real(NULL), set_real(NULL)
+   {
+   }
+
+   /*!
+    * @brief Bind the calls to the current FMU instance of a model.
+    *
+    * @return Returns fmi2OK or fmi2Error if the model is not instantiated
+    * or a function is not bound.  On error no calls are bound.
+    * @param [in] model Loaded and instantiated model object.
+    */
+   fmi2Status bind( Model & model )
+   {
+      return( bind_base( model ) );
+   }
+
+   /*!
+    * @brief Check if the calls are bound.
+    * @return True if bound.
+    */
+   bool is_bound() const { return( component != NULL ); }
+
+   //! Get real values (see FMI2ModelBase::fmi2GetReal()).
+   fmi2Status fmi2GetReal(
+      const fmi2ValueReference vr[],
+            size_t             nvr,
+            fmi2Real           value[] ) const
+   {
+      return( get_real( component, vr, nvr, value ) );
+   }
+
+   //! Set real values (see FMI2ModelBase::fmi2SetReal()).
+   fmi2Status fmi2SetReal(
+      const fmi2ValueReference vr[],
+            size_t             nvr,
+      const fmi2Real           value[] ) const
+   {
+      return( set_real( component, vr, nvr, value ) );
+   }
+
+  protected:
+
+   fmi2Component      component;   //!< @trick_io{**} Bound FMU instance.
+   fmi2GetRealTYPE (* get_real);   //!< @trick_io{**} Bound fmi2GetReal.
+   fmi2SetRealTYPE (* set_real);   //!< @trick_io{**} Bound fmi2SetReal.
+
+   /*!
+    * @brief Bind the calls common to all model classes.
+    *
+    * @return Returns fmi2OK or fmi2Error if the model is not instantiated
+    * or a function is not bound.
+    * @param [in] model Loaded and instantiated model object.
+    */
+   fmi2Status bind_base( FMI2ModelBase & model )
+   {
+      component = NULL;
+      get_real  = model.get_real;
+      set_real  = model.set_real;
+      if ( (get_real == NULL) || (set_real == NULL) ) {
+         std::cerr << "FMU functions are not bound." << std::endl;
+         return( fmi2Error );
+      }
+      if ( model.component == NULL ) {
+         std::cerr << "FMU is not instantiated." << std::endl;
+         return( fmi2Error );
+      }
+      component = model.component;
+      return( fmi2OK );
+   }
+
+  private:
+
+   /*!
+    * @brief Copy constructor not implemented.
+    *
+    * The copy constructor is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2DirectCalls (const FMI2DirectCalls &);
+
+   /*!
+    * @brief Assignment operator not implemented.
+    *
+    * The assignment operator is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2DirectCalls & operator= (const FMI2DirectCalls &);
+
+};
+
+
+/*!
+@class FMI2DirectCalls<FMI2ModelExchangeModel>
+@brief Direct FMI calls for Model Exchange models.
+
+Adds the continuous state and event indicator calls made every integration
+step.
+*/
+template<>
+class FMI2DirectCalls< FMI2ModelExchangeModel >
+: public FMI2DirectCalls< FMI2ModelBase >
+{
+
+  public:
+
+   //! Default constructor.
+   FMI2DirectCalls()
+   : set_continuous_states(NULL), get_continuous_states(NULL),
+     get_derivatives(NULL), get_event_indicators(NULL)
+   {
+   }
+
+   /*!
+    * @brief Bind the calls to the current FMU instance of a model.
+    *
+    * @return Returns fmi2OK or fmi2Error if the model is not instantiated
+    * or a function is not bound.  On error no calls are bound.
+    * @param [in] model Loaded and instantiated model object.
+    */
+   fmi2Status bind( FMI2ModelExchangeModel & model )
+   {
+      set_continuous_states = model.set_continuous_states;
+      get_continuous_states = model.get_continuous_states;
+      get_derivatives       = model.get_derivatives;
+      get_event_indicators  = model.get_event_indicators;
+      if (    (set_continuous_states == NULL) || (get_continuous_states == NULL)
+           || (get_derivatives == NULL) || (get_event_indicators == NULL) ) {
+         std::cerr << "FMU functions are not bound." << std::endl;
+         component = NULL;
+         return( fmi2Error );
+      }
+      return( bind_base( model ) );
+   }
+
+   //! Set the continuous states (see FMI2ModelExchangeModel::fmi2SetContinuousStates()).
+   fmi2Status fmi2SetContinuousStates( const fmi2Real x[], size_t nx ) const
+   {
+      return( set_continuous_states( component, x, nx ) );
+   }
+
+   //! Get the continuous states (see FMI2ModelExchangeModel::fmi2GetContinuousStates()).
+   fmi2Status fmi2GetContinuousStates( fmi2Real x[], size_t nx ) const
+   {
+      return( get_continuous_states( component, x, nx ) );
+   }
+
+   //! Get the state derivatives (see FMI2ModelExchangeModel::fmi2GetDerivatives()).
+   fmi2Status fmi2GetDerivatives( fmi2Real derivatives[], size_t nx ) const
+   {
+      return( get_derivatives( component, derivatives, nx ) );
+   }
+
+   //! Get the event indicators (see FMI2ModelExchangeModel::fmi2GetEventIndicators()).
+   fmi2Status fmi2GetEventIndicators( fmi2Real eventIndicators[], size_t ni ) const
+   {
+      return( get_event_indicators( component, eventIndicators, ni ) );
+   }
+
+  protected:
+
+   fmi2SetContinuousStatesTYPE (* set_continuous_states); //!< @trick_io{**} Bound fmi2SetContinuousStates.
+   fmi2GetContinuousStatesTYPE (* get_continuous_states); //!< @trick_io{**} Bound fmi2GetContinuousStates.
+   fmi2GetDerivativesTYPE      (* get_derivatives);       //!< @trick_io{**} Bound fmi2GetDerivatives.
+   fmi2GetEventIndicatorsTYPE  (* get_event_indicators);  //!< @trick_io{**} Bound fmi2GetEventIndicators.
+
+  private:
+
+   /*!
+    * @brief Copy constructor not implemented.
+    *
+    * The copy constructor is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2DirectCalls (const FMI2DirectCalls &);
+
+   /*!
+    * @brief Assignment operator not implemented.
+    *
+    * The assignment operator is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2DirectCalls & operator= (const FMI2DirectCalls &);
+
+};
+
+} // End TrickFMI namespace.
+
+#endif /* FMI2_DIRECT_CALLS_HH_ */
@@ -0,0 +1,413 @@
+/**
+@file FMI2Ensemble.cc
+@ingroup FMITrickInterface
+@brief Method implementations for the FMI2Ensemble class
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+
+*/
+
+#include <iostream>
+#include <map>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "FMI2Ensemble.hh"
+
+
+//! Default constructor.
+TrickFMI::FMI2Ensemble::FMI2Ensemble()
+: number_of_processes(0), result_size(0),
+  shared_buffer(NULL), shared_buffer_size(0), slots(NULL), results(NULL)
+{
+}
+
+
+//! Destructor.
+TrickFMI::FMI2Ensemble::~FMI2Ensemble()
+{
+   this->release_shared_buffer();
+}
+
+
+//! Remove all the runs and their results.
+void TrickFMI::FMI2Ensemble::clear()
+{
+   this->runs.clear();
+   this->release_shared_buffer();
+   return;
+}
+
+
+/*!
+ * @brief Set the number of runs performed at once.
+ *
+ * @param [in] processes Number of concurrent child processes; 0 uses the
+ * number of online processors.
+ */
+void TrickFMI::FMI2Ensemble::set_number_of_processes( unsigned int processes )
+{
+   this->number_of_processes = processes;
+   return;
+}
+
+
+/*!
+ * @brief Set the number of results each run returns.
+ *
+ * This discards the results of the previous ensemble runs.
+ *
+ * @param [in] size Number of run results.
+ */
+void TrickFMI::FMI2Ensemble::set_result_size( size_t size )
+{
+   this->release_shared_buffer();
+   this->result_size = size;
+   return;
+}
+
+
+/*!
+ * @brief Add a run to the ensemble.
+ *
+ * This discards the results of the previous ensemble runs.
+ *
+ * @return Returns the index of the new run.
+ */
+size_t TrickFMI::FMI2Ensemble::add_run()
+{
+   this->release_shared_buffer();
+   this->runs.push_back( std::vector<RunValue>() );
+   return( this->runs.size() - 1 );
+}
+
+
+/*!
+ * @brief Set a variable value for a run.
+ *
+ * The value is set in the run process before the run function is called.
+ * Integer, Enumeration and Boolean variables take the value converted to
+ * their type.
+ *
+ * @return Returns fmi2OK or fmi2Error if the run index is out of range.
+ * @param [in] run   Run index.
+ * @param [in] name  Model variable name.
+ * @param [in] value Variable value.
+ */
+fmi2Status TrickFMI::FMI2Ensemble::set_run_value(
+         size_t   run,
+   const char   * name,
+         double   value )
+{
+   RunValue run_value;
+
+   if ( run >= this->runs.size() ) {
+      return( fmi2Error );
+   }
+   run_value.name  = name;
+   run_value.value = value;
+   this->runs[run].push_back( run_value );
+
+   return( fmi2OK );
+}
+
+
+/*!
+ * @brief Perform the ensemble runs.
+ *
+ * Each run is a child process forked from the calling process, so it
+ * starts from the current state of the model.  The child sets the run
+ * values, calls the run function and writes the run status and results to
+ * shared memory.  This routine returns after all the runs have finished.
+ *
+ * @return Returns fmi2OK if all the runs succeeded or the most severe run
+ * status otherwise.  Use get_run_status() to check an individual run.  A
+ * run whose process died or that never finished (for example, because a
+ * fork or wait failed) is fmi2Fatal.
+ * @param [inout] model    Loaded and instantiated model object.
+ * @param [in]    function Function that performs a run.
+ * @param [in]    data     User data passed to the run function.
+ */
+fmi2Status TrickFMI::FMI2Ensemble::run(
+   FMI2ModelBase        & model,
+   FMI2EnsembleFunction   function,
+   void                 * data      )
+{
+   const FMI2VariableTable & variables = model.get_variables();
+   std::map<pid_t, size_t> active;
+   std::map<pid_t, size_t>::iterator active_iter;
+   unsigned int process_count;
+   fmi2Status status = fmi2OK;
+   size_t next_run;
+   size_t iinc, jinc;
+   long num_cpus;
+   double start_time;
+   pid_t pid;
+   int wait_status;
+
+   // Check the run values before starting any runs.
+   for ( iinc = 0 ; iinc < this->runs.size() ; iinc++ ) {
+      for ( jinc = 0 ; jinc < this->runs[iinc].size() ; jinc++ ) {
+         if ( variables.find( this->runs[iinc][jinc].name.c_str() ) < 0 ) {
+            std::cerr << "Unknown model variable: "
+                      << this->runs[iinc][jinc].name << std::endl;
+            return( fmi2Error );
+         }
+      }
+   }
+
+   // Map the shared run slots and results.
+   this->release_shared_buffer();
+   if ( this->runs.empty() ) {
+      return( fmi2OK );
+   }
+   this->shared_buffer_size = this->runs.size()
+                            * (sizeof(RunSlot) + this->result_size * sizeof(double));
+   this->shared_buffer = mmap( NULL, this->shared_buffer_size,
+                               PROT_READ | PROT_WRITE,
+                               MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+   if ( this->shared_buffer == MAP_FAILED ) {
+      perror( "Error mapping the ensemble results" );
+      this->shared_buffer = NULL;
+      this->shared_buffer_size = 0;
+      return( fmi2Fatal );
+   }
+   this->slots   = (RunSlot *)this->shared_buffer;
+   this->results = (double *)(this->slots + this->runs.size());
+   for ( iinc = 0 ; iinc < this->runs.size() ; iinc++ ) {
+      this->slots[iinc].status   = fmi2Pending;
+      this->slots[iinc].finished = 0;
+      this->slots[iinc].run_time = 0.0;
+   }
+
+   // Determine the number of concurrent runs.
+   process_count = this->number_of_processes;
+   if ( process_count == 0 ) {
+      num_cpus = sysconf( _SC_NPROCESSORS_ONLN );
+      process_count = (num_cpus > 0) ? (unsigned int)num_cpus : 1;
+   }
+
+   // Buffered output would be written again by every child.
+   fflush( NULL );
+   std::cout.flush();
+   std::cerr.flush();
+
+   next_run = 0;
+   while ( (next_run < this->runs.size()) || !active.empty() ) {
+
+      // Start runs until the process limit is reached.
+      while ( (next_run < this->runs.size()) && (active.size() < process_count) ) {
+
+         pid = fork();
+         if ( pid == 0 ) {
+
+            // Child: perform the run from the inherited model state.
+            RunSlot & slot = this->slots[next_run];
+            start_time = FMI2StartupReport::get_time();
+            slot.status = set_run_values( model, this->runs[next_run] );
+            if ( slot.status <= fmi2Warning ) {
+               slot.status = function( model, next_run,
+                                       this->results + next_run * this->result_size,
+                                       this->result_size, data );
+            }
+            slot.run_time = FMI2StartupReport::get_time() - start_time;
+            slot.finished = 1;
+            fflush( NULL );
+            _exit( 0 );
+
+         }
+         if ( pid < 0 ) {
+            perror( "Error forking an ensemble run" );
+            if ( active.empty() ) {
+               // Nothing will finish to make room; fail the remaining runs.
+               for ( ; next_run < this->runs.size() ; next_run++ ) {
+                  this->slots[next_run].status = fmi2Fatal;
+               }
+            }
+            break;
+         }
+         active[pid] = next_run;
+         next_run++;
+
+      }
+
+      // Wait for a run to finish.
+      if ( active.empty() ) {
+         continue;
+      }
+      pid = waitpid( -1, &wait_status, 0 );
+      if ( pid < 0 ) {
+         if ( errno == EINTR ) {
+            continue;
+         }
+         perror( "Error waiting for an ensemble run" );
+         break;
+      }
+      active_iter = active.find( pid );
+      if ( active_iter == active.end() ) {
+         continue;
+      }
+      if (    !this->slots[active_iter->second].finished
+           || !WIFEXITED( wait_status ) ) {
+         std::cerr << "Ensemble run " << active_iter->second
+                   << " did not finish." << std::endl;
+         this->slots[active_iter->second].status = fmi2Fatal;
+      }
+      active.erase( active_iter );
+
+   }
+
+   // Combine the run status.  Runs left unfinished by a wait failure
+   // are failed.
+   for ( iinc = 0 ; iinc < this->runs.size() ; iinc++ ) {
+      if ( !this->slots[iinc].finished && (this->slots[iinc].status != fmi2Fatal) ) {
+         std::cerr << "Ensemble run " << iinc << " did not finish." << std::endl;
+         this->slots[iinc].status = fmi2Fatal;
+      }
+      if ( this->slots[iinc].status > status ) {
+         status = (fmi2Status)this->slots[iinc].status;
+      }
+   }
+
+   return( status );
+}
+
+
+/*!
+ * @brief Set the variable values of a run.
+ *
+ * The values are set with one call per type.
+ *
+ * @param [inout] model  Model object of the run.
+ * @param [in]    values Variable values of the run.
+ */
+fmi2Status TrickFMI::FMI2Ensemble::set_run_values(
+         FMI2ModelBase         & model,
+   const std::vector<RunValue> & values )
+{
+   const FMI2VariableTable & variables = model.get_variables();
+   std::vector<fmi2ValueReference> real_refs, integer_refs, boolean_refs;
+   std::vector<fmi2Real>    reals;
+   std::vector<fmi2Integer> integers;
+   std::vector<fmi2Boolean> booleans;
+   fmi2Status status = fmi2OK;
+   fmi2Status set_status;
+   FMI2VariableType type;
+   size_t iinc;
+   int index;
+
+   // Sort the values by type.
+   for ( iinc = 0 ; iinc < values.size() ; iinc++ ) {
+      index = variables.find( values[iinc].name.c_str() );
+      type  = variables.get_type( index );
+      if ( type == FMI2Real ) {
+         real_refs.push_back( variables.get_value_reference( index ) );
+         reals.push_back( values[iinc].value );
+      }
+      else if ( (type == FMI2Integer) || (type == FMI2Enumeration) ) {
+         integer_refs.push_back( variables.get_value_reference( index ) );
+         integers.push_back( (fmi2Integer)values[iinc].value );
+      }
+      else if ( type == FMI2Boolean ) {
+         boolean_refs.push_back( variables.get_value_reference( index ) );
+         booleans.push_back( (values[iinc].value != 0.0) ? fmi2True : fmi2False );
+      }
+      else {
+         std::cerr << "Not a numeric model variable: "
+                   << values[iinc].name << std::endl;
+         status = fmi2Error;
+      }
+   }
+
+   // Set the values with one call per type.
+   if ( !real_refs.empty() ) {
+      set_status = model.fmi2SetReal( &real_refs[0], real_refs.size(), &reals[0] );
+      if ( set_status > status ) { status = set_status; }
+   }
+   if ( !integer_refs.empty() ) {
+      set_status = model.fmi2SetInteger( &integer_refs[0], integer_refs.size(), &integers[0] );
+      if ( set_status > status ) { status = set_status; }
+   }
+   if ( !boolean_refs.empty() ) {
+      set_status = model.fmi2SetBoolean( &boolean_refs[0], boolean_refs.size(), &booleans[0] );
+      if ( set_status > status ) { status = set_status; }
+   }
+
+   return( status );
+}
+
+
+/*!
+ * @brief Get the status of a run.
+ *
+ * @return Returns the run status, fmi2Pending if the run has not been
+ * performed, or fmi2Error if the run index is out of range.
+ * @param [in] run Run index.
+ */
+fmi2Status TrickFMI::FMI2Ensemble::get_run_status( size_t run ) const
+{
+   if ( run >= this->runs.size() ) {
+      return( fmi2Error );
+   }
+   if ( this->slots == NULL ) {
+      return( fmi2Pending );
+   }
+   return( (fmi2Status)this->slots[run].status );
+}
+
+
+/*!
+ * @brief Get the wall clock time of a run.
+ *
+ * @return Returns the time spent in the run process setting the run values
+ * and in the run function, or zero if the run has not been performed.
+ * @param [in] run Run index.
+ */
+double TrickFMI::FMI2Ensemble::get_run_time( size_t run ) const
+{
+   if ( (run >= this->runs.size()) || (this->slots == NULL) ) {
+      return( 0.0 );
+   }
+   return( this->slots[run].run_time );
+}
+
+
+/*!
+ * @brief Get the results of a run.
+ *
+ * The results remain valid until the ensemble runs are changed or run
+ * again.
+ *
+ * @return Returns the run results or NULL if the run has not been
+ * performed.
+ * @param [in] run Run index.
+ */
+const double * TrickFMI::FMI2Ensemble::get_results( size_t run ) const
+{
+   if ( (run >= this->runs.size()) || (this->results == NULL) ) {
+      return( NULL );
+   }
+   return( this->results + run * this->result_size );
+}
+
+
+//! Unmap the shared run slots and results.
+void TrickFMI::FMI2Ensemble::release_shared_buffer()
+{
+   if ( this->shared_buffer != NULL ) {
+      munmap( this->shared_buffer, this->shared_buffer_size );
+   }
+   this->shared_buffer      = NULL;
+   this->shared_buffer_size = 0;
+   this->slots              = NULL;
+   this->results            = NULL;
+   return;
+}
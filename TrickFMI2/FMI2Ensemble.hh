@@ -0,0 +1,196 @@
+/*******************************************************************************
+* Things that Trick looks for to trigger parsing and processing:
+* PURPOSE:
+* LIBRARY DEPENDENCY:
+*  ((FMI2Ensemble.o))
+********************************************************************************/
+/*!
+@file FMI2Ensemble.hh
+@ingroup FMITrickInterface
+@brief Definition of the FMI2Ensemble class.
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+
+*/
+
+#ifndef FMI2_ENSEMBLE_HH_
+#define FMI2_ENSEMBLE_HH_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "fmi2FunctionTypes.h"
+
+#include "FMI2ModelBase.hh"
+
+// TrickFMI namespace is used for everything in the TrickFMI repo
+namespace TrickFMI {
+
+/*!
+ * @brief Function that performs one ensemble run.
+ *
+ * This is called in the child process for the run with the model in the
+ * state it had when FMI2Ensemble::run() was called and the run values set.
+ *
+ * @return Run status.
+ * @param [inout] model       Model object of the run.
+ * @param [in]    run         Run index.
+ * @param [out]   results     Run results returned to the parent.
+ * @param [in]    result_size Number of run results.
+ * @param [in]    data        User data passed to FMI2Ensemble::run().
+ */
+typedef fmi2Status (*FMI2EnsembleFunction)(
+   FMI2ModelBase & model,
+   size_t          run,
+   double          results[],
+   size_t          result_size,
+   void          * data        );
+
+/*!
+@class FMI2Ensemble
+@brief Defines the FMI2Ensemble class.
+
+The FMI2Ensemble class runs an ensemble of runs (for example a Monte Carlo
+set) from one loaded and initialized FMU.  The FMU is loaded, instantiated
+and brought to a common starting state once.  Each run is then a forked
+child process that starts from a copy-on-write image of that state, sets
+its own variable values and performs the run.  The run results are written
+to a shared memory buffer read by the parent.  A run costs a fork instead
+of loading, instantiating and initializing the FMU.
+
+The run values are set with fmi2SetReal, fmi2SetInteger and fmi2SetBoolean;
+so, the common state must be one where those variables can be set.  To
+vary fixed parameters, call run() in initialization mode and let the run
+function exit initialization mode:
+
+@code
+ensemble.set_result_size( 4 );
+for ( run = 0 ; run < 1000 ; run++ ) {
+   ensemble.add_run();
+   ensemble.set_run_value( run, "x1", 5.0 + 0.01 * run );
+}
+fmu.fmi2EnterInitializationMode();
+ensemble.run( fmu, ball_run, NULL );
+@endcode
+
+The run function must not depend on threads started before the fork, such
+as FMU worker threads.  Runs end with _exit(); the child never runs the
+model object destructor and never cleans up the unpacked FMU.
+
+@trick_parse{everything}
+
+@tldh
+@trick_link_dependency{FMI2Ensemble.o}
+
+*/
+
+class FMI2Ensemble {
+
+  public:
+
+   // Default constructor.
+   FMI2Ensemble();
+
+   // Destructor.
+   ~FMI2Ensemble();
+
+   void clear();
+   void set_number_of_processes( unsigned int processes );
+   void set_result_size( size_t size );
+
+   /*
+    * Functions used to set up the runs.
+    */
+   size_t add_run();
+   fmi2Status set_run_value( size_t run, const char * name, double value );
+
+   /*
+    * Function used to perform the runs.
+    */
+   fmi2Status run( FMI2ModelBase        & model,
+                   FMI2EnsembleFunction   function,
+                   void                 * data      );
+
+   /*
+    * Functions used to get the run results.
+    */
+   fmi2Status get_run_status( size_t run ) const;
+   double get_run_time( size_t run ) const;
+   const double * get_results( size_t run ) const;
+
+   /*!
+    * @brief Get the number of runs in the ensemble.
+    * @return Number of runs.
+    */
+   size_t get_number_of_runs() const { return( runs.size() ); }
+
+   /*!
+    * @brief Get the number of results of each run.
+    * @return Number of run results.
+    */
+   size_t get_result_size() const { return( result_size ); }
+
+  protected:
+
+   /*!
+   @brief A variable value set by a run.
+   */
+   struct RunValue {
+      std::string name;  /**< @trick_units{--} Variable name. */
+      double      value; /**< @trick_units{--} Variable value. */
+   };
+
+   /*!
+   @brief Run status written by the child process to shared memory.
+   */
+   struct RunSlot {
+      int32_t status;   /**< @trick_units{--} Run status. */
+      int32_t finished; /**< @trick_units{--} The run function returned. */
+      double  run_time; /**< @trick_units{s} Run wall clock time. */
+   };
+
+   std::vector< std::vector<RunValue> > runs; //!< @trick_io{**} Variable values of each run.
+
+   unsigned int number_of_processes; /**< @trick_units{--} @n
+      Number of concurrent runs; 0 uses the number of online processors. */
+
+   size_t result_size; //!< @trick_units{--} Number of results of each run.
+
+   void * shared_buffer;        //!< @trick_io{**} Shared run slots and results.
+   size_t shared_buffer_size;   //!< @trick_units{--} Size of the shared buffer in bytes.
+   RunSlot * slots;             //!< @trick_io{**} Run slots in the shared buffer.
+   double  * results;           //!< @trick_io{**} Run results in the shared buffer.
+
+   void release_shared_buffer();
+
+   static fmi2Status set_run_values( FMI2ModelBase               & model,
+                                     const std::vector<RunValue> & values );
+
+  private:
+
+   /*!
+    * @brief Copy constructor not implemented.
+    *
+    * The copy constructor is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2Ensemble (const FMI2Ensemble &);
+
+   /*!
+    * @brief Assignment operator not implemented.
+    *
+    * The assignment operator is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2Ensemble & operator= (const FMI2Ensemble &);
+
+};
+
+} // End TrickFMI namespace.
+
+#endif /* FMI2_ENSEMBLE_HH_ */
@@ -0,0 +1,824 @@
+/**
+@file FMI2FMUCatalog.cc
+@ingroup FMITrickInterface
+@brief Method implementations for the FMI2FMUCatalog class
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+
+*/
+
+#include <algorithm>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <map>
+#include <set>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <archive.h>
+#include <archive_entry.h>
+
+#include "FMI2BinaryBlock.hh"
+#include "FMI2FMUCatalog.hh"
+
+//! Catalog index file identification string.
+static const char catalog_magic[8] = { 'T', 'F', 'M', 'I', '2', 'C', 'A', 'T' };
+
+//! Catalog index file format version.  Change this whenever the layout changes.
+static const uint32_t catalog_version = 1;
+
+//! Value used to detect an index file written with a different byte order.
+static const uint32_t catalog_byte_order = 0x01020304;
+
+//! Catalog index file header.
+typedef struct {
+   char     magic[8];     //!< Index file identification string.
+   uint32_t version;      //!< Index file format version.
+   uint32_t byte_order;   //!< Byte order check value.
+   uint32_t record_size;  //!< Size of FMI2CatalogRecord in bytes.
+   uint32_t padding;      //!< Unused.
+   uint64_t file_size;    //!< Size of the index file.
+   uint64_t payload_hash; //!< Hash of the index file after the header.
+} CatalogHeader;
+
+//! Binaries directory names and their architecture flags.
+static const struct {
+   const char * name;
+   unsigned int flag;
+} architecture_names[] = {
+   { "win32",         TrickFMI::FMI2CatalogWin32 },
+   { "win64",         TrickFMI::FMI2CatalogWin64 },
+   { "linux32",       TrickFMI::FMI2CatalogLinux32 },
+   { "linux64",       TrickFMI::FMI2CatalogLinux64 },
+   { "darwin32",      TrickFMI::FMI2CatalogDarwin32 },
+   { "darwin64",      TrickFMI::FMI2CatalogDarwin64 },
+   { "darwin_arm64",  TrickFMI::FMI2CatalogDarwinArm64 },
+   { "darwin_x86_64", TrickFMI::FMI2CatalogDarwinX86_64 }
+};
+
+
+/*!
+ * @brief Fill in a catalog index file header for the current build.
+ *
+ * @param [out] header Header to fill in.
+ */
+static void init_catalog_header( CatalogHeader * header )
+{
+   memset( header, 0, sizeof(CatalogHeader) );
+   memcpy( header->magic, catalog_magic, sizeof(catalog_magic) );
+   header->version     = catalog_version;
+   header->byte_order  = catalog_byte_order;
+   header->record_size = sizeof(TrickFMI::FMI2CatalogRecord);
+   return;
+}
+
+
+/*!
+ * @brief Collect the FMU files below a directory.
+ *
+ * @return Returns 0 on success or -1 if a directory could not be read.
+ * @param [in]    directory Directory to search.
+ * @param [inout] paths     List the FMU file paths are appended to.
+ */
+static int find_fmu_files(
+   const std::string              & directory,
+         std::vector<std::string> & paths     )
+{
+   DIR * dir;
+   struct dirent * entry;
+   struct stat path_stat;
+   std::string path;
+   size_t length;
+   int status = 0;
+
+   dir = opendir( directory.c_str() );
+   if ( dir == NULL ) {
+      perror( directory.c_str() );
+      return( -1 );
+   }
+
+   while ( (entry = readdir( dir )) != NULL ) {
+      if ( !strcmp( entry->d_name, "." ) || !strcmp( entry->d_name, ".." ) ) {
+         continue;
+      }
+      path = directory + "/" + entry->d_name;
+      if ( stat( path.c_str(), &path_stat ) != 0 ) {
+         continue;
+      }
+      length = strlen( entry->d_name );
+      if ( S_ISDIR( path_stat.st_mode ) ) {
+         if ( find_fmu_files( path, paths ) ) { status = -1; }
+      }
+      else if (    S_ISREG( path_stat.st_mode ) && (length > 4)
+                && !strcmp( entry->d_name + length - 4, ".fmu" ) ) {
+         paths.push_back( path );
+      }
+   }
+   closedir( dir );
+
+   return( status );
+}
+
+
+//! Default constructor.
+TrickFMI::FMI2FMUCatalog::FMI2FMUCatalog()
+: number_of_threads(0), next_request(0)
+{
+   pthread_mutex_init( &request_mutex, NULL );
+}
+
+
+//! Destructor.
+TrickFMI::FMI2FMUCatalog::~FMI2FMUCatalog()
+{
+   pthread_mutex_destroy( &request_mutex );
+}
+
+
+//! Remove all the catalog entries.
+void TrickFMI::FMI2FMUCatalog::clear()
+{
+   this->records.clear();
+   this->string_data.clear();
+   return;
+}
+
+
+/*!
+ * @brief Set the number of worker threads.
+ *
+ * @param [in] threads Number of worker threads; 0 uses the number of online
+ * processors.
+ */
+void TrickFMI::FMI2FMUCatalog::set_number_of_threads( unsigned int threads )
+{
+   this->number_of_threads = threads;
+   return;
+}
+
+
+/*!
+ * @brief Get the architecture flag of a binaries directory name.
+ *
+ * @return Returns the FMI2CatalogArchitecture flag or FMI2CatalogOtherArch
+ * if the name is not a known platform.
+ * @param [in] name Binaries directory name (for example "linux64").
+ */
+unsigned int TrickFMI::FMI2FMUCatalog::architecture_flag( const char * name )
+{
+   size_t iinc;
+
+   for ( iinc = 0 ; iinc < sizeof(architecture_names)/sizeof(architecture_names[0]) ; iinc++ ) {
+      if ( !strcmp( name, architecture_names[iinc].name ) ) {
+         return( architecture_names[iinc].flag );
+      }
+   }
+   return( FMI2CatalogOtherArch );
+}
+
+
+/*!
+ * @brief Convert the capability flags of a modality to catalog flags.
+ *
+ * @return FMI2CatalogCapability flags.
+ * @param [in] capabilities Capability flags of the modality.
+ */
+unsigned int TrickFMI::FMI2FMUCatalog::capability_flags(
+   const FMI2Capabilities & capabilities )
+{
+   unsigned int flags = 0;
+
+   if ( capabilities.needs_execution_tool ) {
+      flags |= FMI2CatalogNeedsExecutionTool;
+   }
+   if ( capabilities.can_be_instantiated_only_once_per_process ) {
+      flags |= FMI2CatalogInstantiatedOnlyOncePerProcess;
+   }
+   if ( capabilities.can_not_use_memory_management_functions ) {
+      flags |= FMI2CatalogNoMemoryManagementFunctions;
+   }
+   if ( capabilities.can_get_and_set_fmu_state ) {
+      flags |= FMI2CatalogGetAndSetFMUstate;
+   }
+   if ( capabilities.can_serialize_fmu_state ) {
+      flags |= FMI2CatalogSerializeFMUstate;
+   }
+   if ( capabilities.provides_directional_derivative ) {
+      flags |= FMI2CatalogDirectionalDerivative;
+   }
+   if ( capabilities.completed_integrator_step_not_needed ) {
+      flags |= FMI2CatalogCompletedIntegratorStepNotNeeded;
+   }
+   if ( capabilities.can_handle_variable_communication_step_size ) {
+      flags |= FMI2CatalogVariableCommunicationStepSize;
+   }
+   if ( capabilities.can_interpolate_inputs ) {
+      flags |= FMI2CatalogInterpolateInputs;
+   }
+   if ( capabilities.can_run_asynchronuously ) {
+      flags |= FMI2CatalogRunAsynchronuously;
+   }
+
+   return( flags );
+}
+
+
+/*!
+ * @brief Add a string to the catalog string data.
+ *
+ * @return Offset of the string in the string data.
+ * @param [in] value String to add.
+ */
+uint64_t TrickFMI::FMI2FMUCatalog::add_string( const std::string & value )
+{
+   uint64_t offset = this->string_data.size();
+
+   this->string_data.insert( this->string_data.end(), value.begin(), value.end() );
+   this->string_data.push_back( '\0' );
+
+   return( offset );
+}
+
+
+/*!
+ * @brief Scan all the FMU files below a directory.
+ *
+ * @return Returns the scan() status or fmi2Error if a directory could not
+ * be read.
+ * @param [in] directory Directory to search for files ending in ".fmu".
+ */
+fmi2Status TrickFMI::FMI2FMUCatalog::scan_directory( std::string directory )
+{
+   std::vector<std::string> paths;
+   fmi2Status status;
+   int find_status;
+
+   find_status = find_fmu_files( directory, paths );
+   std::sort( paths.begin(), paths.end() );
+
+   status = this->scan( paths );
+   if ( find_status && (status == fmi2OK) ) {
+      status = fmi2Error;
+   }
+
+   return( status );
+}
+
+
+/*!
+ * @brief Build the catalog from a list of FMU files.
+ *
+ * The catalog is replaced by one entry per FMU in list order.  An FMU that
+ * is already in the catalog with the same file size and modification time
+ * keeps its entry; every other FMU is scanned.  The FMUs are scanned in
+ * parallel by a pool of worker threads.  FMUs that can not be read or
+ * parsed are left out of the catalog.
+ *
+ * @return Returns fmi2OK if all the FMUs were cataloged or fmi2Error
+ * otherwise.
+ * @param [in] fmu_paths Paths to the FMU files.
+ */
+fmi2Status TrickFMI::FMI2FMUCatalog::scan( const std::vector<std::string> & fmu_paths )
+{
+   std::vector<FMI2CatalogRecord> old_records;
+   std::vector<char> old_strings;
+   std::map< std::string, size_t > old_paths;
+   std::map< std::string, size_t >::iterator path_iter;
+   std::vector<pthread_t> threads;
+   pthread_t thread;
+   struct stat fmu_stat;
+   unsigned int thread_count;
+   fmi2Status status = fmi2OK;
+   size_t iinc;
+   long num_cpus;
+   int error;
+
+   // Set aside the current entries so unchanged FMUs can reuse them.
+   old_records.swap( this->records );
+   old_strings.swap( this->string_data );
+   for ( iinc = 0 ; iinc < old_records.size() ; iinc++ ) {
+      old_paths[ &old_strings[ old_records[iinc].path ] ] = iinc;
+   }
+
+   // Build the scan list.
+   this->scan_list.resize( fmu_paths.size() );
+   for ( iinc = 0 ; iinc < fmu_paths.size() ; iinc++ ) {
+      ScanRequest & request = this->scan_list[iinc];
+      request.fmu_path = fmu_paths[iinc];
+      request.previous = -1;
+      request.status   = fmi2Pending;
+      if ( stat( fmu_paths[iinc].c_str(), &fmu_stat ) != 0 ) {
+         perror( fmu_paths[iinc].c_str() );
+         request.status = fmi2Error;
+         continue;
+      }
+      request.file_size   = fmu_stat.st_size;
+      request.modify_time = fmu_stat.st_mtime;
+      path_iter = old_paths.find( fmu_paths[iinc] );
+      if (    (path_iter != old_paths.end())
+           && (old_records[path_iter->second].file_size == request.file_size)
+           && (old_records[path_iter->second].modify_time == request.modify_time) ) {
+         request.previous = path_iter->second;
+         request.status   = fmi2OK;
+      }
+   }
+
+   // Determine the size of the worker pool.
+   thread_count = this->number_of_threads;
+   if ( thread_count == 0 ) {
+      num_cpus = sysconf( _SC_NPROCESSORS_ONLN );
+      thread_count = (num_cpus > 0) ? (unsigned int)num_cpus : 1;
+   }
+   if ( thread_count > this->scan_list.size() ) {
+      thread_count = this->scan_list.size();
+   }
+
+   // Start the workers.  The calling thread works the list too.
+   this->next_request = 0;
+   for ( iinc = 1 ; iinc < thread_count ; iinc++ ) {
+      error = pthread_create( &thread, NULL, worker, this );
+      if ( error ) {
+         std::cerr << "Error creating FMU catalog thread: "
+                   << strerror( error ) << std::endl;
+         break;
+      }
+      threads.push_back( thread );
+   }
+   this->scan_requests();
+
+   // Wait for the workers to finish.
+   for ( iinc = 0 ; iinc < threads.size() ; iinc++ ) {
+      pthread_join( threads[iinc], NULL );
+   }
+
+   // Gather the entries in list order.
+   this->records.reserve( this->scan_list.size() );
+   for ( iinc = 0 ; iinc < this->scan_list.size() ; iinc++ ) {
+
+      ScanRequest & request = this->scan_list[iinc];
+      if ( request.status != fmi2OK ) {
+         std::cerr << "Error cataloging FMU: " << request.fmu_path << std::endl;
+         status = fmi2Error;
+         continue;
+      }
+
+      if ( request.previous >= 0 ) {
+         FMI2CatalogRecord record = old_records[request.previous];
+         record.path                      = this->add_string( &old_strings[record.path] );
+         record.guid                      = this->add_string( &old_strings[record.guid] );
+         record.model_name                = this->add_string( &old_strings[record.model_name] );
+         record.fmi_version               = this->add_string( &old_strings[record.fmi_version] );
+         record.model_exchange_identifier = this->add_string( &old_strings[record.model_exchange_identifier] );
+         record.co_simulation_identifier  = this->add_string( &old_strings[record.co_simulation_identifier] );
+         record.architecture_names        = this->add_string( &old_strings[record.architecture_names] );
+         this->records.push_back( record );
+      }
+      else {
+         request.record.path                      = this->add_string( request.fmu_path );
+         request.record.guid                      = this->add_string( request.guid );
+         request.record.model_name                = this->add_string( request.model_name );
+         request.record.fmi_version               = this->add_string( request.fmi_version );
+         request.record.model_exchange_identifier = this->add_string( request.me_identifier );
+         request.record.co_simulation_identifier  = this->add_string( request.cs_identifier );
+         request.record.architecture_names        = this->add_string( request.architecture_names );
+         request.record.file_size                 = request.file_size;
+         request.record.modify_time               = request.modify_time;
+         this->records.push_back( request.record );
+      }
+   }
+   this->scan_list.clear();
+
+   return( status );
+}
+
+
+/*!
+ * @brief Scan FMUs from the scan list until the list is exhausted.
+ */
+void TrickFMI::FMI2FMUCatalog::scan_requests()
+{
+   size_t index;
+
+   while ( true ) {
+
+      // Pick up the next FMU in the list.
+      pthread_mutex_lock( &request_mutex );
+      index = this->next_request++;
+      pthread_mutex_unlock( &request_mutex );
+      if ( index >= this->scan_list.size() ) {
+         break;
+      }
+
+      // Scan it unless it is unchanged or could not be found.
+      ScanRequest & request = this->scan_list[index];
+      if ( request.status == fmi2Pending ) {
+         request.status = scan_fmu( request );
+      }
+   }
+
+   return;
+}
+
+
+/*!
+ * @brief Worker thread entry point.
+ *
+ * @param [in] catalog Pointer to the FMI2FMUCatalog.
+ */
+void * TrickFMI::FMI2FMUCatalog::worker( void * catalog )
+{
+   static_cast<FMI2FMUCatalog *>( catalog )->scan_requests();
+   return( NULL );
+}
+
+
+/*!
+ * @brief Read the catalog information of one FMU.
+ *
+ * The archive entries are read in place.  The modelDescription.xml data is
+ * read into memory and parsed; the data of every other entry is skipped and
+ * only the binaries directory names are noted.
+ *
+ * @return Returns fmi2OK or fmi2Error if the FMU could not be read or its
+ * model description could not be parsed.
+ * @param [inout] request FMU to scan; the results are filled in.
+ */
+fmi2Status TrickFMI::FMI2FMUCatalog::scan_fmu( ScanRequest & request )
+{
+   struct archive * fmu;
+   struct archive_entry * entry;
+   const char * entry_name;
+   const char * arch_end;
+   const void * buff;
+   size_t size;
+   off_t  offset;
+   int status;
+   bool read_error = false;
+   std::string description_xml;
+   std::set<std::string> architectures;
+   std::set<std::string>::iterator arch_iter;
+   FMI2FMUModelDescription description;
+   FMI2CatalogRecord & record = request.record;
+   size_t iinc;
+
+   // Set up the FMU archive to read.
+   fmu = archive_read_new();
+   archive_read_support_filter_all( fmu );
+   archive_read_support_format_all( fmu );
+
+   // Open the FMU archive.
+   status = archive_read_open_filename( fmu, request.fmu_path.c_str(), 10240 );
+   if (status != ARCHIVE_OK) {
+      std::cerr << "Error opening FMU file: " << request.fmu_path << std::endl;
+      archive_read_free( fmu );
+      return( fmi2Error );
+   }
+
+   // Loop through the entries.  Entry data that is not read is skipped by
+   // the next header read.
+   status = archive_read_next_header( fmu, &entry );
+   while (    !read_error
+           && ((status == ARCHIVE_OK) || (status == ARCHIVE_WARN)) ) {
+
+      entry_name = archive_entry_pathname( entry );
+
+      if ( !strcmp( entry_name, "modelDescription.xml" ) ) {
+
+         // Read the model description into memory.
+         status = archive_read_data_block( fmu, &buff, &size, &offset );
+         while ( (status == ARCHIVE_OK) || (status == ARCHIVE_WARN) ) {
+            if ( description_xml.size() < (size_t)offset + size ) {
+               description_xml.resize( offset + size );
+            }
+            description_xml.replace( offset, size, (const char *)buff, size );
+            status = archive_read_data_block( fmu, &buff, &size, &offset );
+         }
+         if ( status != ARCHIVE_EOF ) {
+            read_error = true;
+         }
+
+      }
+      else if ( !strncmp( entry_name, "binaries/", 9 ) ) {
+
+         // Note the architecture directory of any file in it.
+         arch_end = strchr( entry_name + 9, '/' );
+         if ( (arch_end != NULL) && (arch_end > entry_name + 9) && (arch_end[1] != '\0') ) {
+            architectures.insert( std::string( entry_name + 9, arch_end ) );
+         }
+
+      }
+
+      if ( !read_error ) {
+         status = archive_read_next_header( fmu, &entry );
+      }
+   }
+   if ( read_error || (status != ARCHIVE_EOF) ) {
+      std::cerr << request.fmu_path << ": " << archive_error_string( fmu ) << std::endl;
+      read_error = true;
+   }
+
+   archive_read_close( fmu );
+   archive_read_free( fmu );
+
+   if ( read_error ) {
+      return( fmi2Error );
+   }
+   if ( description_xml.empty() ) {
+      std::cerr << "Missing modelDescription.xml in FMU: " << request.fmu_path << std::endl;
+      return( fmi2Error );
+   }
+
+   // Parse the model description.
+   if ( description.parse( description_xml.data(), description_xml.size(),
+                           request.fmu_path + ":modelDescription.xml" ) != fmi2OK ) {
+      std::cerr << description.get_error() << std::endl;
+      return( fmi2Error );
+   }
+
+   // Fill in the catalog information.
+   memset( &record, 0, sizeof(FMI2CatalogRecord) );
+   request.guid          = description.GUID;
+   request.model_name    = description.model_name;
+   request.fmi_version   = description.fmi_version;
+   request.me_identifier = description.model_exchange_model_identifier;
+   request.cs_identifier = description.co_simulation_model_identifier;
+   request.architecture_names.clear();
+   for ( arch_iter = architectures.begin() ; arch_iter != architectures.end() ; ++arch_iter ) {
+      if ( !request.architecture_names.empty() ) {
+         request.architecture_names += " ";
+      }
+      request.architecture_names += *arch_iter;
+      record.architectures |= architecture_flag( arch_iter->c_str() );
+   }
+
+   if ( description.model_exchange ) {
+      record.modalities |= FMI2CatalogModelExchange;
+      record.model_exchange_capabilities =
+         capability_flags( description.model_exchange_capabilities );
+   }
+   if ( description.co_simulation ) {
+      record.modalities |= FMI2CatalogCoSimulation;
+      record.co_simulation_capabilities =
+         capability_flags( description.co_simulation_capabilities );
+      record.max_output_derivative_order =
+         description.co_simulation_capabilities.max_output_derivative_order;
+   }
+
+   record.number_of_variables = description.variables.size();
+   for ( iinc = 0 ; iinc < description.variables.size() ; iinc++ ) {
+      switch ( description.variables.get_causality( iinc ) ) {
+         case FMI2Parameter:
+         case FMI2CalculatedParameter:
+            record.number_of_parameters++;
+            break;
+         case FMI2Input:
+            record.number_of_inputs++;
+            break;
+         case FMI2Output:
+            record.number_of_outputs++;
+            break;
+         case FMI2Local:
+            record.number_of_locals++;
+            break;
+         default:
+            break;
+      }
+   }
+   record.number_of_continuous_states = description.derivatives.get_number_of_unknowns();
+   record.number_of_event_indicators  = description.number_of_event_indicators;
+
+   return( fmi2OK );
+}
+
+
+/*!
+ * @brief Find the catalog entries that match a query.
+ *
+ * An entry matches if it has binaries for all the requested architectures
+ * and supports one of the requested modalities with all the requested
+ * capabilities.
+ *
+ * @return Number of matching entries.
+ * @param [in]  modalities    FMI2CatalogModality flags; 0 allows either.
+ * @param [in]  capabilities  Required FMI2CatalogCapability flags.
+ * @param [in]  architectures Required FMI2CatalogArchitecture flags.
+ * @param [out] matches       Indices of the matching entries.
+ */
+size_t TrickFMI::FMI2FMUCatalog::select(
+   unsigned int          modalities,
+   unsigned int          capabilities,
+   unsigned int          architectures,
+   std::vector<size_t> & matches       ) const
+{
+   size_t iinc;
+
+   if ( modalities == 0 ) {
+      modalities = FMI2CatalogModelExchange | FMI2CatalogCoSimulation;
+   }
+
+   matches.clear();
+   for ( iinc = 0 ; iinc < this->records.size() ; iinc++ ) {
+      const FMI2CatalogRecord & record = this->records[iinc];
+      if ( (record.architectures & architectures) != architectures ) {
+         continue;
+      }
+      if (    (    (record.modalities & modalities & FMI2CatalogModelExchange)
+                && ((record.model_exchange_capabilities & capabilities) == capabilities) )
+           || (    (record.modalities & modalities & FMI2CatalogCoSimulation)
+                && ((record.co_simulation_capabilities & capabilities) == capabilities) ) ) {
+         matches.push_back( iinc );
+      }
+   }
+
+   return( matches.size() );
+}
+
+
+/*!
+ * @brief Find the first catalog entry with a GUID.
+ *
+ * @return Entry index or -1 if no entry has the GUID.
+ * @param [in] guid Model GUID.
+ */
+int TrickFMI::FMI2FMUCatalog::find_guid( const char * guid ) const
+{
+   size_t iinc;
+
+   for ( iinc = 0 ; iinc < this->records.size() ; iinc++ ) {
+      if ( !strcmp( guid, &this->string_data[ this->records[iinc].guid ] ) ) {
+         return( (int)iinc );
+      }
+   }
+   return( -1 );
+}
+
+
+/*!
+ * @brief Find the catalog entry of an FMU file.
+ *
+ * @return Entry index or -1 if the file is not in the catalog.
+ * @param [in] path FMU file path as it was scanned.
+ */
+int TrickFMI::FMI2FMUCatalog::find_path( const char * path ) const
+{
+   size_t iinc;
+
+   for ( iinc = 0 ; iinc < this->records.size() ; iinc++ ) {
+      if ( !strcmp( path, &this->string_data[ this->records[iinc].path ] ) ) {
+         return( (int)iinc );
+      }
+   }
+   return( -1 );
+}
+
+
+/*!
+ * @brief Save the catalog to an index file.
+ *
+ * The file is written to a temporary file and renamed into place so that
+ * readers never see a partial index.
+ *
+ * @return Returns fmi2OK or fmi2Error if the file could not be written.
+ * @param [in] path Path to the index file.
+ */
+fmi2Status TrickFMI::FMI2FMUCatalog::save( std::string path ) const
+{
+   std::string buffer;
+   std::vector<char> temp_path( path.begin(), path.end() );
+   CatalogHeader header;
+   size_t written;
+   ssize_t result;
+   int fd;
+
+   // Build the index file contents.
+   buffer.append( sizeof(CatalogHeader), '\0' );
+   write_binary_block( buffer, this->records );
+   write_binary_block( buffer, this->string_data );
+
+   init_catalog_header( &header );
+   header.file_size    = buffer.size();
+   header.payload_hash = FMI2FMUModelDescription::hash_document(
+                            buffer.data() + sizeof(CatalogHeader),
+                            buffer.size() - sizeof(CatalogHeader) );
+   buffer.replace( 0, sizeof(CatalogHeader), (const char *)&header, sizeof(CatalogHeader) );
+
+   // Write it to a temporary file.
+   static const char suffix[] = ".XXXXXX";
+   temp_path.insert( temp_path.end(), suffix, suffix + sizeof(suffix) );
+   fd = mkstemp( &temp_path[0] );
+   if ( fd == -1 ) {
+      perror( "Error creating FMU catalog file" );
+      return( fmi2Error );
+   }
+   for ( written = 0 ; written < buffer.size() ; written += result ) {
+      result = write( fd, buffer.data() + written, buffer.size() - written );
+      if ( result < 0 ) {
+         if ( errno == EINTR ) { result = 0; continue; }
+         break;
+      }
+   }
+   fchmod( fd, 0000644 );
+   if (    (close( fd ) != 0) || (written < buffer.size())
+        || (rename( &temp_path[0], path.c_str() ) != 0) ) {
+      perror( "Error writing FMU catalog file" );
+      unlink( &temp_path[0] );
+      return( fmi2Error );
+   }
+
+   return( fmi2OK );
+}
+
+
+/*!
+ * @brief Load the catalog from an index file.
+ *
+ * The file is mapped into memory, checked against the current build and its
+ * own payload hash, and the records and strings are copied out of the
+ * mapping.
+ *
+ * @return Returns fmi2OK or fmi2Error if the index file is missing, from a
+ * different build or damaged.  The catalog is empty on error.
+ * @param [in] path Path to the index file.
+ */
+fmi2Status TrickFMI::FMI2FMUCatalog::load( std::string path )
+{
+   struct stat file_stat;
+   CatalogHeader expected;
+   const char * mapping;
+   const char * data;
+   const char * end;
+   size_t iinc;
+   bool valid;
+   int fd;
+
+   this->clear();
+
+   fd = open( path.c_str(), O_RDONLY | O_CLOEXEC );
+   if ( fd == -1 ) {
+      perror( path.c_str() );
+      return( fmi2Error );
+   }
+   if (    (fstat( fd, &file_stat ) != 0)
+        || ((size_t)file_stat.st_size < sizeof(CatalogHeader)) ) {
+      std::cerr << "Invalid FMU catalog file: " << path << std::endl;
+      close( fd );
+      return( fmi2Error );
+   }
+   mapping = (const char *)mmap( NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+   close( fd );
+   if ( mapping == (const char *)MAP_FAILED ) {
+      perror( path.c_str() );
+      return( fmi2Error );
+   }
+
+   // Check the header and the integrity of the rest of the file.
+   init_catalog_header( &expected );
+   expected.file_size = file_stat.st_size;
+   memcpy( &expected.payload_hash,
+           mapping + offsetof( CatalogHeader, payload_hash ), sizeof(uint64_t) );
+   valid =    !memcmp( mapping, &expected, sizeof(CatalogHeader) )
+           && (expected.payload_hash
+               == FMI2FMUModelDescription::hash_document(
+                     mapping + sizeof(CatalogHeader),
+                     file_stat.st_size - sizeof(CatalogHeader) ));
+
+   // Restore the catalog.
+   data = mapping + sizeof(CatalogHeader);
+   end  = mapping + file_stat.st_size;
+   valid =    valid
+           && read_binary_block( &data, end, this->records )
+           && read_binary_block( &data, end, this->string_data )
+           && (this->string_data.empty() || (this->string_data.back() == '\0'));
+
+   // Check the string offsets.
+   for ( iinc = 0 ; valid && (iinc < this->records.size()) ; iinc++ ) {
+      const FMI2CatalogRecord & record = this->records[iinc];
+      valid =    (record.path                      < this->string_data.size())
+              && (record.guid                      < this->string_data.size())
+              && (record.model_name                < this->string_data.size())
+              && (record.fmi_version               < this->string_data.size())
+              && (record.model_exchange_identifier < this->string_data.size())
+              && (record.co_simulation_identifier  < this->string_data.size())
+              && (record.architecture_names        < this->string_data.size());
+   }
+
+   munmap( (void *)mapping, file_stat.st_size );
+
+   if ( !valid ) {
+      std::cerr << "Invalid FMU catalog file: " << path << std::endl;
+      this->clear();
+      return( fmi2Error );
+   }
+
+   return( fmi2OK );
+}
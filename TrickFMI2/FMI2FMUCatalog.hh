@@ -0,0 +1,279 @@
+/*******************************************************************************
+* Things that Trick looks for to trigger parsing and processing:
+* PURPOSE:
+* LIBRARY DEPENDENCY:
+*  ((FMI2FMUCatalog.o))
+********************************************************************************/
+/*!
+@file FMI2FMUCatalog.hh
+@ingroup FMITrickInterface
+@brief Definition of the FMI2FMUCatalog class.
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+
+*/
+
+#ifndef FMI2_FMU_CATALOG_HH_
+#define FMI2_FMU_CATALOG_HH_
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "fmi2FunctionTypes.h"
+
+#include "FMI2FMUModelDescription.hh"
+
+// TrickFMI namespace is used for everything in the TrickFMI repo
+namespace TrickFMI {
+
+//! Modality flags of a catalog entry.
+typedef enum {
+   FMI2CatalogModelExchange = 0x1, //!< The FMU supports Model Exchange.
+   FMI2CatalogCoSimulation  = 0x2  //!< The FMU supports CoSimulation.
+} FMI2CatalogModality;
+
+//! Capability flags of a catalog entry modality (see FMI2Capabilities).
+typedef enum {
+   FMI2CatalogNeedsExecutionTool                   = 0x001,
+   FMI2CatalogInstantiatedOnlyOncePerProcess       = 0x002,
+   FMI2CatalogNoMemoryManagementFunctions          = 0x004,
+   FMI2CatalogGetAndSetFMUstate                    = 0x008,
+   FMI2CatalogSerializeFMUstate                    = 0x010,
+   FMI2CatalogDirectionalDerivative                = 0x020,
+   FMI2CatalogCompletedIntegratorStepNotNeeded     = 0x040,
+   FMI2CatalogVariableCommunicationStepSize        = 0x080,
+   FMI2CatalogInterpolateInputs                    = 0x100,
+   FMI2CatalogRunAsynchronuously                   = 0x200
+} FMI2CatalogCapability;
+
+//! Architecture flags of a catalog entry (binaries/<architecture> present).
+typedef enum {
+   FMI2CatalogWin32        = 0x001,
+   FMI2CatalogWin64        = 0x002,
+   FMI2CatalogLinux32      = 0x004,
+   FMI2CatalogLinux64      = 0x008,
+   FMI2CatalogDarwin32     = 0x010,
+   FMI2CatalogDarwin64     = 0x020,
+   FMI2CatalogDarwinArm64  = 0x040,
+   FMI2CatalogDarwinX86_64 = 0x080,
+   FMI2CatalogOtherArch    = 0x100  //!< Any other binaries directory.
+} FMI2CatalogArchitecture;
+
+/*!
+@brief Fixed size catalog entry.
+
+Strings are offsets into the catalog string data so that the records can be
+written to and mapped from the index file as one array.
+*/
+typedef struct {
+   uint64_t path;                        //!< FMU file path string offset.
+   uint64_t guid;                        //!< GUID string offset.
+   uint64_t model_name;                  //!< Model name string offset.
+   uint64_t fmi_version;                 //!< FMI version string offset.
+   uint64_t model_exchange_identifier;   //!< Model Exchange model identifier string offset.
+   uint64_t co_simulation_identifier;    //!< CoSimulation model identifier string offset.
+   uint64_t architecture_names;          //!< Space separated binaries directories string offset.
+   int64_t  file_size;                   //!< FMU file size in bytes.
+   int64_t  modify_time;                 //!< FMU file modification time in seconds.
+   uint32_t modalities;                  //!< FMI2CatalogModality flags.
+   uint32_t model_exchange_capabilities; //!< FMI2CatalogCapability flags for Model Exchange.
+   uint32_t co_simulation_capabilities;  //!< FMI2CatalogCapability flags for CoSimulation.
+   uint32_t architectures;               //!< FMI2CatalogArchitecture flags.
+   uint32_t number_of_variables;         //!< Number of model variables.
+   uint32_t number_of_parameters;        //!< Parameters and calculated parameters.
+   uint32_t number_of_inputs;            //!< Input variables.
+   uint32_t number_of_outputs;           //!< Output variables.
+   uint32_t number_of_locals;            //!< Local variables.
+   uint32_t number_of_continuous_states; //!< ModelStructure Derivatives.
+   uint32_t number_of_event_indicators;  //!< numberOfEventIndicators.
+   uint32_t max_output_derivative_order; //!< CoSimulation maxOutputDerivativeOrder.
+} FMI2CatalogRecord;
+
+/*!
+@class FMI2FMUCatalog
+@brief Defines the FMI2FMUCatalog class.
+
+The FMI2FMUCatalog class indexes a collection of FMUs without loading them.
+Each FMU archive is read in place: only modelDescription.xml is read into
+memory and parsed with FMI2FMUModelDescription and the names of the
+binaries directories are noted.  Nothing is unpacked to disk and no FMU
+library is opened.  The FMUs are scanned in parallel by a pool of worker
+threads.
+
+The catalog can be saved to a compact index file and loaded again with a
+single mapping of the file.  A rescan with a loaded catalog only parses the
+FMUs whose size or modification time changed.  Queries such as "all the
+FMUs with linux64 binaries that can serialize their state" are a pass over
+the fixed size records:
+
+@code
+std::vector<size_t> matches;
+catalog.select( 0, FMI2CatalogSerializeFMUstate, FMI2CatalogLinux64, matches );
+@endcode
+
+@trick_parse{everything}
+
+@tldh
+@trick_link_dependency{FMI2FMUCatalog.o}
+
+*/
+
+class FMI2FMUCatalog {
+
+  public:
+
+   // Default constructor.
+   FMI2FMUCatalog();
+
+   // Destructor.
+   ~FMI2FMUCatalog();
+
+   void clear();
+   void set_number_of_threads( unsigned int threads );
+
+   /*
+    * Functions used to build the catalog.
+    */
+   fmi2Status scan( const std::vector<std::string> & fmu_paths );
+   fmi2Status scan_directory( std::string directory );
+
+   /*
+    * Functions used to save and restore the catalog index file.
+    */
+   fmi2Status save( std::string path ) const;
+   fmi2Status load( std::string path );
+
+   /*
+    * Functions used to query the catalog.
+    */
+   size_t select(
+      unsigned int          modalities,
+      unsigned int          capabilities,
+      unsigned int          architectures,
+      std::vector<size_t> & matches       ) const;
+   int find_guid( const char * guid ) const;
+   int find_path( const char * path ) const;
+
+   static unsigned int architecture_flag( const char * name );
+   static unsigned int capability_flags( const FMI2Capabilities & capabilities );
+
+   /*!
+    * @brief Get the number of FMUs in the catalog.
+    * @return Number of catalog entries.
+    */
+   size_t size() const { return( records.size() ); }
+
+   /*!
+    * @brief Get a catalog entry.
+    * @return Catalog record.
+    * @param [in] index Entry index.
+    */
+   const FMI2CatalogRecord & get_record( size_t index ) const {
+      return( records[index] );
+   }
+
+   /*!
+    * @brief Get a string of a catalog entry.
+    * @return String value.
+    * @param [in] offset String offset from a catalog record.
+    */
+   const char * get_string( uint64_t offset ) const {
+      return( &string_data[offset] );
+   }
+
+   /*!
+    * @brief Get the FMU file path of a catalog entry.
+    * @return FMU file path.
+    * @param [in] index Entry index.
+    */
+   const char * get_path( size_t index ) const {
+      return( get_string( records[index].path ) );
+   }
+
+   /*!
+    * @brief Get the GUID of a catalog entry.
+    * @return Model GUID.
+    * @param [in] index Entry index.
+    */
+   const char * get_guid( size_t index ) const {
+      return( get_string( records[index].guid ) );
+   }
+
+   /*!
+    * @brief Get the model name of a catalog entry.
+    * @return Model name.
+    * @param [in] index Entry index.
+    */
+   const char * get_model_name( size_t index ) const {
+      return( get_string( records[index].model_name ) );
+   }
+
+  protected:
+
+   /*!
+   @brief An FMU to scan and the result of scanning it.
+   */
+   struct ScanRequest {
+      std::string       fmu_path;           /**< @trick_units{--} Path to the FMU. */
+      int64_t           file_size;          /**< @trick_units{--} FMU file size. */
+      int64_t           modify_time;        /**< @trick_units{--} FMU modification time. */
+      int               previous;           /**< @trick_units{--} Unchanged entry or -1. */
+      fmi2Status        status;             /**< @trick_units{--} Scan status. */
+      FMI2CatalogRecord record;             /**< @trick_units{--} Scanned counts and flags. */
+      std::string       guid;               /**< @trick_units{--} Model GUID. */
+      std::string       model_name;         /**< @trick_units{--} Model name. */
+      std::string       fmi_version;        /**< @trick_units{--} FMI version. */
+      std::string       me_identifier;      /**< @trick_units{--} Model Exchange identifier. */
+      std::string       cs_identifier;      /**< @trick_units{--} CoSimulation identifier. */
+      std::string       architecture_names; /**< @trick_units{--} Binaries directories. */
+   };
+
+   std::vector<FMI2CatalogRecord> records; //!< @trick_io{**} Catalog entries.
+   std::vector<char> string_data;          //!< @trick_io{**} Catalog string storage.
+
+   unsigned int number_of_threads; /**< @trick_units{--} @n
+      Number of worker threads; 0 uses the number of online processors. */
+
+   std::vector<ScanRequest> scan_list; //!< @trick_io{**} FMUs being scanned.
+
+   size_t next_request; /**< @trick_units{--} @n
+      Index of the next FMU in the scan list to be picked up by a worker. */
+
+   pthread_mutex_t request_mutex; /**< @trick_units{--} @n
+      Mutex protecting @ref next_request. */
+
+   uint64_t add_string( const std::string & value );
+   void scan_requests();
+   static fmi2Status scan_fmu( ScanRequest & request );
+
+   static void * worker( void * catalog );
+
+  private:
+
+   /*!
+    * @brief Copy constructor not implemented.
+    *
+    * The copy constructor is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2FMUCatalog (const FMI2FMUCatalog &);
+
+   /*!
+    * @brief Assignment operator not implemented.
+    *
+    * The assignment operator is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2FMUCatalog & operator= (const FMI2FMUCatalog &);
+
+};
+
+} // End TrickFMI namespace.
+
+#endif /* FMI2_FMU_CATALOG_HH_ */
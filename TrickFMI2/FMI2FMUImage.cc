@@ -0,0 +1,184 @@
+/**
+@file FMI2FMUImage.cc
+@ingroup FMITrickInterface
+@brief Method implementations for the FMI2FMUImage class
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+*/
+
+#include <dlfcn.h>
+
+#include "FMI2FMUImage.hh"
+
+//! Registry of the FMU images in the process.
+static std::map<std::string, TrickFMI::FMI2FMUImage *> image_registry;
+
+//! Mutex protecting the image registry.
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+/*!
+ * @brief Constructor.
+ *
+ * @param [in] image_key Registry key for the image.
+ */
+TrickFMI::FMI2FMUImage::FMI2FMUImage( const std::string & image_key )
+: key(image_key), loaded(false), library_fd(-1), cache_refs_fd(-1),
+  delete_unpacked_fmu(false), model_library(NULL), single_instance(false),
+  reference_count(0), instance_count(0)
+{
+   pthread_mutex_init( &load_mutex, NULL );
+   pthread_mutex_init( &symbol_mutex, NULL );
+}
+
+
+//! Destructor.
+TrickFMI::FMI2FMUImage::~FMI2FMUImage()
+{
+   pthread_mutex_destroy( &load_mutex );
+   pthread_mutex_destroy( &symbol_mutex );
+}
+
+
+/*!
+ * @brief Find a symbol in the FMU library.
+ *
+ * Symbols are looked up in the library once and remembered for the other
+ * model objects sharing the image.
+ *
+ * @return Returns the symbol address or NULL if the symbol is not found.
+ * @param [in] symbol_name Name of the symbol in the FMU library.
+ */
+void * TrickFMI::FMI2FMUImage::find_symbol( const char * symbol_name )
+{
+   std::map<std::string, void *>::iterator symbol_iter;
+   void * symbol;
+
+   pthread_mutex_lock( &symbol_mutex );
+   symbol_iter = this->symbols.find( symbol_name );
+   if ( symbol_iter != this->symbols.end() ) {
+      symbol = symbol_iter->second;
+   }
+   else {
+      symbol = (this->model_library != NULL) ? dlsym( this->model_library, symbol_name ) : NULL;
+      if ( symbol != NULL ) { this->symbols[symbol_name] = symbol; }
+   }
+   pthread_mutex_unlock( &symbol_mutex );
+
+   return( symbol );
+}
+
+
+/*!
+ * @brief Count a new instantiated component.
+ *
+ * @return Returns false if the FMU can only be instantiated once per process
+ * and it already has been.
+ */
+bool TrickFMI::FMI2FMUImage::add_instance()
+{
+   bool added = true;
+
+   pthread_mutex_lock( &symbol_mutex );
+   if ( this->single_instance && (this->instance_count > 0) ) {
+      added = false;
+   }
+   else {
+      this->instance_count++;
+   }
+   pthread_mutex_unlock( &symbol_mutex );
+
+   return( added );
+}
+
+
+//! Stop counting a freed component.
+void TrickFMI::FMI2FMUImage::remove_instance()
+{
+   pthread_mutex_lock( &symbol_mutex );
+   if ( this->instance_count > 0 ) { this->instance_count--; }
+   pthread_mutex_unlock( &symbol_mutex );
+   return;
+}
+
+
+/*!
+ * @brief Lock the image for loading.
+ *
+ * Model objects hold this lock while checking and loading the FMU into the
+ * image so that the FMU is loaded only once.
+ */
+void TrickFMI::FMI2FMUImage::lock_load()
+{
+   pthread_mutex_lock( &load_mutex );
+   return;
+}
+
+
+//! Unlock the image after loading.
+void TrickFMI::FMI2FMUImage::unlock_load()
+{
+   pthread_mutex_unlock( &load_mutex );
+   return;
+}
+
+
+/*!
+ * @brief Acquire a reference to an FMU image.
+ *
+ * @return Returns the registered image for the key, creating an empty image
+ * if there is not one.
+ * @param [in] image_key Registry key for the image.
+ */
+TrickFMI::FMI2FMUImage * TrickFMI::FMI2FMUImage::acquire(
+   const std::string & image_key )
+{
+   std::map<std::string, FMI2FMUImage *>::iterator image_iter;
+   FMI2FMUImage * image;
+
+   pthread_mutex_lock( &registry_mutex );
+   image_iter = image_registry.find( image_key );
+   if ( image_iter != image_registry.end() ) {
+      image = image_iter->second;
+   }
+   else {
+      image = new FMI2FMUImage( image_key );
+      image_registry[image_key] = image;
+   }
+   image->reference_count++;
+   pthread_mutex_unlock( &registry_mutex );
+
+   return( image );
+}
+
+
+/*!
+ * @brief Release a reference to an FMU image.
+ *
+ * When the last reference is released, the image is removed from the
+ * registry.  The caller is then responsible for cleaning up the image
+ * resources (library, library file and unpacked FMU) and deleting the image.
+ * The image is deleted here only if it was never loaded.
+ *
+ * @return Returns true if this was the last reference to a loaded image.
+ * @param [in] image Image to release.
+ */
+bool TrickFMI::FMI2FMUImage::release( FMI2FMUImage * image )
+{
+   bool last;
+
+   pthread_mutex_lock( &registry_mutex );
+   last = (--image->reference_count == 0);
+   if ( last ) { image_registry.erase( image->key ); }
+   pthread_mutex_unlock( &registry_mutex );
+
+   if ( last && !image->loaded ) {
+      delete image;
+      return( false );
+   }
+
+   return( last );
+}
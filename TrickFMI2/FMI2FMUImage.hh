@@ -0,0 +1,121 @@
+/*******************************************************************************
+* Things that Trick looks for to trigger parsing and processing:
+* PURPOSE:
+* LIBRARY DEPENDENCY:
+*  ((FMI2FMUImage.o))
+********************************************************************************/
+/*!
+@file FMI2FMUImage.hh
+@ingroup FMITrickInterface
+@brief Definition of the FMI2FMUImage class.
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+
+*/
+
+#ifndef FMI2_FMU_IMAGE_HH_
+#define FMI2_FMU_IMAGE_HH_
+
+#include <map>
+#include <string>
+
+#include <pthread.h>
+
+#include "fmi2FunctionTypes.h"
+
+#include "FMI2FMUModelDescription.hh"
+
+// TrickFMI namespace is used for everything in the TrickFMI repo
+namespace TrickFMI {
+
+/*!
+@class FMI2FMUImage
+@brief Defines the FMI2FMUImage class.
+
+The FMI2FMUImage class holds a loaded FMU that is shared by any number of
+model objects in a process: the unpacked FMU location, the parsed model
+description, the dynamically loaded library and the library symbols bound
+so far.  Images are kept in a process wide, reference counted registry keyed
+by the FMU file and modality.  The first model object to acquire an image
+loads the FMU into it; later model objects reuse it.  The last model object
+to release an image takes back its resources for clean up.
+
+@trick_parse{everything}
+
+@tldh
+@trick_link_dependency{FMI2FMUImage.o}
+
+*/
+
+class FMI2FMUImage {
+
+  public:
+
+   std::string key; //!< @trick_units{--} Registry key for the image.
+
+   bool loaded; //!< @trick_units{--} Flag to indicate the FMU has been loaded.
+
+   std::string unpack_path;     //!< @trick_units{--} Path to unpacked FMU directory.
+   std::string library_path;    //!< @trick_units{--} Path to FMU library.
+   std::string library_variant; //!< @trick_units{--} Instruction set variant of the FMU library.
+   int  library_fd;             //!< @trick_units{--} In memory library file descriptor.
+   int  cache_refs_fd;          //!< @trick_units{--} Unpack cache reference lock file descriptor.
+   bool delete_unpacked_fmu;    //!< @trick_units{--} Delete the unpacked FMU when released.
+   void * model_library;        //!< @trick_units{**} Dynamically loaded model library.
+
+   bool single_instance; /**< @trick_units{--} @n
+      Flag to indicate the FMU can be instantiated only once per process. */
+
+   FMI2FMUModelDescription model_description; //!< Model description object.
+
+   ~FMI2FMUImage();
+
+   void * find_symbol( const char * symbol_name );
+
+   bool add_instance();
+   void remove_instance();
+
+   void lock_load();
+   void unlock_load();
+
+   static FMI2FMUImage * acquire( const std::string & image_key );
+   static bool release( FMI2FMUImage * image );
+
+  protected:
+
+   int reference_count; //!< @trick_units{--} Number of model objects using the image.
+   int instance_count;  //!< @trick_units{--} Number of instantiated components.
+
+   std::map<std::string, void *> symbols; //!< @trick_io{**} Bound library symbols.
+
+   pthread_mutex_t load_mutex;   //!< @trick_io{**} Serializes loading the FMU.
+   pthread_mutex_t symbol_mutex; //!< @trick_io{**} Protects the symbol table and counts.
+
+   FMI2FMUImage( const std::string & image_key );
+
+  private:
+
+   /*!
+    * @brief Copy constructor not implemented.
+    *
+    * The copy constructor is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2FMUImage (const FMI2FMUImage &);
+
+   /*!
+    * @brief Assignment operator not implemented.
+    *
+    * The assignment operator is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2FMUImage & operator= (const FMI2FMUImage &);
+
+};
+
+} // End TrickFMI namespace.
+
+#endif /* FMI2_FMU_IMAGE_HH_ */
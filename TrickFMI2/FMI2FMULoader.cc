@@ -0,0 +1,191 @@
+/**
+@file FMI2FMULoader.cc
+@ingroup FMITrickInterface
+@brief Method implementations for the FMI2FMULoader class
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+
+*/
+
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "FMI2FMULoader.hh"
+
+
+//! Default constructor.
+TrickFMI::FMI2FMULoader::FMI2FMULoader()
+: number_of_threads(0), next_request(0)
+{
+   pthread_mutex_init( &request_mutex, NULL );
+}
+
+
+//! Destructor.
+TrickFMI::FMI2FMULoader::~FMI2FMULoader()
+{
+   pthread_mutex_destroy( &request_mutex );
+}
+
+
+/*!
+ * @brief Set the number of worker threads.
+ *
+ * @param [in] threads Number of worker threads; 0 uses the number of online
+ * processors.
+ */
+void TrickFMI::FMI2FMULoader::set_number_of_threads( unsigned int threads )
+{
+   this->number_of_threads = threads;
+   return;
+}
+
+
+/*!
+ * @brief Add an FMU to the load list.
+ *
+ * @param [in] model    Model object to load the FMU into.
+ * @param [in] fmu_path Path to the FMU.
+ */
+void TrickFMI::FMI2FMULoader::add_fmu(
+   FMI2ModelBase * model,
+   std::string     fmu_path )
+{
+   LoadRequest request;
+
+   request.model    = model;
+   request.fmu_path = fmu_path;
+   request.status   = fmi2Pending;
+   this->load_list.push_back( request );
+
+   return;
+}
+
+
+//! Empty the load list.
+void TrickFMI::FMI2FMULoader::clear()
+{
+   this->load_list.clear();
+   return;
+}
+
+
+/*!
+ * @brief Get the load status of an FMU in the load list.
+ *
+ * @return Returns the load_fmu status, fmi2Pending if the FMU has not been
+ * loaded, or fmi2Error if the index is out of range.
+ * @param [in] index Index of the FMU in the order it was added.
+ */
+fmi2Status TrickFMI::FMI2FMULoader::get_load_status( unsigned int index )
+{
+   if ( index >= this->load_list.size() ) {
+      return( fmi2Error );
+   }
+   return( this->load_list[index].status );
+}
+
+
+/*!
+ * @brief Load all the FMUs in the load list.
+ *
+ * The FMUs are loaded in parallel by a pool of worker threads.  This
+ * routine returns after all the FMUs have been loaded.
+ *
+ * @return Returns fmi2OK if all the FMUs loaded or the most severe load
+ * status otherwise.  Use get_load_status() to check an individual FMU.
+ */
+fmi2Status TrickFMI::FMI2FMULoader::load_fmus()
+{
+   std::vector<pthread_t> threads;
+   pthread_t thread;
+   unsigned int thread_count;
+   fmi2Status status = fmi2OK;
+   unsigned int iinc;
+   long num_cpus;
+   int error;
+
+   // Determine the size of the worker pool.
+   thread_count = this->number_of_threads;
+   if ( thread_count == 0 ) {
+      num_cpus = sysconf( _SC_NPROCESSORS_ONLN );
+      thread_count = (num_cpus > 0) ? (unsigned int)num_cpus : 1;
+   }
+   if ( thread_count > this->load_list.size() ) {
+      thread_count = this->load_list.size();
+   }
+
+   // Start the workers.  The calling thread works the list too.
+   this->next_request = 0;
+   for ( iinc = 1 ; iinc < thread_count ; iinc++ ) {
+      error = pthread_create( &thread, NULL, worker, this );
+      if ( error ) {
+         std::cerr << "Error creating FMU loader thread: "
+                   << strerror( error ) << std::endl;
+         break;
+      }
+      threads.push_back( thread );
+   }
+   this->load_requests();
+
+   // Wait for the workers to finish.
+   for ( iinc = 0 ; iinc < threads.size() ; iinc++ ) {
+      pthread_join( threads[iinc], NULL );
+   }
+
+   // Report the most severe status.
+   for ( iinc = 0 ; iinc < this->load_list.size() ; iinc++ ) {
+      if ( this->load_list[iinc].status != fmi2OK ) {
+         std::cerr << "Error loading FMU: "
+                   << this->load_list[iinc].fmu_path << std::endl;
+         if ( (status == fmi2OK) || (this->load_list[iinc].status == fmi2Fatal) ) {
+            status = this->load_list[iinc].status;
+         }
+      }
+   }
+
+   return( status );
+}
+
+
+/*!
+ * @brief Load FMUs from the load list until the list is exhausted.
+ */
+void TrickFMI::FMI2FMULoader::load_requests()
+{
+   size_t index;
+
+   while ( true ) {
+
+      // Pick up the next FMU in the list.
+      pthread_mutex_lock( &request_mutex );
+      index = this->next_request++;
+      pthread_mutex_unlock( &request_mutex );
+      if ( index >= this->load_list.size() ) {
+         break;
+      }
+
+      // Load it.
+      LoadRequest & request = this->load_list[index];
+      request.status = request.model->load_fmu( request.fmu_path );
+   }
+
+   return;
+}
+
+
+/*!
+ * @brief Worker thread entry point.
+ *
+ * @param [in] loader Pointer to the FMI2FMULoader.
+ */
+void * TrickFMI::FMI2FMULoader::worker( void * loader )
+{
+   static_cast<FMI2FMULoader *>( loader )->load_requests();
+   return( NULL );
+}
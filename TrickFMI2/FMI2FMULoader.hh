@@ -0,0 +1,129 @@
+/*******************************************************************************
+* Things that Trick looks for to trigger parsing and processing:
+* PURPOSE:
+* LIBRARY DEPENDENCY:
+*  ((FMI2FMULoader.o))
+********************************************************************************/
+/*!
+@file FMI2FMULoader.hh
+@ingroup FMITrickInterface
+@brief Definition of the FMI2FMULoader class.
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+
+*/
+
+#ifndef FMI2_FMU_LOADER_HH_
+#define FMI2_FMU_LOADER_HH_
+
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+#include "FMI2ModelBase.hh"
+
+// TrickFMI namespace is used for everything in the TrickFMI repo
+namespace TrickFMI {
+
+/*!
+@class FMI2FMULoader
+@brief Defines the FMI2FMULoader class.
+
+The FMI2FMULoader class loads a list of FMUs in parallel on a pool of worker
+threads.  Each FMU is unpacked, parsed, loaded and bound by its own model
+object using FMI2ModelBase::load_fmu.  This is intended for simulations that
+load many FMUs at startup.
+
+The model objects must remain valid and must not be used by other threads
+until load_fmus() returns.  The models should have distinct unpack paths
+(for example, by setting FMI2ModelBase::use_unpack_cache).
+
+@trick_parse{everything}
+
+@tldh
+@trick_link_dependency{FMI2FMULoader.o}
+
+
+*/
+
+class FMI2FMULoader
+{
+
+  public:
+
+   // Default constructor.
+   FMI2FMULoader();
+
+   // Destructor.
+   virtual ~FMI2FMULoader();
+
+   // Loader set up.
+   void set_number_of_threads( unsigned int threads );
+   void add_fmu( FMI2ModelBase * model, std::string fmu_path );
+   void clear();
+
+   // Load all the FMUs.
+   fmi2Status load_fmus();
+
+   /*!
+    * @brief Get the number of FMUs in the load list.
+    * @return Number of FMUs in the load list.
+    */
+   unsigned int get_number_of_fmus(){ return( load_list.size() ); }
+
+   fmi2Status get_load_status( unsigned int index );
+
+  protected:
+
+   /*!
+   @brief An FMU to load and the result of loading it.
+   */
+   struct LoadRequest {
+      FMI2ModelBase * model;    /**< @trick_units{--} Model to load into. */
+      std::string     fmu_path; /**< @trick_units{--} Path to the FMU. */
+      fmi2Status      status;   /**< @trick_units{--} Load status. */
+   };
+
+   std::vector<LoadRequest> load_list; /**< @trick_units{--} @n
+      The list of FMUs to load. */
+
+   unsigned int number_of_threads; /**< @trick_units{--} @n
+      Number of worker threads; 0 uses the number of online processors. */
+
+   size_t next_request; /**< @trick_units{--} @n
+      Index of the next FMU in the load list to be picked up by a worker. */
+
+   pthread_mutex_t request_mutex; /**< @trick_units{--} @n
+      Mutex protecting @ref next_request. */
+
+   void load_requests();
+
+   static void * worker( void * loader );
+
+  private:
+
+   /*!
+    * @brief Copy constructor not implemented.
+    *
+    * The copy constructor is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2FMULoader (const FMI2FMULoader &);
+
+   /*!
+    * @brief Assignment operator not implemented.
+    *
+    * The assignment operator is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2FMULoader & operator= (const FMI2FMULoader &);
+
+};
+
+} // End TrickFMI namespace.
+
+#endif /* FMI2_FMU_LOADER_HH_ */
@@ -13,26 +13,143 @@ All Other Rights Reserved.
 @revs_end
 */
 
+#include <algorithm>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <iostream>
+#include <map>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
 
+#include "FMI2BinaryBlock.hh"
 #include "FMI2FMUModelDescription.hh"
 
 #include <libxml/parser.h>
 
+/*!
+ * @brief Initialize the XML parser library.
+ *
+ * The parser library must be initialized once before it is used from
+ * multiple threads.  The library is never cleaned up here since that would
+ * free global state in use by other threads and other parsers.
+ */
+static void init_xml_parser()
+{
+   static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+   pthread_once( &init_once, xmlInitParser );
+}
+
+
+/*!
+ * @brief Move the reader to the next child element of an element.
+ *
+ * Nodes below the child elements (grandchildren, text, comments) are
+ * skipped.  This must not be called for an empty element since an empty
+ * element has no end node to stop at.
+ *
+ * @return Returns 1 if the reader is on a child element, 0 if the reader
+ * is on the end of the parent element or -1 on a parse error.
+ * @param [in] reader Text reader.
+ * @param [in] depth  Depth of the parent element.
+ */
+static int next_child_element(
+   xmlTextReaderPtr reader,
+   int              depth )
+{
+   int status;
+
+   while ( (status = xmlTextReaderRead( reader )) == 1 ) {
+      if ( xmlTextReaderDepth( reader ) <= depth ) { return( 0 ); }
+      if (    (xmlTextReaderNodeType( reader ) == XML_READER_TYPE_ELEMENT)
+           && (xmlTextReaderDepth( reader ) == depth + 1)                 ) {
+         return( 1 );
+      }
+   }
+
+   return( (status == 0) ? 0 : -1 );
+}
+
+
+/*!
+ * @brief Get the name of the node the reader is on.
+ *
+ * @return Returns the node name.
+ * @param [in] reader Text reader.
+ */
+static const char * node_name( xmlTextReaderPtr reader )
+{
+   const xmlChar * name = xmlTextReaderConstName( reader );
+   return( (name != NULL) ? (const char *)name : "" );
+}
+
+
+/*!
+ * @brief Get an attribute of the element the reader is on.
+ *
+ * @return Returns true if the element has the attribute.
+ * @param [in]  reader Text reader.
+ * @param [in]  name   Attribute name.
+ * @param [out] value  Attribute value.
+ */
+static bool get_attribute(
+   xmlTextReaderPtr   reader,
+   const char       * name,
+   std::string      & value   )
+{
+   xmlChar * attribute = xmlTextReaderGetAttribute( reader, (const xmlChar *)name );
+
+   if ( attribute == NULL ) { return( false ); }
+   value = (const char *)attribute;
+   xmlFree( attribute );
+   return( true );
+}
+
+
+/*!
+ * @brief Look up an enumerated attribute value.
+ *
+ * @return Returns the position of the value in the list of names or -1 if
+ * the value is not in the list.
+ * @param [in] value Attribute value.
+ * @param [in] names NULL terminated list of the allowed values.
+ */
+static int find_name(
+   const char * value,
+   const char * names[] )
+{
+   int position;
+
+   for ( position = 0 ; names[position] != NULL ; position++ ) {
+      if ( !strcmp( value, names[position] ) ) { return( position ); }
+   }
+
+   return( -1 );
+}
+
+
 //! @brief Default constructor.
 TrickFMI::FMI2FMUModelDescription::FMI2FMUModelDescription()
   :number_of_event_indicators(0),
    co_simulation(false),
    model_exchange(false),
-   doc(NULL)
+   loaded_from_cache(false)
 {
-
+   memset( &co_simulation_capabilities, 0, sizeof(FMI2Capabilities) );
+   memset( &model_exchange_capabilities, 0, sizeof(FMI2Capabilities) );
 }
 
 //! @brief Class destructor.
 TrickFMI::FMI2FMUModelDescription::~FMI2FMUModelDescription()
 {
-   xmlFreeDoc( doc );
+
 }
 
 
@@ -43,118 +160,1299 @@ TrickFMI::FMI2FMUModelDescription::~FMI2FMUModelDescription()
  */
 fmi2Status TrickFMI::FMI2FMUModelDescription::parse( std::string path )
 {
-   xmlNodePtr cur;
-
-   xmlChar * xml_fmi_version;
-   xmlChar * xml_model_name;
-   xmlChar * xml_guid;
-   xmlChar * xml_num_event_ids;
+   xmlTextReaderPtr reader;
+   fmi2Status status;
 
    // Set the path to the model description file.
    this->file_path = path;
+   this->loaded_from_cache = false;
+
+   // Open a reader on the XML file.
+   init_xml_parser();
+   reader = xmlReaderForFile( this->file_path.c_str(), NULL, 0 );
+   if ( reader == NULL ){
+      this->error_message << "Document \"" << this->file_path
+                          << "\" not parsed successfully!" << std::endl;
+      return( fmi2Error );
+   }
+
+   status = this->parse_document( reader );
+   xmlFreeTextReader( reader );
+
+   return( status );
+}
+
+
+/*!
+ * @brief Parse the FMU model description document from a memory buffer.
+ *
+ * This is used when the model description is read directly out of the FMU
+ * archive instead of from an unpacked file.
+ *
+ * @param [in] buffer Pointer to the model description document contents.
+ * @param [in] size   Size of the model description document in bytes.
+ * @param [in] path   Name used to identify the document in error messages.
+ */
+fmi2Status TrickFMI::FMI2FMUModelDescription::parse(
+   const char  * buffer,
+   size_t        size,
+   std::string   path    )
+{
+   xmlTextReaderPtr reader;
+   fmi2Status status;
+
+   // Set the path to the model description document.
+   this->file_path = path;
+   this->loaded_from_cache = false;
+
+   // Open a reader on the XML buffer.
+   init_xml_parser();
+   reader = xmlReaderForMemory( buffer, (int)size, this->file_path.c_str(), NULL, 0 );
+   if ( reader == NULL ){
+      this->error_message << "Document \"" << this->file_path
+                          << "\" not parsed successfully!" << std::endl;
+      return( fmi2Error );
+   }
+
+   status = this->parse_document( reader );
+   xmlFreeTextReader( reader );
+
+   return( status );
+}
+
+
+/*!
+ * @brief Get the attributes of a modality element.
+ *
+ * @param [in]  reader       Text reader on a ModelExchange or CoSimulation
+ *                           element.
+ * @param [out] identifier   modelIdentifier attribute or an empty string if
+ *                           the attribute is missing.
+ * @param [out] capabilities Capability flags.  Missing flags are false.
+ */
+void TrickFMI::FMI2FMUModelDescription::parse_modality(
+   xmlTextReaderPtr   reader,
+   std::string      & identifier,
+   FMI2Capabilities & capabilities )
+{
+   const char * name;
+   const char * value;
+   bool flag;
+
+   identifier.clear();
+   memset( &capabilities, 0, sizeof(FMI2Capabilities) );
+
+   if ( xmlTextReaderMoveToFirstAttribute( reader ) == 1 ) {
+      do {
+         name  = node_name( reader );
+         value = (const char *)xmlTextReaderConstValue( reader );
+         if ( value == NULL ) { continue; }
+         flag = !strcmp( value, "true" );
+         if ( !strcmp( name, "modelIdentifier" ) ) {
+            identifier = value;
+         }
+         else if ( !strcmp( name, "needsExecutionTool" ) ) {
+            capabilities.needs_execution_tool = flag;
+         }
+         else if ( !strcmp( name, "canBeInstantiatedOnlyOncePerProcess" ) ) {
+            capabilities.can_be_instantiated_only_once_per_process = flag;
+         }
+         else if ( !strcmp( name, "canNotUseMemoryManagementFunctions" ) ) {
+            capabilities.can_not_use_memory_management_functions = flag;
+         }
+         else if ( !strcmp( name, "canGetAndSetFMUstate" ) ) {
+            capabilities.can_get_and_set_fmu_state = flag;
+         }
+         else if ( !strcmp( name, "canSerializeFMUstate" ) ) {
+            capabilities.can_serialize_fmu_state = flag;
+         }
+         else if ( !strcmp( name, "providesDirectionalDerivative" ) ) {
+            capabilities.provides_directional_derivative = flag;
+         }
+         else if ( !strcmp( name, "completedIntegratorStepNotNeeded" ) ) {
+            capabilities.completed_integrator_step_not_needed = flag;
+         }
+         else if ( !strcmp( name, "canHandleVariableCommunicationStepSize" ) ) {
+            capabilities.can_handle_variable_communication_step_size = flag;
+         }
+         else if ( !strcmp( name, "canInterpolateInputs" ) ) {
+            capabilities.can_interpolate_inputs = flag;
+         }
+         else if ( !strcmp( name, "canRunAsynchronuously" ) ) {
+            capabilities.can_run_asynchronuously = flag;
+         }
+         else if ( !strcmp( name, "maxOutputDerivativeOrder" ) ) {
+            capabilities.max_output_derivative_order =
+               (unsigned int)strtoul( value, NULL, 10 );
+         }
+      } while ( xmlTextReaderMoveToNextAttribute( reader ) == 1 );
+      xmlTextReaderMoveToElement( reader );
+   }
+
+   return;
+}
+
+
+/*!
+ * @brief Parse the UnitDefinitions element into the unit table.
+ *
+ * Each Unit is added with its BaseUnit definition, if it has one, followed
+ * by its DisplayUnit elements.
+ *
+ * @param [in] reader Text reader on the UnitDefinitions element.
+ */
+fmi2Status TrickFMI::FMI2FMUModelDescription::parse_unit_definitions(
+   xmlTextReaderPtr reader )
+{
+   static const char * base_unit_names[] =
+      { "kg", "m", "s", "A", "K", "mol", "cd", "rad", NULL };
+
+   const char * name;
+   const char * value;
+   std::string unit_name;
+   std::string display_name;
+   std::string number;
+   std::vector<std::string> display_names;
+   std::vector<double> display_factors;
+   std::vector<double> display_offsets;
+   FMI2UnitDefinition definition;
+   bool has_definition;
+   int depth = xmlTextReaderDepth( reader );
+   int read_status;
+   int base;
+   int unit;
+   size_t iinc;
+
+   if ( xmlTextReaderIsEmptyElement( reader ) ) { return( fmi2OK ); }
+
+   while ( (read_status = next_child_element( reader, depth )) == 1 ) {
+
+      if ( strcmp( node_name( reader ), "Unit" ) ) { continue; }
+      if ( !get_attribute( reader, "name", unit_name ) ) {
+         this->error_message << "Unit without a name in \""
+                             << this->file_path << "\"!" << std::endl;
+         return( fmi2Error );
+      }
+
+      // Get the BaseUnit and DisplayUnit elements.
+      memset( &definition, 0, sizeof(definition) );
+      definition.factor = 1.0;
+      has_definition = false;
+      display_names.clear();
+      display_factors.clear();
+      display_offsets.clear();
+      if ( !xmlTextReaderIsEmptyElement( reader ) ) {
+         while ( (read_status = next_child_element( reader, depth + 1 )) == 1 ) {
+            if ( !strcmp( node_name( reader ), "BaseUnit" ) ) {
+               has_definition = true;
+               if ( xmlTextReaderMoveToFirstAttribute( reader ) == 1 ) {
+                  do {
+                     name  = node_name( reader );
+                     value = (const char *)xmlTextReaderConstValue( reader );
+                     if ( value == NULL ) { continue; }
+                     if ( !strcmp( name, "factor" ) ) {
+                        definition.factor = strtod( value, NULL );
+                     }
+                     else if ( !strcmp( name, "offset" ) ) {
+                        definition.offset = strtod( value, NULL );
+                     }
+                     else if ( (base = find_name( name, base_unit_names )) >= 0 ) {
+                        definition.exponents[base] = (int8_t)atoi( value );
+                     }
+                  } while ( xmlTextReaderMoveToNextAttribute( reader ) == 1 );
+                  xmlTextReaderMoveToElement( reader );
+               }
+            }
+            else if (    !strcmp( node_name( reader ), "DisplayUnit" )
+                      && get_attribute( reader, "name", display_name ) ) {
+               display_names.push_back( display_name );
+               display_factors.push_back( get_attribute( reader, "factor", number ) ?
+                                          strtod( number.c_str(), NULL ) : 1.0 );
+               display_offsets.push_back( get_attribute( reader, "offset", number ) ?
+                                          strtod( number.c_str(), NULL ) : 0.0 );
+            }
+         }
+         if ( read_status < 0 ) { break; }
+      }
+
+      unit = this->units.add_unit( unit_name.c_str(), has_definition ? &definition : NULL );
+      for ( iinc = 0 ; iinc < display_names.size() ; iinc++ ) {
+         this->units.add_display_unit( unit, display_names[iinc].c_str(),
+                                       display_factors[iinc], display_offsets[iinc] );
+      }
+   }
+
+   if ( read_status < 0 ) {
+      this->error_message << "Document \"" << this->file_path
+                          << "\" not parsed successfully!" << std::endl;
+      return( fmi2Error );
+   }
+
+   return( fmi2OK );
+}
+
+
+/*!
+ * @brief Parse the TypeDefinitions element into the unit table.
+ *
+ * Units referenced by a SimpleType that are not in UnitDefinitions are
+ * added to the unit table by name.
+ *
+ * @param [in] reader Text reader on the TypeDefinitions element.
+ */
+fmi2Status TrickFMI::FMI2FMUModelDescription::parse_type_definitions(
+   xmlTextReaderPtr reader )
+{
+   static const char * type_names[] =
+      { "Real", "Integer", "Boolean", "String", "Enumeration", NULL };
+
+   std::string type_name;
+   std::string quantity;
+   std::string unit_name;
+   std::string display_name;
+   bool has_quantity;
+   int depth = xmlTextReaderDepth( reader );
+   int read_status;
+   int type;
+   int unit;
+   int display;
+
+   if ( xmlTextReaderIsEmptyElement( reader ) ) { return( fmi2OK ); }
+
+   while ( (read_status = next_child_element( reader, depth )) == 1 ) {
+
+      if ( strcmp( node_name( reader ), "SimpleType" ) ) { continue; }
+      if ( !get_attribute( reader, "name", type_name ) ) {
+         this->error_message << "SimpleType without a name in \""
+                             << this->file_path << "\"!" << std::endl;
+         return( fmi2Error );
+      }
+
+      // The type element is the only element child.
+      type = -1;
+      if (    !xmlTextReaderIsEmptyElement( reader )
+           && ((read_status = next_child_element( reader, depth + 1 )) == 1) ) {
+         type = find_name( node_name( reader ), type_names );
+      }
+      if ( read_status < 0 ) { break; }
+      if ( type < 0 ) {
+         this->error_message << "Invalid SimpleType \"" << type_name
+                             << "\" in \"" << this->file_path << "\"!" << std::endl;
+         return( fmi2Error );
+      }
+
+      has_quantity = get_attribute( reader, "quantity", quantity );
+      unit    = -1;
+      display = -1;
+      if ( get_attribute( reader, "unit", unit_name ) ) {
+         unit = this->units.find_unit( unit_name.c_str() );
+         if ( unit < 0 ) {
+            unit = this->units.add_unit( unit_name.c_str(), NULL );
+         }
+         if ( get_attribute( reader, "displayUnit", display_name ) ) {
+            display = this->units.find_display_unit( unit, display_name.c_str() );
+         }
+      }
+
+      this->units.add_type( type_name.c_str(), (FMI2VariableType)type,
+                            has_quantity ? quantity.c_str() : NULL, unit, display );
+   }
+
+   if ( read_status < 0 ) {
+      this->error_message << "Document \"" << this->file_path
+                          << "\" not parsed successfully!" << std::endl;
+      return( fmi2Error );
+   }
+
+   return( fmi2OK );
+}
+
+
+/*!
+ * @brief Parse the ModelVariables element into the variable table.
+ *
+ * Each ScalarVariable is added to @ref variables in document order, so the
+ * variable index is the ModelVariables index used by ModelStructure minus
+ * one.  The name, valueReference, causality, variability, initial, type,
+ * start value, derivative, declaredType and unit of each variable are
+ * recorded.  The units and types must already be in @ref units.  The
+ * variables are read one at a time and only the table is kept.
+ *
+ * @param [in] reader Text reader on the ModelVariables element.
+ */
+fmi2Status TrickFMI::FMI2FMUModelDescription::parse_model_variables(
+   xmlTextReaderPtr reader )
+{
+   static const char * type_names[] =
+      { "Real", "Integer", "Boolean", "String", "Enumeration", NULL };
+   static const char * causality_names[] =
+      { "parameter", "calculatedParameter", "input", "output", "local",
+        "independent", NULL };
+   static const char * variability_names[] =
+      { "constant", "fixed", "tunable", "discrete", "continuous", NULL };
+   static const char * initial_names[] =
+      { "exact", "approx", "calculated", NULL };
+
+   const char * name;
+   const char * value;
+   std::string var_name;
+   std::string start;
+   std::string declared_type;
+   std::string unit_name;
+   bool has_name, has_value_ref, has_start;
+   fmi2ValueReference value_ref = 0;
+   int depth = xmlTextReaderDepth( reader );
+   int read_status;
+   size_t index;
+   int type, causality, variability, initial;
+   int state;
+   int unit, type_index;
+   std::vector<int> derivative_of;
+   std::map<std::string, int> unit_indices;
+   std::map<std::string, int> type_indices;
+   std::map<std::string, int>::iterator found;
+   fmi2Status status = fmi2OK;
+
+   this->variables.clear();
+
+   // Index the units and types by name.
+   for ( index = 0 ; index < this->units.get_number_of_units() ; index++ ) {
+      unit_indices.insert( std::make_pair( std::string( this->units.get_unit_name( index ) ),
+                                           (int)index ) );
+   }
+   for ( index = 0 ; index < this->units.get_number_of_types() ; index++ ) {
+      type_indices.insert( std::make_pair( std::string( this->units.get_type_name( index ) ),
+                                           (int)index ) );
+   }
+
+   if ( xmlTextReaderIsEmptyElement( reader ) ) {
+      this->variables.build_index();
+      return( fmi2OK );
+   }
+
+   while ( (read_status = next_child_element( reader, depth )) == 1 ) {
+
+      if ( strcmp( node_name( reader ), "ScalarVariable" ) ) { continue; }
+
+      // Get the variable attributes.
+      has_name      = false;
+      has_value_ref = false;
+      causality     = FMI2Local;
+      variability   = FMI2Continuous;
+      initial       = FMI2InitialUnspecified;
+      if ( xmlTextReaderMoveToFirstAttribute( reader ) == 1 ) {
+         do {
+            name  = node_name( reader );
+            value = (const char *)xmlTextReaderConstValue( reader );
+            if ( value == NULL ) { continue; }
+            if ( !strcmp( name, "name" ) ) {
+               var_name = value;
+               has_name = true;
+            }
+            else if ( !strcmp( name, "valueReference" ) ) {
+               value_ref = (fmi2ValueReference)strtoul( value, NULL, 10 );
+               has_value_ref = true;
+            }
+            else if ( !strcmp( name, "causality" ) ) {
+               causality = find_name( value, causality_names );
+            }
+            else if ( !strcmp( name, "variability" ) ) {
+               variability = find_name( value, variability_names );
+            }
+            else if ( !strcmp( name, "initial" ) ) {
+               initial = find_name( value, initial_names );
+            }
+         } while ( xmlTextReaderMoveToNextAttribute( reader ) == 1 );
+         xmlTextReaderMoveToElement( reader );
+      }
+
+      // The type element is the first element child.
+      type      = -1;
+      state     = 0;
+      has_start = false;
+      declared_type.clear();
+      unit_name.clear();
+      if (    !xmlTextReaderIsEmptyElement( reader )
+           && ((read_status = next_child_element( reader, depth + 1 )) == 1) ) {
+         type = find_name( node_name( reader ), type_names );
+         if ( xmlTextReaderMoveToFirstAttribute( reader ) == 1 ) {
+            do {
+               name  = node_name( reader );
+               value = (const char *)xmlTextReaderConstValue( reader );
+               if ( value == NULL ) { continue; }
+               if ( !strcmp( name, "start" ) ) {
+                  start = value;
+                  has_start = true;
+               }
+               else if ( !strcmp( name, "derivative" ) ) {
+                  // The state this variable is the derivative of (1 based index).
+                  state = atoi( value );
+               }
+               else if ( !strcmp( name, "declaredType" ) ) {
+                  declared_type = value;
+               }
+               else if ( !strcmp( name, "unit" ) ) {
+                  unit_name = value;
+               }
+            } while ( xmlTextReaderMoveToNextAttribute( reader ) == 1 );
+            xmlTextReaderMoveToElement( reader );
+         }
+      }
+      if ( read_status < 0 ) { break; }
+
+      if (    !has_name || !has_value_ref || (type < 0)
+           || (causality < 0) || (variability < 0) || (initial < 0) ) {
+         this->error_message << "Invalid ScalarVariable \""
+                             << (has_name ? var_name.c_str() : "")
+                             << "\" in \"" << this->file_path << "\"!" << std::endl;
+         status = fmi2Error;
+         break;
+      }
+
+      index = this->variables.add_variable(
+                 var_name.c_str(), value_ref,
+                 (FMI2VariableType)type, (FMI2Causality)causality,
+                 (FMI2Variability)variability, (FMI2Initial)initial );
+
+      // Set the start value.
+      if ( has_start ) {
+         if ( type == FMI2String ) {
+            this->variables.set_start( index, start.c_str() );
+         }
+         else if ( type == FMI2Boolean ) {
+            this->variables.set_start( index,
+               ( (start == "true") || (start == "1") ) ? 1.0 : 0.0 );
+         }
+         else {
+            this->variables.set_start( index, strtod( start.c_str(), NULL ) );
+         }
+      }
+
+      // Set the declared type and unit.  The variable unit overrides the
+      // unit of the declared type.
+      type_index = -1;
+      unit       = -1;
+      if ( !declared_type.empty() ) {
+         found = type_indices.find( declared_type );
+         if ( found == type_indices.end() ) {
+            this->error_message << "Unknown declaredType \"" << declared_type
+                                << "\" for \"" << var_name << "\" in \""
+                                << this->file_path << "\"!" << std::endl;
+            status = fmi2Error;
+            break;
+         }
+         type_index = found->second;
+         unit = this->units.get_type_unit( type_index );
+      }
+      if ( !unit_name.empty() ) {
+         found = unit_indices.find( unit_name );
+         if ( found == unit_indices.end() ) {
+            unit = this->units.add_unit( unit_name.c_str(), NULL );
+            unit_indices.insert( std::make_pair( unit_name, unit ) );
+         }
+         else {
+            unit = found->second;
+         }
+      }
+      if ( (type_index >= 0) || (unit >= 0) ) {
+         this->variables.set_unit( index, unit, type_index );
+      }
+
+      derivative_of.push_back( (type == FMI2Real) ? state : 0 );
+
+   }
+
+   if ( read_status < 0 ) {
+      this->error_message << "Document \"" << this->file_path
+                          << "\" not parsed successfully!" << std::endl;
+      status = fmi2Error;
+   }
+   if ( status != fmi2OK ) {
+      this->variables.clear();
+      return( status );
+   }
+
+   // Check the derivative indices now that all the variables are known.
+   for ( index = 0 ; index < derivative_of.size() ; index++ ) {
+      if ( derivative_of[index] == 0 ) { continue; }
+      if ( (derivative_of[index] < 1) || ((size_t)derivative_of[index] > derivative_of.size()) ) {
+         this->error_message << "Invalid derivative index for \""
+                             << this->variables.get_name( index ) << "\" in \""
+                             << this->file_path << "\"!" << std::endl;
+         this->variables.clear();
+         return( fmi2Error );
+      }
+      this->variables.set_derivative( index, derivative_of[index] - 1 );
+   }
+
+   // Build the name index.
+   this->variables.build_index();
 
-   // Parse in the XML file.
-   doc = xmlParseFile( this->file_path.c_str() );
-   if ( doc == NULL ){
+   return( fmi2OK );
+}
+
+
+/*!
+ * @brief Parse the Unknown elements of a ModelStructure list into a graph.
+ *
+ * The 1 based ModelVariables indices in the index and dependencies
+ * attributes are stored as 0 based variable indices.  An Unknown without a
+ * dependencies attribute is marked as depending on all the known variables.
+ * A missing dependenciesKind defaults to dependent.
+ *
+ * @param [in]  reader Text reader on an Outputs, Derivatives or
+ *                     InitialUnknowns element.
+ * @param [out] graph  Dependency graph to fill in.
+ */
+fmi2Status TrickFMI::FMI2FMUModelDescription::parse_unknowns(
+   xmlTextReaderPtr      reader,
+   FMI2DependencyGraph & graph )
+{
+   static const char * kind_names[] =
+      { "dependent", "constant", "fixed", "tunable", "discrete", NULL };
+
+   std::string list_name( node_name( reader ) );
+   std::string dependencies;
+   std::string kinds;
+   const char * name;
+   const char * value;
+   const char * dep_ptr;
+   const char * kind_ptr;
+   char * end_ptr;
+   char kind_name[16];
+   bool has_dependencies, has_kinds;
+   size_t num_variables = this->variables.size();
+   size_t kind_len;
+   int depth = xmlTextReaderDepth( reader );
+   int read_status = 0;
+   long index;
+   long dependency;
+   int kind;
+
+   graph.clear();
+
+   if ( !xmlTextReaderIsEmptyElement( reader ) ) {
+      while ( (read_status = next_child_element( reader, depth )) == 1 ) {
+
+         if ( strcmp( node_name( reader ), "Unknown" ) ) { continue; }
+
+         index            = 0;
+         has_dependencies = false;
+         has_kinds        = false;
+         if ( xmlTextReaderMoveToFirstAttribute( reader ) == 1 ) {
+            do {
+               name  = node_name( reader );
+               value = (const char *)xmlTextReaderConstValue( reader );
+               if ( value == NULL ) { continue; }
+               if ( !strcmp( name, "index" ) ) {
+                  index = strtol( value, NULL, 10 );
+               }
+               else if ( !strcmp( name, "dependencies" ) ) {
+                  dependencies = value;
+                  has_dependencies = true;
+               }
+               else if ( !strcmp( name, "dependenciesKind" ) ) {
+                  kinds = value;
+                  has_kinds = true;
+               }
+            } while ( xmlTextReaderMoveToNextAttribute( reader ) == 1 );
+            xmlTextReaderMoveToElement( reader );
+         }
+
+         if ( (index < 1) || ((size_t)index > num_variables) ) {
+            this->error_message << "Invalid " << list_name << " Unknown index in \""
+                                << this->file_path << "\"!" << std::endl;
+            graph.clear();
+            return( fmi2Error );
+         }
+
+         graph.add_row( (int)(index - 1), !has_dependencies );
+
+         // Walk the whitespace separated dependencies and kinds in step.
+         dep_ptr  = has_dependencies ? dependencies.c_str() : NULL;
+         kind_ptr = has_kinds ? kinds.c_str() : NULL;
+         while ( dep_ptr != NULL ) {
+            dependency = strtol( dep_ptr, &end_ptr, 10 );
+            if ( end_ptr == dep_ptr ) { break; }
+            dep_ptr = end_ptr;
+
+            kind = FMI2Dependent;
+            if ( kind_ptr != NULL ) {
+               kind_ptr += strspn( kind_ptr, " \t\r\n" );
+               kind_len  = strcspn( kind_ptr, " \t\r\n" );
+               if ( (kind_len > 0) && (kind_len < sizeof(kind_name)) ) {
+                  memcpy( kind_name, kind_ptr, kind_len );
+                  kind_name[kind_len] = '\0';
+                  for ( kind = 0 ; kind_names[kind] != NULL ; kind++ ) {
+                     if ( !strcmp( kind_name, kind_names[kind] ) ) { break; }
+                  }
+               }
+               else if ( kind_len > 0 ) {
+                  kind = FMI2DependsDiscrete + 1;
+               }
+               kind_ptr += kind_len;
+            }
+
+            if (    (dependency < 1) || ((size_t)dependency > num_variables)
+                 || (kind_names[kind] == NULL)                              ) {
+               this->error_message << "Invalid " << list_name << " dependency for \""
+                                   << this->variables.get_name( index - 1 ) << "\" in \""
+                                   << this->file_path << "\"!" << std::endl;
+               graph.clear();
+               return( fmi2Error );
+            }
+            graph.add_dependency( (int)(dependency - 1), (FMI2DependencyKind)kind );
+         }
+      }
+   }
+
+   if ( read_status < 0 ) {
       this->error_message << "Document \"" << this->file_path
                           << "\" not parsed successfully!" << std::endl;
+      graph.clear();
       return( fmi2Error );
    }
 
-   // Get the documents root node.
-   cur = xmlDocGetRootElement( doc );
-   if ( cur == NULL ) {
+   graph.compute_levels();
+
+   return( fmi2OK );
+}
+
+
+/*!
+ * @brief Parse the ModelStructure element into the dependency graphs.
+ *
+ * @param [in] reader Text reader on the ModelStructure element.
+ */
+fmi2Status TrickFMI::FMI2FMUModelDescription::parse_model_structure(
+   xmlTextReaderPtr reader )
+{
+   const char * name;
+   int depth = xmlTextReaderDepth( reader );
+   int read_status = 0;
+   fmi2Status status = fmi2OK;
+
+   if ( xmlTextReaderIsEmptyElement( reader ) ) { return( fmi2OK ); }
+
+   while ( (read_status = next_child_element( reader, depth )) == 1 ) {
+      name = node_name( reader );
+      if ( !strcmp( name, "Outputs" ) ) {
+         status = this->parse_unknowns( reader, this->outputs );
+      }
+      else if ( !strcmp( name, "Derivatives" ) ) {
+         status = this->parse_unknowns( reader, this->derivatives );
+      }
+      else if ( !strcmp( name, "InitialUnknowns" ) ) {
+         status = this->parse_unknowns( reader, this->initial_unknowns );
+      }
+      if ( status != fmi2OK ) { return( status ); }
+   }
+
+   if ( read_status < 0 ) {
+      this->error_message << "Document \"" << this->file_path
+                          << "\" not parsed successfully!" << std::endl;
+      return( fmi2Error );
+   }
+
+   return( fmi2OK );
+}
+
+
+/*!
+ * @brief Process the FMU model description document.
+ *
+ * This reads the XML document in a single pass with a streaming text
+ * reader and extracts the model description information directly into the
+ * description tables.  No document tree is built or kept.
+ *
+ * @param [in] reader Text reader opened on the document.
+ */
+fmi2Status TrickFMI::FMI2FMUModelDescription::parse_document(
+   xmlTextReaderPtr reader )
+{
+   const char * name;
+   const char * value;
+   bool has_fmi_version = false;
+   bool has_model_name  = false;
+   bool has_guid        = false;
+   int read_status;
+   fmi2Status status = fmi2OK;
+
+   // Forget anything from a previous parse.
+   this->fmi_version.clear();
+   this->model_name.clear();
+   this->GUID.clear();
+   this->number_of_event_indicators = 0;
+   this->co_simulation  = false;
+   this->model_exchange = false;
+   this->co_simulation_model_identifier.clear();
+   this->model_exchange_model_identifier.clear();
+   memset( &this->co_simulation_capabilities, 0, sizeof(FMI2Capabilities) );
+   memset( &this->model_exchange_capabilities, 0, sizeof(FMI2Capabilities) );
+   this->units.clear();
+   this->variables.clear();
+   this->outputs.clear();
+   this->derivatives.clear();
+   this->initial_unknowns.clear();
+
+   // Move to the documents root element.
+   do {
+      read_status = xmlTextReaderRead( reader );
+   } while (    (read_status == 1)
+             && (xmlTextReaderNodeType( reader ) != XML_READER_TYPE_ELEMENT) );
+   if ( read_status != 1 ) {
       this->error_message << "Document \"" << this->file_path
-                          << "\" is empty!" << std::endl;
-      xmlFreeDoc( doc );
+                          << ((read_status == 0) ? "\" is empty!" : "\" not parsed successfully!")
+                          << std::endl;
       return( fmi2Error );
    }
 
    // Check document type.
-   if ( xmlStrcmp( cur->name, (const xmlChar *) "fmiModelDescription") ) {
-      this->error_message << "Wrong document type: \"" << cur->name
+   if ( strcmp( node_name( reader ), "fmiModelDescription") ) {
+      this->error_message << "Wrong document type: \"" << node_name( reader )
                           << "\" should be \"fmiModelDescription\"!" << std::endl;
-      xmlFreeDoc( doc );
       return( fmi2Error );
    }
 
    //
-   // Get the properties that MUST be associated with the fmiModelDescription.
+   // Get the properties associated with the fmiModelDescription.
    //
-   // Get the FMI version identifier.
-   if ( !xmlHasProp( cur, (const xmlChar *) "fmiVersion" ) ) {
+   if ( xmlTextReaderMoveToFirstAttribute( reader ) == 1 ) {
+      do {
+         name  = node_name( reader );
+         value = (const char *)xmlTextReaderConstValue( reader );
+         if ( value == NULL ) { continue; }
+         if ( !strcmp( name, "fmiVersion" ) ) {
+            this->fmi_version = value;
+            has_fmi_version = true;
+         }
+         else if ( !strcmp( name, "modelName" ) ) {
+            this->model_name = value;
+            has_model_name = true;
+         }
+         else if ( !strcmp( name, "guid" ) ) {
+            this->GUID = value;
+            has_guid = true;
+         }
+         else if ( !strcmp( name, "numberOfEventIndicators" ) ) {
+            this->number_of_event_indicators = atoi( value );
+         }
+      } while ( xmlTextReaderMoveToNextAttribute( reader ) == 1 );
+      xmlTextReaderMoveToElement( reader );
+   }
+
+   // Check the properties that MUST be associated with the fmiModelDescription.
+   if ( !has_fmi_version ) {
       this->error_message << "Missing \"fmiVersion\"" << std::endl;
-      xmlFreeDoc( doc );
       return( fmi2Error );
    }
-   xml_fmi_version = xmlGetProp( cur, (const xmlChar *) "fmiVersion" );
 
    // Currently only support FMI version 2.0.
-   if ( xmlStrcmp( xml_fmi_version, (const xmlChar *) "2.0" ) ) {
-      this->error_message << "Wrong FMI Version: \"" << xml_fmi_version
+   if ( this->fmi_version != "2.0" ) {
+      this->error_message << "Wrong FMI Version: \"" << this->fmi_version
                           << "\" should be \"2.0\"!" << std::endl;
-      xmlFree( xml_fmi_version );
-      xmlFreeDoc( doc );
       return( fmi2Error );
    }
-   this->fmi_version = (const char *)xml_fmi_version;
-   xmlFree( xml_fmi_version );
 
-   // Get the model name.
-   if ( !xmlHasProp( cur, (const xmlChar *) "modelName" ) ) {
+   if ( !has_model_name ) {
       this->error_message << "Missing \"modelName\"" << std::endl;
-      xmlFreeDoc( doc );
       return( fmi2Error );
    }
-   xml_model_name =  xmlGetProp( cur, (const xmlChar *) "modelName" );
-   this->model_name = (const char *)xml_model_name;
-   xmlFree( xml_model_name );
 
-   // Get the Globally Unique IDentifier (GIUD).
-   if ( !xmlHasProp( cur, (const xmlChar *) "guid" ) ) {
+   if ( !has_guid ) {
       this->error_message << "Missing \"GUID\"" << std::endl;
-      xmlFreeDoc( doc );
       return( fmi2Error );
    }
-   xml_guid =  xmlGetProp( cur, (const xmlChar *) "guid" );
-   this->GUID = (const char *)xml_guid;
-   xmlFree( xml_guid );
 
-   //
-   // Get the properties that can be associated with the fmiModelDescription.
-   //
-   // Get the number of event indicators.
-   if ( xmlHasProp( cur, (const xmlChar *) "numberOfEventIndicators" ) ) {
-      xml_num_event_ids =  xmlGetProp( cur, (const xmlChar *) "numberOfEventIndicators" );
-      this->number_of_event_indicators = atoi( (const char *) xml_num_event_ids );
-      xmlFree( xml_num_event_ids );
+   // Read the top level elements.
+   if ( !xmlTextReaderIsEmptyElement( reader ) ) {
+      while ( (read_status = next_child_element( reader, 0 )) == 1 ) {
+
+         name = node_name( reader );
+
+         // Check for modality and the model variables.
+         if ( !strcmp( name, "CoSimulation" ) ) {
+            this->co_simulation = true;
+            this->parse_modality( reader,
+                                  this->co_simulation_model_identifier,
+                                  this->co_simulation_capabilities );
+         }
+         else if ( !strcmp( name, "ModelExchange" ) ) {
+            this->model_exchange = true;
+            this->parse_modality( reader,
+                                  this->model_exchange_model_identifier,
+                                  this->model_exchange_capabilities );
+         }
+         else if ( !strcmp( name, "UnitDefinitions" ) ) {
+            status = this->parse_unit_definitions( reader );
+         }
+         else if ( !strcmp( name, "TypeDefinitions" ) ) {
+            status = this->parse_type_definitions( reader );
+         }
+         else if ( !strcmp( name, "ModelVariables" ) ) {
+            status = this->parse_model_variables( reader );
+         }
+         else if ( !strcmp( name, "ModelStructure" ) ) {
+            status = this->parse_model_structure( reader );
+         }
+
+         if ( status != fmi2OK ) { return( status ); }
+      }
+   }
+
+   // Read through the end of the document to catch any trailing errors.
+   if ( read_status >= 0 ) {
+      while ( (read_status = xmlTextReaderRead( reader )) == 1 ) {}
+   }
+   if ( read_status < 0 ) {
+      this->error_message << "Document \"" << this->file_path
+                          << "\" not parsed successfully!" << std::endl;
+      return( fmi2Error );
    }
 
-   // Begin parsing document by walking document tree.
-   cur = cur->xmlChildrenNode;
-   while ( cur != NULL ) {
+   // Return success.
+   return( fmi2OK );
+
+}
+
+
+
+/*
+ * Binary model description cache.
+ *
+ * The cache file is a fixed header followed by a sequence of 8 byte aligned
+ * blocks (see FMI2BinaryBlock.hh): the GUID, the scalar description fields,
+ * the capability flags, the unit table, the variable table and the
+ * ModelStructure graphs.
+ * The file contains no pointers so it can be mapped at any address.
+ */
+//! Cache file identification string.
+static const char binary_magic[8] = { 'T', 'F', 'M', 'I', '2', 'M', 'D', '\0' };
+
+//! Cache file format version.  Change this whenever the layout changes.
+static const uint32_t binary_version = 3;
+
+//! Value used to detect a cache file written with a different byte order.
+static const uint32_t binary_byte_order = 0x01020304;
+
+//! Binary model description cache file header.
+typedef struct {
+   char     magic[8];             //!< Cache file identification string.
+   uint32_t version;              //!< Cache file format version.
+   uint32_t byte_order;           //!< Byte order check value.
+   uint32_t size_t_size;          //!< Size of size_t in bytes.
+   uint32_t value_reference_size; //!< Size of fmi2ValueReference in bytes.
+   uint64_t source_hash;          //!< Hash of the modelDescription.xml contents.
+   uint64_t source_size;          //!< Size of the modelDescription.xml contents.
+   uint64_t file_size;            //!< Size of the cache file.
+   uint64_t payload_hash;         //!< Hash of the cache file after the header.
+} BinaryHeader;
+
+//! Scalar model description fields in the cache file.
+typedef struct {
+   int32_t number_of_event_indicators;
+   uint8_t co_simulation;
+   uint8_t model_exchange;
+   uint8_t padding[2];
+} BinaryScalars;
+
+
+/*!
+ * @brief Fill in a cache file header for the current build.
+ *
+ * @param [out] header      Header to fill in.
+ * @param [in]  source_hash Hash of the modelDescription.xml contents.
+ * @param [in]  source_size Size of the modelDescription.xml contents.
+ */
+static void init_binary_header(
+   BinaryHeader * header,
+   uint64_t       source_hash,
+   size_t         source_size )
+{
+   memset( header, 0, sizeof(BinaryHeader) );
+   memcpy( header->magic, binary_magic, sizeof(binary_magic) );
+   header->version              = binary_version;
+   header->byte_order           = binary_byte_order;
+   header->size_t_size          = sizeof(size_t);
+   header->value_reference_size = sizeof(fmi2ValueReference);
+   header->source_hash          = source_hash;
+   header->source_size          = source_size;
+   return;
+}
+
 
-      // Right now, we're only checking for modality.
-      // Stay tuned; more to come!
-      if ( ( !xmlStrcmp( cur->name, (const xmlChar *) "CoSimulation" ) ) ) {
-         this->co_simulation = true;
+/*!
+ * @brief Find the guid attribute of the fmiModelDescription element.
+ *
+ * This scans the attributes of the root element without parsing the
+ * document so that the cache file can be located before deciding whether
+ * the document has to be parsed.
+ *
+ * @return Returns true if the GUID was found.
+ * @param [in]  buffer Model description document contents.
+ * @param [in]  size   Size of the document in bytes.
+ * @param [out] guid   GUID of the model.
+ */
+static bool find_guid(
+   const char        * buffer,
+         size_t        size,
+         std::string & guid )
+{
+   static const char root_tag[] = "<fmiModelDescription";
+   const char * end = buffer + size;
+   const char * ptr;
+   const char * name;
+   size_t name_len;
+   char quote;
+
+   ptr = (const char *)memmem( buffer, size, root_tag, sizeof(root_tag) - 1 );
+   if ( ptr == NULL ) { return( false ); }
+   ptr += sizeof(root_tag) - 1;
+
+   // Walk the name="value" attribute pairs.
+   while ( ptr < end ) {
+      while ( (ptr < end) && strchr( " \t\r\n", *ptr ) ) { ptr++; }
+      if ( (ptr >= end) || (*ptr == '>') || (*ptr == '/') ) { return( false ); }
+      name = ptr;
+      while ( (ptr < end) && !strchr( " \t\r\n=", *ptr ) ) { ptr++; }
+      name_len = ptr - name;
+      while ( (ptr < end) && strchr( " \t\r\n", *ptr ) ) { ptr++; }
+      if ( (ptr >= end) || (*ptr != '=') ) { return( false ); }
+      ptr++;
+      while ( (ptr < end) && strchr( " \t\r\n", *ptr ) ) { ptr++; }
+      if ( (ptr >= end) || ((*ptr != '"') && (*ptr != '\'')) ) { return( false ); }
+      quote = *ptr++;
+      guid.assign( ptr, std::find( ptr, end, quote ) );
+      ptr += guid.size() + 1;
+      if ( (name_len == 4) && !strncmp( name, "guid", 4 ) ) {
+         // Leave values with entity references to the XML parser.
+         return( (ptr <= end) && (guid.find( '&' ) == std::string::npos) );
       }
-      else if ( ( !xmlStrcmp( cur->name, (const xmlChar *) "ModelExchange" ) ) ) {
-         this->model_exchange = true;
+   }
+
+   return( false );
+}
+
+
+/*!
+ * @brief Compute the content hash of a model description document.
+ *
+ * This hashes the document 32 bytes at a time in four independent 64-bit
+ * lanes so that large documents hash at memory speed.  It is used to key
+ * the binary model description cache, not for security.
+ *
+ * @return Returns the 64-bit hash of the document.
+ * @param [in] buffer Model description document contents.
+ * @param [in] size   Size of the document in bytes.
+ */
+uint64_t TrickFMI::FMI2FMUModelDescription::hash_document(
+   const char * buffer,
+   size_t       size    )
+{
+   static const uint64_t prime = 0x9E3779B97F4A7C15ULL;
+   uint64_t lanes[4] = { prime, (uint64_t)size, ~prime, ~(uint64_t)size };
+   uint64_t hash = 14695981039346656037ULL;
+   uint64_t word;
+   size_t iinc, jinc;
+
+   for ( iinc = 0 ; iinc + 32 <= size ; iinc += 32 ) {
+      for ( jinc = 0 ; jinc < 4 ; jinc++ ) {
+         memcpy( &word, buffer + iinc + 8 * jinc, sizeof(word) );
+         lanes[jinc] = (lanes[jinc] ^ word) * prime;
+         lanes[jinc] ^= lanes[jinc] >> 29;
       }
+   }
+
+   // Combine the lanes and add the tail bytes (FNV-1a).
+   for ( jinc = 0 ; jinc < 4 ; jinc++ ) {
+      hash = (hash ^ lanes[jinc]) * 1099511628211ULL;
+   }
+   for ( ; iinc < size ; iinc++ ) {
+      hash = (hash ^ (unsigned char)buffer[iinc]) * 1099511628211ULL;
+   }
+   hash ^= hash >> 33;
+   hash *= prime;
+   hash ^= hash >> 29;
+
+   return( hash );
+}
 
-      // Move to next node.
-      cur = cur->next;
+
+/*!
+ * @brief Parse the FMU model description document using the binary cache.
+ *
+ * The document is mapped into memory and handed to the memory buffer
+ * version of parse_cached().
+ *
+ * @param [in] path      Path to the FMU model description document.
+ * @param [in] cache_dir Directory holding the binary cache files (must exist).
+ */
+fmi2Status TrickFMI::FMI2FMUModelDescription::parse_cached(
+   std::string path,
+   std::string cache_dir )
+{
+   struct stat file_stat;
+   void * buffer;
+   fmi2Status status;
+   int fd;
+
+   fd = open( path.c_str(), O_RDONLY | O_CLOEXEC );
+   if ( (fd == -1) || (fstat( fd, &file_stat ) != 0) || (file_stat.st_size == 0) ) {
+      if ( fd != -1 ) { close( fd ); }
+      return( this->parse( path ) );
+   }
+   buffer = mmap( NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+   close( fd );
+   if ( buffer == MAP_FAILED ) {
+      return( this->parse( path ) );
    }
 
-   // Clean up the parser.
-   xmlCleanupParser();
+   status = this->parse_cached( (const char *)buffer, file_stat.st_size, path, cache_dir );
 
-   // Debug memory for regression tests
-   xmlMemoryDump();
+   munmap( buffer, file_stat.st_size );
+   return( status );
+}
 
-   // Return success.
-   return( fmi2OK );
 
+/*!
+ * @brief Parse the FMU model description document from a memory buffer
+ * using the binary cache.
+ *
+ * The cache file is named for the model GUID and the hash of the document
+ * contents.  If a valid cache file exists, the description is loaded from
+ * it and the XML document is never parsed.  Otherwise the document is
+ * parsed and the cache file is written for the next load.  Any problem with
+ * the cache falls back to parsing the document.
+ *
+ * @param [in] buffer    Pointer to the model description document contents.
+ * @param [in] size      Size of the model description document in bytes.
+ * @param [in] path      Name used to identify the document in error messages.
+ * @param [in] cache_dir Directory holding the binary cache files (must exist).
+ */
+fmi2Status TrickFMI::FMI2FMUModelDescription::parse_cached(
+   const char  * buffer,
+   size_t        size,
+   std::string   path,
+   std::string   cache_dir )
+{
+   std::ostringstream cache_path;
+   std::string guid;
+   uint64_t source_hash;
+   size_t iinc;
+   fmi2Status status;
+
+   // The cache key needs the GUID.
+   if ( !find_guid( buffer, size, guid ) || guid.empty() ) {
+      return( this->parse( buffer, size, path ) );
+   }
+
+   // Build the cache file name from the GUID and the content hash.
+   source_hash = hash_document( buffer, size );
+   cache_path << cache_dir << "/";
+   for ( iinc = 0 ; iinc < guid.size() ; iinc++ ) {
+      cache_path << ( isalnum( (unsigned char)guid[iinc] ) ? guid[iinc] : '_' );
+   }
+   cache_path << "." << std::hex;
+   cache_path.width( 16 );
+   cache_path.fill( '0' );
+   cache_path << source_hash << ".fmi2md";
+
+   // Use the cache file if there is a valid one.
+   if ( this->load_binary( cache_path.str(), source_hash, size, guid ) == fmi2OK ) {
+      this->file_path = path;
+      return( fmi2OK );
+   }
+
+   // Otherwise parse the document and save it for next time.
+   status = this->parse( buffer, size, path );
+   if ( status == fmi2OK ) {
+      this->save_binary( cache_path.str(), source_hash, size );
+   }
+
+   return( status );
+}
+
+
+/*!
+ * @brief Write the parsed model description to a binary cache file.
+ *
+ * The file is written under a temporary name and renamed into place so
+ * that other processes never see a partially written cache file.
+ *
+ * @param [in] path        Path to the cache file.
+ * @param [in] source_hash Hash of the modelDescription.xml contents.
+ * @param [in] source_size Size of the modelDescription.xml contents.
+ */
+fmi2Status TrickFMI::FMI2FMUModelDescription::save_binary(
+   std::string path,
+   uint64_t    source_hash,
+   size_t      source_size )
+{
+   std::string buffer;
+   std::vector<char> temp_path( path.begin(), path.end() );
+   BinaryHeader header;
+   BinaryScalars scalars;
+   size_t written;
+   ssize_t result;
+   int fd;
+
+   // Build the cache file contents.
+   buffer.append( sizeof(BinaryHeader), '\0' );
+   write_binary_block( buffer, this->GUID );
+   write_binary_block( buffer, this->fmi_version );
+   write_binary_block( buffer, this->model_name );
+   write_binary_block( buffer, this->co_simulation_model_identifier );
+   write_binary_block( buffer, this->model_exchange_model_identifier );
+   memset( &scalars, 0, sizeof(scalars) );
+   scalars.number_of_event_indicators      = this->number_of_event_indicators;
+   scalars.co_simulation                   = this->co_simulation;
+   scalars.model_exchange                  = this->model_exchange;
+   write_binary_block( buffer, &scalars, sizeof(scalars) );
+   write_binary_block( buffer, &this->co_simulation_capabilities, sizeof(FMI2Capabilities) );
+   write_binary_block( buffer, &this->model_exchange_capabilities, sizeof(FMI2Capabilities) );
+   this->units.write_binary( buffer );
+   this->variables.write_binary( buffer );
+   this->outputs.write_binary( buffer );
+   this->derivatives.write_binary( buffer );
+   this->initial_unknowns.write_binary( buffer );
+
+   init_binary_header( &header, source_hash, source_size );
+   header.file_size    = buffer.size();
+   header.payload_hash = hash_document( buffer.data() + sizeof(BinaryHeader),
+                                        buffer.size() - sizeof(BinaryHeader) );
+   buffer.replace( 0, sizeof(BinaryHeader), (const char *)&header, sizeof(BinaryHeader) );
+
+   // Write it to a temporary file.
+   static const char suffix[] = ".XXXXXX";
+   temp_path.insert( temp_path.end(), suffix, suffix + sizeof(suffix) );
+   fd = mkstemp( &temp_path[0] );
+   if ( fd == -1 ) {
+      perror( "Error creating model description cache file" );
+      return( fmi2Error );
+   }
+   for ( written = 0 ; written < buffer.size() ; written += result ) {
+      result = write( fd, buffer.data() + written, buffer.size() - written );
+      if ( result < 0 ) {
+         if ( errno == EINTR ) { result = 0; continue; }
+         break;
+      }
+   }
+   fchmod( fd, 0000644 );
+   if (    (close( fd ) != 0) || (written < buffer.size())
+        || (rename( &temp_path[0], path.c_str() ) != 0) ) {
+      perror( "Error writing model description cache file" );
+      unlink( &temp_path[0] );
+      return( fmi2Error );
+   }
+
+   return( fmi2OK );
 }
 
+
+/*!
+ * @brief Load the model description from a binary cache file.
+ *
+ * The file is mapped into memory, checked against the current build, the
+ * document hash and size, the GUID and its own payload hash, and the
+ * description is restored from the mapped blocks.
+ *
+ * @return Returns fmi2OK if the description was loaded or fmi2Error if the
+ * cache file is missing, stale or damaged.
+ * @param [in] path        Path to the cache file.
+ * @param [in] source_hash Hash of the modelDescription.xml contents.
+ * @param [in] source_size Size of the modelDescription.xml contents.
+ * @param [in] guid        Expected model GUID.
+ */
+fmi2Status TrickFMI::FMI2FMUModelDescription::load_binary(
+         std::string   path,
+         uint64_t      source_hash,
+         size_t        source_size,
+   const std::string & guid         )
+{
+   struct stat file_stat;
+   BinaryHeader expected;
+   BinaryScalars scalars;
+   const char * mapping;
+   const char * data;
+   const char * end;
+   const char * block;
+   const char * cs_block;
+   const char * me_block;
+   size_t block_size;
+   size_t cs_block_size;
+   size_t me_block_size;
+   size_t iinc;
+   bool valid;
+   int fd;
+
+   fd = open( path.c_str(), O_RDONLY | O_CLOEXEC );
+   if ( fd == -1 ) { return( fmi2Error ); }
+   if (    (fstat( fd, &file_stat ) != 0)
+        || ((size_t)file_stat.st_size < sizeof(BinaryHeader)) ) {
+      close( fd );
+      return( fmi2Error );
+   }
+   mapping = (const char *)mmap( NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+   close( fd );
+   if ( mapping == (const char *)MAP_FAILED ) { return( fmi2Error ); }
+
+   // Check the header and the integrity of the rest of the file.
+   init_binary_header( &expected, source_hash, source_size );
+   expected.file_size = file_stat.st_size;
+   memcpy( &expected.payload_hash,
+           mapping + offsetof( BinaryHeader, payload_hash ), sizeof(uint64_t) );
+   valid =    !memcmp( mapping, &expected, sizeof(BinaryHeader) )
+           && (expected.payload_hash
+               == hash_document( mapping + sizeof(BinaryHeader),
+                                 file_stat.st_size - sizeof(BinaryHeader) ));
+
+   // Restore the description.
+   data = mapping + sizeof(BinaryHeader);
+   end  = mapping + file_stat.st_size;
+   valid =    valid
+           && read_binary_block( &data, end, this->GUID )
+           && (this->GUID == guid)
+           && read_binary_block( &data, end, this->fmi_version )
+           && read_binary_block( &data, end, this->model_name )
+           && read_binary_block( &data, end, this->co_simulation_model_identifier )
+           && read_binary_block( &data, end, this->model_exchange_model_identifier )
+           && read_binary_block( &data, end, &block, &block_size )
+           && (block_size == sizeof(scalars))
+           && read_binary_block( &data, end, &cs_block, &cs_block_size )
+           && (cs_block_size == sizeof(FMI2Capabilities))
+           && read_binary_block( &data, end, &me_block, &me_block_size )
+           && (me_block_size == sizeof(FMI2Capabilities))
+           && this->units.read_binary( &data, end )
+           && this->variables.read_binary( &data, end )
+           && this->outputs.read_binary( &data, end )
+           && this->derivatives.read_binary( &data, end )
+           && this->initial_unknowns.read_binary( &data, end );
+
+   // Check the variable unit and type indices against the unit table.
+   for ( iinc = 0 ; valid && (iinc < this->variables.size()) ; iinc++ ) {
+      valid =    (this->variables.get_unit( iinc ) < (int)this->units.get_number_of_units())
+              && (this->variables.get_declared_type( iinc ) < (int)this->units.get_number_of_types());
+   }
+
+   if ( valid ) {
+      memcpy( &scalars, block, sizeof(scalars) );
+      this->number_of_event_indicators      = scalars.number_of_event_indicators;
+      this->co_simulation                   = scalars.co_simulation;
+      this->model_exchange                  = scalars.model_exchange;
+      memcpy( &this->co_simulation_capabilities, cs_block, sizeof(FMI2Capabilities) );
+      memcpy( &this->model_exchange_capabilities, me_block, sizeof(FMI2Capabilities) );
+      this->loaded_from_cache               = true;
+   }
+   else {
+      // Do not leave a partially restored description behind.
+      this->units.clear();
+      this->variables.clear();
+      this->outputs.clear();
+      this->derivatives.clear();
+      this->initial_unknowns.clear();
+   }
+
+   munmap( (void *)mapping, file_stat.st_size );
+
+   return( valid ? fmi2OK : fmi2Error );
+}
@@ -19,16 +19,40 @@ All Other Rights Reserved.
 #ifndef FMI2_FMU_MODEL_DESCRIPTION_HH_
 #define FMI2_FMU_MODEL_DESCRIPTION_HH_
 
+#include <stdint.h>
 #include <sstream>
 #include <string>
 
 #include "fmi2FunctionTypes.h"
 
-#include <libxml/tree.h>
+#include "FMI2DependencyGraph.hh"
+#include "FMI2UnitTable.hh"
+#include "FMI2VariableTable.hh"
+
+#include <libxml/xmlreader.h>
 
 // TrickFMI namespace is used for everything in the TrickFMI repo
 namespace TrickFMI {
 
+/*!
+@brief Capability flags of a ModelExchange or CoSimulation element.
+
+Flags that do not apply to a modality are always false (or 0).
+*/
+typedef struct {
+   bool needs_execution_tool;                        //!< needsExecutionTool.
+   bool can_be_instantiated_only_once_per_process;   //!< canBeInstantiatedOnlyOncePerProcess.
+   bool can_not_use_memory_management_functions;     //!< canNotUseMemoryManagementFunctions.
+   bool can_get_and_set_fmu_state;                   //!< canGetAndSetFMUstate.
+   bool can_serialize_fmu_state;                     //!< canSerializeFMUstate.
+   bool provides_directional_derivative;             //!< providesDirectionalDerivative.
+   bool completed_integrator_step_not_needed;        //!< completedIntegratorStepNotNeeded (ModelExchange).
+   bool can_handle_variable_communication_step_size; //!< canHandleVariableCommunicationStepSize (CoSimulation).
+   bool can_interpolate_inputs;                      //!< canInterpolateInputs (CoSimulation).
+   bool can_run_asynchronuously;                     //!< canRunAsynchronuously (CoSimulation).
+   unsigned int max_output_derivative_order;         //!< maxOutputDerivativeOrder (CoSimulation).
+} FMI2Capabilities;
+
 /*!
 @class FMI2FMUModelDescription
 @brief Define the FMI2FMUModelDescription class.
@@ -59,7 +83,36 @@ class FMI2FMUModelDescription {
    bool co_simulation; //!< Flag to indicate this FMU supports CoSimulation.
    bool model_exchange; //!< Flag to indicate this FMU supports Model Exchange.
 
+   std::string co_simulation_model_identifier;  //!< CoSimulation library name.
+   std::string model_exchange_model_identifier; //!< Model Exchange library name.
+
+   FMI2Capabilities co_simulation_capabilities;  //!< @trick_io{**} CoSimulation capability flags.
+   FMI2Capabilities model_exchange_capabilities; //!< @trick_io{**} Model Exchange capability flags.
+
+   FMI2UnitTable units; //!< @trick_io{**} Units and types from UnitDefinitions and TypeDefinitions.
+
+   FMI2VariableTable variables; //!< @trick_io{**} Model variables from ModelVariables.
+
+   FMI2DependencyGraph outputs;          //!< @trick_io{**} ModelStructure Outputs.
+   FMI2DependencyGraph derivatives;      //!< @trick_io{**} ModelStructure Derivatives.
+   FMI2DependencyGraph initial_unknowns; //!< @trick_io{**} ModelStructure InitialUnknowns.
+
+   bool loaded_from_cache; //!< Flag to indicate the description came from the binary cache.
+
    fmi2Status parse( std::string path );
+   fmi2Status parse( const char * buffer, size_t size, std::string path );
+
+   /*
+    * Functions used with the binary model description cache.
+    */
+   fmi2Status parse_cached( std::string path, std::string cache_dir );
+   fmi2Status parse_cached( const char * buffer, size_t size,
+                            std::string path, std::string cache_dir );
+   fmi2Status save_binary( std::string path, uint64_t source_hash, size_t source_size );
+   fmi2Status load_binary( std::string path, uint64_t source_hash, size_t source_size,
+                           const std::string & guid );
+
+   static uint64_t hash_document( const char * buffer, size_t size );
 
    /*!
     * @brief Get the error string associated the current parse status.
@@ -75,9 +128,20 @@ class FMI2FMUModelDescription {
    ~FMI2FMUModelDescription();
 
   protected:
-   xmlDocPtr doc; //!< @trick_io{**} @n XML document
    std::stringstream error_message; //!< Current parse error message.
 
+   fmi2Status parse_document( xmlTextReaderPtr reader );
+
+   void parse_modality( xmlTextReaderPtr reader,
+                        std::string & identifier,
+                        FMI2Capabilities & capabilities );
+
+   fmi2Status parse_unit_definitions( xmlTextReaderPtr reader );
+   fmi2Status parse_type_definitions( xmlTextReaderPtr reader );
+   fmi2Status parse_model_variables( xmlTextReaderPtr reader );
+   fmi2Status parse_model_structure( xmlTextReaderPtr reader );
+   fmi2Status parse_unknowns( xmlTextReaderPtr reader, FMI2DependencyGraph & graph );
+
 };
 
 } // End TrickFMI namespace.
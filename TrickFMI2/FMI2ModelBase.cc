@@ -14,19 +14,33 @@ All Other Rights Reserved.
 */
 
 /* Include file that defines dynamic load library functions. */
+#include <algorithm>
 #include <iostream>
 #include <sstream>
+#include <map>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <ftw.h>
+#include <dirent.h>
+#include <sys/wait.h>
 #include <sys/stat.h>
 #include <sys/param.h>
+#include <sys/mman.h>
+#include <sys/file.h>
 #include <errno.h>
+#include <pthread.h>
 #include <libgen.h>
 #include <dlfcn.h>
+#include <limits.h>
+#include <float.h>
+#include <math.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
 
 // Archive library includes.
 #include <archive.h>
@@ -63,9 +77,531 @@ static int remove_callback(
 }  /* end of extern "C" { */
 
 
+/*!
+ * @brief Remove a directory tree.
+ *
+ * @return Returns 0 on success or if the path does not exist.
+ * @param [in] path Path to the directory tree to remove.
+ */
+static int remove_tree( const char * path )
+{
+   struct stat path_stat;
+   if ( stat( path, &path_stat ) == 0 ){
+      return( nftw( path, remove_callback, 64, FTW_DEPTH | FTW_PHYS ) );
+   }
+   return( 0 );
+}
+
+
+/*!
+ * @brief Update a 64-bit FNV-1a hash with a block of data.
+ *
+ * @param [inout] hash Hash to update.
+ * @param [in]    data Data to add to the hash.
+ * @param [in]    size Size of the data in bytes.
+ */
+static void hash_update(
+         uint64_t * hash,
+   const void     * data,
+         size_t     size )
+{
+   const unsigned char * bytes = (const unsigned char *)data;
+   size_t iinc;
+
+   for ( iinc = 0 ; iinc < size ; iinc++ ) {
+      *hash ^= bytes[iinc];
+      *hash *= 1099511628211ULL;
+   }
+
+   return;
+}
+
+
+/*!
+ * @brief Update a 64-bit FNV-1a hash with the contents of a file.
+ *
+ * @return Returns 0 on success or -1 if the file could not be read.
+ * @param [in]    path Path to the file.
+ * @param [inout] hash Hash to update.
+ */
+static int hash_file_update(
+   const char     * path,
+         uint64_t * hash )
+{
+   unsigned char buff[65536];
+   ssize_t size;
+   int fd;
+
+   fd = open( path, O_RDONLY | O_CLOEXEC );
+   if ( fd == -1 ) { return( -1 ); }
+
+   while ( (size = read( fd, buff, sizeof(buff) )) != 0 ) {
+      if ( size < 0 ) {
+         if ( errno == EINTR ) { continue; }
+         close( fd );
+         return( -1 );
+      }
+      hash_update( hash, buff, size );
+   }
+
+   close( fd );
+   return( 0 );
+}
+
+
+/*!
+ * @brief Update a 64-bit FNV-1a hash with the standard output of a command.
+ *
+ * @return Returns 0 on success or -1 if the command could not be run or
+ * did not exit successfully.
+ * @param [in]    argv Command and arguments; NULL terminated.
+ * @param [inout] hash Hash to update.
+ */
+static int hash_command_update(
+   char * const   argv[],
+         uint64_t * hash )
+{
+   unsigned char buff[4096];
+   ssize_t size;
+   int fds[2];
+   int wait_status = -1;
+   int dev_null;
+   pid_t pid;
+
+   if ( pipe( fds ) ) { return( -1 ); }
+   pid = fork();
+   if ( pid == 0 ) {
+      dup2( fds[1], STDOUT_FILENO );
+      dev_null = open( "/dev/null", O_WRONLY );
+      if ( dev_null != -1 ) { dup2( dev_null, STDERR_FILENO ); }
+      close( fds[0] );
+      close( fds[1] );
+      execvp( argv[0], argv );
+      _exit( 127 );
+   }
+   close( fds[1] );
+
+   while ( (pid > 0) && ((size = read( fds[0], buff, sizeof(buff) )) != 0) ) {
+      if ( size < 0 ) {
+         if ( errno == EINTR ) { continue; }
+         break;
+      }
+      hash_update( hash, buff, size );
+   }
+   close( fds[0] );
+
+   while ( (pid > 0) && (waitpid( pid, &wait_status, 0 ) == -1) && (errno == EINTR) ) {}
+   if ( (pid < 0) || !WIFEXITED( wait_status ) || (WEXITSTATUS( wait_status ) != 0) ) {
+      return( -1 );
+   }
+   return( 0 );
+}
+
+
+/*!
+ * @brief Compute the content hash of an FMU file.
+ *
+ * This computes the 64-bit FNV-1a hash of the file contents.  It is used
+ * to key the shared unpack cache so that a changed FMU with the same name
+ * is never mistaken for a previously unpacked one.
+ *
+ * @return Returns 0 on success or -1 if the file could not be read.
+ * @param [in]  path Path to the FMU file.
+ * @param [out] hash Hash of the file contents.
+ */
+static int hash_fmu_file(
+   const char     * path,
+         uint64_t * hash )
+{
+   *hash = 14695981039346656037ULL;
+   return( hash_file_update( path, hash ) );
+}
+
+
+/*!
+ * @brief Write a block of archive data to a file descriptor.
+ *
+ * This is a helper function used to copy a data block read from the FMU
+ * archive into a file descriptor at the block's offset.  It handles partial
+ * writes.
+ *
+ * @return Returns 0 on success or -1 on a write error.
+ * @param [in]    fd     File descriptor to write to.
+ * @param [in]    buff   Data block to write.
+ * @param [in]    size   Size of the data block in bytes.
+ * @param [in]    offset Offset of the data block in the file.
+ * @param [inout] report Startup report to accumulate the write time into
+ *                       or NULL.
+ */
+static int write_data_block(
+         int                           fd,
+   const void                        * buff,
+         size_t                        size,
+         off_t                         offset,
+         TrickFMI::FMI2StartupReport * report )
+{
+   const char * data = (const char *)buff;
+   double start_time = TrickFMI::FMI2StartupReport::get_time();
+   ssize_t written;
+
+   while ( size > 0 ) {
+      written = pwrite( fd, data, size, offset );
+      if ( written < 0 ) {
+         if ( errno == EINTR ) { continue; }
+         return( -1 );
+      }
+      data   += written;
+      size   -= written;
+      offset += written;
+   }
+
+   if ( report != NULL ) {
+      report->write_time += TrickFMI::FMI2StartupReport::get_time() - start_time;
+   }
+
+   return( 0 );
+}
+
+
+/*!
+ * @brief Read the next block of archive entry data.
+ *
+ * This is archive_read_data_block with the read and decompression time
+ * accumulated.
+ *
+ * @return Returns the archive_read_data_block status.
+ * @param [in]    fmu             FMU archive positioned at an entry.
+ * @param [out]   buff            Data block read.
+ * @param [out]   size            Size of the data block in bytes.
+ * @param [out]   offset          Offset of the data block in the entry.
+ * @param [inout] decompress_time Time to accumulate the read time into.
+ */
+static int read_data_block(
+   struct archive   * fmu,
+   const void      ** buff,
+   size_t           * size,
+   off_t            * offset,
+   double           * decompress_time )
+{
+   double start_time = TrickFMI::FMI2StartupReport::get_time();
+   int status;
+
+   status = archive_read_data_block( fmu, buff, size, offset );
+   *decompress_time += TrickFMI::FMI2StartupReport::get_time() - start_time;
+
+   return( status );
+}
+
+
+/*!
+ * @brief Check that an archive entry name stays inside the unpack directory.
+ *
+ * @return Returns true if the name is relative and has no ".." components.
+ * @param [in] entry_name Name of the FMU archive entry.
+ */
+static bool is_safe_entry_name( const char * entry_name )
+{
+   const char * component = entry_name;
+
+   if ( (entry_name[0] == '\0') || (entry_name[0] == '/') ) {
+      return( false );
+   }
+
+   while ( component != NULL ) {
+      if (    (component[0] == '.') && (component[1] == '.')
+           && ((component[2] == '/') || (component[2] == '\0')) ) {
+         return( false );
+      }
+      component = strchr( component, '/' );
+      if ( component != NULL ) { component++; }
+   }
+
+   return( true );
+}
+
+
+/*!
+ * @brief Create the parent directories of an archive entry.
+ *
+ * @return Returns 0 on success or -1 on error.
+ * @param [in] dir_fd     Handle to the directory the entry name is relative to.
+ * @param [in] entry_name Name of the FMU archive entry.
+ */
+static int make_parent_dirs(
+         int    dir_fd,
+   const char * entry_name )
+{
+   std::string parent( entry_name );
+   size_t slash_pos = parent.find( '/' );
+
+   while ( slash_pos != std::string::npos ) {
+      parent[slash_pos] = '\0';
+      if ( (mkdirat( dir_fd, parent.c_str(), 0755 ) == -1) && (errno != EEXIST) ) {
+         return( -1 );
+      }
+      parent[slash_pos] = '/';
+      slash_pos = parent.find( '/', slash_pos + 1 );
+   }
+
+   return( 0 );
+}
+
+
+/*!
+ * @brief Write an FMU archive entry relative to a directory handle.
+ *
+ * This writes the current archive entry below the directory using the *at
+ * family of system calls instead of changing the process working directory.
+ * Directories and regular files are written along with their permissions
+ * and modification times.  Other entry types are skipped.
+ *
+ * @return Returns 0 on success or -1 on error.
+ * @param [in]    fmu             FMU archive positioned at the entry.
+ * @param [in]    entry           FMU archive entry to write.
+ * @param [in]    dir_fd          Handle to the directory to write into.
+ * @param [inout] decompress_time Time to accumulate the archive read time into.
+ */
+static int extract_entry(
+   struct archive       * fmu,
+   struct archive_entry * entry,
+   int                    dir_fd,
+   double               * decompress_time )
+{
+   const char * entry_name = archive_entry_pathname( entry );
+   mode_t mode = archive_entry_perm( entry ) | S_IRUSR | S_IWUSR;
+   struct timespec times[2];
+   const void * buff;
+   size_t size;
+   off_t  offset;
+   int status;
+   int fd;
+
+   // Do not let entries escape the directory.
+   if ( !is_safe_entry_name( entry_name ) ) {
+      fprintf( stderr, "Unsafe FMU archive entry name: %s\n", entry_name );
+      return( -1 );
+   }
+   if ( make_parent_dirs( dir_fd, entry_name ) ) {
+      perror( entry_name );
+      return( -1 );
+   }
+
+   // Directories only need to be created.
+   if ( archive_entry_filetype( entry ) == AE_IFDIR ) {
+      if ( (mkdirat( dir_fd, entry_name, mode | S_IXUSR ) == -1) && (errno != EEXIST) ) {
+         perror( entry_name );
+         return( -1 );
+      }
+      return( 0 );
+   }
+   else if ( archive_entry_filetype( entry ) != AE_IFREG ) {
+      fprintf( stderr, "Skipping FMU archive entry: %s\n", entry_name );
+      return( 0 );
+   }
+
+   // Create the file.
+   fd = openat( dir_fd, entry_name,
+                O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, mode );
+   if ( fd == -1 ) {
+      perror( entry_name );
+      return( -1 );
+   }
+
+   // Copy the data blocks into the file.
+   while ( (status = read_data_block( fmu, &buff, &size, &offset, decompress_time )) == ARCHIVE_OK ) {
+      if ( write_data_block( fd, buff, size, offset, NULL ) ) {
+         perror( entry_name );
+         close( fd );
+         return( -1 );
+      }
+   }
+   if ( status != ARCHIVE_EOF ) {
+      fprintf( stderr, "%s\n", archive_error_string( fmu ) );
+      close( fd );
+      return( -1 );
+   }
+
+   // Set the file size (for trailing sparse blocks) and modification time.
+   times[0].tv_sec  = 0;
+   times[0].tv_nsec = UTIME_OMIT;
+   times[1].tv_sec  = archive_entry_mtime( entry );
+   times[1].tv_nsec = archive_entry_mtime_nsec( entry );
+   if (    (ftruncate( fd, archive_entry_size( entry ) ) == -1)
+        || (futimens( fd, times ) == -1)                       ) {
+      perror( entry_name );
+      close( fd );
+      return( -1 );
+   }
+   if ( close( fd ) == -1 ) {
+      perror( entry_name );
+      return( -1 );
+   }
+
+   return( 0 );
+}
+
+
+//! Size of the blocks read from the FMU archive.
+static const size_t archive_block_size = 1024 * 1024;
+
+//! Uncompressed bytes needed to give another thread work when extracting.
+static const size_t extract_bytes_per_thread = 4 * 1024 * 1024;
+
+
+/*!
+ * @brief Open an FMU archive for reading.
+ *
+ * Zip archives are read through their central directory and read in large
+ * blocks.
+ *
+ * @return Returns the archive or NULL if it could not be opened.
+ * @param [in] fmu_path Path to the FMU archive.
+ */
+static struct archive * open_fmu_archive( const char * fmu_path )
+{
+   struct archive * fmu;
+
+   // Set up the FMU archive to read.
+   fmu = archive_read_new();
+   archive_read_support_filter_all( fmu );
+   archive_read_support_format_all( fmu );
+
+   // Open the FMU archive.
+   if ( archive_read_open_filename( fmu, fmu_path, archive_block_size ) != ARCHIVE_OK ) {
+      std::cerr << "Error opening FMU file: " << fmu_path << std::endl;
+      archive_read_free( fmu );
+      return( NULL );
+   }
+
+   return( fmu );
+}
+
+
+namespace {
+
+/*!
+ * @brief FMU archive entries being extracted by a pool of threads.
+ */
+struct ExtractJob {
+   const char        * fmu_path;        //!< Path to the FMU archive.
+   int                 dir_fd;          //!< Handle to the extraction directory.
+   std::vector<char>   selected;        //!< Selection flag of each archive entry.
+   std::vector<char>   claimed;         //!< Claim flag of each archive entry.
+   size_t              unclaimed;       //!< Number of selected entries not yet claimed.
+   bool                failed;          //!< An entry failed to extract.
+   double              decompress_time; //!< Read and decompress time summed over threads.
+   double              write_time;      //!< File write time summed over threads.
+   pthread_mutex_t     mutex;           //!< Mutex protecting the claims, flag and times.
+};
+
+} // End anonymous namespace.
+
+
+/*!
+ * @brief Extract the selected FMU archive entries claimed by this thread.
+ *
+ * Each thread reads the archive with its own handle.  It walks the entries
+ * in archive order and extracts the selected entries no other thread has
+ * claimed; the data of the other entries is skipped without being
+ * decompressed.
+ *
+ * @return Returns NULL.
+ * @param [inout] job_ptr The ExtractJob.
+ */
+static void * extract_worker( void * job_ptr )
+{
+   ExtractJob * job = (ExtractJob *)job_ptr;
+   struct archive * fmu;
+   struct archive_entry * entry;
+   double decompress_time = 0.0;
+   double write_time = 0.0;
+   double entry_start;
+   double decompress_start;
+   size_t index = 0;
+   bool claimed;
+   bool done = false;
+   bool failed = false;
+   int status = ARCHIVE_EOF;
+
+   fmu = open_fmu_archive( job->fmu_path );
+   if ( fmu == NULL ) {
+      failed = true;
+      done   = true;
+   }
+
+   while ( !done ) {
+
+      status = archive_read_next_header( fmu, &entry );
+      if ( (status != ARCHIVE_OK) && (status != ARCHIVE_WARN) ) {
+         break;
+      }
+
+      // Claim the next selected entry.
+      if ( (index < job->selected.size()) && job->selected[index] ) {
+         pthread_mutex_lock( &job->mutex );
+         claimed = !job->claimed[index] && !job->failed;
+         if ( claimed ) {
+            job->claimed[index] = 1;
+            job->unclaimed--;
+         }
+         done = job->failed || (job->unclaimed == 0);
+         pthread_mutex_unlock( &job->mutex );
+
+         // Write out the entry.
+         if ( claimed ) {
+            entry_start = TrickFMI::FMI2StartupReport::get_time();
+            decompress_start = decompress_time;
+            if ( extract_entry( fmu, entry, job->dir_fd, &decompress_time ) ) {
+               failed = true;
+               done   = true;
+            }
+            write_time += TrickFMI::FMI2StartupReport::get_time() - entry_start
+                        - (decompress_time - decompress_start);
+         }
+      }
+      index++;
+
+   }
+
+   // Running out of entries before all are claimed is an archive error.
+   if ( !done && (status != ARCHIVE_EOF) ) {
+      fprintf( stderr, "Error extracting FMU file %s: %s\n",
+               job->fmu_path, archive_error_string( fmu ) );
+      failed = true;
+   }
+   if ( fmu != NULL ) {
+      archive_read_close( fmu );
+      archive_read_free( fmu );
+   }
+
+   pthread_mutex_lock( &job->mutex );
+   job->failed = job->failed || failed;
+   job->decompress_time += decompress_time;
+   job->write_time += write_time;
+   pthread_mutex_unlock( &job->mutex );
+
+   return( NULL );
+}
+
+
 //! Default constructor.
 TrickFMI::FMI2ModelBase::FMI2ModelBase()
-: delete_unpacked_fmu(true), component(NULL), model_library(NULL)
+: delete_unpacked_fmu(true), unpack_in_memory(false), use_unpack_cache(false),
+  extract_resources(true), extract_all_entries(false), share_fmu_image(false),
+  number_of_extract_threads(0),
+  finite_difference_step(sqrt( DBL_EPSILON )),
+  apply_description_starts(false), use_isa_variants(true),
+  source_compiler("cc"), source_cflags("-O3 -march=native"),
+  component(NULL), library_fd(-1), cache_refs_fd(-1), model_library(NULL),
+  static_functions(NULL),
+  description(&model_description), image(NULL),
+  use_fmu_state_rollback(false), use_directional_derivative(false),
+  rollback_state(NULL),
+  instance_callbacks(NULL), instance_visible(fmi2False),
+  instance_logging_on(fmi2False),
+  experiment_tolerance_defined(fmi2False), experiment_tolerance(0.0),
+  experiment_stop_time_defined(fmi2False), experiment_stop_time(0.0),
+  swap_count(0), swap_description(NULL)
 {
    /* Make sure that all the function pointers are set to NULL. */
    clean_up();
@@ -88,201 +624,2062 @@ TrickFMI::FMI2ModelBase::~FMI2ModelBase()
    /* Make sure that all the function pointers are set to NULL. */
    clean_up();
 
-   if ( delete_unpacked_fmu ) {
+   if ( cache_refs_fd >= 0 ) {
+      // Release the shared unpack cache entry.
+      if ( release_unpack_cache() ) {
+         perror( "Error releasing the unpack cache" );
+         exit(1);
+      }
+   }
+   else if ( delete_unpacked_fmu ) {
       // Remove the unpack directory.
       if ( remove_unpack_dir() ) {
          perror( "Error removing the unpack directory" );
          exit(1);
       }
    }
+
+   // Free the model description of a swapped in FMU.
+   delete swap_description;
+}
+
+
+/*!
+ * @brief Load an FMU.
+ *
+ * This routine loads in the FMU specified by the @ref fmu_path variable.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::load_fmu( void )
+{
+   double start_time;
+   fmi2Status status;
+
+   /* Make sure that the FMU path has been specified. */
+   if ( this->fmu_path.empty() ) {
+      std::cerr << "Empty FMU path!" << std::endl;
+      return( fmi2Fatal);
+   }
+
+   /* Determine the platform architecture for the FMU library. */
+   this->set_host_architecture();
+
+#if !defined(__linux__)
+   /* Loading directly from the archive relies on Linux memfd_create. */
+   if ( this->unpack_in_memory ) {
+      std::cerr << "In memory FMU loading is not supported on this platform, "
+                << "unpacking FMU instead." << std::endl;
+      this->unpack_in_memory = false;
+   }
+#endif
+
+   /* Building the library from the FMU sources needs the sources on disk. */
+   if ( this->unpack_in_memory && !this->source_build_dir.empty() ) {
+      std::cerr << "Building the FMU library from its sources, "
+                << "unpacking FMU instead of loading it in memory." << std::endl;
+      this->unpack_in_memory = false;
+   }
+
+   /* Start timing the load phases. */
+   this->startup_report.clear();
+   this->startup_report.fmu_path = this->fmu_path;
+   start_time = FMI2StartupReport::get_time();
+
+   if ( this->share_fmu_image ) {
+
+      /* Use the shared FMU image. */
+      status = this->load_shared_fmu();
+
+   }
+   else {
+
+      /* Unpack the FMU, parse the model description and load the library. */
+      status = this->load_fmu_files();
+
+      /* Bind the FMI functions. */
+      if ( status == fmi2OK ) {
+         status = this->bind_function_ptrs_timed();
+      }
+
+   }
+
+   /* Choose the host strategies the FMU capabilities allow. */
+   if ( status == fmi2OK ) {
+      this->select_host_strategies();
+   }
+
+   this->startup_report.load_time = FMI2StartupReport::get_time() - start_time;
+
+   return( status );
+}
+
+
+/*!
+ * @brief Unpack the FMU, parse the model description and load the library.
+ *
+ * This routine performs the FMU loading steps that can be shared between
+ * model objects through an FMI2FMUImage.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::load_fmu_files( void )
+{
+   double start_time = FMI2StartupReport::get_time();
+   fmi2Status status;
+
+   if ( this->unpack_in_memory ) {
+
+      /* Read the model description and library directly from the FMU. */
+      status = this->load_fmu_in_memory();
+
+      /* The model description parse is timed separately. */
+      this->startup_report.unpack_time = FMI2StartupReport::get_time() - start_time
+                                       - this->startup_report.parse_time;
+      if ( status != fmi2OK ) {
+         return( fmi2Fatal );
+      }
+
+   }
+   else {
+
+      /* Unpack the FMU. */
+      if ( this->use_unpack_cache ) {
+         status = this->unpack_fmu_cached();
+      }
+      else {
+         status = this->unpack_fmu();
+      }
+      this->startup_report.unpack_time = FMI2StartupReport::get_time() - start_time;
+      if ( status != fmi2OK ) {
+         return( fmi2Fatal );
+      }
+
+      /* Process the model description file. */
+      std::string model_description_path;
+      model_description_path = this->unpack_path + "/modelDescription.xml";
+      start_time = FMI2StartupReport::get_time();
+      if ( this->description_cache_dir.empty() ) {
+         status = this->description->parse( model_description_path );
+      }
+      else {
+         status = this->description->parse_cached( model_description_path,
+                                                   this->description_cache_dir );
+      }
+      this->startup_report.parse_time = FMI2StartupReport::get_time() - start_time;
+      if ( status != fmi2OK ){
+         std::cerr << this->description->get_error() << std::endl;
+         return( fmi2Fatal );
+      }
+
+   }
+
+   // Check model modality.
+   if (    (this->modality == fmi2ModelExchange)
+        && !this->description->model_exchange ) {
+      return( fmi2Fatal );
+   }
+   if (    (this->modality == fmi2CoSimulation)
+        && !this->description->co_simulation ) {
+      return( fmi2Fatal );
+   }
+
+   /* Load the dynamic library. */
+   if ( this->load_library() != fmi2OK ) {
+      return( fmi2Fatal );
+   }
+
+   /* Return success. */
+   return( fmi2OK );
+}
+
+
+/*!
+ * @brief Load an FMU through the shared FMU image registry.
+ *
+ * The first model object to load an FMU with a given modality loads it into
+ * a shared FMI2FMUImage.  The other model objects reuse the image and only
+ * bind their function pointers, which are looked up once in the image.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::load_shared_fmu( void )
+{
+   char real_path[PATH_MAX];
+   std::string image_key;
+   bool loaded;
+
+   // The image is keyed by the FMU file and the modality.
+   if ( realpath( this->fmu_path.c_str(), real_path ) == NULL ) {
+      std::cerr << "Error finding FMU file: " << fmu_path << std::endl;
+      return( fmi2Fatal );
+   }
+   image_key = real_path;
+   image_key += (this->modality == fmi2ModelExchange) ? ":ModelExchange" : ":CoSimulation";
+
+   // Get the image and make sure that the FMU is loaded into it.
+   this->image = FMI2FMUImage::acquire( image_key );
+   this->image->lock_load();
+   this->description = &this->image->model_description;
+   if ( !this->image->loaded ) {
+
+      if ( this->load_fmu_files() == fmi2OK ) {
+
+         // Hand the loaded FMU over to the image.
+         this->image->unpack_path         = this->unpack_path;
+         this->image->library_path        = this->library_path;
+         this->image->library_variant     = this->library_variant;
+         this->image->library_fd          = this->library_fd;
+         this->image->cache_refs_fd       = this->cache_refs_fd;
+         this->image->delete_unpacked_fmu = this->delete_unpacked_fmu;
+         this->image->model_library       = this->model_library;
+         this->image->single_instance =
+            this->get_capabilities().can_be_instantiated_only_once_per_process;
+         this->library_fd    = -1;
+         this->cache_refs_fd = -1;
+         this->image->loaded = true;
+
+      }
+      else {
+
+         // Clean up what was loaded; another model object can try again.
+         this->close_library();
+         if ( this->cache_refs_fd >= 0 ) {
+            this->release_unpack_cache();
+         }
+         else if ( this->delete_unpacked_fmu ) {
+            this->remove_unpack_dir();
+         }
+
+      }
+
+   }
+   else {
+
+      // Use the FMU already loaded into the image.
+      this->unpack_path   = this->image->unpack_path;
+      this->library_path  = this->image->library_path;
+      this->library_variant = this->image->library_variant;
+      this->model_library = this->image->model_library;
+
+   }
+   loaded = this->image->loaded;
+   this->image->unlock_load();
+
+   if ( !loaded ) {
+      this->release_fmu_image();
+      return( fmi2Fatal );
+   }
+
+   return( this->bind_function_ptrs_timed() );
+}
+
+
+/*!
+ * @brief Bind all the internal FMI2 function pointers and time it.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::bind_function_ptrs_timed( void )
+{
+   double start_time = FMI2StartupReport::get_time();
+   fmi2Status status;
+
+   status = this->bind_function_ptrs();
+   this->startup_report.bind_time = FMI2StartupReport::get_time() - start_time;
+
+   return( status );
+}
+
+
+/*!
+ * @brief Release the shared FMU image.
+ *
+ * The FMU resources borrowed from the image are dropped.  If this is the last
+ * model object using the image, the resources are taken back from the image
+ * so they are cleaned up with this object.
+ */
+void TrickFMI::FMI2ModelBase::release_fmu_image( void )
+{
+   FMI2FMUImage * shared_image = this->image;
+
+   if ( shared_image == NULL ) { return; }
+
+   // Drop the borrowed resources.
+   this->image         = NULL;
+   this->description   = &this->model_description;
+   this->model_library = NULL;
+   this->unpack_path.clear();
+   this->library_path.clear();
+   this->library_variant.clear();
+
+   // The last user takes back the resources.
+   if ( FMI2FMUImage::release( shared_image ) ) {
+      this->unpack_path         = shared_image->unpack_path;
+      this->library_path        = shared_image->library_path;
+      this->library_variant     = shared_image->library_variant;
+      this->library_fd          = shared_image->library_fd;
+      this->cache_refs_fd       = shared_image->cache_refs_fd;
+      this->delete_unpacked_fmu = shared_image->delete_unpacked_fmu;
+      this->model_library       = shared_image->model_library;
+      delete shared_image;
+   }
+
+   return;
+}
+
+
+/*!
+ * @brief Look up the value references of model variables by name.
+ *
+ * @return Returns fmi2OK if all the variables are found or fmi2Error if any
+ * variable is not found.
+ * @param [in]  names Model variable names.
+ * @param [in]  nvr   Number of variable names.
+ * @param [out] vr    Value references of the variables.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::get_value_references(
+   const char * const       names[],
+         size_t             nvr,
+         fmi2ValueReference vr[]    )
+{
+   fmi2Status status = fmi2OK;
+   size_t iinc;
+   int index;
+
+   for ( iinc = 0 ; iinc < nvr ; iinc++ ) {
+      index = this->description->variables.find( names[iinc] );
+      if ( index < 0 ) {
+         std::cerr << "Unknown model variable: " << names[iinc] << std::endl;
+         status = fmi2Error;
+         continue;
+      }
+      vr[iinc] = this->description->variables.get_value_reference( index );
+   }
+
+   return( status );
+}
+
+
+/*!
+ * @brief Override the start value of a numeric model variable.
+ *
+ * The override is kept by name, so it can be set (for example from the
+ * Trick input file) before the FMU is loaded.  It is set in the model by
+ * apply_start_values() when the model enters initialization mode.
+ *
+ * @param [in] name  Name of the model variable.
+ * @param [in] value Start value.  Boolean values are 0 or 1.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::set_start_value(
+   const char * name,
+   double       value )
+{
+   this->string_start_overrides.erase( name );
+   this->start_overrides[ name ] = value;
+   return( fmi2OK );
+}
+
+
+/*!
+ * @brief Override the start value of a String model variable.
+ *
+ * @param [in] name  Name of the model variable.
+ * @param [in] value Start value.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::set_start_value(
+   const char * name,
+   const char * value )
+{
+   this->start_overrides.erase( name );
+   this->string_start_overrides[ name ] = value;
+   return( fmi2OK );
+}
+
+
+//! @brief Remove all the start value overrides.
+void TrickFMI::FMI2ModelBase::clear_start_values( void )
+{
+   this->start_overrides.clear();
+   this->string_start_overrides.clear();
+   return;
+}
+
+
+/*!
+ * @brief Start value of a model variable gathered by apply_start_values().
+ */
+typedef struct {
+   TrickFMI::FMI2VariableType type;    //!< Base type (Enumeration is Integer).
+   fmi2ValueReference value_reference; //!< Variable value reference.
+   size_t             order;           //!< Gathering order (later entries win).
+   size_t             index;           //!< Variable index.
+   double             value;           //!< Numeric start value.
+   const char       * string;          //!< String start value or NULL.
+} StartEntry;
+
+/*!
+ * @brief Get the base type whose value references a variable shares.
+ * @return FMI2Integer for Enumeration variables, otherwise the type.
+ * @param [in] type Model variable type.
+ */
+static TrickFMI::FMI2VariableType start_entry_type( TrickFMI::FMI2VariableType type )
+{
+   return( (type == TrickFMI::FMI2Enumeration) ? TrickFMI::FMI2Integer : type );
+}
+
+/*!
+ * @brief Start value ordering by base type, value reference then gathering
+ * order.  Value references are only unique within a base type.
+ */
+static bool start_entry_less(
+   const StartEntry & left,
+   const StartEntry & right )
+{
+   if ( left.type != right.type ) {
+      return( left.type < right.type );
+   }
+   if ( left.value_reference != right.value_reference ) {
+      return( left.value_reference < right.value_reference );
+   }
+   return( left.order < right.order );
+}
+
+
+/*!
+ * @brief Set the start values in the model with one call per type.
+ *
+ * The start values from the model description (if @ref
+ * apply_description_starts is set) and the start value overrides are
+ * gathered into per-type buffers sorted by value reference.  Aliases share
+ * a value reference within a base type, so each value reference of a type is
+ * set once, with overrides taking precedence over the model description.
+ * Constant and independent variables are never set.  The per-type buffers
+ * keep their capacity between calls.
+ *
+ * @return Returns the worst status of the set calls or fmi2Error if an
+ * override names an unknown variable or has the wrong type.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::apply_start_values( void )
+{
+   const FMI2VariableTable & variables = this->description->variables;
+   std::map<std::string, double>::const_iterator override_iter;
+   std::map<std::string, std::string>::const_iterator string_iter;
+   std::vector<StartEntry> entries;
+   StartEntry entry;
+   fmi2Status status = fmi2OK;
+   fmi2Status set_status;
+   size_t iinc;
+   int index;
+
+   memset( &entry, 0, sizeof(entry) );
+
+   // Gather the model description start values.
+   if ( this->apply_description_starts ) {
+      entries.reserve( variables.size() + this->start_overrides.size()
+                       + this->string_start_overrides.size() );
+      for ( iinc = 0 ; iinc < variables.size() ; iinc++ ) {
+         if (    !variables.has_start( iinc )
+              || (variables.get_variability( iinc ) == FMI2Constant)
+              || (variables.get_causality( iinc ) == FMI2Independent) ) {
+            continue;
+         }
+         entry.type            = start_entry_type( variables.get_type( iinc ) );
+         entry.value_reference = variables.get_value_reference( iinc );
+         entry.index           = iinc;
+         entry.value           = variables.get_start( iinc );
+         entry.string          = variables.get_start_string( iinc );
+         entries.push_back( entry );
+         entry.order++;
+      }
+   }
+
+   // Gather the overrides.
+   for ( override_iter = this->start_overrides.begin() ;
+         override_iter != this->start_overrides.end() ; ++override_iter ) {
+      index = variables.find( override_iter->first.c_str() );
+      if ( (index < 0) || (variables.get_type( index ) == FMI2String) ) {
+         std::cerr << ( (index < 0) ? "Unknown model variable: " : "Not a numeric model variable: " )
+                   << override_iter->first << std::endl;
+         status = fmi2Error;
+         continue;
+      }
+      entry.type            = start_entry_type( variables.get_type( index ) );
+      entry.value_reference = variables.get_value_reference( index );
+      entry.index           = index;
+      entry.value           = override_iter->second;
+      entry.string          = NULL;
+      entries.push_back( entry );
+      entry.order++;
+   }
+   for ( string_iter = this->string_start_overrides.begin() ;
+         string_iter != this->string_start_overrides.end() ; ++string_iter ) {
+      index = variables.find( string_iter->first.c_str() );
+      if ( (index < 0) || (variables.get_type( index ) != FMI2String) ) {
+         std::cerr << ( (index < 0) ? "Unknown model variable: " : "Not a String model variable: " )
+                   << string_iter->first << std::endl;
+         status = fmi2Error;
+         continue;
+      }
+      entry.type            = start_entry_type( variables.get_type( index ) );
+      entry.value_reference = variables.get_value_reference( index );
+      entry.index           = index;
+      entry.value           = 0.0;
+      entry.string          = string_iter->second.c_str();
+      entries.push_back( entry );
+      entry.order++;
+   }
+
+   // Sort by type and value reference and build the per-type buffers,
+   // keeping the last entry for each value reference of a type.
+   std::sort( entries.begin(), entries.end(), start_entry_less );
+   this->real_start_refs.clear();
+   this->real_start_values.clear();
+   this->integer_start_refs.clear();
+   this->integer_start_values.clear();
+   this->boolean_start_refs.clear();
+   this->boolean_start_values.clear();
+   this->string_start_refs.clear();
+   this->string_start_values.clear();
+   for ( iinc = 0 ; iinc < entries.size() ; iinc++ ) {
+      if (    (iinc + 1 < entries.size())
+           && (entries[iinc + 1].type == entries[iinc].type)
+           && (entries[iinc + 1].value_reference == entries[iinc].value_reference) ) {
+         continue;
+      }
+      if ( entries[iinc].type == FMI2Real ) {
+         this->real_start_refs.push_back( entries[iinc].value_reference );
+         this->real_start_values.push_back( entries[iinc].value );
+      }
+      else if ( entries[iinc].type == FMI2Integer ) {
+         this->integer_start_refs.push_back( entries[iinc].value_reference );
+         this->integer_start_values.push_back( (fmi2Integer)entries[iinc].value );
+      }
+      else if ( entries[iinc].type == FMI2Boolean ) {
+         this->boolean_start_refs.push_back( entries[iinc].value_reference );
+         this->boolean_start_values.push_back( (entries[iinc].value != 0.0) ? fmi2True : fmi2False );
+      }
+      else if ( entries[iinc].string != NULL ) {
+         this->string_start_refs.push_back( entries[iinc].value_reference );
+         this->string_start_values.push_back( entries[iinc].string );
+      }
+   }
+
+   // Set the values with one call per type.
+   if ( !this->real_start_refs.empty() ) {
+      set_status = this->fmi2SetReal( &this->real_start_refs[0],
+                                      this->real_start_refs.size(),
+                                      &this->real_start_values[0] );
+      if ( set_status > status ) { status = set_status; }
+   }
+   if ( !this->integer_start_refs.empty() ) {
+      set_status = this->fmi2SetInteger( &this->integer_start_refs[0],
+                                         this->integer_start_refs.size(),
+                                         &this->integer_start_values[0] );
+      if ( set_status > status ) { status = set_status; }
+   }
+   if ( !this->boolean_start_refs.empty() ) {
+      set_status = this->fmi2SetBoolean( &this->boolean_start_refs[0],
+                                         this->boolean_start_refs.size(),
+                                         &this->boolean_start_values[0] );
+      if ( set_status > status ) { status = set_status; }
+   }
+   if ( !this->string_start_refs.empty() ) {
+      set_status = this->fmi2SetString( &this->string_start_refs[0],
+                                        this->string_start_refs.size(),
+                                        &this->string_start_values[0] );
+      if ( set_status > status ) { status = set_status; }
+   }
+
+   // The string values point into the overrides and the variable table.
+   this->string_start_values.clear();
+
+   return( status );
+}
+
+
+/*!
+ * @brief Choose the host strategies allowed by the FMU capabilities.
+ *
+ * This is called once when the FMU is loaded so that the strategies are
+ * known up front instead of being discovered through failed calls.
+ * Subclasses extend this for modality specific strategies.
+ */
+void TrickFMI::FMI2ModelBase::select_host_strategies()
+{
+   const FMI2Capabilities & capabilities = this->get_capabilities();
+
+   this->use_fmu_state_rollback     = capabilities.can_get_and_set_fmu_state;
+   this->use_directional_derivative = capabilities.provides_directional_derivative;
+
+   return;
+}
+
+
+/*!
+ * @brief Check if the model state can be rolled back.
+ *
+ * @return Returns true if save_rollback_state() and restore_rollback_state()
+ * roll back the full FMU state, which needs the FMU canGetAndSetFMUstate
+ * capability.
+ */
+bool TrickFMI::FMI2ModelBase::can_rollback( void )
+{
+   return( this->use_fmu_state_rollback );
+}
+
+
+/*!
+ * @brief Save the model state so that it can be rolled back.
+ *
+ * The FMU state is saved with fmi2GetFMUstate.  A previously saved state is
+ * updated in place.
+ *
+ * @return Returns the fmi2GetFMUstate status or fmi2Error if the FMU can not
+ * get and set its state.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::save_rollback_state( void )
+{
+   if ( !this->use_fmu_state_rollback ) {
+      return( fmi2Error );
+   }
+   return( this->fmi2GetFMUstate( &this->rollback_state ) );
+}
+
+
+/*!
+ * @brief Roll the model state back to the last saved state.
+ *
+ * @return Returns the fmi2SetFMUstate status or fmi2Error if there is no
+ * saved state.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::restore_rollback_state( void )
+{
+   if ( !this->use_fmu_state_rollback || (this->rollback_state == NULL) ) {
+      return( fmi2Error );
+   }
+   return( this->fmi2SetFMUstate( this->rollback_state ) );
+}
+
+
+/*!
+ * @brief Free the saved rollback state.
+ */
+void TrickFMI::FMI2ModelBase::free_rollback_state( void )
+{
+   if ( this->rollback_state != NULL ) {
+      this->fmi2FreeFMUstate( &this->rollback_state );
+      this->rollback_state = NULL;
+   }
+   return;
+}
+
+
+/*!
+ * @brief Set the values of the known variables of a directional derivative.
+ *
+ * This is used to perturb the known variables for finite differences.
+ * Subclasses override this for variables that can not be set with
+ * fmi2SetReal.
+ *
+ * @param [in] vr    Value references of the known variables.
+ * @param [in] nvr   Number of known variables.
+ * @param [in] value Values of the known variables.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::set_known_reals(
+   const fmi2ValueReference vr[],
+         size_t             nvr,
+   const fmi2Real           value[] )
+{
+   return( this->fmi2SetReal( vr, nvr, value ) );
+}
+
+
+/*!
+ * @brief Bring the model unknowns up to date after the knowns are set.
+ *
+ * The base implementation does nothing.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::evaluate_unknowns()
+{
+   return( fmi2OK );
+}
+
+
+/*!
+ * @brief Get the model time carried across an FMU swap.
+ *
+ * The base implementation returns zero.  Subclasses return the time the
+ * model has reached.
+ */
+fmi2Real TrickFMI::FMI2ModelBase::get_swap_time( void )
+{
+   return( 0.0 );
+}
+
+
+/*!
+ * @brief Bring a swapped in FMU instance back to where the old one was.
+ *
+ * This is called after the new instance leaves initialization mode with
+ * the variable values of the old instance set.  The base implementation
+ * does nothing.
+ *
+ * @param [in] values Variable values of the old FMU instance.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::resume_swapped_instance(
+   const SwapValues & /*values*/ )
+{
+   return( fmi2OK );
+}
+
+
+/*!
+ * @brief Compute a directional derivative of the model.
+ *
+ * This computes dvUnknown = (d unknowns / d knowns) * dvKnown.  If the FMU
+ * provides directional derivatives, fmi2GetDirectionalDerivative is used.
+ * Otherwise the derivative is computed with a forward finite difference
+ * along dvKnown scaled by @ref finite_difference_step and the known
+ * variables are restored afterwards.
+ *
+ * @param [in]  vUnknown_ref Value references of the unknowns.
+ * @param [in]  nUnknown     Number of unknowns.
+ * @param [in]  vKnown_ref   Value references of the knowns.
+ * @param [in]  nKnown       Number of knowns.
+ * @param [in]  dvKnown      Seed vector of the knowns.
+ * @param [out] dvUnknown    Directional derivative of the unknowns.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::directional_derivative(
+   const fmi2ValueReference vUnknown_ref[],
+         size_t             nUnknown,
+   const fmi2ValueReference vKnown_ref[],
+         size_t             nKnown,
+   const fmi2Real           dvKnown[],
+         fmi2Real           dvUnknown[]    )
+{
+   fmi2Real * known;
+   fmi2Real * perturbed;
+   fmi2Real * unknown;
+   fmi2Real known_norm = 0.0;
+   fmi2Real seed_norm  = 0.0;
+   fmi2Real step;
+   fmi2Status status;
+   fmi2Status restore_status;
+   size_t iinc;
+
+   if ( this->use_directional_derivative ) {
+      return( this->fmi2GetDirectionalDerivative( vUnknown_ref, nUnknown,
+                                                  vKnown_ref, nKnown,
+                                                  dvKnown, dvUnknown ) );
+   }
+
+   // Lay out the work space: knowns, perturbed knowns and base unknowns.
+   this->derivative_work.resize( 2 * nKnown + nUnknown + 1 );
+   known     = &this->derivative_work[0];
+   perturbed = known + nKnown;
+   unknown   = perturbed + nKnown;
+
+   // Get the current knowns and unknowns.
+   status = this->fmi2GetReal( vKnown_ref, nKnown, known );
+   if ( status > fmi2Warning ) { return( status ); }
+   status = this->evaluate_unknowns();
+   if ( status > fmi2Warning ) { return( status ); }
+   status = this->fmi2GetReal( vUnknown_ref, nUnknown, unknown );
+   if ( status > fmi2Warning ) { return( status ); }
+
+   // Pick a step along the seed scaled to the size of the knowns.
+   for ( iinc = 0 ; iinc < nKnown ; iinc++ ) {
+      known_norm = fmax( known_norm, fabs( known[iinc] ) );
+      seed_norm  = fmax( seed_norm, fabs( dvKnown[iinc] ) );
+   }
+   if ( seed_norm == 0.0 ) {
+      for ( iinc = 0 ; iinc < nUnknown ; iinc++ ) { dvUnknown[iinc] = 0.0; }
+      return( fmi2OK );
+   }
+   step = this->finite_difference_step * (1.0 + known_norm) / seed_norm;
+
+   // Evaluate the unknowns at the perturbed knowns.
+   for ( iinc = 0 ; iinc < nKnown ; iinc++ ) {
+      perturbed[iinc] = known[iinc] + step * dvKnown[iinc];
+   }
+   status = this->set_known_reals( vKnown_ref, nKnown, perturbed );
+   if ( status <= fmi2Warning ) {
+      status = this->evaluate_unknowns();
+   }
+   if ( status <= fmi2Warning ) {
+      status = this->fmi2GetReal( vUnknown_ref, nUnknown, dvUnknown );
+   }
+
+   // Restore the knowns.
+   restore_status = this->set_known_reals( vKnown_ref, nKnown, known );
+   if ( restore_status <= fmi2Warning ) {
+      restore_status = this->evaluate_unknowns();
+   }
+   if ( restore_status > status ) { status = restore_status; }
+   if ( status > fmi2Warning ) { return( status ); }
+
+   for ( iinc = 0 ; iinc < nUnknown ; iinc++ ) {
+      dvUnknown[iinc] = (dvUnknown[iinc] - unknown[iinc]) / step;
+   }
+
+   return( status );
+}
+
+
+/*!
+ * @brief Load an FMU.
+ *
+ * This routine loads in the FMU specified by the C style string
+ * passed in as an argument.  Note that this will also set the
+ * @ref fmu_path class variable.
+ *
+ * @param [in] path A C-style string that specifies the path to the FMU.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::load_fmu( const char * path )
+{
+   this->fmu_path = path;
+   return( this->load_fmu() );
+}
+
+
+/*!
+ * @brief Load an FMU.
+ *
+ * This routine loads in the FMU specified by the C++ style string
+ * passed in as an argument.  Note that this will also set the
+ * @ref fmu_path class variable.
+ *
+ * @param [in] path A C++-style string that specifies the path to the FMU.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::load_fmu( std::string path )
+{
+   this->fmu_path = path;
+   return( this->load_fmu() );
+}
+
+
+/*!
+ * @brief Count the variables renumbered by a new model description.
+ *
+ * @return Number of variables of both descriptions with a different value
+ * reference or type in the new one.
+ * @param [in] old_variables Variables of the old model description.
+ * @param [in] new_variables Variables of the new model description.
+ */
+static size_t count_renumbered_variables(
+   const TrickFMI::FMI2VariableTable & old_variables,
+   const TrickFMI::FMI2VariableTable & new_variables )
+{
+   size_t renumbered = 0;
+   size_t iinc;
+   int index;
+
+   for ( iinc = 0 ; iinc < old_variables.size() ; iinc++ ) {
+      index = new_variables.find( old_variables.get_name( iinc ) );
+      if (    (index >= 0)
+           && (    (new_variables.get_value_reference( index )
+                    != old_variables.get_value_reference( iinc ))
+                || (new_variables.get_type( index ) != old_variables.get_type( iinc )) ) ) {
+         renumbered++;
+      }
+   }
+
+   return( renumbered );
+}
+
+
+/*!
+ * @brief Replace the running FMU with a new version.
+ *
+ * This routine replaces the running FMU with a new version of it
+ * without restarting the simulation.  See swap_fmu( std::string ).
+ *
+ * @param [in] path C-style string that specifies the path to the new FMU.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::swap_fmu( const char * path )
+{
+   return( this->swap_fmu( std::string( path ) ) );
+}
+
+
+/*!
+ * @brief Replace the running FMU with a new version.
+ *
+ * The new FMU is loaded beside the running one with the same load settings
+ * and instantiated with the same instance name, callback functions and
+ * experiment setup.  The model state is then carried across.  When both
+ * FMUs can serialize their state and have the same GUID, the serialized
+ * state of the running instance is set on the new one.  Otherwise, the
+ * values of the running FMU variables are set on the new FMU variables of
+ * the same name in initialization mode and a Model Exchange model is
+ * brought back into Continuous-Time Mode at the current time with its
+ * continuous states.
+ *
+ * The functions of the new FMU only replace those of the running FMU once
+ * the new instance holds the state; the old instance, library and unpacked
+ * FMU are released after that.  If any step fails, the new FMU is released
+ * and the running FMU is left in place.  The @ref startup_report covers
+ * the loading of the new FMU.
+ *
+ * The new FMU may number its variables differently.  Value references
+ * looked up before the swap, and the FMI2RealBinding and FMI2TransferPlan
+ * objects built on this model, are not updated; a warning is printed when
+ * a variable of both FMUs changes its value reference or type, and they
+ * have to be built again.
+ *
+ * @return Returns fmi2OK if the new FMU is running or fmi2Error if the
+ * running FMU is kept.
+ * @param [in] path C++-style string that specifies the path to the new FMU.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::swap_fmu( std::string path )
+{
+   std::vector<fmi2Byte> state;
+   std::string resource_location;
+   fmi2FreeInstanceTYPE * old_free_instance;
+   SwapValues values;
+   LoadedFMU old_fmu;
+   fmi2Real time;
+   fmi2Status status;
+   size_t renumbered;
+
+   // Only a running instance of an FMU loaded by this object is swapped.
+   if ( this->component == NULL ) {
+      std::cerr << "No FMU instance to swap: " << this->fmu_path << std::endl;
+      return( fmi2Error );
+   }
+   if ( (this->image != NULL) || (this->static_functions != NULL) ) {
+      std::cerr << "Shared and statically linked FMUs can not be swapped: "
+                << this->fmu_path << std::endl;
+      return( fmi2Error );
+   }
+
+   // Capture the state of the running instance.
+   this->free_rollback_state();
+   if (    this->get_capabilities().can_serialize_fmu_state
+        && (this->get_serialized_state( state ) != fmi2OK) ) {
+      state.clear();
+   }
+   if ( this->get_swap_values( values ) > fmi2Warning ) {
+      std::cerr << "Error getting the model state to swap: " << this->fmu_path << std::endl;
+      return( fmi2Error );
+   }
+   time              = this->get_swap_time();
+   old_free_instance = this->free_instance;
+   resource_location = this->instance_resource_location;
+
+   // Set the running FMU aside and load the new one in its place.
+   old_fmu.component     = NULL;
+   old_fmu.fmu_path      = path;
+   old_fmu.library_fd    = -1;
+   old_fmu.cache_refs_fd = -1;
+   old_fmu.model_library = NULL;
+   old_fmu.description   = new FMI2FMUModelDescription;
+   this->exchange_loaded_fmu( old_fmu );
+   this->swap_count++;
+   status = this->load_fmu();
+
+   // Instantiate the new FMU and carry the state across.  A serialized
+   // state only carries over to the same model structure.
+   if ( status == fmi2OK ) {
+      if ( this->description->GUID != old_fmu.description->GUID ) {
+         state.clear();
+      }
+      status = this->start_swapped_instance( old_fmu.unpack_path, state,
+                                             values, time );
+   }
+
+   if ( status > fmi2Warning ) {
+
+      // Drop the new FMU and put the running one back.
+      std::cerr << "Error swapping in FMU, keeping the running FMU: "
+                << path << std::endl;
+      if ( this->component != NULL ) {
+         this->fmi2FreeInstance();
+      }
+      this->clean_up();
+      this->exchange_loaded_fmu( old_fmu );
+      this->release_loaded_fmu( old_fmu );
+      delete old_fmu.description;
+      this->instance_resource_location = resource_location;
+      this->bind_function_ptrs();
+      this->select_host_strategies();
+      return( fmi2Error );
+
+   }
+
+   // Value references held outside this object are not updated.
+   renumbered = count_renumbered_variables( old_fmu.description->variables,
+                                            this->description->variables );
+   if ( renumbered > 0 ) {
+      std::cerr << "Warning: the new FMU renumbers " << renumbered
+                << " model variables; rebuild the value references, bindings"
+                << " and transfer plans of this model: " << path << std::endl;
+   }
+
+   // The new FMU is running; release the old one.
+   if ( old_free_instance != NULL ) {
+      old_free_instance( old_fmu.component );
+   }
+   this->release_loaded_fmu( old_fmu );
+   if ( old_fmu.description != &this->model_description ) {
+      delete old_fmu.description;
+   }
+   this->swap_description = this->description;
+
+   return( fmi2OK );
+}
+
+
+/*!
+ * @brief Exchange the loaded FMU resources with a set aside FMU.
+ *
+ * @param [inout] other Resources of the set aside FMU.
+ */
+void TrickFMI::FMI2ModelBase::exchange_loaded_fmu( LoadedFMU & other )
+{
+   std::swap( this->component,       other.component );
+   std::swap( this->fmu_path,        other.fmu_path );
+   std::swap( this->unpack_path,     other.unpack_path );
+   std::swap( this->library_path,    other.library_path );
+   std::swap( this->library_variant, other.library_variant );
+   std::swap( this->library_fd,      other.library_fd );
+   std::swap( this->cache_refs_fd,   other.cache_refs_fd );
+   std::swap( this->model_library,   other.model_library );
+   std::swap( this->description,     other.description );
+   return;
+}
+
+
+/*!
+ * @brief Close the library and release the unpacked files of a set aside FMU.
+ *
+ * The FMU instance and model description are not touched.
+ *
+ * @param [inout] loaded Resources of the set aside FMU.
+ */
+void TrickFMI::FMI2ModelBase::release_loaded_fmu( LoadedFMU & loaded )
+{
+   this->exchange_loaded_fmu( loaded );
+   this->close_library();
+   if ( this->cache_refs_fd >= 0 ) {
+      if ( this->release_unpack_cache() ) {
+         perror( "Error releasing the unpack cache" );
+      }
+   }
+   else if ( this->delete_unpacked_fmu ) {
+      if ( this->remove_unpack_dir() ) {
+         perror( "Error removing the unpack directory" );
+      }
+   }
+   this->exchange_loaded_fmu( loaded );
+   return;
+}
+
+
+/*!
+ * @brief Get the values of the model variables by name for an FMU swap.
+ *
+ * Values are read with one call per type for all the variables except
+ * constants and the independent variable.
+ *
+ * @param [out] values Variable values by name.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::get_swap_values( SwapValues & values )
+{
+   const FMI2VariableTable & variables = this->description->variables;
+   std::vector<size_t> real_index, integer_index, boolean_index, string_index;
+   std::vector<fmi2ValueReference> refs;
+   std::vector<fmi2Real>    reals;
+   std::vector<fmi2Integer> integers;
+   std::vector<fmi2Boolean> booleans;
+   std::vector<fmi2String>  strings;
+   fmi2Status status = fmi2OK;
+   fmi2Status get_status;
+   FMI2VariableType type;
+   size_t iinc;
+
+   // Sort the variables by type.
+   for ( iinc = 0 ; iinc < variables.size() ; iinc++ ) {
+      if (    (variables.get_variability( iinc ) == FMI2Constant)
+           || (variables.get_causality( iinc ) == FMI2Independent) ) {
+         continue;
+      }
+      type = variables.get_type( iinc );
+      if ( type == FMI2Real ) {
+         real_index.push_back( iinc );
+      }
+      else if ( (type == FMI2Integer) || (type == FMI2Enumeration) ) {
+         integer_index.push_back( iinc );
+      }
+      else if ( type == FMI2Boolean ) {
+         boolean_index.push_back( iinc );
+      }
+      else {
+         string_index.push_back( iinc );
+      }
+   }
+
+   // Get the values with one call per type.
+   if ( !real_index.empty() ) {
+      refs.resize( real_index.size() );
+      reals.resize( real_index.size() );
+      for ( iinc = 0 ; iinc < real_index.size() ; iinc++ ) {
+         refs[iinc] = variables.get_value_reference( real_index[iinc] );
+      }
+      get_status = this->fmi2GetReal( &refs[0], refs.size(), &reals[0] );
+      if ( get_status > status ) { status = get_status; }
+      for ( iinc = 0 ; iinc < real_index.size() ; iinc++ ) {
+         values.numeric[ variables.get_name( real_index[iinc] ) ] = reals[iinc];
+      }
+   }
+   if ( !integer_index.empty() ) {
+      refs.resize( integer_index.size() );
+      integers.resize( integer_index.size() );
+      for ( iinc = 0 ; iinc < integer_index.size() ; iinc++ ) {
+         refs[iinc] = variables.get_value_reference( integer_index[iinc] );
+      }
+      get_status = this->fmi2GetInteger( &refs[0], refs.size(), &integers[0] );
+      if ( get_status > status ) { status = get_status; }
+      for ( iinc = 0 ; iinc < integer_index.size() ; iinc++ ) {
+         values.numeric[ variables.get_name( integer_index[iinc] ) ] = integers[iinc];
+      }
+   }
+   if ( !boolean_index.empty() ) {
+      refs.resize( boolean_index.size() );
+      booleans.resize( boolean_index.size() );
+      for ( iinc = 0 ; iinc < boolean_index.size() ; iinc++ ) {
+         refs[iinc] = variables.get_value_reference( boolean_index[iinc] );
+      }
+      get_status = this->fmi2GetBoolean( &refs[0], refs.size(), &booleans[0] );
+      if ( get_status > status ) { status = get_status; }
+      for ( iinc = 0 ; iinc < boolean_index.size() ; iinc++ ) {
+         values.numeric[ variables.get_name( boolean_index[iinc] ) ] = booleans[iinc] ? 1.0 : 0.0;
+      }
+   }
+   if ( !string_index.empty() ) {
+      refs.resize( string_index.size() );
+      strings.assign( string_index.size(), NULL );
+      for ( iinc = 0 ; iinc < string_index.size() ; iinc++ ) {
+         refs[iinc] = variables.get_value_reference( string_index[iinc] );
+      }
+      get_status = this->fmi2GetString( &refs[0], refs.size(), &strings[0] );
+      if ( get_status > status ) { status = get_status; }
+      for ( iinc = 0 ; iinc < string_index.size() ; iinc++ ) {
+         values.strings[ variables.get_name( string_index[iinc] ) ] =
+            (strings[iinc] != NULL) ? strings[iinc] : "";
+      }
+   }
+
+   return( status );
+}
+
+
+/*!
+ * @brief Set the values of the model variables by name after an FMU swap.
+ *
+ * This is called in initialization mode.  Only the variables that can be
+ * set in initialization mode are set: parameters, inputs and the variables
+ * with an exact or approximate initial value.  Variables without a value
+ * are left at their start values.
+ *
+ * @param [in] values Variable values by name.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::set_swap_values( const SwapValues & values )
+{
+   const FMI2VariableTable & variables = this->description->variables;
+   std::map<std::string, double>::const_iterator numeric_iter;
+   std::map<std::string, std::string>::const_iterator string_iter;
+   std::vector<fmi2ValueReference> real_refs, integer_refs, boolean_refs, string_refs;
+   std::vector<fmi2Real>    reals;
+   std::vector<fmi2Integer> integers;
+   std::vector<fmi2Boolean> booleans;
+   std::vector<fmi2String>  strings;
+   fmi2Status status = fmi2OK;
+   fmi2Status set_status;
+   FMI2VariableType type;
+   FMI2Causality causality;
+   FMI2Initial initial;
+   size_t iinc;
+
+   for ( iinc = 0 ; iinc < variables.size() ; iinc++ ) {
+
+      // Skip the variables that can not be set in initialization mode.
+      causality = variables.get_causality( iinc );
+      initial   = variables.get_initial( iinc );
+      if (    (variables.get_variability( iinc ) == FMI2Constant)
+           || (causality == FMI2Independent)
+           || (causality == FMI2CalculatedParameter)
+           || (initial == FMI2Calculated)
+           || (    (initial == FMI2InitialUnspecified)
+                && (causality != FMI2Parameter)
+                && (causality != FMI2Input)              ) ) {
+         continue;
+      }
+
+      type = variables.get_type( iinc );
+      if ( type == FMI2String ) {
+         string_iter = values.strings.find( variables.get_name( iinc ) );
+         if ( string_iter != values.strings.end() ) {
+            string_refs.push_back( variables.get_value_reference( iinc ) );
+            strings.push_back( string_iter->second.c_str() );
+         }
+         continue;
+      }
+      numeric_iter = values.numeric.find( variables.get_name( iinc ) );
+      if ( numeric_iter == values.numeric.end() ) {
+         continue;
+      }
+      if ( type == FMI2Real ) {
+         real_refs.push_back( variables.get_value_reference( iinc ) );
+         reals.push_back( numeric_iter->second );
+      }
+      else if ( (type == FMI2Integer) || (type == FMI2Enumeration) ) {
+         integer_refs.push_back( variables.get_value_reference( iinc ) );
+         integers.push_back( (fmi2Integer)numeric_iter->second );
+      }
+      else {
+         boolean_refs.push_back( variables.get_value_reference( iinc ) );
+         booleans.push_back( (numeric_iter->second != 0.0) ? fmi2True : fmi2False );
+      }
+
+   }
+
+   // Set the values with one call per type.
+   if ( !real_refs.empty() ) {
+      set_status = this->fmi2SetReal( &real_refs[0], real_refs.size(), &reals[0] );
+      if ( set_status > status ) { status = set_status; }
+   }
+   if ( !integer_refs.empty() ) {
+      set_status = this->fmi2SetInteger( &integer_refs[0], integer_refs.size(), &integers[0] );
+      if ( set_status > status ) { status = set_status; }
+   }
+   if ( !boolean_refs.empty() ) {
+      set_status = this->fmi2SetBoolean( &boolean_refs[0], boolean_refs.size(), &booleans[0] );
+      if ( set_status > status ) { status = set_status; }
+   }
+   if ( !string_refs.empty() ) {
+      set_status = this->fmi2SetString( &string_refs[0], string_refs.size(), &strings[0] );
+      if ( set_status > status ) { status = set_status; }
+   }
+
+   return( status );
+}
+
+
+/*!
+ * @brief Get the serialized state of the FMU instance.
+ *
+ * @param [out] state Serialized FMU state.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::get_serialized_state(
+   std::vector<fmi2Byte> & state )
+{
+   fmi2FMUstate fmu_state = NULL;
+   size_t size = 0;
+   fmi2Status status;
+
+   status = this->fmi2GetFMUstate( &fmu_state );
+   if ( status <= fmi2Warning ) {
+      status = this->fmi2SerializedFMUstateSize( fmu_state, &size );
+   }
+   if ( (status <= fmi2Warning) && (size > 0) ) {
+      state.resize( size );
+      status = this->fmi2SerializeFMUstate( fmu_state, &state[0], size );
+   }
+   if ( fmu_state != NULL ) {
+      this->fmi2FreeFMUstate( &fmu_state );
+   }
+
+   return( ((status <= fmi2Warning) && (size > 0)) ? fmi2OK : fmi2Error );
+}
+
+
+/*!
+ * @brief Set a serialized state on the FMU instance.
+ *
+ * @param [in] state Serialized FMU state.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::set_serialized_state(
+   const std::vector<fmi2Byte> & state )
+{
+   fmi2FMUstate fmu_state = NULL;
+   fmi2Status status;
+
+   status = this->fmi2DeSerializeFMUstate( &state[0], state.size(), &fmu_state );
+   if ( status <= fmi2Warning ) {
+      status = this->fmi2SetFMUstate( fmu_state );
+   }
+   if ( fmu_state != NULL ) {
+      this->fmi2FreeFMUstate( &fmu_state );
+   }
+
+   return( (status <= fmi2Warning) ? fmi2OK : fmi2Error );
+}
+
+
+/*!
+ * @brief Instantiate a swapped in FMU and give it the state of the old one.
+ *
+ * A resource location inside the old unpacked FMU is moved to the new
+ * unpacked FMU.
+ *
+ * @param [in] old_unpack_path Path to the old unpacked FMU.
+ * @param [in] state           Serialized state of the old FMU or empty.
+ * @param [in] values          Variable values of the old FMU.
+ * @param [in] time            Model time of the old FMU.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::start_swapped_instance(
+   const std::string           & old_unpack_path,
+   const std::vector<fmi2Byte> & state,
+   const SwapValues            & values,
+         fmi2Real                time             )
+{
+   std::string name = this->instance_name;
+   std::string resource_location = this->instance_resource_location;
+   fmi2Status status;
+   fmi2Status step_status;
+   size_t pos;
+
+   // Instantiate the new FMU.
+   if ( !old_unpack_path.empty() && !this->unpack_path.empty() ) {
+      pos = resource_location.find( old_unpack_path );
+      if ( pos != std::string::npos ) {
+         resource_location.replace( pos, old_unpack_path.size(), this->unpack_path );
+      }
+   }
+   if ( this->fmi2Instantiate( name.c_str(), this->modality,
+                               this->description->GUID.c_str(),
+                               resource_location.c_str(),
+                               this->instance_callbacks,
+                               this->instance_visible,
+                               this->instance_logging_on ) == NULL ) {
+      return( fmi2Fatal );
+   }
+
+   // Set the serialized state if the new FMU takes it.
+   if ( !state.empty() && this->get_capabilities().can_serialize_fmu_state ) {
+      if ( this->set_serialized_state( state ) == fmi2OK ) {
+         return( fmi2OK );
+      }
+      std::cerr << "Serialized FMU state not accepted by the new FMU, "
+                << "setting the variable values instead." << std::endl;
+   }
+
+   // Otherwise, set the variable values in initialization mode.
+   status = this->fmi2SetupExperiment( this->experiment_tolerance_defined,
+                                       this->experiment_tolerance,
+                                       time,
+                                       this->experiment_stop_time_defined,
+                                       this->experiment_stop_time );
+   if ( status > fmi2Warning ) { return( status ); }
+   status = this->fmi2EnterInitializationMode();
+   if ( status > fmi2Warning ) { return( status ); }
+   step_status = this->set_swap_values( values );
+   if ( step_status > status ) { status = step_status; }
+   if ( status > fmi2Warning ) { return( status ); }
+   step_status = this->fmi2ExitInitializationMode();
+   if ( step_status > status ) { status = step_status; }
+   if ( status > fmi2Warning ) { return( status ); }
+
+   // Bring the model back to where the old one was.
+   step_status = this->resume_swapped_instance( values );
+   if ( step_status > status ) { status = step_status; }
+
+   return( status );
+}
+
+
+/*!
+ * @brief Unpacks the FMU.
+ *
+ * This routine finds the FMU file, creates the appropriate
+ * directories and unzips the archive into the expanded FMU directory
+ * structure.  This is a prerequisite for loading the library.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::unpack_fmu( )
+{
+   struct stat unpack_dir_stat;
+
+   //
+   // Create the directory in which to unpack the archive.
+   //
+   // First check to make sure that the unpacking area does exist.
+   if (     stat( unpack_dir.c_str(), &unpack_dir_stat )
+         || !S_ISDIR( unpack_dir_stat.st_mode )           ) {
+      std::cerr << "Unpacking area does not exist: " << unpack_dir << std::endl;
+      return( fmi2Fatal );
+   }
+
+   // Build the unpack path.  A swapped in FMU version is unpacked beside
+   // the running one.
+   unpack_path = unpack_dir + "/" + this->fmu_base_name();
+   if ( this->swap_count > 0 ) {
+      std::ostringstream swap_suffix;
+      swap_suffix << "." << this->swap_count;
+      unpack_path += swap_suffix.str();
+   }
+
+   // Check to make sure that the directory doesn't already exist.
+   if ( stat( unpack_path.c_str(), &unpack_dir_stat ) == 0 ){
+      std::cerr << "FMU unpacking directory already exists: " << unpack_path << std::endl;
+      return( fmi2Fatal );
+   }
+   else {
+      if ( errno != ENOENT ){
+         perror( "Error associated with unpack directory" );
+         return( fmi2Fatal );
+      }
+   }
+
+   // Create the unpack directory.
+   if ( mkdir( unpack_path.c_str(), 0000755 ) ) {
+      std::cerr << "Error creating the unpack directory: " << unpack_path << std::endl;
+      perror( "Error creating the unpack directory" );
+      return( fmi2Fatal );
+   }
+
+   // Extract the FMU archive into the unpack directory.
+   return( this->extract_fmu( unpack_path, NULL ) );
+}
+
+
+/*!
+ * @brief Unpacks the FMU into the shared unpack cache.
+ *
+ * This routine unpacks the FMU into a directory in the unpacking area that
+ * is named for the FMU and the hash of its contents.  Access to the cache
+ * entry is serialized with an exclusive lock on the associated ".lock" file.
+ * A completed extraction is marked by recording the content hash in the lock
+ * file; if one is found it is reused, otherwise the FMU is extracted into a
+ * temporary directory that is renamed into place once complete.
+ *
+ * Each user holds a shared lock on the associated ".refs" file for as long
+ * as it uses the unpacked FMU.  This lets release_unpack_cache() determine
+ * if it is the last user without a separately maintained reference count
+ * that could be left stale by a crashed process.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::unpack_fmu_cached( )
+{
+   struct stat unpack_dir_stat;
+   uint64_t hash;
+   char hash_string[17];
+   char marker[16];
+   std::string selection;
+   std::string cache_path;
+   std::string temp_path;
+   std::string refs_path;
+   int lock_fd;
+   int refs_fd = -1;
+   bool verified;
+   fmi2Status status = fmi2OK;
+
+   // First check to make sure that the unpacking area does exist.
+   if (     stat( unpack_dir.c_str(), &unpack_dir_stat )
+         || !S_ISDIR( unpack_dir_stat.st_mode )           ) {
+      std::cerr << "Unpacking area does not exist: " << unpack_dir << std::endl;
+      return( fmi2Fatal );
+   }
+
+   // Build the cache path from the FMU name and content hash.
+   if ( hash_fmu_file( fmu_path.c_str(), &hash ) ) {
+      std::cerr << "Error reading FMU file: " << fmu_path << std::endl;
+      return( fmi2Fatal );
+   }
+   // The unpacked entries depend on the architecture and selection flags.
+   selection = this->architecture;
+   if ( this->extract_resources ) { selection += ":resources"; }
+   if ( this->extract_all_entries ) { selection += ":all"; }
+   if ( !this->source_build_dir.empty() ) { selection += ":sources"; }
+   if ( this->static_functions != NULL ) { selection += ":static"; }
+   hash_update( &hash, selection.data(), selection.size() );
+   snprintf( hash_string, sizeof(hash_string), "%016llx", (unsigned long long)hash );
+   cache_path = unpack_dir + "/" + this->fmu_base_name() + "." + hash_string;
+   refs_path  = cache_path + ".refs";
+
+   // Lock the cache entry.
+   lock_fd = open( (cache_path + ".lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0000644 );
+   if ( lock_fd == -1 ) {
+      perror( "Error opening the unpack cache lock" );
+      return( fmi2Fatal );
+   }
+   if ( flock( lock_fd, LOCK_EX ) ) {
+      perror( "Error locking the unpack cache" );
+      close( lock_fd );
+      return( fmi2Fatal );
+   }
+
+   // Check for a verified extraction.
+   verified =    (pread( lock_fd, marker, sizeof(marker), 0 ) == sizeof(marker))
+              && !strncmp( marker, hash_string, sizeof(marker) )
+              && (stat( cache_path.c_str(), &unpack_dir_stat ) == 0)
+              && S_ISDIR( unpack_dir_stat.st_mode );
+
+   if ( !verified ) {
+
+      // Clear out anything left behind by an incomplete extraction.
+      temp_path = cache_path + ".tmp";
+      if (    ftruncate( lock_fd, 0 )
+           || remove_tree( cache_path.c_str() )
+           || remove_tree( temp_path.c_str() )  ) {
+         perror( "Error clearing the unpack cache" );
+         status = fmi2Fatal;
+      }
+
+      // Extract into a temporary directory and move it into place.
+      if ( status == fmi2OK ) {
+         if ( mkdir( temp_path.c_str(), 0000755 ) ) {
+            std::cerr << "Error creating the unpack directory: " << temp_path << std::endl;
+            perror( "Error creating the unpack directory" );
+            status = fmi2Fatal;
+         }
+         else if ( this->extract_fmu( temp_path, NULL ) != fmi2OK ) {
+            remove_tree( temp_path.c_str() );
+            status = fmi2Fatal;
+         }
+         else if (    rename( temp_path.c_str(), cache_path.c_str() )
+                   || (pwrite( lock_fd, hash_string, sizeof(marker), 0 ) != sizeof(marker)) ) {
+            perror( "Error completing the unpack cache entry" );
+            status = fmi2Fatal;
+         }
+      }
+
+   }
+
+   // Register as a user of the cache entry.
+   if ( status == fmi2OK ) {
+      refs_fd = open( refs_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0000644 );
+      if ( (refs_fd == -1) || flock( refs_fd, LOCK_SH ) ) {
+         perror( "Error referencing the unpack cache" );
+         if ( refs_fd != -1 ) { close( refs_fd ); }
+         status = fmi2Fatal;
+      }
+      else {
+         this->unpack_path   = cache_path;
+         this->cache_refs_fd = refs_fd;
+      }
+   }
+
+   // Unlock the cache entry.
+   close( lock_fd );
+
+   return( status );
+}
+
+
+/*!
+ * @brief Release the shared unpack cache entry.
+ *
+ * This routine releases this instance's reference on the shared unpack
+ * cache entry.  If @ref delete_unpacked_fmu is set and there are no other
+ * users of the entry in any process, the unpacked FMU is removed.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::release_unpack_cache( )
+{
+   int lock_fd;
+   fmi2Status status = fmi2OK;
+
+   if ( this->cache_refs_fd < 0 ) { return( fmi2OK ); }
+
+   if ( delete_unpacked_fmu ) {
+
+      // Lock the cache entry so no new users can register.
+      lock_fd = open( (this->unpack_path + ".lock").c_str(), O_RDWR | O_CLOEXEC );
+      if ( (lock_fd != -1) && (flock( lock_fd, LOCK_EX ) == 0) ) {
+
+         // This is the last user if no one else holds a reference lock.
+         if ( flock( this->cache_refs_fd, LOCK_EX | LOCK_NB ) == 0 ) {
+            if ( ftruncate( lock_fd, 0 ) || this->remove_unpack_dir() ) {
+               status = fmi2Error;
+            }
+         }
+
+      }
+      else {
+         status = fmi2Error;
+      }
+      if ( lock_fd != -1 ) { close( lock_fd ); }
+
+   }
+
+   // Drop this reference.
+   close( this->cache_refs_fd );
+   this->cache_refs_fd = -1;
+
+   return( status );
+}
+
+
+/*!
+ * @brief Unpack additional FMU archive entries.
+ *
+ * By default, only the FMU archive entries needed to load the FMU are
+ * unpacked.  This routine unpacks the remaining entries with names that
+ * begin with the specified prefix (for example "documentation/") into the
+ * unpacked FMU directory.  Entries that have already been unpacked are
+ * left alone.
+ *
+ * @param [in] prefix Archive entry name prefix; an empty string selects all.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::extract_fmu_entries(
+   const char * prefix )
+{
+   int lock_fd = -1;
+   fmi2Status status;
+
+   // There must be an unpacked FMU to extract into.
+   if ( this->unpack_path.empty() ) {
+      std::cerr << "FMU has not been unpacked: " << fmu_path << std::endl;
+      return( fmi2Error );
+   }
+
+   // Entries in the shared unpack cache are extracted under the cache lock.
+   if ( this->cache_refs_fd >= 0 ) {
+      lock_fd = open( (this->unpack_path + ".lock").c_str(), O_RDWR | O_CLOEXEC );
+      if ( (lock_fd == -1) || flock( lock_fd, LOCK_EX ) ) {
+         perror( "Error locking the unpack cache" );
+         if ( lock_fd != -1 ) { close( lock_fd ); }
+         return( fmi2Error );
+      }
+   }
+
+   status = this->extract_fmu( this->unpack_path, prefix );
+
+   if ( lock_fd != -1 ) { close( lock_fd ); }
+
+   return( (status == fmi2OK) ? fmi2OK : fmi2Error );
+}
+
+
+/*!
+ * @brief Check if an FMU archive entry is needed to load the FMU.
+ *
+ * The entries needed to load the FMU are the modelDescription.xml file, the
+ * files in the binaries directory for the platform @ref architecture and,
+ * if @ref extract_resources is set, the resources directory.  Subdirectories
+ * of the binaries directory (for example .dylib.dSYM debug bundles) are not
+ * needed.  All entries are needed if @ref extract_all_entries is set.
+ *
+ * @return Returns true if the entry is needed to load the FMU.
+ * @param [in] entry_name Name of the FMU archive entry.
+ */
+bool TrickFMI::FMI2ModelBase::is_load_entry(
+   const char * entry_name )
+{
+   std::string binaries_dir;
+
+   if ( this->extract_all_entries ) {
+      return( true );
+   }
+   if ( !strcmp( entry_name, "modelDescription.xml" ) ) {
+      return( true );
+   }
+   if ( this->extract_resources && !strncmp( entry_name, "resources/", 10 ) ) {
+      return( true );
+   }
+   if ( !this->source_build_dir.empty() && !strncmp( entry_name, "sources/", 8 ) ) {
+      return( true );
+   }
+
+   if ( this->static_functions != NULL ) {
+      return( false );
+   }
+
+   binaries_dir = "binaries/" + this->architecture + "/";
+   return(    !strncmp( entry_name, binaries_dir.c_str(), binaries_dir.size() )
+           && (strchr( entry_name + binaries_dir.size(), '/' ) == NULL) );
+}
+
+
+/*!
+ * @brief Get the FMU name from the FMU path.
+ *
+ * @return Returns the FMU file name without leading directories or
+ * file extension.
+ */
+std::string TrickFMI::FMI2ModelBase::fmu_base_name( )
+{
+   char * base_name;
+   char * dot_pos;
+   std::string fmu_name;
+
+   base_name = strdup( fmu_path.c_str() );
+   fmu_name = basename( base_name );
+   free( base_name );
+   dot_pos = strchr( (char *)fmu_name.c_str(), '.' );
+   if ( dot_pos != NULL ){ fmu_name.resize( dot_pos - fmu_name.c_str() ); }
+
+   return( fmu_name );
+}
+
+
+/*!
+ * @brief Extract the FMU archive into a directory.
+ *
+ * This routine unzips the selected FMU archive entries into an existing
+ * directory.  When loading, only the entries needed to load the FMU are
+ * selected (see is_load_entry()).  Otherwise, the entries with names that
+ * begin with the prefix and have not already been extracted are selected.
+ *
+ * The archive headers are read first to select the entries.  The selected
+ * entries are then inflated and written by a pool of threads, each reading
+ * the archive with its own handle (see @ref number_of_extract_threads).
+ *
+ * All files are created relative to a directory handle for the extraction
+ * directory.  The process current working directory is never changed; so,
+ * FMUs can be extracted from multiple threads at once.
+ *
+ * @param [in] extract_path Path to the directory to extract into.
+ * @param [in] prefix       Entry name prefix or NULL to select load entries.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::extract_fmu(
+   const std::string & extract_path,
+   const char        * prefix        )
+{
+   const char * entry_name;
+   struct stat entry_stat;
+   struct archive * fmu;
+   struct archive_entry * entry;
+   ExtractJob job;
+   std::vector<pthread_t> threads;
+   pthread_t thread;
+   unsigned int thread_count;
+   size_t selected_count = 0;
+   size_t selected_bytes = 0;
+   size_t iinc;
+   long num_cpus;
+   int status;
+
+   // Open the FMU archive.
+   fmu = open_fmu_archive( fmu_path.c_str() );
+   if ( fmu == NULL ) {
+      return( fmi2Fatal );
+   }
+
+   // Open a handle to the extraction directory.
+   job.dir_fd = open( extract_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+   if ( job.dir_fd == -1 ) {
+      std::cerr << "Error opening the unpack directory: " << extract_path << std::endl;
+      perror( "Error opening the unpack directory" );
+      archive_read_free( fmu );
+      return( fmi2Fatal );
+   }
+
+   // Select the entries to extract from the archive headers.  The entry
+   // data is skipped by the next header read without being decompressed.
+   status = archive_read_next_header( fmu, &entry );
+   while ( (status == ARCHIVE_OK) || (status == ARCHIVE_WARN) ) {
+
+      // Print out message if everything is not ARCHIVE_OK.
+      if ( status < ARCHIVE_OK ) {
+         fprintf( stderr, "%s\n", archive_error_string( fmu ) );
+      }
+
+      entry_name = archive_entry_pathname( entry );
+      if ( prefix == NULL ) {
+         job.selected.push_back( this->is_load_entry( entry_name ) );
+      }
+      else {
+         job.selected.push_back(    !strncmp( entry_name, prefix, strlen( prefix ) )
+                                 && (fstatat( job.dir_fd, entry_name, &entry_stat,
+                                              AT_SYMLINK_NOFOLLOW ) != 0) );
+      }
+      if ( job.selected.back() ) {
+         selected_count++;
+         if ( archive_entry_filetype( entry ) == AE_IFREG ) {
+            selected_bytes += archive_entry_size( entry );
+         }
+      }
+
+      status = archive_read_next_header( fmu, &entry );
+
+   }
+
+   // Check for error.
+   if ( status != ARCHIVE_EOF ) {
+      fprintf( stderr, "Error extracting FMU file %s: %s\n",
+               fmu_path.c_str(), archive_error_string( fmu ) );
+      close( job.dir_fd );
+      archive_read_close( fmu );
+      archive_read_free( fmu );
+      return( fmi2Fatal );
+   }
+   archive_read_close( fmu );
+   archive_read_free( fmu );
+
+   // Use only as many threads as there is data to keep them busy.
+   thread_count = this->number_of_extract_threads;
+   if ( thread_count == 0 ) {
+      num_cpus = sysconf( _SC_NPROCESSORS_ONLN );
+      thread_count = (num_cpus > 0) ? (unsigned int)num_cpus : 1;
+   }
+   if ( thread_count > 1 + selected_bytes / extract_bytes_per_thread ) {
+      thread_count = 1 + selected_bytes / extract_bytes_per_thread;
+   }
+   if ( thread_count > selected_count ) {
+      thread_count = (selected_count > 0) ? selected_count : 1;
+   }
+
+   // Extract the selected entries.  Directories are created by whichever
+   // thread needs them first.
+   job.fmu_path        = fmu_path.c_str();
+   job.claimed.assign( job.selected.size(), 0 );
+   job.unclaimed       = selected_count;
+   job.failed          = false;
+   job.decompress_time = 0.0;
+   job.write_time      = 0.0;
+   pthread_mutex_init( &job.mutex, NULL );
+   if ( selected_count > 0 ) {
+      for ( iinc = 1 ; iinc < thread_count ; iinc++ ) {
+         if ( pthread_create( &thread, NULL, extract_worker, &job ) != 0 ) {
+            break;
+         }
+         threads.push_back( thread );
+      }
+      extract_worker( &job );
+      for ( iinc = 0 ; iinc < threads.size() ; iinc++ ) {
+         pthread_join( threads[iinc], NULL );
+      }
+   }
+   pthread_mutex_destroy( &job.mutex );
+
+   // Close the extraction directory.
+   close( job.dir_fd );
+
+   // Record the extraction work.
+   this->startup_report.decompress_time += job.decompress_time;
+   this->startup_report.write_time      += job.write_time;
+   this->startup_report.unpacked_bytes  += selected_bytes;
+   if ( threads.size() + 1 > (size_t)this->startup_report.unpack_threads ) {
+      this->startup_report.unpack_threads = threads.size() + 1;
+   }
+
+   // Check for error.
+   if ( job.failed ) {
+      return( fmi2Fatal );
+   }
+
+   /* Return success. */
+   return( fmi2OK );
+}
+
+
+/*!
+ * @brief Set the FMU platform architecture for the host.
+ *
+ * This routine sets the @ref architecture used to locate the FMU library
+ * based on the platform this code was compiled for.
+ */
+void TrickFMI::FMI2ModelBase::set_host_architecture( )
+{
+   // Determine the architecture.
+#if defined(__linux__)
+   this->architecture = "linux64";
+#elif defined(__APPLE__) && defined(__MACH__) && defined(__aarch64__)
+   this->architecture = "darwin_arm64";
+#elif defined(__APPLE__) && defined(__MACH__) && defined(__x86_64__)
+   this->architecture = "darwin_x86_64";
+#endif
+
+   return;
+}
+
+
+/*!
+ * @brief Get the name of an x86-64 instruction set level.
+ *
+ * @return Returns the level name used for compiler -march options and FMU
+ * library variants or NULL for the baseline (level 0 or 1).
+ * @param [in] isa_level Instruction set level (see host_isa_level()).
+ */
+static const char * isa_variant_name( unsigned int isa_level )
+{
+   static const char * names[] = { "x86-64-v2", "x86-64-v3", "x86-64-v4" };
+
+   if ( (isa_level < 2) || (isa_level > 4) ) {
+      return( NULL );
+   }
+   return( names[isa_level - 2] );
+}
+
+
+/*!
+ * @brief Get the FMU library file name suffix for the architecture.
+ *
+ * @return Returns the library file name suffix or an empty string if the
+ * @ref architecture is not supported.
+ */
+std::string TrickFMI::FMI2ModelBase::library_suffix( )
+{
+   if ( this->architecture == "darwin_arm64"  || this->architecture == "darwin_x86_64") {
+      return( ".dylib" );
+   }
+   else if ( this->architecture == "linux64" ) {
+      return( ".so" );
+   }
+   return( "" );
 }
 
 
 /*!
- * @brief Load an FMU.
+ * @brief Get the FMU library file name.
  *
- * This routine loads in the FMU specified by the @ref fmu_path variable.
+ * The FMU library is named for the model identifier of the modality in use.
+ * The model name is used for FMUs that do not specify a model identifier.
+ * Instruction set variants of the library add the variant name before the
+ * suffix (for example trickBall.x86-64-v3.so).
+ *
+ * @return Returns the library file name or an empty string if the
+ * @ref architecture is not supported.
+ * @param [in] isa_level Instruction set level of the variant (see
+ * host_isa_level()) or 0 or 1 for the baseline library.
  */
-fmi2Status TrickFMI::FMI2ModelBase::load_fmu( void )
+std::string TrickFMI::FMI2ModelBase::library_file_name( unsigned int isa_level )
 {
-   /* Make sure that the FMU path has been specified. */
-   if ( this->fmu_path.empty() ) {
-      std::cerr << "Empty FMU path!" << std::endl;
-      return( fmi2Fatal);
-   }
+   std::string identifier;
 
-   /* Unpack the FMU. */
-   if ( this->unpack_fmu() != fmi2OK ) {
-      return( fmi2Fatal );
+   if ( this->library_suffix().empty() ) {
+      return( "" );
    }
 
-   /* Process the model description file. */
-   std::string model_description_path;
-   model_description_path = this->unpack_path + "/modelDescription.xml";
-   if ( this->model_description.parse( model_description_path ) != fmi2OK ){
-      std::cerr << this->model_description.get_error() << std::endl;
-      return( fmi2Fatal );
-   }
-   // Check model modality.
-   if (    (this->modality == fmi2ModelExchange)
-        && !this->model_description.model_exchange ) {
-      return( fmi2Fatal );
+   if ( this->modality == fmi2ModelExchange ) {
+      identifier = this->description->model_exchange_model_identifier;
    }
-   if (    (this->modality == fmi2CoSimulation)
-        && !this->model_description.co_simulation ) {
-      return( fmi2Fatal );
+   else {
+      identifier = this->description->co_simulation_model_identifier;
    }
-
-   /* Load the dynamic library. */
-   if ( this->load_library() != fmi2OK ) {
-      return( fmi2Fatal );
+   if ( identifier.empty() ) {
+      identifier = this->description->model_name;
    }
-
-   if ( this->bind_function_ptrs() != fmi2OK ){
-      return( fmi2Fatal );
+   if ( isa_variant_name( isa_level ) != NULL ) {
+      identifier = identifier + "." + isa_variant_name( isa_level );
    }
 
-   /* Return success. */
-   return( fmi2OK );
+   return( identifier + this->library_suffix() );
 }
 
 
 /*!
- * @brief Load an FMU.
+ * @brief Get the best instruction set level to look for a library variant.
  *
- * This routine loads in the FMU specified by the C style string
- * passed in as an argument.  Note that this will also set the
- * @ref fmu_path class variable.
+ * Variants are only built for x86-64 Linux shared libraries.
  *
- * @param [in] path A C-style string that specifies the path to the FMU.
+ * @return Returns the host_isa_level() or 0 if variants are not used.
  */
-fmi2Status TrickFMI::FMI2ModelBase::load_fmu( const char * path )
+unsigned int TrickFMI::FMI2ModelBase::library_isa_level( )
 {
-   this->fmu_path = path;
-   return( this->load_fmu() );
+   if ( !this->use_isa_variants || (this->library_suffix() != ".so") ) {
+      return( 0 );
+   }
+   return( host_isa_level() );
 }
 
 
 /*!
- * @brief Load an FMU.
+ * @brief Get the instruction set level of the host CPU.
  *
- * This routine loads in the FMU specified by the C++ style string
- * passed in as an argument.  Note that this will also set the
- * @ref fmu_path class variable.
+ * The levels are the x86-64 micro-architecture levels: 1 is the x86-64
+ * baseline, 2 adds SSE4.2 and POPCNT, 3 adds AVX2, FMA and BMI2 and 4 adds
+ * AVX-512.  The AVX and AVX-512 levels also require that the operating
+ * system saves the wider registers.
  *
- * @param [in] path A C++-style string that specifies the path to the FMU.
+ * @return Returns the instruction set level or 0 if the host is not x86-64.
  */
-fmi2Status TrickFMI::FMI2ModelBase::load_fmu( std::string path )
+unsigned int TrickFMI::FMI2ModelBase::host_isa_level( )
 {
-   this->fmu_path = path;
-   return( this->load_fmu() );
+#if defined(__x86_64__)
+   unsigned int eax, ebx, ecx, edx;
+   unsigned int ecx1, ecx81, ebx7;
+   unsigned int xcr0 = 0;
+   unsigned int level = 1;
+
+   if ( !__get_cpuid( 1, &eax, &ebx, &ecx1, &edx ) ) { return( level ); }
+   if ( !__get_cpuid( 0x80000001, &eax, &ebx, &ecx81, &edx ) ) { ecx81 = 0; }
+   if ( !__get_cpuid_count( 7, 0, &eax, &ebx7, &ecx, &edx ) ) { ebx7 = 0; }
+
+   // Registers saved by the operating system (needs OSXSAVE).
+   if ( ecx1 & (1u << 27) ) {
+      __asm__ __volatile__ ( "xgetbv" : "=a" (eax), "=d" (edx) : "c" (0) );
+      xcr0 = eax;
+   }
+
+   // x86-64-v2: SSE3, SSSE3, CMPXCHG16B, SSE4.1, SSE4.2, POPCNT and LAHF.
+   if (    ((ecx1 & 0x00d82201u) != 0x00d82201u)
+        || !(ecx81 & 1u) ) {
+      return( level );
+   }
+   level = 2;
+
+   // x86-64-v3: AVX, AVX2, BMI1, BMI2, F16C, FMA, LZCNT and MOVBE.
+   if (    ((ecx1 & 0x30401000u) != 0x30401000u)
+        || ((ebx7 & 0x00000128u) != 0x00000128u)
+        || !(ecx81 & (1u << 5))
+        || ((xcr0 & 0x06u) != 0x06u) ) {
+      return( level );
+   }
+   level = 3;
+
+   // x86-64-v4: AVX512F, AVX512BW, AVX512CD, AVX512DQ and AVX512VL.
+   if (    ((ebx7 & 0xd0030000u) != 0xd0030000u)
+        || ((xcr0 & 0xe6u) != 0xe6u) ) {
+      return( level );
+   }
+   level = 4;
+
+   return( level );
+#else
+   return( 0 );
+#endif
 }
 
 
 /*!
- * @brief Unpacks the FMU.
+ * @brief Load the FMU directly from the FMU archive.
  *
- * This routine finds the FMU file, creates the appropriate
- * directories and unzips the archive into the expanded FMU directory
- * structure.  This is a prerequisite for loading the library.
+ * This routine reads the modelDescription.xml file and the FMU libraries
+ * for the platform architecture straight out of the FMU archive without
+ * unpacking anything to disk.  The model description is parsed from an
+ * in memory buffer and each candidate library is streamed into an anonymous
+ * memory file created with memfd_create.  The memory file matching the model
+ * identifier is kept open so that load_library() can load it through /proc/self/fd.
  */
-fmi2Status TrickFMI::FMI2ModelBase::unpack_fmu( )
+fmi2Status TrickFMI::FMI2ModelBase::load_fmu_in_memory( )
 {
-   int cwd_file_id;
+#if defined(__linux__)
    struct archive * fmu;
-   struct archive * unpack;
    struct archive_entry * entry;
+   const char * entry_name;
    const void * buff;
    size_t size;
    off_t  offset;
-   int flags;
    int status;
-   char * base_name;
-   char * fmu_name;
-   char * dot_pos;
-
-   struct stat unpack_dir_stat;
-
-   /* Select which attributes we want to restore. */
-   flags = ARCHIVE_EXTRACT_TIME;
-   flags |= ARCHIVE_EXTRACT_PERM;
-   flags |= ARCHIVE_EXTRACT_ACL;
-   flags |= ARCHIVE_EXTRACT_FFLAGS;
-
-   // Set up the FMU archive to read.
-   fmu = archive_read_new();
-   archive_read_support_filter_all( fmu );
-   archive_read_support_format_all( fmu );
-
-   // Set up how to write out the archive.
-   unpack = archive_write_disk_new();
-   archive_write_disk_set_options( unpack, flags );
-   archive_write_disk_set_standard_lookup( unpack );
-
-   // Open the FMU archive.
-   status = archive_read_open_filename( fmu, fmu_path.c_str(), 10240 );
-   if (status != ARCHIVE_OK) {
-      std::cerr << "Error opening FMU file: " << fmu_path << std::endl;
-      return( fmi2Fatal );
-   }
-
-   // Get current working directory.
-   cwd_file_id = open( ".", O_RDONLY );
-   if ( cwd_file_id == -1 ){
-      perror( "Error getting current working directory! " );
-      return( fmi2Fatal );
-   }
-
-   //
-   // Create the directory in which to unpack the archive.
-   //
-   // First check to make sure that the unpacking area does exist.
-   if (     stat( unpack_dir.c_str(), &unpack_dir_stat )
-         || !S_ISDIR( unpack_dir_stat.st_mode )           ) {
-      std::cerr << "Unpacking area does not exist: " << unpack_dir << std::endl;
-      return( fmi2Fatal );
-   }
-
-   // Build the unpack path.
-   base_name = strdup( fmu_path.c_str() );
-   fmu_name = strdup( basename( base_name ));
-   dot_pos = strchr( fmu_name, '.' );
-   if ( dot_pos != NULL ){ *dot_pos = '\0'; }
-   unpack_path = unpack_dir + "/" + fmu_name;
-   free( base_name );
-   free( fmu_name );
-
-   // Check to make sure that the directory doesn't already exist.
-   if ( stat( unpack_path.c_str(), &unpack_dir_stat ) == 0 ){
-      std::cerr << "FMU unpacking directory already exists: " << unpack_path << std::endl;
-      return( fmi2Fatal );
-   }
-   else {
-      if ( errno != ENOENT ){
-         perror( "Error associated with unpack directory" );
-         return( fmi2Fatal );
-      }
-   }
-
-   // Create the unpack directory.
-   if ( mkdir( unpack_path.c_str(), 0000755 ) ) {
-      std::cerr << "Error creating the unpack directory: " << unpack_path << std::endl;
-      perror( "Error creating the unpack directory" );
+   fmi2Status parse_status;
+   int fd;
+   bool read_error = false;
+   std::string description_xml;
+   double parse_start;
+   std::string binaries_dir;
+   std::string suffix;
+   std::string library_name;
+   std::stringstream path;
+   std::map< std::string, int > libraries;
+   std::map< std::string, int >::iterator lib_iter;
+   unsigned int isa_level;
+
+   // Libraries are located in the binaries directory for this architecture.
+   // The library file name is not known until the model description is
+   // parsed; so, every library in the directory is a candidate.
+   suffix = this->library_suffix();
+   if ( suffix.empty() ) {
+      std::cerr << "Unsupported architecture: " << architecture << std::endl;
       return( fmi2Fatal );
    }
+   binaries_dir = "binaries/" + this->architecture + "/";
 
-   // Move to the newly created directory.
-   if ( chdir( unpack_path.c_str() ) ) {
-      std::cerr << "Error moving into the unpack directory: " << unpack_path << std::endl;
-      perror( "Error moving into the unpack directory" );
+   // Open the FMU archive.
+   fmu = open_fmu_archive( fmu_path.c_str() );
+   if ( fmu == NULL ) {
       return( fmi2Fatal );
    }
 
    // Read the next header in the FMU archive.
    status = archive_read_next_header( fmu, &entry );
 
-   // Loop through writing out the data and reading the next header.
-   while (    (status != ARCHIVE_EOF)
+   // Loop through the entries keeping only the ones needed to load the FMU.
+   // All other entry data is skipped by the next header read.
+   while (    !read_error
            && ((status == ARCHIVE_OK) || (status == ARCHIVE_WARN)) ) {
 
       // Print out message if everything is not ARCHIVE_OK.
@@ -290,87 +2687,140 @@ fmi2Status TrickFMI::FMI2ModelBase::unpack_fmu( )
          fprintf( stderr, "%s\n", archive_error_string( fmu ) );
       }
 
-      status = archive_write_header( unpack, entry );
-
-      if ( status < ARCHIVE_OK ){
-         fprintf( stderr, "%s\n", archive_error_string( unpack ) );
-      }
-      else if ( archive_entry_size( entry ) > 0 ) {
-
-         // Read the next data block.
-         status = archive_read_data_block( fmu, &buff, &size, &offset );
-         if ( status < ARCHIVE_OK ) {
-            fprintf( stderr, "%s\n", archive_error_string(unpack) );
-         }
+      entry_name = archive_entry_pathname( entry );
 
-         // Loop through the data blocks.
-         while (    (status != ARCHIVE_EOF)
-                 && ((status == ARCHIVE_OK) || (status == ARCHIVE_WARN)) ) {
+      if ( !strcmp( entry_name, "modelDescription.xml" ) ) {
 
-            // Write the data block.
-            status = archive_write_data_block( unpack, buff, size, offset );
-            if ( status < ARCHIVE_OK ) {
-               fprintf( stderr, "%s\n", archive_error_string(unpack) );
-            }
-            if ( status < ARCHIVE_WARN ) {
-               continue;
+         // Read the model description into memory.
+         status = read_data_block( fmu, &buff, &size, &offset,
+                                   &this->startup_report.decompress_time );
+         while ( (status == ARCHIVE_OK) || (status == ARCHIVE_WARN) ) {
+            if ( description_xml.size() < (size_t)offset + size ) {
+               description_xml.resize( offset + size );
             }
-
-            // Read the next data block.
-            status = archive_read_data_block( fmu, &buff, &size, &offset );
+            description_xml.replace( offset, size, (const char *)buff, size );
+            status = read_data_block( fmu, &buff, &size, &offset,
+                                      &this->startup_report.decompress_time );
          }
-
-         // If ARCHIVE_EOF of archive entry then mark as ARCHIVE_OK.
-         if ( status == ARCHIVE_EOF ){ status = ARCHIVE_OK; }
-         if ( status < ARCHIVE_OK ) {
-            fprintf( stderr, "%s\n", archive_error_string( unpack ) );
+         if ( status != ARCHIVE_EOF ) {
+            fprintf( stderr, "%s\n", archive_error_string( fmu ) );
+            read_error = true;
          }
 
       }
+      else if (    (this->static_functions == NULL)
+                && !strncmp( entry_name, binaries_dir.c_str(), binaries_dir.size() )
+                && (strchr( entry_name + binaries_dir.size(), '/' ) == NULL)
+                && (strlen( entry_name ) > binaries_dir.size() + suffix.size())
+                && !strcmp( entry_name + strlen( entry_name ) - suffix.size(),
+                            suffix.c_str() )                                    ) {
+
+         // Stream the candidate library into an anonymous memory file.
+         library_name = entry_name + binaries_dir.size();
+         fd = memfd_create( library_name.c_str(), MFD_CLOEXEC );
+         if ( fd == -1 ) {
+            perror( "Error creating in memory library file" );
+            read_error = true;
+            continue;
+         }
+         libraries[ library_name ] = fd;
+
+         status = read_data_block( fmu, &buff, &size, &offset,
+                                   &this->startup_report.decompress_time );
+         while ( (status == ARCHIVE_OK) || (status == ARCHIVE_WARN) ) {
+            if ( write_data_block( fd, buff, size, offset, &this->startup_report ) ) {
+               perror( "Error writing in memory library file" );
+               read_error = true;
+               break;
+            }
+            status = read_data_block( fmu, &buff, &size, &offset,
+                                      &this->startup_report.decompress_time );
+         }
+         if ( !read_error && (status != ARCHIVE_EOF) ) {
+            fprintf( stderr, "%s\n", archive_error_string( fmu ) );
+            read_error = true;
+         }
 
-      status = archive_write_finish_entry( unpack );
-      if ( status < ARCHIVE_OK ) {
-         fprintf( stderr, "%s\n", archive_error_string( unpack ) );
       }
 
       // Read the next header in the FMU archive.
-      status = archive_read_next_header( fmu, &entry );
+      if ( !read_error ) {
+         status = archive_read_next_header( fmu, &entry );
+      }
 
    } // End of while loop.
 
    // Check for error.
-   if ( status < ARCHIVE_WARN ) {
-      fprintf( stderr, "%s\n", archive_error_string( fmu ) );
-   }
-
-   // Close the archive unpack object.
-   archive_write_close( unpack );
-   archive_write_free( unpack );
-
-   // Check for error.
-   if ( status < ARCHIVE_WARN ) {
+   if ( !read_error && (status != ARCHIVE_EOF) ) {
       fprintf( stderr, "%s\n", archive_error_string( fmu ) );
+      read_error = true;
    }
 
    // Close the archive file.
-   archive_read_close(fmu);
-   archive_read_free(fmu);
-
-   // Check for error.
-   if ( status < ARCHIVE_WARN ) {
-      fprintf( stderr, "%s\n", archive_error_string( fmu ) );
-      return( fmi2Fatal );
+   archive_read_close( fmu );
+   archive_read_free( fmu );
+
+   // Process the model description.
+   if ( !read_error ) {
+      if ( description_xml.empty() ) {
+         std::cerr << "Missing modelDescription.xml in FMU: " << fmu_path << std::endl;
+         read_error = true;
+      }
+      else {
+         parse_start = FMI2StartupReport::get_time();
+         if ( this->description_cache_dir.empty() ) {
+            parse_status = this->description->parse( description_xml.data(),
+                                                     description_xml.size(),
+                                                     fmu_path + ":modelDescription.xml" );
+         }
+         else {
+            parse_status = this->description->parse_cached( description_xml.data(),
+                                                            description_xml.size(),
+                                                            fmu_path + ":modelDescription.xml",
+                                                            this->description_cache_dir );
+         }
+         if ( parse_status != fmi2OK ){
+            std::cerr << this->description->get_error() << std::endl;
+            read_error = true;
+         }
+         this->startup_report.parse_time = FMI2StartupReport::get_time() - parse_start;
+      }
    }
 
-   // Move back into the original current working directory.
-   if (    (fchdir( cwd_file_id ) == -1)
-        || (close( cwd_file_id ) == -1)  ) {
-      perror( "Error moving back to the original directory" );
-      return( fmi2Fatal );
+   // Keep the library that matches the model, using the best instruction
+   // set variant present, and close the rest.  An FMU linked into the host
+   // has no library.
+   if ( !read_error && (this->static_functions == NULL) ) {
+      for ( isa_level = this->library_isa_level() ; isa_level > 1 ; isa_level-- ) {
+         lib_iter = libraries.find( this->library_file_name( isa_level ) );
+         if ( lib_iter != libraries.end() ) { break; }
+      }
+      if ( isa_level <= 1 ) {
+         lib_iter = libraries.find( this->library_file_name() );
+      }
+      if ( lib_iter == libraries.end() ) {
+         std::cerr << "Library does not exist: " << fmu_path << ":"
+                   << binaries_dir << this->library_file_name() << std::endl;
+         read_error = true;
+      }
+      else {
+         this->library_variant = (isa_level > 1) ? isa_variant_name( isa_level ) : "";
+         this->library_fd = lib_iter->second;
+         libraries.erase( lib_iter );
+         path << "/proc/self/fd/" << this->library_fd;
+         this->library_path = path.str();
+      }
+   }
+   for ( lib_iter = libraries.begin() ; lib_iter != libraries.end() ; ++lib_iter ) {
+      close( lib_iter->second );
    }
 
-   /* Return success. */
-   return( fmi2OK );
+   return( read_error ? fmi2Fatal : fmi2OK );
+
+#else
+   std::cerr << "In memory FMU loading is not supported on this platform!" << std::endl;
+   return( fmi2Fatal );
+#endif
 }
 
 
@@ -384,7 +2834,7 @@ fmi2Status TrickFMI::FMI2ModelBase::remove_unpack_dir( )
    struct stat unpack_dir_stat;
    if ( stat( unpack_path.c_str(), &unpack_dir_stat ) == 0 ){
       std::cout << "Removing unpacking path: " << unpack_path << std::endl;
-      if ( nftw( unpack_path.c_str(), remove_callback, 64, FTW_DEPTH | FTW_PHYS ) ) {
+      if ( remove_tree( unpack_path.c_str() ) ) {
          return( fmi2Error);
       }
    }
@@ -396,46 +2846,69 @@ fmi2Status TrickFMI::FMI2ModelBase::remove_unpack_dir( )
  * @brief Load in the FMU shared/dynamic libraries.
  *
  * This routine loads in the shared or dynamic libraries that are
- * unpacked by unpack_fmu().
+ * unpacked by unpack_fmu() or loaded into memory by load_fmu_in_memory().
  */
 fmi2Status TrickFMI::FMI2ModelBase::load_library()
 {
    std::stringstream path;
+   unsigned int isa_level;
+   double start_time;
 
    struct stat library_stat;
 
+   // An FMU linked into the host has no library to load.
+   if ( this->static_functions != NULL ) {
+      this->library_path.clear();
+      this->library_variant.clear();
+      return( fmi2OK );
+   }
+
    //
-   // Construct the path to the library.
+   // Construct the path to the library.  This has already been done if
+   // the library was loaded into memory from the FMU archive.
    //
-   // Make sure that the unpack path has been set.
-   if ( this->unpack_path.empty() ){
-      std::cerr << "Error, empty unpack path!" << std::endl;
-      return( fmi2Fatal );
-   }
+   if ( !this->source_build_dir.empty() ) {
 
-   // Determine the architecture.
-#if defined(__linux__)
-   this->architecture = "linux64";
-#elif defined(__APPLE__) && defined(__MACH__) && defined(__aarch64__)
-   this->architecture = "darwin_arm64";
-#elif defined(__APPLE__) && defined(__MACH__) && defined(__x86_64__)
-   this->architecture = "darwin_x86_64";
-#endif
+      // Build the library from the FMU sources (or reuse a previous build).
+      start_time = FMI2StartupReport::get_time();
+      if ( this->build_library_from_sources() != fmi2OK ) {
+         return( fmi2Fatal );
+      }
+      this->startup_report.compile_time = FMI2StartupReport::get_time() - start_time;
 
-   // Construct the path to the library.
-   path << this->unpack_path << "/binaries/" << this->architecture << "/"
-        << this->model_description.model_name;
-   if ( this->architecture == "darwin_arm64"  || this->architecture == "darwin_x86_64") {
-      path << ".dylib";
-   }
-   else if ( this->architecture == "linux64" ) {
-      path << ".so";
    }
-   else {
-      std::cerr << "Unsupported architecture: " << architecture << std::endl;
-      return( fmi2Fatal );
+   else if ( this->library_fd < 0 ) {
+
+      // Make sure that the unpack path has been set.
+      if ( this->unpack_path.empty() ){
+         std::cerr << "Error, empty unpack path!" << std::endl;
+         return( fmi2Fatal );
+      }
+
+      // Construct the path to the library.  Use the best instruction set
+      // variant of the library that is present, if any.
+      if ( this->library_file_name().empty() ) {
+         std::cerr << "Unsupported architecture: " << architecture << std::endl;
+         return( fmi2Fatal );
+      }
+      for ( isa_level = this->library_isa_level() ; isa_level > 1 ; isa_level-- ) {
+         path.str( "" );
+         path << this->unpack_path << "/binaries/" << this->architecture << "/"
+              << this->library_file_name( isa_level );
+         if (    (stat( path.str().c_str(), &library_stat ) == 0)
+              && S_ISREG( library_stat.st_mode )                  ) {
+            break;
+         }
+      }
+      if ( isa_level <= 1 ) {
+         path.str( "" );
+         path << this->unpack_path << "/binaries/" << this->architecture << "/"
+              << this->library_file_name();
+      }
+      this->library_path = path.str();
+      this->library_variant = (isa_level > 1) ? isa_variant_name( isa_level ) : "";
+
    }
-   this->library_path = path.str();
 
    // Make sure that the library path is set.
    if ( this->library_path.empty() ){
@@ -453,7 +2926,9 @@ fmi2Status TrickFMI::FMI2ModelBase::load_library()
    //
    // Load the library.
    //
+   start_time = FMI2StartupReport::get_time();
    model_library = dlopen( library_path.c_str(), RTLD_NOW );
+   this->startup_report.dlopen_time = FMI2StartupReport::get_time() - start_time;
    if ( model_library == NULL ){
       std::cerr << "Error loading library: " << library_path << std::endl;
       std::cerr << "   \"" << dlerror() << "\"" << std::endl;
@@ -464,12 +2939,174 @@ fmi2Status TrickFMI::FMI2ModelBase::load_library()
 }
 
 
+/*!
+ * @brief Build the FMU library from the FMU sources.
+ *
+ * Every C file in the unpacked sources directory is compiled and linked into
+ * a shared library with @ref source_compiler and @ref source_cflags.  The
+ * library is kept in the @ref source_build_dir under a name made from the
+ * model identifier and a hash of the source files, the compiler and its
+ * version, the options, the architecture and the host instruction set
+ * level (see host_isa_level()), so a later load with the same sources and
+ * options reuses it.  The library is built under a temporary name and
+ * renamed into place so that other processes never see a partial build.
+ *
+ * @return Returns fmi2OK and sets the @ref library_path or fmi2Fatal if the
+ * sources could not be read or compiled.
+ */
+fmi2Status TrickFMI::FMI2ModelBase::build_library_from_sources( )
+{
+   std::string sources_dir;
+   std::string library_name;
+   std::string build_path;
+   std::vector<char> temp_path;
+   std::vector<std::string> files;
+   std::vector<std::string> arguments;
+   std::vector<char *> argv;
+   std::stringstream flags;
+   std::string flag;
+   struct dirent * dir_entry;
+   struct stat file_stat;
+   uint64_t hash = 14695981039346656037ULL;
+   char hash_string[17];
+   char version_option[] = "--version";
+   char * version_argv[] = { NULL, version_option, NULL };
+   unsigned int isa_level;
+   DIR * dir;
+   size_t iinc;
+   size_t length;
+   pid_t pid;
+   int wait_status;
+   int fd;
+
+   // Find the source files.
+   sources_dir = this->unpack_path + "/sources";
+   dir = opendir( sources_dir.c_str() );
+   if ( dir == NULL ) {
+      std::cerr << "FMU has no sources directory: " << fmu_path << std::endl;
+      return( fmi2Fatal );
+   }
+   while ( (dir_entry = readdir( dir )) != NULL ) {
+      if (    (stat( (sources_dir + "/" + dir_entry->d_name).c_str(), &file_stat ) == 0)
+           && S_ISREG( file_stat.st_mode ) ) {
+         files.push_back( dir_entry->d_name );
+      }
+   }
+   closedir( dir );
+   std::sort( files.begin(), files.end() );
+
+   // Key the build by the source files (headers included), the compiler,
+   // its version, its options and the architecture.  Options such as
+   // -march=native resolve differently on other CPUs sharing the build
+   // directory, so the host instruction set level is part of the key too.
+   hash_update( &hash, this->source_compiler.c_str(), this->source_compiler.size() + 1 );
+   hash_update( &hash, this->source_cflags.c_str(), this->source_cflags.size() + 1 );
+   hash_update( &hash, this->architecture.c_str(), this->architecture.size() + 1 );
+   isa_level = host_isa_level();
+   hash_update( &hash, &isa_level, sizeof(isa_level) );
+   version_argv[0] = const_cast<char *>( this->source_compiler.c_str() );
+   if ( hash_command_update( version_argv, &hash ) ) {
+      std::cerr << "Error running FMU source compiler: " << this->source_compiler << std::endl;
+      return( fmi2Fatal );
+   }
+   for ( iinc = 0 ; iinc < files.size() ; iinc++ ) {
+      hash_update( &hash, files[iinc].c_str(), files[iinc].size() + 1 );
+      if ( hash_file_update( (sources_dir + "/" + files[iinc]).c_str(), &hash ) ) {
+         std::cerr << "Error reading FMU source file: " << sources_dir << "/"
+                   << files[iinc] << std::endl;
+         return( fmi2Fatal );
+      }
+   }
+   snprintf( hash_string, sizeof(hash_string), "%016llx", (unsigned long long)hash );
+
+   library_name = this->library_file_name();
+   if ( library_name.empty() ) {
+      std::cerr << "Unsupported architecture: " << architecture << std::endl;
+      return( fmi2Fatal );
+   }
+   length = library_name.size() - this->library_suffix().size();
+   build_path = this->source_build_dir + "/" + library_name.substr( 0, length )
+              + "." + hash_string + this->library_suffix();
+
+   // Reuse a previous build.
+   this->library_variant.clear();
+   if ( (stat( build_path.c_str(), &file_stat ) == 0) && S_ISREG( file_stat.st_mode ) ) {
+      this->library_path = build_path;
+      return( fmi2OK );
+   }
+
+   // Reserve a temporary library file in the build directory.
+   static const char suffix[] = ".XXXXXX";
+   temp_path.assign( build_path.begin(), build_path.end() );
+   temp_path.insert( temp_path.end(), suffix, suffix + sizeof(suffix) );
+   fd = mkstemp( &temp_path[0] );
+   if ( fd == -1 ) {
+      perror( "Error creating FMU source build file" );
+      return( fmi2Fatal );
+   }
+   fchmod( fd, 0000755 );
+   close( fd );
+
+   // Assemble the compile command.
+   arguments.push_back( this->source_compiler );
+   flags.str( this->source_cflags );
+   while ( flags >> flag ) {
+      arguments.push_back( flag );
+   }
+   arguments.push_back( "-shared" );
+   arguments.push_back( "-fPIC" );
+   if ( this->library_suffix() == ".so" ) {
+      // Catch missing sources at build time rather than caching a library
+      // that can not be loaded.
+      arguments.push_back( "-Wl,-z,defs" );
+   }
+   arguments.push_back( "-I" + sources_dir );
+   arguments.push_back( "-o" );
+   arguments.push_back( &temp_path[0] );
+   for ( iinc = 0 ; iinc < files.size() ; iinc++ ) {
+      length = files[iinc].size();
+      if ( (length > 2) && !files[iinc].compare( length - 2, 2, ".c" ) ) {
+         arguments.push_back( sources_dir + "/" + files[iinc] );
+      }
+   }
+   arguments.push_back( "-lm" );
+   for ( iinc = 0 ; iinc < arguments.size() ; iinc++ ) {
+      argv.push_back( const_cast<char *>( arguments[iinc].c_str() ) );
+   }
+   argv.push_back( NULL );
+
+   // Compile.
+   std::cout << "Building FMU library from sources: " << build_path << std::endl;
+   pid = fork();
+   if ( pid == 0 ) {
+      execvp( argv[0], &argv[0] );
+      perror( argv[0] );
+      _exit( 127 );
+   }
+   wait_status = -1;
+   while ( (pid > 0) && (waitpid( pid, &wait_status, 0 ) == -1) && (errno == EINTR) ) {}
+   if (    (pid < 0) || !WIFEXITED( wait_status ) || (WEXITSTATUS( wait_status ) != 0)
+        || (rename( &temp_path[0], build_path.c_str() ) != 0) ) {
+      std::cerr << "Error building FMU library from sources: " << sources_dir << std::endl;
+      unlink( &temp_path[0] );
+      return( fmi2Fatal );
+   }
+
+   this->library_path = build_path;
+
+   return( fmi2OK );
+}
+
+
 /*!
  * @brief Bind a specific FMU function.
  *
  * Helper function to bind a function from an open dynamic library.  The
  * function name has to exactly match a name in the dynamic library.
  *
+ * The functions of an FMU linked into the host are looked up in its
+ * function table instead (see set_static_functions()).
+ *
  * @return Function pointer to function in dynamic library.  This routine
  * returns a NULL pointer if the function is not found.
  * @param [in] model_library Pointer to open FMU dynamic library.
@@ -479,12 +3116,39 @@ void * TrickFMI::FMI2ModelBase::bind_function_ptr(
    void       * model_library,
    const char * function_name )
 {
+   const FMI2StaticFunction * entry;
    void * function_ptr;
+   const char * error;
+
+   // Functions of an FMU linked into the host come from its table.
+   if ( this->static_functions != NULL ) {
+      function_ptr = NULL;
+      for ( entry = this->static_functions ; entry->name != NULL ; entry++ ) {
+         if ( !strcmp( entry->name, function_name ) ) {
+            function_ptr = entry->function;
+            break;
+         }
+      }
+      if ( function_ptr == NULL ) {
+         std::cerr << "Error binding to statically linked function: "
+                   << function_name << std::endl;
+      }
+      return( function_ptr );
+   }
+
    if ( model_library == NULL ){ return( NULL ); }
-   function_ptr = dlsym( model_library, function_name );
+   if ( this->image != NULL ) {
+      // Shared images remember the functions already bound.
+      function_ptr = this->image->find_symbol( function_name );
+   }
+   else {
+      function_ptr = dlsym( model_library, function_name );
+   }
    if ( function_ptr == NULL ) {
       std::cerr << "Error binding to function: " << function_name << std::endl;
-      std::cerr << "   \"" << dlerror() << "\"" << std::endl;
+      if ( (error = dlerror()) != NULL ) {
+         std::cerr << "   \"" << error << "\"" << std::endl;
+      }
    }
    return( function_ptr );
 }
@@ -628,12 +3292,38 @@ void TrickFMI::FMI2ModelBase::clean_up()
    deserialize_fmu_state = NULL;
    get_directional_derivative = NULL;
 
+   /* Forget the host strategies. */
+   use_fmu_state_rollback     = false;
+   use_directional_derivative = false;
+   rollback_state             = NULL;
+
+   /* Release the shared FMU image. */
+   this->release_fmu_image();
+
+   /* Close the model's library. */
+   this->close_library();
+
+   return;
+}
+
+
+/*!
+ * @brief Close the model's dynamically loaded library and library file.
+ */
+void TrickFMI::FMI2ModelBase::close_library()
+{
    /* Close the model's dynamically loaded library. */
    if ( model_library != NULL ){
       dlclose( model_library );
       model_library = NULL;
    }
 
+   /* Close the model's in memory library file. */
+   if ( library_fd >= 0 ){
+      close( library_fd );
+      library_fd = -1;
+   }
+
    return;
 }
 
@@ -648,6 +3338,7 @@ const char * TrickFMI::FMI2ModelBase::fmi2GetTypesPlatform( void )
 {
    /* Call the C FMU method if loaded. */
    if ( get_types_platform != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallGetTypesPlatform );
       return( get_types_platform() );
    }
    return( NULL );
@@ -663,6 +3354,7 @@ const char * TrickFMI::FMI2ModelBase::fmi2GetVersion( void )
 {
    /* Call the C FMU method if loaded. */
    if ( get_version != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallGetVersion );
       return( get_version() );
    }
    return( NULL );
@@ -689,11 +3381,34 @@ fmi2Component TrickFMI::FMI2ModelBase::fmi2Instantiate(
          fmi2Boolean             visible,
          fmi2Boolean             loggingOn  )
 {
+   double start_time;
+
    /* Call the C FMU method if loaded. */
    if ( instantiate != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallInstantiate );
+      // Honor canBeInstantiatedOnlyOncePerProcess for shared images.
+      if ( (this->image != NULL) && !this->image->add_instance() ) {
+         std::cerr << "FMU can only be instantiated once per process: "
+                   << fmu_path << std::endl;
+         return( NULL );
+      }
+      // Remember the instantiation for swap_fmu().
+      this->instance_name              = instanceName;
+      this->instance_resource_location = (fmuResourceLocation != NULL) ? fmuResourceLocation : "";
+      this->instance_callbacks         = functions;
+      this->instance_visible           = visible;
+      this->instance_logging_on        = loggingOn;
+      this->call_profile.name          = instanceName;
+      FMI2Trace::set_instance_name( &this->call_profile, instanceName );
+      start_time = FMI2StartupReport::get_time();
       component = instantiate( instanceName, fmuType, fmuGUID,
                                fmuResourceLocation, functions,
                                visible, loggingOn );
+      FMI2Trace::set_instance_name( component, instanceName );
+      this->startup_report.instantiate_time = FMI2StartupReport::get_time() - start_time;
+      if ( (component == NULL) && (this->image != NULL) ) {
+         this->image->remove_instance();
+      }
       return( component );
    }
    return( NULL );
@@ -707,7 +3422,13 @@ void TrickFMI::FMI2ModelBase::fmi2FreeInstance( void )
 {
    /* Call the C FMU method if loaded. */
    if ( free_instance != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallFreeInstance );
+      this->free_rollback_state();
       free_instance( component );
+      if ( (component != NULL) && (this->image != NULL) ) {
+         this->image->remove_instance();
+      }
+      component = NULL;
    }
    return;
 }
@@ -727,6 +3448,7 @@ fmi2Status TrickFMI::FMI2ModelBase::fmi2SetDebugLogging(
 {
    /* Call the C FMU method if loaded. */
    if ( set_debug_logging != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallSetDebugLogging );
       return( set_debug_logging( component, loggingOn, nCategories, categories) );
    }
    return( fmi2Fatal );
@@ -751,6 +3473,12 @@ fmi2Status TrickFMI::FMI2ModelBase::fmi2SetupExperiment(
 {
    /* Call the C FMU method if loaded. */
    if ( setup_experiment != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallSetupExperiment );
+      // Remember the experiment for swap_fmu().
+      this->experiment_tolerance_defined = toleranceDefined;
+      this->experiment_tolerance         = tolerance;
+      this->experiment_stop_time_defined = stopTimeDefined;
+      this->experiment_stop_time         = stopTime;
       return( setup_experiment( component, toleranceDefined, tolerance,
                                 startTime, stopTimeDefined, stopTime ) );
    }
@@ -763,9 +3491,28 @@ fmi2Status TrickFMI::FMI2ModelBase::fmi2SetupExperiment(
  */
 fmi2Status TrickFMI::FMI2ModelBase::fmi2EnterInitializationMode( void )
 {
+   double start_time;
+   fmi2Status status;
+
    /* Call the C FMU method if loaded. */
    if ( enter_initialization_mode != NULL ) {
-      return( enter_initialization_mode( component ) );
+      start_time = FMI2StartupReport::get_time();
+      /* Set the start values first; their set calls are profiled on their own. */
+      if (    this->apply_description_starts
+           || !this->start_overrides.empty()
+           || !this->string_start_overrides.empty() ) {
+         status = this->apply_start_values();
+         if ( status > fmi2Warning ) {
+            this->startup_report.initialization_time += FMI2StartupReport::get_time() - start_time;
+            return( status );
+         }
+      }
+      {
+         FMI2CallTimer timer( call_profile, FMI2CallEnterInitializationMode );
+         status = enter_initialization_mode( component );
+      }
+      this->startup_report.initialization_time += FMI2StartupReport::get_time() - start_time;
+      return( status );
    }
    return( fmi2Fatal );
 }
@@ -776,9 +3523,16 @@ fmi2Status TrickFMI::FMI2ModelBase::fmi2EnterInitializationMode( void )
  */
 fmi2Status TrickFMI::FMI2ModelBase::fmi2ExitInitializationMode( void )
 {
+   double start_time;
+   fmi2Status status;
+
    /* Call the C FMU method if loaded. */
    if ( exit_initialization_mode != NULL ) {
-      return( exit_initialization_mode( component ) );
+      FMI2CallTimer timer( call_profile, FMI2CallExitInitializationMode );
+      start_time = FMI2StartupReport::get_time();
+      status = exit_initialization_mode( component );
+      this->startup_report.initialization_time += FMI2StartupReport::get_time() - start_time;
+      return( status );
    }
    return( fmi2Fatal );
 }
@@ -786,12 +3540,23 @@ fmi2Status TrickFMI::FMI2ModelBase::fmi2ExitInitializationMode( void )
 
 /*!
  * @brief Terminate the FMU model.
+ *
+ * The call profile is printed if requested (see FMI2CallProfile).
  */
 fmi2Status TrickFMI::FMI2ModelBase::fmi2Terminate( void )
 {
+   fmi2Status status;
+
    /* Call the C FMU method if loaded. */
    if ( terminate != NULL ) {
-      return( terminate( component ) );
+      {
+         FMI2CallTimer timer( call_profile, FMI2CallTerminate );
+         status = terminate( component );
+      }
+      if ( call_profile.print_on_terminate ) {
+         call_profile.print( std::cout );
+      }
+      return( status );
    }
    return( fmi2Fatal );
 }
@@ -810,6 +3575,7 @@ fmi2Status TrickFMI::FMI2ModelBase::fmi2Reset( void )
 {
    /* Call the C FMU method if loaded. */
    if ( reset != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallReset );
       return( reset( component ) );
    }
    return( fmi2Fatal );
@@ -830,6 +3596,7 @@ fmi2Status TrickFMI::FMI2ModelBase::fmi2GetReal(
 {
    /* Call the C FMU method if loaded. */
    if ( get_real != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallGetReal );
       return( get_real( component, vr, nvr, value ) );
    }
    return( fmi2Fatal );
@@ -850,6 +3617,7 @@ fmi2Status TrickFMI::FMI2ModelBase::fmi2GetInteger(
 {
    /* Call the C FMU method if loaded. */
    if ( get_integer != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallGetInteger );
       return( get_integer( component, vr, nvr, value ) );
    }
    return( fmi2Fatal );
@@ -870,6 +3638,7 @@ fmi2Status TrickFMI::FMI2ModelBase::fmi2GetBoolean(
 {
    /* Call the C FMU method if loaded. */
    if ( get_boolean != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallGetBoolean );
       return( get_boolean( component, vr, nvr, value ) );
    }
    return( fmi2Fatal );
@@ -890,6 +3659,7 @@ fmi2Status TrickFMI::FMI2ModelBase::fmi2GetString(
 {
    /* Call the C FMU method if loaded. */
    if ( get_string != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallGetString );
       return( get_string( component, vr, nvr, value ) );
    }
    return( fmi2Fatal );
@@ -910,6 +3680,7 @@ fmi2Status TrickFMI::FMI2ModelBase::fmi2SetReal(
 {
    /* Call the C FMU method if loaded. */
    if ( set_real != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallSetReal );
       return( set_real( component, vr, nvr, value ) );
    }
    return( fmi2Fatal );
@@ -930,6 +3701,7 @@ fmi2Status TrickFMI::FMI2ModelBase::fmi2SetInteger(
 {
    /* Call the C FMU method if loaded. */
    if ( set_integer != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallSetInteger );
       return( set_integer( component, vr, nvr, value ) );
    }
    return( fmi2Fatal );
@@ -950,6 +3722,7 @@ fmi2Status TrickFMI::FMI2ModelBase::fmi2SetBoolean(
 {
    /* Call the C FMU method if loaded. */
    if ( set_boolean != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallSetBoolean );
       return( set_boolean( component, vr, nvr, value ) );
    }
    return( fmi2Fatal );
@@ -970,6 +3743,7 @@ fmi2Status TrickFMI::FMI2ModelBase::fmi2SetString(
 {
    /* Call the C FMU method if loaded. */
    if ( set_string != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallSetString );
       return( set_string( component, vr, nvr, value ) );
    }
    return( fmi2Fatal );
@@ -986,6 +3760,7 @@ fmi2Status TrickFMI::FMI2ModelBase::fmi2GetFMUstate(
 {
    /* Call the C FMU method if loaded. */
    if ( get_fmu_state != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallGetFMUstate );
       return( get_fmu_state( component, FMUstate ) );
    }
    return( fmi2Fatal );
@@ -1002,6 +3777,7 @@ fmi2Status TrickFMI::FMI2ModelBase::fmi2SetFMUstate(
 {
    /* Call the C FMU method if loaded. */
    if ( set_fmu_state != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallSetFMUstate );
       return( set_fmu_state( component, FMUstate ) );
    }
    return( fmi2Fatal );
@@ -1018,6 +3794,7 @@ fmi2Status TrickFMI::FMI2ModelBase::fmi2FreeFMUstate(
 {
    /* Call the C FMU method if loaded. */
    if ( free_fmu_state != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallFreeFMUstate );
       return( free_fmu_state( component, FMUstate ) );
    }
    return( fmi2Fatal );
@@ -1036,6 +3813,7 @@ fmi2Status TrickFMI::FMI2ModelBase::fmi2SerializedFMUstateSize(
 {
    /* Call the C FMU method if loaded. */
    if ( serialized_fmu_state_size != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallSerializedFMUstateSize );
       return( serialized_fmu_state_size( component, FMUstate, size ) );
    }
    return( fmi2Fatal );
@@ -1059,6 +3837,7 @@ fmi2Status TrickFMI::FMI2ModelBase::fmi2SerializeFMUstate(
 {
    /* Call the C FMU method if loaded. */
    if ( serialize_fmu_state != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallSerializeFMUstate );
       return( serialize_fmu_state( component, FMUstate, serializedState, size ) );
    }
    return( fmi2Fatal );
@@ -1079,6 +3858,7 @@ fmi2Status TrickFMI::FMI2ModelBase::fmi2DeSerializeFMUstate(
 {
    /* Call the C FMU method if loaded. */
    if ( deserialize_fmu_state != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallDeSerializeFMUstate );
       return( deserialize_fmu_state( component, serializedState, size, FMUstate ) );
    }
    return( fmi2Fatal );
@@ -1105,6 +3885,7 @@ fmi2Status TrickFMI::FMI2ModelBase::fmi2GetDirectionalDerivative(
 {
    /* Call the C FMU method if loaded. */
    if ( get_directional_derivative != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallGetDirectionalDerivative );
       return( get_directional_derivative( component,
                                           vUnknown_ref, nUnknown,
                                           vKnown_ref, nKnown,
@@ -37,11 +37,17 @@ All Other Rights Reserved.
 #ifndef FMI2_MODEL_BASE_HH_
 #define FMI2_MODEL_BASE_HH_
 
+#include <map>
 #include <string>
+#include <vector>
 
 #include "fmi2FunctionTypes.h"
 
 #include "FMI2FMUModelDescription.hh"
+#include "FMI2FMUImage.hh"
+#include "FMI2StartupReport.hh"
+#include "FMI2CallProfile.hh"
+#include "FMI2StaticFMU.hh"
 
 // TrickFMI namespace is used for everything in the TrickFMI repo
 namespace TrickFMI {
@@ -73,6 +79,71 @@ public:
    bool delete_unpacked_fmu; /**< @trick_units{--} @n
       Flag to indicate if unpacked FMU is deleted. */
 
+   bool unpack_in_memory; /**< @trick_units{--} @n
+      Flag to indicate that the FMU model description and library are loaded
+      directly from the FMU archive without unpacking to disk (Linux only). */
+
+   bool use_unpack_cache; /**< @trick_units{--} @n
+      Flag to indicate that the FMU is unpacked into a content addressed
+      cache in the unpacking area that is shared between instances and
+      processes.  When set, @ref delete_unpacked_fmu removes the cached
+      FMU only when the last user releases it. */
+
+   bool extract_resources; /**< @trick_units{--} @n
+      Flag to indicate that the FMU resources directory is unpacked when the
+      FMU is loaded. */
+
+   bool extract_all_entries; /**< @trick_units{--} @n
+      Flag to indicate that every FMU archive entry is unpacked when the FMU
+      is loaded.  By default only the model description, the libraries for
+      the platform architecture and the resources are unpacked.  Other
+      entries can be unpacked later with extract_fmu_entries(). */
+
+   bool share_fmu_image; /**< @trick_units{--} @n
+      Flag to indicate that the loaded FMU (unpacked files, model description,
+      library and bound functions) is shared with the other model objects in
+      the process that load the same FMU with the same modality.  The FMU is
+      loaded once by the first model object using the settings of that
+      object. */
+
+   unsigned int number_of_extract_threads; /**< @trick_units{--} @n
+      Number of threads that extract the FMU archive entries; 0 uses the
+      number of online processors.  Fewer threads are used for small
+      archives. */
+
+   FMI2StartupReport startup_report; /**< @trick_units{--} @n
+      Times spent in each phase of loading, instantiating and initializing
+      the FMU. */
+
+   FMI2CallProfile call_profile; /**< @trick_units{--} @n
+      Call counts and latency histograms of the FMI functions called
+      through this model object. */
+
+   double finite_difference_step; /**< @trick_units{--} @n
+      Relative step used to compute directional derivatives by finite
+      differences when the FMU does not provide them. */
+
+   bool apply_description_starts; /**< @trick_units{--} @n
+      Flag to indicate that the start values from the model description are
+      set, along with the start value overrides, when the model enters
+      initialization mode.  This is only needed for FMUs that do not
+      initialize their own variables to their start values. */
+
+   bool use_isa_variants; /**< @trick_units{--} @n
+      Flag to indicate that the FMU library variant built for the best
+      instruction set level supported by the host CPU is loaded when the FMU
+      packages one (for example binaries/linux64/model.x86-64-v3.so).  The
+      baseline library is loaded otherwise. */
+
+   std::string source_compiler; /**< @trick_units{--} @n
+      C compiler used to build the FMU library from the FMU sources (see
+      set_source_build_dir()). */
+
+   std::string source_cflags; /**< @trick_units{--} @n
+      Compiler options used to build the FMU library from the FMU sources.
+      Add include paths here for headers the sources do not ship, such as
+      the FMI headers. */
+
    // Default constructor.
    FMI2ModelBase();
 
@@ -86,6 +157,14 @@ public:
    fmi2Status load_fmu( const char * );
    fmi2Status load_fmu( std::string fmu_path );
 
+   fmi2Status extract_fmu_entries( const char * prefix );
+
+   /*
+    * Functions used to replace the running FMU with a new version.
+    */
+   fmi2Status swap_fmu( const char * );
+   fmi2Status swap_fmu( std::string fmu_path );
+
    /*
     * Public helper functions.
     */
@@ -125,6 +204,53 @@ public:
       return( this->unpack_dir.c_str() );
    }
 
+   /*!
+    * @brief Set the directory for the binary model description cache.
+    *
+    * When set, parsed model descriptions are saved in this directory and
+    * later loads of the same model description skip the XML parse.  An
+    * empty path (the default) disables the cache.
+    *
+    * @param [in] path C-style string that specifies the cache directory (must exist).
+    */
+   void set_description_cache_dir( const char * path ){
+      this->description_cache_dir = path;
+   }
+
+   /*!
+    * @brief Get the directory for the binary model description cache.
+    *
+    * @return Returns the binary model description cache directory.
+    */
+   const char * get_description_cache_dir( ){
+      return( this->description_cache_dir.c_str() );
+   }
+
+   /*!
+    * @brief Set the directory for libraries built from the FMU sources.
+    *
+    * When set, the FMU library is compiled from the C files in the FMU
+    * sources directory with @ref source_compiler and @ref source_cflags
+    * instead of loaded from the binaries directory.  Built libraries are
+    * kept in this directory, keyed by the source files, the compiler and
+    * its options, and later loads reuse them.  An empty path (the default)
+    * loads the library shipped in the FMU.
+    *
+    * @param [in] path C-style string that specifies the build directory (must exist).
+    */
+   void set_source_build_dir( const char * path ){
+      this->source_build_dir = path;
+   }
+
+   /*!
+    * @brief Get the directory for libraries built from the FMU sources.
+    *
+    * @return Returns the source build directory.
+    */
+   const char * get_source_build_dir( ){
+      return( this->source_build_dir.c_str() );
+   }
+
    /*!
     * @brief Get the path to the unpacked FMU directory.
     *
@@ -140,7 +266,49 @@ public:
     * @return Returns the name of the FMU model.
     */
    const char * get_model_name( ){
-      return( this->model_description.model_name.c_str() );
+      return( this->description->model_name.c_str() );
+   }
+
+   /*!
+    * @brief Get the model variable table.
+    *
+    * @return Returns the table of model variables from the model description.
+    */
+   const FMI2VariableTable & get_variables( ){
+      return( this->description->variables );
+   }
+
+   /*!
+    * @brief Get the model unit and type table.
+    *
+    * @return Returns the units and simple types from the model description.
+    */
+   const FMI2UnitTable & get_units( ){
+      return( this->description->units );
+   }
+
+   /*
+    * Functions used to set the variable start values.
+    */
+   fmi2Status set_start_value( const char * name, double value );
+   fmi2Status set_start_value( const char * name, const char * value );
+   void clear_start_values( void );
+   fmi2Status apply_start_values( void );
+
+   fmi2Status get_value_references(
+      const char * const       names[],
+            size_t             nvr,
+            fmi2ValueReference vr[]    );
+
+   /*!
+    * @brief Get the FMU capability flags for the model modality.
+    *
+    * @return Returns the capability flags from the model description.
+    */
+   const FMI2Capabilities & get_capabilities( ){
+      return( (this->modality == fmi2ModelExchange) ?
+              this->description->model_exchange_capabilities :
+              this->description->co_simulation_capabilities );
    }
 
    /*!
@@ -170,8 +338,50 @@ public:
       return( this->library_path.c_str() );
    }
 
+   /*!
+    * @brief Get the instruction set variant of the loaded FMU library.
+    *
+    * @return Returns the variant name (for example "x86-64-v3") or an empty
+    * string if the baseline library is loaded.
+    */
+   const char * get_library_variant( ){
+      return( this->library_variant.c_str() );
+   }
+
+   static unsigned int host_isa_level();
+
+   /*!
+    * @brief Bind to the functions of an FMU linked into the host.
+    *
+    * When set, load_fmu() still reads the model description (and unpacks
+    * the resources) from the FMU but binds the FMI functions from the table
+    * instead of loading the FMU library.  See FMI2StaticFMU.hh.
+    *
+    * @param [in] functions Function table from FMI2_STATIC_FMU_FUNCTIONS or
+    * NULL to load the FMU library.
+    */
+   void set_static_functions( const FMI2StaticFunction * functions ){
+      this->static_functions = functions;
+   }
+
    virtual void clean_up();
 
+   /*
+    * Host strategies selected from the FMU capabilities when it is loaded.
+    */
+   virtual bool can_rollback( void );
+   virtual fmi2Status save_rollback_state( void );
+   virtual fmi2Status restore_rollback_state( void );
+   virtual void free_rollback_state( void );
+
+   fmi2Status directional_derivative(
+      const fmi2ValueReference vUnknown_ref[],
+            size_t             nUnknown,
+      const fmi2ValueReference vKnown_ref[],
+            size_t             nKnown,
+      const fmi2Real           dvKnown[],
+            fmi2Real           dvUnknown[]    );
+
 
    //------------------------------------------------------------------------
    // The following functions are common to both FMI modalities.
@@ -313,11 +523,65 @@ public:
    std::string   fmu_path;      //!< Path to FMU.
    std::string   unpack_dir;    //!< Path to FMU unpacking area (must exist).
    std::string   unpack_path;   //!< Path to FMU unpacking directory (must not exist).
+   std::string   description_cache_dir; //!< Path to binary model description cache (must exist).
+   std::string   source_build_dir; //!< Path to libraries built from FMU sources (must exist).
    std::string   architecture;  //!< Machine architecture for library.
    std::string   library_path;  //!< Path to FMU library.
+   std::string   library_variant; //!< Instruction set variant of the FMU library.
+   int           library_fd;    //!< @trick_units{--} In memory library file descriptor.
+   int           cache_refs_fd; //!< @trick_units{--} Unpack cache reference lock file descriptor.
    void        * model_library; //!< @trick_units{**} Dynamically loaded model library.
+   const FMI2StaticFunction * static_functions; //!< @trick_io{**} Statically linked FMU functions or NULL.
 
    FMI2FMUModelDescription model_description;  //!< Model description object.
+   FMI2FMUModelDescription * description; //!< @trick_io{**} Model description in use.
+   FMI2FMUImage * image; //!< @trick_io{**} Shared FMU image in use or NULL.
+
+   bool use_fmu_state_rollback;     //!< @trick_units{--} Roll back with fmi2GetFMUstate and fmi2SetFMUstate.
+   bool use_directional_derivative; //!< @trick_units{--} Use fmi2GetDirectionalDerivative, not finite differences.
+   fmi2FMUstate rollback_state;     //!< @trick_io{**} FMU state saved for rollback.
+   std::vector<fmi2Real> derivative_work; //!< @trick_io{**} Finite difference work space.
+
+   std::map<std::string, double>      start_overrides;        //!< @trick_io{**} Numeric start value overrides by name.
+   std::map<std::string, std::string> string_start_overrides; //!< @trick_io{**} String start value overrides by name.
+
+   std::vector<fmi2ValueReference> real_start_refs;     //!< @trick_io{**} Sorted Real start value references.
+   std::vector<fmi2Real>           real_start_values;   //!< @trick_io{**} Real start values.
+   std::vector<fmi2ValueReference> integer_start_refs;  //!< @trick_io{**} Sorted Integer start value references.
+   std::vector<fmi2Integer>        integer_start_values;//!< @trick_io{**} Integer start values.
+   std::vector<fmi2ValueReference> boolean_start_refs;  //!< @trick_io{**} Sorted Boolean start value references.
+   std::vector<fmi2Boolean>        boolean_start_values;//!< @trick_io{**} Boolean start values.
+   std::vector<fmi2ValueReference> string_start_refs;   //!< @trick_io{**} Sorted String start value references.
+   std::vector<fmi2String>         string_start_values; //!< @trick_io{**} String start values.
+
+   std::string   instance_name;              //!< Instance name passed to fmi2Instantiate.
+   std::string   instance_resource_location; //!< Resource location passed to fmi2Instantiate.
+   const fmi2CallbackFunctions * instance_callbacks; //!< @trick_io{**} Callback functions passed to fmi2Instantiate.
+   fmi2Boolean   instance_visible;           //!< @trick_units{--} Visible flag passed to fmi2Instantiate.
+   fmi2Boolean   instance_logging_on;        //!< @trick_units{--} Logging flag passed to fmi2Instantiate.
+   fmi2Boolean   experiment_tolerance_defined; //!< @trick_units{--} Tolerance flag passed to fmi2SetupExperiment.
+   fmi2Real      experiment_tolerance;         //!< @trick_units{--} Tolerance passed to fmi2SetupExperiment.
+   fmi2Boolean   experiment_stop_time_defined; //!< @trick_units{--} Stop time flag passed to fmi2SetupExperiment.
+   fmi2Real      experiment_stop_time;         //!< @trick_units{s} Stop time passed to fmi2SetupExperiment.
+   unsigned int  swap_count; //!< @trick_units{--} Number of FMU versions swapped in.
+   FMI2FMUModelDescription * swap_description; //!< @trick_io{**} Model description of a swapped in FMU or NULL.
+
+   /*!
+   @brief Variable values carried across an FMU swap, by variable name.
+   */
+   struct SwapValues {
+      std::map<std::string, double>      numeric; /**< @trick_io{**} Real, Integer, Enumeration and Boolean values. */
+      std::map<std::string, std::string> strings; /**< @trick_io{**} String values. */
+   };
+
+   virtual void select_host_strategies();
+
+   virtual fmi2Status evaluate_unknowns();
+
+   virtual fmi2Status set_known_reals(
+      const fmi2ValueReference vr[],
+            size_t             nvr,
+      const fmi2Real           value[] );
 
    virtual void * bind_function_ptr(
       void       * model_library,
@@ -325,6 +589,9 @@ public:
 
    virtual fmi2Status bind_function_ptrs();
 
+   virtual fmi2Real get_swap_time( void );
+   virtual fmi2Status resume_swapped_instance( const SwapValues & values );
+
    /*
     * C function pointers bound when the FMU is loaded.
     */
@@ -365,10 +632,57 @@ public:
    /* Getting partial derivatives */
    fmi2GetDirectionalDerivativeTYPE (*get_directional_derivative);
 
+   // Direct calls bind to the FMU functions (see FMI2DirectCalls.hh).
+   template< class Model > friend class FMI2DirectCalls;
+
 
   private:
+
+   /*!
+   @brief The resources of a loaded FMU that are replaced by an FMU swap.
+   */
+   struct LoadedFMU {
+      fmi2Component component;       /**< @trick_units{**} FMU instance. */
+      std::string   fmu_path;        /**< @trick_units{--} Path to FMU. */
+      std::string   unpack_path;     /**< @trick_units{--} Path to FMU unpacking directory. */
+      std::string   library_path;    /**< @trick_units{--} Path to FMU library. */
+      std::string   library_variant; /**< @trick_units{--} Instruction set variant of the FMU library. */
+      int           library_fd;      /**< @trick_units{--} In memory library file descriptor. */
+      int           cache_refs_fd;   /**< @trick_units{--} Unpack cache reference lock file descriptor. */
+      void        * model_library;   /**< @trick_units{**} Dynamically loaded model library. */
+      FMI2FMUModelDescription * description; /**< @trick_io{**} Model description. */
+   };
+
+   void exchange_loaded_fmu( LoadedFMU & other );
+   void release_loaded_fmu( LoadedFMU & loaded );
+   fmi2Status get_swap_values( SwapValues & values );
+   fmi2Status set_swap_values( const SwapValues & values );
+   fmi2Status get_serialized_state( std::vector<fmi2Byte> & state );
+   fmi2Status set_serialized_state( const std::vector<fmi2Byte> & state );
+   fmi2Status start_swapped_instance( const std::string & old_unpack_path,
+                                      const std::vector<fmi2Byte> & state,
+                                      const SwapValues & values,
+                                      fmi2Real time );
+
+   void set_host_architecture();
+   std::string library_suffix();
+   std::string library_file_name( unsigned int isa_level = 0 );
+   unsigned int library_isa_level();
+   std::string fmu_base_name();
    fmi2Status unpack_fmu();
+   fmi2Status unpack_fmu_cached();
+   fmi2Status extract_fmu( const std::string & extract_path,
+                           const char        * prefix );
+   bool is_load_entry( const char * entry_name );
+   fmi2Status release_unpack_cache();
+   fmi2Status load_fmu_in_memory();
    fmi2Status load_library();
+   fmi2Status build_library_from_sources();
+   fmi2Status load_fmu_files();
+   fmi2Status load_shared_fmu();
+   fmi2Status bind_function_ptrs_timed();
+   void release_fmu_image();
+   void close_library();
    fmi2Status remove_unpack_dir();
 
    /*!
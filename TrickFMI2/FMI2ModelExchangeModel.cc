@@ -17,6 +17,10 @@ All Other Rights Reserved.
 
 
 TrickFMI::FMI2ModelExchangeModel::FMI2ModelExchangeModel()
+: call_completed_integrator_step(true),
+  current_time(0.0),
+  rollback_time(0.0),
+  rollback_saved(false)
 {
 
    // Set the model use modality.
@@ -45,6 +49,11 @@ void TrickFMI::FMI2ModelExchangeModel::clean_up()
    get_continuous_states = NULL;
    get_nominals_of_continuous_state = NULL;
 
+   /* Forget the host strategies. */
+   call_completed_integrator_step = true;
+   rollback_saved = false;
+   state_indices.clear();
+
    /* Call the base class clean up method. */
    FMI2ModelBase::clean_up();
 
@@ -102,11 +111,270 @@ fmi2Status TrickFMI::FMI2ModelExchangeModel::bind_function_ptrs()
 }
 
 
+/*!
+ * @brief Choose the host strategies allowed by the FMU capabilities.
+ *
+ * In addition to the common strategies, this skips
+ * fmi2CompletedIntegratorStep when the FMU does not need it and maps the
+ * continuous state value references to their positions in the state vector
+ * (the order of the ModelStructure Derivatives).
+ */
+void TrickFMI::FMI2ModelExchangeModel::select_host_strategies()
+{
+   const FMI2DependencyGraph & derivatives = this->description->derivatives;
+   const FMI2VariableTable & variables = this->description->variables;
+   size_t row;
+   int state;
+
+   FMI2ModelBase::select_host_strategies();
+
+   call_completed_integrator_step =
+      !this->get_capabilities().completed_integrator_step_not_needed;
+
+   state_indices.clear();
+   for ( row = 0 ; row < derivatives.get_number_of_unknowns() ; row++ ) {
+      state = variables.get_derivative( derivatives.get_unknown( row ) );
+      if ( state >= 0 ) {
+         state_indices[ variables.get_value_reference( state ) ] = row;
+      }
+   }
+   rollback_states.resize( derivatives.get_number_of_unknowns() );
+   state_work.resize( derivatives.get_number_of_unknowns() );
+   rollback_saved = false;
+
+   return;
+}
+
+
+/*!
+ * @brief Check if the model time and continuous states can be rolled back.
+ *
+ * This is the partial rollback used when can_rollback() is false: the
+ * model time and continuous states are restored, but discrete states and
+ * any other internal FMU state changed since the save are not.  It is
+ * enough for an integrator retrying a step with no events in it.
+ *
+ * @return Returns true.
+ */
+bool TrickFMI::FMI2ModelExchangeModel::can_rollback_continuous_states( void )
+{
+   return( true );
+}
+
+
+/*!
+ * @brief Save the model state so that it can be rolled back.
+ *
+ * If the FMU can get and set its state, the full FMU state is saved.
+ * Otherwise only the model time and continuous states are saved (see
+ * can_rollback_continuous_states()).
+ */
+fmi2Status TrickFMI::FMI2ModelExchangeModel::save_rollback_state( void )
+{
+   fmi2Status status;
+
+   if ( this->use_fmu_state_rollback ) {
+      return( FMI2ModelBase::save_rollback_state() );
+   }
+
+   status = this->fmi2GetContinuousStates( rollback_states.empty() ? NULL : &rollback_states[0],
+                                           rollback_states.size() );
+   rollback_time  = current_time;
+   rollback_saved = (status <= fmi2Warning);
+   return( status );
+}
+
+
+/*!
+ * @brief Roll the model state back to the last saved state.
+ *
+ * Without FMU state support only the model time and continuous states are
+ * restored (see can_rollback_continuous_states()).
+ */
+fmi2Status TrickFMI::FMI2ModelExchangeModel::restore_rollback_state( void )
+{
+   fmi2Status status;
+
+   if ( this->use_fmu_state_rollback ) {
+      return( FMI2ModelBase::restore_rollback_state() );
+   }
+   if ( !rollback_saved ) {
+      return( fmi2Error );
+   }
+
+   status = this->fmi2SetTime( rollback_time );
+   if ( status <= fmi2Warning ) {
+      status = this->fmi2SetContinuousStates( rollback_states.empty() ? NULL : &rollback_states[0],
+                                              rollback_states.size() );
+   }
+   return( status );
+}
+
+
+/*!
+ * @brief Set up the model experiment and record the start time.
+ */
+fmi2Status TrickFMI::FMI2ModelExchangeModel::fmi2SetupExperiment(
+   fmi2Boolean toleranceDefined,
+   fmi2Real    tolerance,
+   fmi2Real    startTime,
+   fmi2Boolean stopTimeDefined,
+   fmi2Real    stopTime          )
+{
+   current_time = startTime;
+   return( FMI2ModelBase::fmi2SetupExperiment( toleranceDefined, tolerance,
+                                               startTime,
+                                               stopTimeDefined, stopTime ) );
+}
+
+
+/*!
+ * @brief Bring the model unknowns up to date after the knowns are set.
+ *
+ * Some FMUs only evaluate their derivatives and the variables that depend
+ * on them in fmi2GetDerivatives, so the derivatives are evaluated here.
+ */
+fmi2Status TrickFMI::FMI2ModelExchangeModel::evaluate_unknowns()
+{
+   if ( state_work.empty() ) {
+      return( fmi2OK );
+   }
+   return( this->fmi2GetDerivatives( &state_work[0], state_work.size() ) );
+}
+
+
+/*!
+ * @brief Set the values of the known variables of a directional derivative.
+ *
+ * Continuous states can only be set through fmi2SetContinuousStates so
+ * known states are set in the state vector and the other knowns are set
+ * with fmi2SetReal.
+ *
+ * @param [in] vr    Value references of the known variables.
+ * @param [in] nvr   Number of known variables.
+ * @param [in] value Values of the known variables.
+ */
+fmi2Status TrickFMI::FMI2ModelExchangeModel::set_known_reals(
+   const fmi2ValueReference vr[],
+         size_t             nvr,
+   const fmi2Real           value[] )
+{
+   std::map<fmi2ValueReference, size_t>::iterator state_iter;
+   fmi2Status status = fmi2OK;
+   fmi2Status set_status;
+   bool states_changed = false;
+   size_t iinc;
+
+   if ( state_indices.empty() ) {
+      return( FMI2ModelBase::set_known_reals( vr, nvr, value ) );
+   }
+
+   // Split the knowns into states and other variables.
+   other_known_refs.clear();
+   other_known_values.clear();
+   for ( iinc = 0 ; iinc < nvr ; iinc++ ) {
+      state_iter = state_indices.find( vr[iinc] );
+      if ( state_iter == state_indices.end() ) {
+         other_known_refs.push_back( vr[iinc] );
+         other_known_values.push_back( value[iinc] );
+         continue;
+      }
+      if ( !states_changed ) {
+         status = this->fmi2GetContinuousStates( &state_work[0], state_work.size() );
+         if ( status > fmi2Warning ) { return( status ); }
+         states_changed = true;
+      }
+      state_work[ state_iter->second ] = value[iinc];
+   }
+
+   if ( states_changed ) {
+      status = this->fmi2SetContinuousStates( &state_work[0], state_work.size() );
+      if ( status > fmi2Warning ) { return( status ); }
+   }
+   if ( !other_known_refs.empty() ) {
+      set_status = this->fmi2SetReal( &other_known_refs[0], other_known_refs.size(),
+                                      &other_known_values[0] );
+      if ( set_status > status ) { status = set_status; }
+   }
+
+   return( status );
+}
+
+
+/*!
+ * @brief Get the model time carried across an FMU swap.
+ *
+ * @return Returns the model time last set.
+ */
+fmi2Real TrickFMI::FMI2ModelExchangeModel::get_swap_time( void )
+{
+   return( current_time );
+}
+
+
+/*!
+ * @brief Bring a swapped in FMU instance back into Continuous-Time Mode.
+ *
+ * The discrete states are updated as after initialization, the model time
+ * is set and the continuous states are set to the values of the old FMU
+ * states of the same name.
+ *
+ * @param [in] values Variable values of the old FMU instance.
+ */
+fmi2Status TrickFMI::FMI2ModelExchangeModel::resume_swapped_instance(
+   const SwapValues & values )
+{
+   const FMI2VariableTable & variables = this->description->variables;
+   std::map<fmi2ValueReference, size_t>::const_iterator state_iter;
+   std::map<std::string, double>::const_iterator value_iter;
+   fmi2EventInfo event_info;
+   fmi2Status status;
+   size_t iinc;
+
+   // Iterate on the discrete states.
+   event_info.newDiscreteStatesNeeded = fmi2True;
+   while ( event_info.newDiscreteStatesNeeded ) {
+      status = this->fmi2NewDiscreteStates( &event_info );
+      if ( status > fmi2Warning ) { return( status ); }
+   }
+
+   // Enter Continuous-Time Mode at the current time.
+   status = this->fmi2EnterContinuousTimeMode();
+   if ( status > fmi2Warning ) { return( status ); }
+   status = this->fmi2SetTime( current_time );
+   if ( status > fmi2Warning ) { return( status ); }
+   if ( state_work.empty() ) {
+      return( status );
+   }
+
+   // Set the continuous states.
+   status = this->fmi2GetContinuousStates( &state_work[0], state_work.size() );
+   if ( status > fmi2Warning ) { return( status ); }
+   for ( iinc = 0 ; iinc < variables.size() ; iinc++ ) {
+      if ( variables.get_type( iinc ) != FMI2Real ) {
+         continue;
+      }
+      state_iter = state_indices.find( variables.get_value_reference( iinc ) );
+      if ( state_iter == state_indices.end() ) {
+         continue;
+      }
+      value_iter = values.numeric.find( variables.get_name( iinc ) );
+      if ( value_iter != values.numeric.end() ) {
+         state_work[ state_iter->second ] = value_iter->second;
+      }
+   }
+
+   return( this->fmi2SetContinuousStates( &state_work[0], state_work.size() ) );
+}
+
+
 fmi2Status TrickFMI::FMI2ModelExchangeModel::fmi2SetTime(
    fmi2Real time )
 {
    /* Call the C FMU method if loaded. */
    if ( set_time != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallSetTime );
+      current_time = time;
       return( set_time( component, time ) );
    }
    return( fmi2Fatal );
@@ -119,6 +387,7 @@ fmi2Status TrickFMI::FMI2ModelExchangeModel::fmi2SetContinuousStates(
 {
    /* Call the C FMU method if loaded. */
    if ( set_continuous_states != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallSetContinuousStates );
       return( set_continuous_states( component, x, nx ) );
    }
    return( fmi2Fatal );
@@ -129,6 +398,7 @@ fmi2Status TrickFMI::FMI2ModelExchangeModel::fmi2EnterEventMode( void )
 {
    /* Call the C FMU method if loaded. */
    if ( enter_event_mode != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallEnterEventMode );
       return( enter_event_mode( component ) );
    }
    return( fmi2Fatal );
@@ -140,6 +410,7 @@ fmi2Status TrickFMI::FMI2ModelExchangeModel::fmi2NewDiscreteStates(
 {
    /* Call the C FMU method if loaded. */
    if ( new_discrete_states != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallNewDiscreteStates );
       return( new_discrete_states( component, fmi2eventInfo ) );
    }
    return( fmi2Fatal );
@@ -150,6 +421,7 @@ fmi2Status TrickFMI::FMI2ModelExchangeModel::fmi2EnterContinuousTimeMode( void )
 {
    /* Call the C FMU method if loaded. */
    if ( enter_continuous_time_mode != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallEnterContinuousTimeMode );
       return( enter_continuous_time_mode( component ) );
    }
    return( fmi2Fatal );
@@ -161,8 +433,16 @@ fmi2Status TrickFMI::FMI2ModelExchangeModel::fmi2CompletedIntegratorStep(
    fmi2Boolean * enterEventMode,
    fmi2Boolean * terminateSimulation  )
 {
+   /* Skip the call when the FMU does not need it. */
+   if ( !call_completed_integrator_step && (completed_integrator_step != NULL) ) {
+      *enterEventMode      = fmi2False;
+      *terminateSimulation = fmi2False;
+      return( fmi2OK );
+   }
+
    /* Call the C FMU method if loaded. */
    if ( completed_integrator_step != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallCompletedIntegratorStep );
       return( completed_integrator_step( component,
                                          noSetFMUStatePriorToCurrentPoint,
                                          enterEventMode,
@@ -178,6 +458,7 @@ fmi2Status TrickFMI::FMI2ModelExchangeModel::fmi2GetDerivatives(
 {
    /* Call the C FMU method if loaded. */
    if ( get_derivatives != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallGetDerivatives );
       return( get_derivatives( component, derivatives, nx ) );
    }
    return( fmi2Fatal );
@@ -190,6 +471,7 @@ fmi2Status TrickFMI::FMI2ModelExchangeModel::fmi2GetEventIndicators(
 {
    /* Call the C FMU method if loaded. */
    if ( get_event_indicators != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallGetEventIndicators );
       return( get_event_indicators( component, eventIndicators, ni ) );
    }
    return( fmi2Fatal );
@@ -202,6 +484,7 @@ fmi2Status TrickFMI::FMI2ModelExchangeModel::fmi2GetContinuousStates(
 {
    /* Call the C FMU method if loaded. */
    if ( get_continuous_states != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallGetContinuousStates );
       return( get_continuous_states( component, x, nx ) );
    }
    return( fmi2Fatal );
@@ -214,6 +497,7 @@ fmi2Status TrickFMI::FMI2ModelExchangeModel::fmi2GetNominalsOfContinuousStates(
 {
    /* Call the C FMU method if loaded. */
    if ( get_nominals_of_continuous_state != NULL ) {
+      FMI2CallTimer timer( call_profile, FMI2CallGetNominalsOfContinuousStates );
       return( get_nominals_of_continuous_state( component, x_nominal, nx ) );
    }
    return( fmi2Fatal );
@@ -20,6 +20,9 @@ All Other Rights Reserved.
 #ifndef FMI2_MODEL_EXCHANGE_MODEL_HH_
 #define FMI2_MODEL_EXCHANGE_MODEL_HH_
 
+#include <map>
+#include <vector>
+
 #include "FMI2ModelBase.hh"
 
 // TrickFMI namespace is used for everything in the TrickFMI repo
@@ -62,6 +65,20 @@ class FMI2ModelExchangeModel: public TrickFMI::FMI2ModelBase
     */
    virtual void clean_up();
 
+   /*
+    * Host strategies selected from the FMU capabilities when it is loaded.
+    */
+   bool can_rollback_continuous_states( void );
+   virtual fmi2Status save_rollback_state( void );
+   virtual fmi2Status restore_rollback_state( void );
+
+   virtual fmi2Status fmi2SetupExperiment(
+      fmi2Boolean toleranceDefined,
+      fmi2Real    tolerance,
+      fmi2Real    startTime,
+      fmi2Boolean stopTimeDefined,
+      fmi2Real    stopTime          );
+
 
    //------------------------------------------------------------------------
    // The following functions are for the FMI 2 model exchange modality.
@@ -100,8 +117,30 @@ class FMI2ModelExchangeModel: public TrickFMI::FMI2ModelBase
 
   protected:
 
+   bool call_completed_integrator_step; //!< @trick_units{--} FMU needs fmi2CompletedIntegratorStep.
+   fmi2Real current_time;  //!< @trick_units{s} Model time last set.
+   fmi2Real rollback_time; //!< @trick_units{s} Model time saved for rollback.
+   bool rollback_saved;    //!< @trick_units{--} Continuous states saved for rollback.
+   std::vector<fmi2Real> rollback_states; //!< @trick_io{**} Continuous states saved for rollback.
+   std::vector<fmi2Real> state_work;      //!< @trick_io{**} Continuous state work space.
+   std::vector<fmi2ValueReference> other_known_refs;   //!< @trick_io{**} Known input work space.
+   std::vector<fmi2Real>           other_known_values; //!< @trick_io{**} Known input work space.
+   std::map<fmi2ValueReference, size_t> state_indices; //!< @trick_io{**} State vector index of each state value reference.
+
+   virtual void select_host_strategies();
+
+   virtual fmi2Status evaluate_unknowns();
+
+   virtual fmi2Status set_known_reals(
+      const fmi2ValueReference vr[],
+            size_t             nvr,
+      const fmi2Real           value[] );
+
    virtual fmi2Status bind_function_ptrs();
 
+   virtual fmi2Real get_swap_time( void );
+   virtual fmi2Status resume_swapped_instance( const SwapValues & values );
+
    /*
     * C function pointers bound when the FMU is loaded.
     */
@@ -124,6 +163,9 @@ class FMI2ModelExchangeModel: public TrickFMI::FMI2ModelBase
    fmi2GetContinuousStatesTYPE           (*get_continuous_states);
    fmi2GetNominalsOfContinuousStatesTYPE (*get_nominals_of_continuous_state);
 
+   // Direct calls bind to the FMU functions (see FMI2DirectCalls.hh).
+   template< class Model > friend class FMI2DirectCalls;
+
 
   private:
    /*!
@@ -0,0 +1,205 @@
+/**
+@file FMI2RealBinding.cc
+@ingroup FMITrickInterface
+@brief Method implementations for the FMI2RealBinding class
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+*/
+
+#include <iostream>
+
+#include "FMI2ModelBase.hh"
+#include "FMI2RealBinding.hh"
+
+
+/*!
+ * @brief Apply an affine conversion to a buffer.
+ *
+ * The loop has no dependencies between elements so the compiler can
+ * vectorize it.
+ *
+ * @param [in]  count  Number of values.
+ * @param [in]  input  Values to convert.
+ * @param [in]  scale  Scale factors.
+ * @param [in]  offset Offsets.
+ * @param [out] output Converted values (may not overlap the inputs).
+ */
+static void convert_values(
+         size_t             count,
+   const fmi2Real * __restrict__ input,
+   const fmi2Real * __restrict__ scale,
+   const fmi2Real * __restrict__ offset,
+         fmi2Real * __restrict__ output )
+{
+   size_t iinc;
+
+   for ( iinc = 0 ; iinc < count ; iinc++ ) {
+      output[iinc] = scale[iinc] * input[iinc] + offset[iinc];
+   }
+
+   return;
+}
+
+
+//! Default constructor.
+TrickFMI::FMI2RealBinding::FMI2RealBinding()
+: model(NULL),
+  needs_conversion(false)
+{
+}
+
+
+//! Destructor.
+TrickFMI::FMI2RealBinding::~FMI2RealBinding()
+{
+}
+
+
+//! Remove all the bound variables.
+void TrickFMI::FMI2RealBinding::clear()
+{
+   model = NULL;
+   needs_conversion = false;
+   value_references.clear();
+   scales.clear();
+   offsets.clear();
+   inverse_scales.clear();
+   inverse_offsets.clear();
+   fmu_values.clear();
+   return;
+}
+
+
+/*!
+ * @brief Bind a list of Real model variables to host units.
+ *
+ * The model description of the model must be loaded.  Any previously bound
+ * variables are replaced.
+ *
+ * @return Returns fmi2OK or fmi2Error if a variable is unknown, is not a
+ * Real or its unit can not be converted to the host unit.  On error no
+ * variables are bound.
+ * @param [in] model      Model with the variables.
+ * @param [in] names      Names of the model variables.
+ * @param [in] host_units Host unit string of each variable, or NULL to
+ *                        use the FMU units for all the variables.  A NULL
+ *                        or empty unit string uses the FMU unit.
+ * @param [in] count      Number of variables.
+ */
+fmi2Status TrickFMI::FMI2RealBinding::bind(
+         FMI2ModelBase & model,
+   const char * const    names[],
+   const char * const    host_units[],
+         size_t          count         )
+{
+   const FMI2VariableTable & variables = model.get_variables();
+   const FMI2UnitTable & units = model.get_units();
+   const char * host_unit;
+   fmi2Status status = fmi2OK;
+   double scale, offset;
+   size_t iinc;
+   int index;
+
+   this->clear();
+   value_references.reserve( count );
+   scales.reserve( count );
+   offsets.reserve( count );
+   inverse_scales.reserve( count );
+   inverse_offsets.reserve( count );
+
+   for ( iinc = 0 ; iinc < count ; iinc++ ) {
+
+      host_unit = (host_units != NULL) ? host_units[iinc] : NULL;
+
+      index = variables.find( names[iinc] );
+      if ( index < 0 ) {
+         std::cerr << "Unknown model variable: " << names[iinc] << std::endl;
+         status = fmi2Error;
+         continue;
+      }
+      if ( variables.get_type( index ) != FMI2Real ) {
+         std::cerr << "Model variable is not a Real: " << names[iinc] << std::endl;
+         status = fmi2Error;
+         continue;
+      }
+      if (    !units.get_conversion( variables.get_unit( index ), host_unit, scale, offset )
+           || (scale == 0.0) ) {
+         std::cerr << "Can not convert model variable " << names[iinc] << " from \""
+                   << ( (variables.get_unit( index ) >= 0) ?
+                        units.get_unit_name( variables.get_unit( index ) ) : "" )
+                   << "\" to \"" << ( (host_unit != NULL) ? host_unit : "" ) << "\"" << std::endl;
+         status = fmi2Error;
+         continue;
+      }
+
+      value_references.push_back( variables.get_value_reference( index ) );
+      scales.push_back( scale );
+      offsets.push_back( offset );
+      inverse_scales.push_back( 1.0 / scale );
+      inverse_offsets.push_back( -offset / scale );
+      if ( (scale != 1.0) || (offset != 0.0) ) {
+         needs_conversion = true;
+      }
+   }
+
+   if ( status != fmi2OK ) {
+      this->clear();
+      return( status );
+   }
+
+   this->model = &model;
+   fmu_values.resize( value_references.size() );
+
+   return( fmi2OK );
+}
+
+
+/*!
+ * @brief Get the bound variables in host units.
+ *
+ * @param [out] values Values of the bound variables in binding order.
+ */
+fmi2Status TrickFMI::FMI2RealBinding::get( fmi2Real values[] )
+{
+   fmi2Status status;
+
+   if ( model == NULL ) { return( fmi2Error ); }
+   if ( value_references.empty() ) { return( fmi2OK ); }
+
+   if ( !needs_conversion ) {
+      return( model->fmi2GetReal( &value_references[0], value_references.size(), values ) );
+   }
+
+   status = model->fmi2GetReal( &value_references[0], value_references.size(),
+                                &fmu_values[0] );
+   if ( status <= fmi2Warning ) {
+      convert_values( fmu_values.size(), &fmu_values[0],
+                      &scales[0], &offsets[0], values );
+   }
+
+   return( status );
+}
+
+
+/*!
+ * @brief Set the bound variables from host units.
+ *
+ * @param [in] values Values of the bound variables in binding order.
+ */
+fmi2Status TrickFMI::FMI2RealBinding::set( const fmi2Real values[] )
+{
+   if ( model == NULL ) { return( fmi2Error ); }
+   if ( value_references.empty() ) { return( fmi2OK ); }
+
+   if ( !needs_conversion ) {
+      return( model->fmi2SetReal( &value_references[0], value_references.size(), values ) );
+   }
+
+   convert_values( fmu_values.size(), values,
+                   &inverse_scales[0], &inverse_offsets[0], &fmu_values[0] );
+   return( model->fmi2SetReal( &value_references[0], value_references.size(),
+                               &fmu_values[0] ) );
+}
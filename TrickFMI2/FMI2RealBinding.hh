@@ -0,0 +1,126 @@
+/*******************************************************************************
+* Things that Trick looks for to trigger parsing and processing:
+* PURPOSE:
+* LIBRARY DEPENDENCY:
+*  ((FMI2RealBinding.o))
+********************************************************************************/
+/*!
+@file FMI2RealBinding.hh
+@ingroup FMITrickInterface
+@brief Definition of the FMI2RealBinding class.
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+
+*/
+
+#ifndef FMI2_REAL_BINDING_HH_
+#define FMI2_REAL_BINDING_HH_
+
+#include <stddef.h>
+#include <vector>
+
+#include "fmi2FunctionTypes.h"
+
+// TrickFMI namespace is used for everything in the TrickFMI repo
+namespace TrickFMI {
+
+class FMI2ModelBase;
+
+/*!
+@class FMI2RealBinding
+@brief Defines the FMI2RealBinding class.
+
+The FMI2RealBinding class binds a list of FMU Real variables to a
+contiguous host buffer in host units.  The variable names are resolved and
+the affine conversion from each variable's FMU unit to its host unit (for
+example a Trick @trick_units value) is computed once when the variables are
+bound.  Each get() or set() is then one fmi2GetReal or fmi2SetReal call for
+all the variables and one pass of scale and offset over the buffer.  The
+conversion pass is skipped when every conversion is the identity.
+
+@trick_parse{everything}
+
+@tldh
+@trick_link_dependency{FMI2RealBinding.o}
+
+*/
+
+class FMI2RealBinding {
+
+  public:
+
+   // Default constructor.
+   FMI2RealBinding();
+
+   // Destructor.
+   ~FMI2RealBinding();
+
+   void clear();
+
+   fmi2Status bind(
+            FMI2ModelBase & model,
+      const char * const    names[],
+      const char * const    host_units[],
+            size_t          count         );
+
+   fmi2Status get( fmi2Real values[] );
+   fmi2Status set( const fmi2Real values[] );
+
+   /*!
+    * @brief Get the number of bound variables.
+    * @return Number of variables.
+    */
+   size_t size() const { return( value_references.size() ); }
+
+   /*!
+    * @brief Get the conversion scale of a bound variable.
+    * @return Host value per FMU value.
+    * @param [in] index Position of the variable in the binding.
+    */
+   double get_scale( size_t index ) const { return( scales[index] ); }
+
+   /*!
+    * @brief Get the conversion offset of a bound variable.
+    * @return Host value of an FMU value of zero.
+    * @param [in] index Position of the variable in the binding.
+    */
+   double get_offset( size_t index ) const { return( offsets[index] ); }
+
+  protected:
+
+   FMI2ModelBase * model; //!< @trick_io{**} Model the variables are bound to.
+   bool needs_conversion; //!< @trick_units{--} At least one conversion is not the identity.
+
+   std::vector<fmi2ValueReference> value_references; //!< @trick_io{**} Bound value references.
+   std::vector<fmi2Real> scales;          //!< @trick_io{**} FMU to host scale factors.
+   std::vector<fmi2Real> offsets;         //!< @trick_io{**} FMU to host offsets.
+   std::vector<fmi2Real> inverse_scales;  //!< @trick_io{**} Host to FMU scale factors.
+   std::vector<fmi2Real> inverse_offsets; //!< @trick_io{**} Host to FMU offsets.
+   std::vector<fmi2Real> fmu_values;      //!< @trick_io{**} Values in FMU units.
+
+  private:
+
+   /*!
+    * @brief Copy constructor not implemented.
+    *
+    * The copy constructor is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2RealBinding (const FMI2RealBinding &);
+
+   /*!
+    * @brief Assignment operator not implemented.
+    *
+    * The assignment operator is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2RealBinding & operator= (const FMI2RealBinding &);
+
+};
+
+} // End TrickFMI namespace.
+
+#endif /* FMI2_REAL_BINDING_HH_ */
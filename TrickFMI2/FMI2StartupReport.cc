@@ -0,0 +1,205 @@
+/**
+@file FMI2StartupReport.cc
+@ingroup FMITrickInterface
+@brief Method implementations for the FMI2StartupReport class
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+*/
+
+#include <iomanip>
+#include <pthread.h>
+#include <time.h>
+
+#include "FMI2StartupReport.hh"
+
+//! Head of the list of reports in the process.
+static TrickFMI::FMI2StartupReport * report_list = NULL;
+
+//! Mutex protecting the list of reports.
+static pthread_mutex_t report_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+//! Number of timed phases in a report.
+#define NUM_PHASES 11
+
+/*!
+ * @brief Get the phase times of a report in a fixed order.
+ *
+ * @param [in]  report Report to get the times from.
+ * @param [out] times  Phase times in the order of phase_names.
+ */
+static void get_phase_times(
+   const TrickFMI::FMI2StartupReport & report,
+         double                        times[NUM_PHASES] )
+{
+   times[0] = report.load_time;
+   times[1] = report.unpack_time;
+   times[2] = report.decompress_time;
+   times[3] = report.write_time;
+   times[4] = report.parse_time;
+   times[5] = report.compile_time;
+   times[6] = report.dlopen_time;
+   times[7] = report.bind_time;
+   times[8] = report.instantiate_time;
+   times[9] = report.initialization_time;
+   times[10] = report.load_time + report.instantiate_time + report.initialization_time;
+   return;
+}
+
+//! Names of the phases in the order of get_phase_times.
+static const char * phase_names[NUM_PHASES] = {
+   "load", "  unpack", "    decompress", "    write", "  parse", "  compile",
+   "  dlopen", "  bind", "instantiate", "initialization", "total" };
+
+
+//! Default constructor.
+TrickFMI::FMI2StartupReport::FMI2StartupReport()
+: next(NULL), prev(NULL)
+{
+   clear();
+
+   // Add this report to the process list.
+   pthread_mutex_lock( &report_mutex );
+   this->next = report_list;
+   if ( report_list != NULL ) { report_list->prev = this; }
+   report_list = this;
+   pthread_mutex_unlock( &report_mutex );
+}
+
+
+//! Destructor.
+TrickFMI::FMI2StartupReport::~FMI2StartupReport()
+{
+   // Remove this report from the process list.
+   pthread_mutex_lock( &report_mutex );
+   if ( this->prev != NULL ) { this->prev->next = this->next; }
+   else { report_list = this->next; }
+   if ( this->next != NULL ) { this->next->prev = this->prev; }
+   pthread_mutex_unlock( &report_mutex );
+}
+
+
+//! Reset all the phase times to zero.
+void TrickFMI::FMI2StartupReport::clear()
+{
+   load_time           = 0.0;
+   unpack_time         = 0.0;
+   decompress_time     = 0.0;
+   write_time          = 0.0;
+   parse_time          = 0.0;
+   compile_time        = 0.0;
+   dlopen_time         = 0.0;
+   bind_time           = 0.0;
+   instantiate_time    = 0.0;
+   initialization_time = 0.0;
+   unpacked_bytes      = 0.0;
+   unpack_threads      = 0;
+   return;
+}
+
+
+/*!
+ * @brief Print the phase times.
+ *
+ * @param [in] stream Output stream to print to.
+ */
+void TrickFMI::FMI2StartupReport::print( std::ostream & stream )
+{
+   double times[NUM_PHASES];
+   int iinc;
+
+   get_phase_times( *this, times );
+
+   stream << "FMU startup times (s): " << fmu_path << std::endl;
+   for ( iinc = 0 ; iinc < NUM_PHASES ; iinc++ ) {
+      stream << "   " << std::left << std::setw( 16 ) << phase_names[iinc]
+             << std::right << std::fixed << std::setprecision( 6 )
+             << std::setw( 12 ) << times[iinc] << std::endl;
+   }
+   if ( (unpacked_bytes > 0.0) && (unpack_time > 0.0) ) {
+      stream << "   unpack throughput " << std::setprecision( 1 )
+             << unpacked_bytes / unpack_time / 1.0e6 << " MB/s ("
+             << unpacked_bytes / 1.0e6 << " MB, " << unpack_threads
+             << " threads)" << std::endl;
+   }
+
+   return;
+}
+
+
+/*!
+ * @brief Print a summary of the startup times of all the FMUs.
+ *
+ * The summary has the total, mean and maximum time of each phase over the
+ * reports of all the model objects in the process, the overall unpack
+ * throughput and names the FMU with the longest total startup time.
+ *
+ * @param [in] stream Output stream to print to.
+ */
+void TrickFMI::FMI2StartupReport::print_summary( std::ostream & stream )
+{
+   double times[NUM_PHASES];
+   double totals[NUM_PHASES] = { 0.0 };
+   double maximums[NUM_PHASES] = { 0.0 };
+   double total_bytes = 0.0;
+   double total_unpack_time = 0.0;
+   std::string slowest_fmu;
+   FMI2StartupReport * report;
+   int num_reports = 0;
+   int iinc;
+
+   pthread_mutex_lock( &report_mutex );
+   for ( report = report_list ; report != NULL ; report = report->next ) {
+      get_phase_times( *report, times );
+      for ( iinc = 0 ; iinc < NUM_PHASES ; iinc++ ) {
+         totals[iinc] += times[iinc];
+         if ( times[iinc] > maximums[iinc] ) {
+            maximums[iinc] = times[iinc];
+            if ( iinc == NUM_PHASES - 1 ) { slowest_fmu = report->fmu_path; }
+         }
+      }
+      if ( report->unpacked_bytes > 0.0 ) {
+         total_bytes       += report->unpacked_bytes;
+         total_unpack_time += report->unpack_time;
+      }
+      num_reports++;
+   }
+   pthread_mutex_unlock( &report_mutex );
+
+   stream << "FMU startup summary for " << num_reports << " FMUs (s):" << std::endl;
+   stream << "   " << std::left << std::setw( 16 ) << "phase" << std::right
+          << std::setw( 12 ) << "total" << std::setw( 12 ) << "mean"
+          << std::setw( 12 ) << "max" << std::endl;
+   for ( iinc = 0 ; iinc < NUM_PHASES ; iinc++ ) {
+      stream << "   " << std::left << std::setw( 16 ) << phase_names[iinc]
+             << std::right << std::fixed << std::setprecision( 6 )
+             << std::setw( 12 ) << totals[iinc]
+             << std::setw( 12 ) << ((num_reports > 0) ? totals[iinc] / num_reports : 0.0)
+             << std::setw( 12 ) << maximums[iinc] << std::endl;
+   }
+   if ( total_unpack_time > 0.0 ) {
+      stream << "   unpack throughput " << std::setprecision( 1 )
+             << total_bytes / total_unpack_time / 1.0e6 << " MB/s ("
+             << total_bytes / 1.0e6 << " MB)" << std::endl;
+   }
+   if ( !slowest_fmu.empty() ) {
+      stream << "   slowest FMU: " << slowest_fmu << std::endl;
+   }
+
+   return;
+}
+
+
+/*!
+ * @brief Get the current monotonic clock time.
+ *
+ * @return Returns the monotonic clock time in seconds.
+ */
+double TrickFMI::FMI2StartupReport::get_time()
+{
+   struct timespec now;
+   clock_gettime( CLOCK_MONOTONIC, &now );
+   return( (double)now.tv_sec + (double)now.tv_nsec * 1.0e-9 );
+}
@@ -0,0 +1,132 @@
+/*******************************************************************************
+* Things that Trick looks for to trigger parsing and processing:
+* PURPOSE:
+* LIBRARY DEPENDENCY:
+*  ((FMI2StartupReport.o))
+********************************************************************************/
+/*!
+@file FMI2StartupReport.hh
+@ingroup FMITrickInterface
+@brief Definition of the FMI2StartupReport class.
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+
+*/
+
+#ifndef FMI2_STARTUP_REPORT_HH_
+#define FMI2_STARTUP_REPORT_HH_
+
+#include <iostream>
+#include <string>
+
+// TrickFMI namespace is used for everything in the TrickFMI repo
+namespace TrickFMI {
+
+/*!
+@class FMI2StartupReport
+@brief Defines the FMI2StartupReport class.
+
+The FMI2StartupReport class holds the time spent in each phase of loading,
+instantiating and initializing an FMU.  Times are wall clock times measured
+with the monotonic clock.  Each FMI2ModelBase has a report.  The reports
+of all the model objects in the process are summarized by print_summary().
+
+The phases are:
+- unpack: reading and unpacking the FMU archive (including the time to
+  check the shared unpack cache), made up in part of:
+  - decompress: reading and decompressing archive entry data.
+  - write: writing unpacked files (or in memory library files).
+  When the archive is extracted by several threads, decompress and write
+  are summed over the threads and can exceed unpack.  The unpack
+  throughput is the uncompressed size of the extracted files over the
+  unpack time.
+- parse: parsing the model description.
+- compile: building the FMU library from the FMU sources (see
+  FMI2ModelBase::set_source_build_dir()).
+- dlopen: loading the FMU library.
+- bind: binding the FMI functions.
+- instantiate: fmi2Instantiate.
+- initialization: fmi2EnterInitializationMode and fmi2ExitInitializationMode.
+
+The load time is the total time spent in FMI2ModelBase::load_fmu.
+
+@trick_parse{everything}
+
+@tldh
+@trick_link_dependency{FMI2StartupReport.o}
+
+*/
+
+class FMI2StartupReport {
+
+  public:
+
+   std::string fmu_path; //!< @trick_units{--} Path to the FMU.
+
+   double load_time;           //!< @trick_units{s} Total FMU load time.
+   double unpack_time;         //!< @trick_units{s} FMU unpack time.
+   double decompress_time;     //!< @trick_units{s} Archive read and decompress time.
+   double write_time;          //!< @trick_units{s} Unpacked file write time.
+   double parse_time;          //!< @trick_units{s} Model description parse time.
+   double compile_time;        //!< @trick_units{s} FMU source build time.
+   double dlopen_time;         //!< @trick_units{s} Library load time.
+   double bind_time;           //!< @trick_units{s} Function binding time.
+   double instantiate_time;    //!< @trick_units{s} fmi2Instantiate time.
+   double initialization_time; //!< @trick_units{s} Initialization mode time.
+
+   double unpacked_bytes; //!< @trick_units{--} Uncompressed size of the extracted files.
+   int    unpack_threads; //!< @trick_units{--} Most threads used to extract the FMU.
+
+   // Default constructor.
+   FMI2StartupReport();
+
+   // Destructor.
+   ~FMI2StartupReport();
+
+   void clear();
+
+   void print( std::ostream & stream );
+
+   /*!
+    * @brief Print the report to standard out.
+    */
+   void print_report(){ print( std::cout ); }
+
+   static void print_summary( std::ostream & stream );
+
+   /*!
+    * @brief Print the summary of all reports to standard out.
+    */
+   static void print_startup_summary(){ print_summary( std::cout ); }
+
+   static double get_time();
+
+  private:
+
+   FMI2StartupReport * next; //!< @trick_io{**} Next report in the process list.
+   FMI2StartupReport * prev; //!< @trick_io{**} Previous report in the process list.
+
+   /*!
+    * @brief Copy constructor not implemented.
+    *
+    * The copy constructor is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2StartupReport (const FMI2StartupReport &);
+
+   /*!
+    * @brief Assignment operator not implemented.
+    *
+    * The assignment operator is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2StartupReport & operator= (const FMI2StartupReport &);
+
+};
+
+} // End TrickFMI namespace.
+
+#endif /* FMI2_STARTUP_REPORT_HH_ */
@@ -0,0 +1,137 @@
+/*!
+@file FMI2StaticFMU.hh
+@ingroup FMITrickInterface
+@brief Function tables for FMUs linked statically into the host.
+
+An FMU whose C sources are compiled with FMI2_FUNCTION_PREFIX defined (see
+fmi2Functions.h) provides the FMI functions under prefixed names, for
+example trickBall_fmi2Instantiate.  The fmu.mk "static" target builds such
+an object.  Linking it into the host and handing its function table to
+FMI2ModelBase::set_static_functions() binds the model object straight to
+the linked functions; the FMU library is neither extracted nor opened.
+
+@code
+#include "FMI2StaticFMU.hh"
+
+FMI2_STATIC_FMU( trickBall_ )
+
+   fmu.set_static_functions( FMI2_STATIC_FMU_FUNCTIONS( trickBall_ ) );
+   fmu.load_fmu( "trickBall.fmu" );
+@endcode
+
+The prefixed functions are weak references; a function the FMU does not
+provide is bound as missing just as it would be by dlsym.  Since weak
+references do not pull members out of static archives, link the FMU object
+itself.
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+
+*/
+
+#ifndef FMI2_STATIC_FMU_HH_
+#define FMI2_STATIC_FMU_HH_
+
+#include <stddef.h>
+
+#include "fmi2FunctionTypes.h"
+
+// TrickFMI namespace is used for everything in the TrickFMI repo
+namespace TrickFMI {
+
+/*!
+@brief FMI function of a statically linked FMU.
+
+A table of these ends with an entry with a NULL name.
+*/
+typedef struct {
+   const char * name;     //!< Unprefixed FMI function name.
+   void       * function; //!< Linked function or NULL if not provided.
+} FMI2StaticFunction;
+
+} // End TrickFMI namespace.
+
+//! Paste an FMU prefix and an FMI function name.
+#define FMI2_STATIC_NAME( prefix, name ) prefix ## name
+
+//! Declare a prefixed FMI function as a weak reference.
+#define FMI2_STATIC_DECLARE( prefix, name ) \
+   extern "C" name ## TYPE FMI2_STATIC_NAME( prefix, name ) __attribute__((weak));
+
+//! Function table entry for a prefixed FMI function.
+#define FMI2_STATIC_ENTRY( prefix, name ) \
+   { #name, (void *)&FMI2_STATIC_NAME( prefix, name ) },
+
+//! Apply a macro to every FMI 2.0 function name.
+#define FMI2_STATIC_FOR_EACH( macro, prefix ) \
+   macro( prefix, fmi2GetTypesPlatform ) \
+   macro( prefix, fmi2GetVersion ) \
+   macro( prefix, fmi2SetDebugLogging ) \
+   macro( prefix, fmi2Instantiate ) \
+   macro( prefix, fmi2FreeInstance ) \
+   macro( prefix, fmi2SetupExperiment ) \
+   macro( prefix, fmi2EnterInitializationMode ) \
+   macro( prefix, fmi2ExitInitializationMode ) \
+   macro( prefix, fmi2Terminate ) \
+   macro( prefix, fmi2Reset ) \
+   macro( prefix, fmi2GetReal ) \
+   macro( prefix, fmi2GetInteger ) \
+   macro( prefix, fmi2GetBoolean ) \
+   macro( prefix, fmi2GetString ) \
+   macro( prefix, fmi2SetReal ) \
+   macro( prefix, fmi2SetInteger ) \
+   macro( prefix, fmi2SetBoolean ) \
+   macro( prefix, fmi2SetString ) \
+   macro( prefix, fmi2GetFMUstate ) \
+   macro( prefix, fmi2SetFMUstate ) \
+   macro( prefix, fmi2FreeFMUstate ) \
+   macro( prefix, fmi2SerializedFMUstateSize ) \
+   macro( prefix, fmi2SerializeFMUstate ) \
+   macro( prefix, fmi2DeSerializeFMUstate ) \
+   macro( prefix, fmi2GetDirectionalDerivative ) \
+   macro( prefix, fmi2EnterEventMode ) \
+   macro( prefix, fmi2NewDiscreteStates ) \
+   macro( prefix, fmi2EnterContinuousTimeMode ) \
+   macro( prefix, fmi2CompletedIntegratorStep ) \
+   macro( prefix, fmi2SetTime ) \
+   macro( prefix, fmi2SetContinuousStates ) \
+   macro( prefix, fmi2GetDerivatives ) \
+   macro( prefix, fmi2GetEventIndicators ) \
+   macro( prefix, fmi2GetContinuousStates ) \
+   macro( prefix, fmi2GetNominalsOfContinuousStates ) \
+   macro( prefix, fmi2SetRealInputDerivatives ) \
+   macro( prefix, fmi2GetRealOutputDerivatives ) \
+   macro( prefix, fmi2DoStep ) \
+   macro( prefix, fmi2CancelStep ) \
+   macro( prefix, fmi2GetStatus ) \
+   macro( prefix, fmi2GetRealStatus ) \
+   macro( prefix, fmi2GetIntegerStatus ) \
+   macro( prefix, fmi2GetBooleanStatus ) \
+   macro( prefix, fmi2GetStringStatus )
+
+/*!
+ * @brief Declare the functions of a statically linked FMU and define its
+ * function table.
+ *
+ * Use this once, at file scope, in the host source file that loads the FMU.
+ *
+ * @param prefix FMI2_FUNCTION_PREFIX the FMU was compiled with.
+ */
+#define FMI2_STATIC_FMU( prefix ) \
+   FMI2_STATIC_FOR_EACH( FMI2_STATIC_DECLARE, prefix ) \
+   static const TrickFMI::FMI2StaticFunction FMI2_STATIC_NAME( prefix, fmi2_static_functions )[] = { \
+      FMI2_STATIC_FOR_EACH( FMI2_STATIC_ENTRY, prefix ) \
+      { NULL, NULL } \
+   };
+
+/*!
+ * @brief Get the function table defined by FMI2_STATIC_FMU.
+ *
+ * @param prefix FMI2_FUNCTION_PREFIX the FMU was compiled with.
+ */
+#define FMI2_STATIC_FMU_FUNCTIONS( prefix ) \
+   FMI2_STATIC_NAME( prefix, fmi2_static_functions )
+
+#endif /* FMI2_STATIC_FMU_HH_ */
@@ -0,0 +1,386 @@
+/**
+@file FMI2Trace.cc
+@ingroup FMITrickInterface
+@brief Method implementations for the FMI2Trace class
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#include <iomanip>
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <vector>
+
+#include "FMI2CallProfile.hh"
+#include "FMI2Trace.hh"
+#include "trick_fmi_trace.h"
+
+//! Default number of events held by each thread buffer.
+#define DEFAULT_BUFFER_SIZE (1024*1024)
+
+//! One traced event.
+typedef struct {
+   uint64_t     time;     //!< Event time in nanoseconds.
+   const void * instance; //!< Model object or FMU instance.
+   int          point;    //!< FMI2Call or TrickFMITracePoint.
+   char         phase;    //!< 'B' for begin or 'E' for end.
+} TraceEvent;
+
+//! Ring buffer of the events of one thread.
+typedef struct {
+   std::vector<TraceEvent> events; //!< Event ring.
+   size_t   next;     //!< Index of the next event in the ring.
+   uint64_t recorded; //!< Number of events recorded since cleared.
+   long     tid;      //!< Thread id.
+} TraceBuffer;
+
+//! Buffer of the calling thread.
+static __thread TraceBuffer * thread_buffer = NULL;
+
+//! Buffers of all the traced threads; kept until exit.
+static std::vector<TraceBuffer *> trace_buffers;
+
+//! Names of the traced instances.
+static std::map<const void *, std::string> instance_names;
+
+//! Lock for the buffer list and the instance names.
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+//! The trace is written at exit.
+static bool exit_handler_registered = false;
+
+bool        TrickFMI::FMI2Trace::enabled     = false;
+std::string TrickFMI::FMI2Trace::path;
+size_t      TrickFMI::FMI2Trace::buffer_size = DEFAULT_BUFFER_SIZE;
+uint64_t    TrickFMI::FMI2Trace::start_time  = 0;
+
+
+/*!
+ * @brief Write a string as a JSON string.
+ * @param [inout] stream Output stream.
+ * @param [in]    text   String to write.
+ */
+static void write_json_string( std::ostream & stream, const std::string & text )
+{
+   char escape[8];
+   size_t iinc;
+
+   stream << '"';
+   for ( iinc = 0 ; iinc < text.size() ; iinc++ ) {
+      if ( (text[iinc] == '"') || (text[iinc] == '\\') ) {
+         stream << '\\' << text[iinc];
+      }
+      else if ( (unsigned char)text[iinc] < 0x20 ) {
+         snprintf( escape, sizeof(escape), "\\u%04x", (unsigned int)text[iinc] );
+         stream << escape;
+      }
+      else {
+         stream << text[iinc];
+      }
+   }
+   stream << '"';
+   return;
+}
+
+
+/*!
+ * @brief Start tracing.
+ *
+ * Events are added to the events already traced.  The buffer size only
+ * applies to threads that have not traced yet.
+ *
+ * @return Always returns fmi2OK.
+ * @param [in] path        Trace file written by stop() and at exit; NULL
+ *                         or empty to only write the trace with write().
+ * @param [in] buffer_size Number of events held by each thread buffer; 0
+ *                         for the default (about a million).
+ */
+fmi2Status TrickFMI::FMI2Trace::start(
+   const char * path,
+   size_t       buffer_size )
+{
+   pthread_mutex_lock( &trace_mutex );
+   FMI2Trace::path = (path != NULL) ? path : "";
+   FMI2Trace::buffer_size = (buffer_size > 0) ? buffer_size : DEFAULT_BUFFER_SIZE;
+   if ( start_time == 0 ) {
+      start_time = FMI2CallProfile::get_ticks();
+   }
+   if ( !FMI2Trace::path.empty() && !exit_handler_registered ) {
+      atexit( write_at_exit );
+      exit_handler_registered = true;
+   }
+   enabled = true;
+   pthread_mutex_unlock( &trace_mutex );
+   return( fmi2OK );
+}
+
+
+/*!
+ * @brief Stop tracing and write the trace file given to start(), if any.
+ *
+ * @return Returns fmi2OK or fmi2Error if the trace file can not be written.
+ */
+fmi2Status TrickFMI::FMI2Trace::stop()
+{
+   fmi2Status status = fmi2OK;
+
+   enabled = false;
+   if ( !path.empty() ) {
+      status = write( path.c_str() );
+      path.clear();
+   }
+   return( status );
+}
+
+
+/*!
+ * @brief Remove all the traced events.
+ *
+ * Instance names are kept.  Call when no FMI calls are being made.
+ */
+void TrickFMI::FMI2Trace::clear()
+{
+   size_t iinc;
+
+   pthread_mutex_lock( &trace_mutex );
+   for ( iinc = 0 ; iinc < trace_buffers.size() ; iinc++ ) {
+      trace_buffers[iinc]->next     = 0;
+      trace_buffers[iinc]->recorded = 0;
+   }
+   start_time = enabled ? FMI2CallProfile::get_ticks() : 0;
+   pthread_mutex_unlock( &trace_mutex );
+   return;
+}
+
+
+/*!
+ * @brief Name a model object or FMU instance in the trace.
+ *
+ * @param [in] instance Model object or FMU instance.
+ * @param [in] name     Instance name.
+ */
+void TrickFMI::FMI2Trace::set_instance_name(
+   const void * instance,
+   const char * name      )
+{
+   if ( (instance == NULL) || (name == NULL) ) { return; }
+   pthread_mutex_lock( &trace_mutex );
+   instance_names[instance] = name;
+   pthread_mutex_unlock( &trace_mutex );
+   return;
+}
+
+
+/*!
+ * @brief Add an event to the buffer of the calling thread.
+ *
+ * The buffer of a thread is allocated by its first event.
+ *
+ * @param [in] instance Model object or FMU instance.
+ * @param [in] point    FMI2Call or TrickFMITracePoint.
+ * @param [in] phase    'B' for begin or 'E' for end.
+ */
+void TrickFMI::FMI2Trace::add_event(
+   const void * instance,
+   int          point,
+   char         phase     )
+{
+   TraceBuffer * buffer = thread_buffer;
+   TraceEvent  * event;
+
+   if ( buffer == NULL ) {
+      buffer = new TraceBuffer;
+      buffer->events.resize( buffer_size );
+      buffer->next     = 0;
+      buffer->recorded = 0;
+#if defined(__linux__)
+      buffer->tid      = (long)syscall( SYS_gettid );
+#else
+      buffer->tid      = 0;
+#endif
+      pthread_mutex_lock( &trace_mutex );
+      trace_buffers.push_back( buffer );
+#if !defined(__linux__)
+      buffer->tid = (long)trace_buffers.size();
+#endif
+      pthread_mutex_unlock( &trace_mutex );
+      thread_buffer = buffer;
+   }
+
+   event = &buffer->events[buffer->next];
+   event->time     = FMI2CallProfile::get_ticks();
+   event->instance = instance;
+   event->point    = point;
+   event->phase    = phase;
+   if ( ++(buffer->next) == buffer->events.size() ) {
+      buffer->next = 0;
+   }
+   buffer->recorded++;
+   return;
+}
+
+
+/*!
+ * @brief Get the name of an FMI call or FMU trace point.
+ * @return Name of the call or trace point.
+ * @param [in] point FMI2Call or TrickFMITracePoint.
+ */
+const char * TrickFMI::FMI2Trace::get_point_name( int point )
+{
+   if ( (point >= 0) && (point < FMI2CallCount) ) {
+      return( FMI2CallProfile::get_call_name( (FMI2Call)point ) );
+   }
+   if ( point == TRICK_FMI_TRACE_DO_STEP_FRAME ) {
+      return( "fmi2DoStep frame" );
+   }
+   if ( point == TRICK_FMI_TRACE_EVENT_ITERATION ) {
+      return( "event iteration" );
+   }
+   return( "unknown" );
+}
+
+
+/*!
+ * @brief Write the traced events as a Chrome trace event JSON file.
+ *
+ * End events whose begin event was dropped from a full buffer are left
+ * out.  Call when no FMI calls are being made.
+ *
+ * @return Returns fmi2OK or fmi2Error if the file can not be written.
+ * @param [in] path Trace file name.
+ */
+fmi2Status TrickFMI::FMI2Trace::write( const char * path )
+{
+   std::map<const void *, std::string>::const_iterator name;
+   std::ofstream stream;
+   TraceBuffer * buffer;
+   const TraceEvent * event;
+   uint64_t dropped = 0;
+   size_t count, first, depth;
+   size_t iinc, jinc;
+   long pid = (long)getpid();
+   bool first_event = true;
+
+   stream.open( path );
+   if ( !stream.is_open() ) {
+      std::cerr << "Error opening trace file: " << path << std::endl;
+      return( fmi2Error );
+   }
+
+   pthread_mutex_lock( &trace_mutex );
+
+   stream << "{\"traceEvents\":[\n";
+   stream << std::fixed << std::setprecision( 3 );
+   for ( iinc = 0 ; iinc < trace_buffers.size() ; iinc++ ) {
+
+      // Walk the ring from its oldest event.
+      buffer = trace_buffers[iinc];
+      if ( buffer->recorded > buffer->events.size() ) {
+         count    = buffer->events.size();
+         first    = buffer->next;
+         dropped += buffer->recorded - count;
+      }
+      else {
+         count = buffer->recorded;
+         first = 0;
+      }
+
+      depth = 0;
+      for ( jinc = 0 ; jinc < count ; jinc++ ) {
+
+         event = &buffer->events[(first + jinc) % buffer->events.size()];
+         if ( event->phase == 'B' ) {
+            depth++;
+         }
+         else if ( depth > 0 ) {
+            depth--;
+         }
+         else {
+            continue;
+         }
+
+         if ( !first_event ) { stream << ",\n"; }
+         first_event = false;
+         stream << "{\"name\":\"" << get_point_name( event->point ) << "\""
+                << ",\"cat\":\"" << ((event->point < FMI2CallCount) ? "fmi" : "fmu") << "\""
+                << ",\"ph\":\"" << event->phase << "\""
+                << ",\"ts\":" << (double)(int64_t)(event->time - start_time) / 1000.0
+                << ",\"pid\":" << pid
+                << ",\"tid\":" << buffer->tid
+                << ",\"args\":{\"instance\":";
+         name = instance_names.find( event->instance );
+         if ( name != instance_names.end() ) {
+            write_json_string( stream, name->second );
+         }
+         else {
+            stream << "\"" << event->instance << "\"";
+         }
+         stream << "}}";
+
+      }
+   }
+   stream << "\n],\"displayTimeUnit\":\"ns\"";
+   stream << ",\"otherData\":{\"dropped_events\":" << dropped << "}}\n";
+
+   pthread_mutex_unlock( &trace_mutex );
+
+   stream.close();
+   if ( stream.fail() ) {
+      std::cerr << "Error writing trace file: " << path << std::endl;
+      return( fmi2Error );
+   }
+   if ( dropped > 0 ) {
+      std::cerr << "Trace buffers were full; dropped the oldest "
+                << dropped << " events." << std::endl;
+   }
+   return( fmi2OK );
+}
+
+
+//! Write the trace file at exit if still tracing.
+void TrickFMI::FMI2Trace::write_at_exit()
+{
+   if ( enabled ) {
+      stop();
+   }
+   return;
+}
+
+
+/*!
+ * @brief Trace the beginning of an FMU trace point.
+ *
+ * Called by TrickFMI wrapped FMUs (see trick_fmi_trace.h).
+ *
+ * @param [in] instance FMU instance.
+ * @param [in] point    TrickFMITracePoint.
+ */
+extern "C" void trick_fmi_trace_begin( const void * instance, int point )
+{
+   TrickFMI::FMI2Trace::begin( instance, point );
+}
+
+
+/*!
+ * @brief Trace the end of an FMU trace point.
+ *
+ * Called by TrickFMI wrapped FMUs (see trick_fmi_trace.h).
+ *
+ * @param [in] instance FMU instance.
+ * @param [in] point    TrickFMITracePoint.
+ */
+extern "C" void trick_fmi_trace_end( const void * instance, int point )
+{
+   TrickFMI::FMI2Trace::end( instance, point );
+}
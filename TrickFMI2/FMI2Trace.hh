@@ -0,0 +1,133 @@
+/*******************************************************************************
+* Things that Trick looks for to trigger parsing and processing:
+* PURPOSE:
+* LIBRARY DEPENDENCY:
+*  ((FMI2Trace.o))
+********************************************************************************/
+/*!
+@file FMI2Trace.hh
+@ingroup FMITrickInterface
+@brief Definition of the FMI2Trace class.
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+
+*/
+
+#ifndef FMI2_TRACE_HH_
+#define FMI2_TRACE_HH_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include "fmi2FunctionTypes.h"
+
+// TrickFMI namespace is used for everything in the TrickFMI repo
+namespace TrickFMI {
+
+/*!
+@class FMI2Trace
+@brief Defines the FMI2Trace class.
+
+The FMI2Trace class records a timeline of begin and end events for every
+FMI call made through a model object and for the trace points inside
+TrickFMI wrapped FMUs: each fmi2DoStep sub-integration frame and each event
+location iteration of process_dynamic_events() (see trick_fmi_trace.h).
+The timeline is written in the Chrome trace event JSON format, which is
+read by chrome://tracing and https://ui.perfetto.dev, and shows where the
+FMUs of a multi-FMU simulation serialize, stall or iterate on events.
+
+The trace is process wide and off until start() is called.  When off, each
+FMI call costs one test of a flag.  When on, each event costs a read of the
+monotonic clock and a store into a ring buffer of the calling thread; no
+lock is taken.  When a ring buffer is full its oldest events are dropped.
+The trace is written by stop() or write(), or at process exit if started
+with a file name.  Write the trace when no FMI calls are being made.
+
+Each event carries the thread and the model instance.  Host calls are
+traced by model object and FMU trace points by FMU instance; both are
+named by the instance name given to fmi2Instantiate.  The FMU trace points
+are found when the host program exports its symbols to shared libraries
+(link with -rdynamic); Trick simulations do.
+
+@trick_parse{everything}
+
+@tldh
+@trick_link_dependency{FMI2Trace.o}
+
+*/
+
+class FMI2Trace {
+
+  public:
+
+   static bool enabled; //!< @trick_units{--} Flag to indicate that events are traced.
+
+   static fmi2Status start( const char * path = NULL, size_t buffer_size = 0 );
+   static fmi2Status stop();
+   static fmi2Status write( const char * path );
+   static void clear();
+
+   static void set_instance_name( const void * instance, const char * name );
+
+   static void add_event( const void * instance, int point, char phase );
+
+   static const char * get_point_name( int point );
+
+   /*!
+    * @brief Trace the beginning of a call or trace point if tracing.
+    * @param [in] instance Model object or FMU instance.
+    * @param [in] point    FMI2Call or TrickFMITracePoint.
+    */
+   static void begin( const void * instance, int point )
+   {
+      if ( enabled ) { add_event( instance, point, 'B' ); }
+   }
+
+   /*!
+    * @brief Trace the end of a call or trace point if tracing.
+    * @param [in] instance Model object or FMU instance.
+    * @param [in] point    FMI2Call or TrickFMITracePoint.
+    */
+   static void end( const void * instance, int point )
+   {
+      if ( enabled ) { add_event( instance, point, 'E' ); }
+   }
+
+  protected:
+
+   static std::string path; //!< @trick_io{**} Trace file written at exit.
+   static size_t buffer_size; //!< @trick_io{**} Events held by each thread buffer.
+   static uint64_t start_time; //!< @trick_io{**} Trace start time in nanoseconds.
+
+   static void write_at_exit();
+
+  private:
+
+   // Only static members; not instantiated.
+   FMI2Trace();
+
+   /*!
+    * @brief Copy constructor not implemented.
+    *
+    * The copy constructor is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2Trace (const FMI2Trace &);
+
+   /*!
+    * @brief Assignment operator not implemented.
+    *
+    * The assignment operator is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2Trace & operator= (const FMI2Trace &);
+
+};
+
+} // End TrickFMI namespace.
+
+#endif /* FMI2_TRACE_HH_ */
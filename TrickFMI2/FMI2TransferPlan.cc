@@ -0,0 +1,270 @@
+/**
+@file FMI2TransferPlan.cc
+@ingroup FMITrickInterface
+@brief Method implementations for the FMI2TransferPlan class
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+*/
+
+#include <algorithm>
+#include <iostream>
+
+#include "FMI2ModelBase.hh"
+#include "FMI2TransferPlan.hh"
+
+
+//! Default constructor.
+TrickFMI::FMI2TransferPlan::FMI2TransferPlan()
+: model(NULL)
+{
+}
+
+
+//! Destructor.
+TrickFMI::FMI2TransferPlan::~FMI2TransferPlan()
+{
+}
+
+
+//! Remove all the variables from the plan.
+void TrickFMI::FMI2TransferPlan::clear()
+{
+   model = NULL;
+   handles.clear();
+   real_group.value_references.clear();
+   real_group.buffer_indices.clear();
+   real_group.slots.clear();
+   integer_group.value_references.clear();
+   integer_group.buffer_indices.clear();
+   integer_group.slots.clear();
+   boolean_group.value_references.clear();
+   boolean_group.buffer_indices.clear();
+   boolean_group.slots.clear();
+   reals.clear();
+   integers.clear();
+   booleans.clear();
+   return;
+}
+
+
+/*!
+ * @brief Build a transfer plan for a list of model variables.
+ *
+ * The model description of the model must be loaded.  Any previous plan is
+ * replaced.  The host buffer holds the variable values in the order of the
+ * names.
+ *
+ * @return Returns fmi2OK or fmi2Error if a variable is unknown or is a
+ * String.  On error the plan is empty.
+ * @param [in] model Model with the variables.
+ * @param [in] names Names of the model variables.
+ * @param [in] count Number of variables.
+ */
+fmi2Status TrickFMI::FMI2TransferPlan::build(
+         FMI2ModelBase & model,
+   const char * const    names[],
+         size_t          count    )
+{
+   const FMI2VariableTable & variables = model.get_variables();
+   std::vector<fmi2ValueReference> buffer_references;
+   std::vector<fmi2ValueReference>::iterator last;
+   TypeGroup * groups[3] = { &real_group, &integer_group, &boolean_group };
+   TypeGroup * group;
+   fmi2Status status = fmi2OK;
+   Handle handle;
+   size_t iinc, jinc;
+   int index;
+
+   this->clear();
+   handles.reserve( count );
+   buffer_references.reserve( count );
+
+   // Resolve the names and collect the value references of each type.
+   for ( iinc = 0 ; iinc < count ; iinc++ ) {
+
+      index = variables.find( names[iinc] );
+      if ( index < 0 ) {
+         std::cerr << "Unknown model variable: " << names[iinc] << std::endl;
+         status = fmi2Error;
+         continue;
+      }
+      handle.type = variables.get_type( index );
+      handle.slot = 0;
+      if ( handle.type == FMI2Real ) {
+         group = &real_group;
+      }
+      else if ( (handle.type == FMI2Integer) || (handle.type == FMI2Enumeration) ) {
+         group = &integer_group;
+      }
+      else if ( handle.type == FMI2Boolean ) {
+         group = &boolean_group;
+      }
+      else {
+         std::cerr << "Not a numeric model variable: " << names[iinc] << std::endl;
+         status = fmi2Error;
+         continue;
+      }
+
+      handles.push_back( handle );
+      buffer_references.push_back( variables.get_value_reference( index ) );
+      group->value_references.push_back( buffer_references.back() );
+      group->buffer_indices.push_back( iinc );
+
+   }
+
+   if ( status != fmi2OK ) {
+      this->clear();
+      return( status );
+   }
+
+   // Sort and merge the value references of each type, then find the value
+   // array slot of each variable.  The scatter and gather lists stay in
+   // host buffer order.
+   for ( iinc = 0 ; iinc < 3 ; iinc++ ) {
+      group = groups[iinc];
+      std::sort( group->value_references.begin(), group->value_references.end() );
+      last = std::unique( group->value_references.begin(), group->value_references.end() );
+      group->value_references.erase( last, group->value_references.end() );
+      group->slots.resize( group->buffer_indices.size() );
+      for ( jinc = 0 ; jinc < group->buffer_indices.size() ; jinc++ ) {
+         group->slots[jinc] = std::lower_bound( group->value_references.begin(),
+                                                group->value_references.end(),
+                                                buffer_references[group->buffer_indices[jinc]] )
+                            - group->value_references.begin();
+         handles[group->buffer_indices[jinc]].slot = group->slots[jinc];
+      }
+   }
+
+   this->model = &model;
+   reals.resize( real_group.value_references.size() );
+   integers.resize( integer_group.value_references.size() );
+   booleans.resize( boolean_group.value_references.size() );
+
+   return( fmi2OK );
+}
+
+
+/*!
+ * @brief Get the plan variables into the host buffer.
+ *
+ * @return Returns the most severe status of the get calls.  The host
+ * buffer is only updated for the types whose get call succeeded.
+ * @param [out] values Values of the plan variables in plan order.
+ */
+fmi2Status TrickFMI::FMI2TransferPlan::get( double values[] )
+{
+   fmi2Status status = fmi2OK;
+   fmi2Status get_status;
+   size_t iinc;
+
+   if ( model == NULL ) { return( fmi2Error ); }
+
+   if ( !reals.empty() ) {
+      get_status = model->fmi2GetReal( &real_group.value_references[0],
+                                       reals.size(), &reals[0] );
+      if ( get_status <= fmi2Warning ) {
+         for ( iinc = 0 ; iinc < real_group.slots.size() ; iinc++ ) {
+            values[real_group.buffer_indices[iinc]] = reals[real_group.slots[iinc]];
+         }
+      }
+      if ( get_status > status ) { status = get_status; }
+   }
+   if ( !integers.empty() ) {
+      get_status = model->fmi2GetInteger( &integer_group.value_references[0],
+                                          integers.size(), &integers[0] );
+      if ( get_status <= fmi2Warning ) {
+         for ( iinc = 0 ; iinc < integer_group.slots.size() ; iinc++ ) {
+            values[integer_group.buffer_indices[iinc]] = integers[integer_group.slots[iinc]];
+         }
+      }
+      if ( get_status > status ) { status = get_status; }
+   }
+   if ( !booleans.empty() ) {
+      get_status = model->fmi2GetBoolean( &boolean_group.value_references[0],
+                                          booleans.size(), &booleans[0] );
+      if ( get_status <= fmi2Warning ) {
+         for ( iinc = 0 ; iinc < boolean_group.slots.size() ; iinc++ ) {
+            values[boolean_group.buffer_indices[iinc]] =
+               (booleans[boolean_group.slots[iinc]] != fmi2False) ? 1.0 : 0.0;
+         }
+      }
+      if ( get_status > status ) { status = get_status; }
+   }
+
+   return( status );
+}
+
+
+/*!
+ * @brief Set the plan variables from the host buffer.
+ *
+ * When a variable appears more than once in the plan, the value of its last
+ * occurrence is set.  Integer and Enumeration values are truncated and any
+ * nonzero Boolean value is true.
+ *
+ * @return Returns the most severe status of the set calls.
+ * @param [in] values Values of the plan variables in plan order.
+ */
+fmi2Status TrickFMI::FMI2TransferPlan::set( const double values[] )
+{
+   fmi2Status status = fmi2OK;
+   fmi2Status set_status;
+   size_t iinc;
+
+   if ( model == NULL ) { return( fmi2Error ); }
+
+   if ( !reals.empty() ) {
+      for ( iinc = 0 ; iinc < real_group.slots.size() ; iinc++ ) {
+         reals[real_group.slots[iinc]] = values[real_group.buffer_indices[iinc]];
+      }
+      set_status = model->fmi2SetReal( &real_group.value_references[0],
+                                       reals.size(), &reals[0] );
+      if ( set_status > status ) { status = set_status; }
+   }
+   if ( !integers.empty() ) {
+      for ( iinc = 0 ; iinc < integer_group.slots.size() ; iinc++ ) {
+         integers[integer_group.slots[iinc]] =
+            (fmi2Integer)values[integer_group.buffer_indices[iinc]];
+      }
+      set_status = model->fmi2SetInteger( &integer_group.value_references[0],
+                                          integers.size(), &integers[0] );
+      if ( set_status > status ) { status = set_status; }
+   }
+   if ( !booleans.empty() ) {
+      for ( iinc = 0 ; iinc < boolean_group.slots.size() ; iinc++ ) {
+         booleans[boolean_group.slots[iinc]] =
+            (values[boolean_group.buffer_indices[iinc]] != 0.0) ? fmi2True : fmi2False;
+      }
+      set_status = model->fmi2SetBoolean( &boolean_group.value_references[0],
+                                          booleans.size(), &booleans[0] );
+      if ( set_status > status ) { status = set_status; }
+   }
+
+   return( status );
+}
+
+
+/*!
+ * @brief Get the number of value references transferred for a type.
+ *
+ * Integer and Enumeration variables are transferred together.
+ *
+ * @return Number of distinct value references of the type.
+ * @param [in] type Model variable type.
+ */
+size_t TrickFMI::FMI2TransferPlan::get_transfer_size( FMI2VariableType type ) const
+{
+   if ( type == FMI2Real ) {
+      return( real_group.value_references.size() );
+   }
+   if ( (type == FMI2Integer) || (type == FMI2Enumeration) ) {
+      return( integer_group.value_references.size() );
+   }
+   if ( type == FMI2Boolean ) {
+      return( boolean_group.value_references.size() );
+   }
+   return( 0 );
+}
@@ -0,0 +1,159 @@
+/*******************************************************************************
+* Things that Trick looks for to trigger parsing and processing:
+* PURPOSE:
+* LIBRARY DEPENDENCY:
+*  ((FMI2TransferPlan.o))
+********************************************************************************/
+/*!
+@file FMI2TransferPlan.hh
+@ingroup FMITrickInterface
+@brief Definition of the FMI2TransferPlan class.
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+
+*/
+
+#ifndef FMI2_TRANSFER_PLAN_HH_
+#define FMI2_TRANSFER_PLAN_HH_
+
+#include <stddef.h>
+#include <vector>
+
+#include "fmi2FunctionTypes.h"
+
+#include "FMI2VariableTable.hh"
+
+// TrickFMI namespace is used for everything in the TrickFMI repo
+namespace TrickFMI {
+
+class FMI2ModelBase;
+
+/*!
+@class FMI2TransferPlan
+@brief Defines the FMI2TransferPlan class.
+
+The FMI2TransferPlan class moves a set of named numeric model variables of
+mixed types between the FMU and a contiguous host buffer of doubles.  The
+names are resolved once when the plan is built.  Each variable becomes a
+typed handle: its type and its slot in the value array for that type.  The
+value references of each type are sorted and duplicates (repeated names and
+aliases) are merged, so each value reference is transferred once.
+
+Each get() or set() is then one fmi2GetReal, fmi2GetInteger and
+fmi2GetBoolean (or fmi2Set) call for the types in the plan, plus a scatter
+into (or gather from) the host buffer.  Integer, Enumeration and Boolean
+values are converted to and from doubles.
+
+@code
+const char * names[] = { "x1", "v1", "contact", "x1" };
+double values[4];
+
+plan.build( fmu, names, 4 );
+plan.get( values );
+@endcode
+
+A plan is not changed by get() or set(); rebuild it to transfer other
+variables.
+
+@trick_parse{everything}
+
+@tldh
+@trick_link_dependency{FMI2TransferPlan.o}
+
+*/
+
+class FMI2TransferPlan {
+
+  public:
+
+   // Default constructor.
+   FMI2TransferPlan();
+
+   // Destructor.
+   ~FMI2TransferPlan();
+
+   void clear();
+
+   fmi2Status build(
+            FMI2ModelBase & model,
+      const char * const    names[],
+            size_t          count    );
+
+   fmi2Status get( double values[] );
+   fmi2Status set( const double values[] );
+
+   /*!
+    * @brief Get the number of variables in the plan.
+    * @return Number of host buffer values.
+    */
+   size_t size() const { return( handles.size() ); }
+
+   /*!
+    * @brief Get the type of a variable in the plan.
+    * @return Model variable type.
+    * @param [in] index Position of the variable in the host buffer.
+    */
+   FMI2VariableType get_type( size_t index ) const { return( handles[index].type ); }
+
+   size_t get_transfer_size( FMI2VariableType type ) const;
+
+  protected:
+
+   /*!
+   @brief A resolved plan variable.
+   */
+   struct Handle {
+      FMI2VariableType type; /**< @trick_units{--} Variable type. */
+      size_t           slot; /**< @trick_units{--} Index in the type value array. */
+   };
+
+   /*!
+   @brief The variables of a plan transferred with one call.
+   */
+   struct TypeGroup {
+      std::vector<fmi2ValueReference> value_references; /**< @trick_io{**} @n
+         Sorted distinct value references. */
+      std::vector<size_t> buffer_indices; /**< @trick_io{**} @n
+         Host buffer index of each variable of the group. */
+      std::vector<size_t> slots; /**< @trick_io{**} @n
+         Value array slot of each variable of the group. */
+   };
+
+   FMI2ModelBase * model; //!< @trick_io{**} Model the plan transfers from.
+
+   std::vector<Handle> handles; //!< @trick_io{**} Handle of each host buffer value.
+
+   TypeGroup real_group;    //!< @trick_io{**} Real variables.
+   TypeGroup integer_group; //!< @trick_io{**} Integer and Enumeration variables.
+   TypeGroup boolean_group; //!< @trick_io{**} Boolean variables.
+
+   std::vector<fmi2Real>    reals;    //!< @trick_io{**} Real values in slot order.
+   std::vector<fmi2Integer> integers; //!< @trick_io{**} Integer values in slot order.
+   std::vector<fmi2Boolean> booleans; //!< @trick_io{**} Boolean values in slot order.
+
+  private:
+
+   /*!
+    * @brief Copy constructor not implemented.
+    *
+    * The copy constructor is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2TransferPlan (const FMI2TransferPlan &);
+
+   /*!
+    * @brief Assignment operator not implemented.
+    *
+    * The assignment operator is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2TransferPlan & operator= (const FMI2TransferPlan &);
+
+};
+
+} // End TrickFMI namespace.
+
+#endif /* FMI2_TRANSFER_PLAN_HH_ */
@@ -0,0 +1,572 @@
+/**
+@file FMI2UnitTable.cc
+@ingroup FMITrickInterface
+@brief Method implementations for the FMI2UnitTable class
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+*/
+
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FMI2BinaryBlock.hh"
+#include "FMI2UnitTable.hh"
+
+//! Marker for a missing string offset.
+const size_t TrickFMI::FMI2UnitTable::no_string;
+
+
+/*!
+ * @brief Unit symbol accepted in a host unit string.
+ */
+typedef struct {
+   const char * symbol;                           //!< Unit symbol.
+   double       factor;                           //!< Scale factor to SI.
+   double       offset;                           //!< Offset to SI.
+   int8_t       exponents[ FMI2_NUM_BASE_UNITS ]; //!< kg, m, s, A, K, mol, cd, rad.
+   bool         prefixed;                         //!< Symbol takes SI prefixes.
+} UnitSymbol;
+
+//! Unit symbols accepted in host unit strings (Trick and SI names).
+static const UnitSymbol unit_symbols[] = {
+   // Length.
+   { "m",      1.0,                 0.0,    { 0, 1, 0, 0, 0, 0, 0, 0 }, true  },
+   { "ft",     0.3048,              0.0,    { 0, 1, 0, 0, 0, 0, 0, 0 }, false },
+   { "in",     0.0254,              0.0,    { 0, 1, 0, 0, 0, 0, 0, 0 }, false },
+   { "yd",     0.9144,              0.0,    { 0, 1, 0, 0, 0, 0, 0, 0 }, false },
+   { "mi",     1609.344,            0.0,    { 0, 1, 0, 0, 0, 0, 0, 0 }, false },
+   { "nmi",    1852.0,              0.0,    { 0, 1, 0, 0, 0, 0, 0, 0 }, false },
+   // Mass.
+   { "g",      1.0e-3,              0.0,    { 1, 0, 0, 0, 0, 0, 0, 0 }, true  },
+   { "lbm",    0.45359237,          0.0,    { 1, 0, 0, 0, 0, 0, 0, 0 }, false },
+   { "slug",   14.593902937206364,  0.0,    { 1, 0, 0, 0, 0, 0, 0, 0 }, false },
+   // Time.
+   { "s",      1.0,                 0.0,    { 0, 0, 1, 0, 0, 0, 0, 0 }, true  },
+   { "min",    60.0,                0.0,    { 0, 0, 1, 0, 0, 0, 0, 0 }, false },
+   { "hr",     3600.0,              0.0,    { 0, 0, 1, 0, 0, 0, 0, 0 }, false },
+   { "h",      3600.0,              0.0,    { 0, 0, 1, 0, 0, 0, 0, 0 }, false },
+   { "day",    86400.0,             0.0,    { 0, 0, 1, 0, 0, 0, 0, 0 }, false },
+   // Angle.
+   { "rad",    1.0,                 0.0,    { 0, 0, 0, 0, 0, 0, 0, 1 }, true  },
+   { "r",      1.0,                 0.0,    { 0, 0, 0, 0, 0, 0, 0, 1 }, false },
+   { "degree", M_PI / 180.0,        0.0,    { 0, 0, 0, 0, 0, 0, 0, 1 }, false },
+   { "deg",    M_PI / 180.0,        0.0,    { 0, 0, 0, 0, 0, 0, 0, 1 }, false },
+   { "d",      M_PI / 180.0,        0.0,    { 0, 0, 0, 0, 0, 0, 0, 1 }, false },
+   { "rev",    2.0 * M_PI,          0.0,    { 0, 0, 0, 0, 0, 0, 0, 1 }, false },
+   { "rpm",    2.0 * M_PI / 60.0,   0.0,    { 0, 0,-1, 0, 0, 0, 0, 1 }, false },
+   // Force, energy, power and pressure.
+   { "N",      1.0,                 0.0,    { 1, 1,-2, 0, 0, 0, 0, 0 }, true  },
+   { "lbf",    4.4482216152605,     0.0,    { 1, 1,-2, 0, 0, 0, 0, 0 }, false },
+   { "J",      1.0,                 0.0,    { 1, 2,-2, 0, 0, 0, 0, 0 }, true  },
+   { "W",      1.0,                 0.0,    { 1, 2,-3, 0, 0, 0, 0, 0 }, true  },
+   { "hp",     745.69987158227022,  0.0,    { 1, 2,-3, 0, 0, 0, 0, 0 }, false },
+   { "Pa",     1.0,                 0.0,    {-1, 1,-2, 0, 0, 0, 0, 0 }, true  },
+   { "bar",    1.0e5,               0.0,    {-1, 1,-2, 0, 0, 0, 0, 0 }, false },
+   { "atm",    101325.0,            0.0,    {-1, 1,-2, 0, 0, 0, 0, 0 }, false },
+   { "psi",    6894.757293168361,   0.0,    {-1, 1,-2, 0, 0, 0, 0, 0 }, false },
+   { "Hz",     1.0,                 0.0,    { 0, 0,-1, 0, 0, 0, 0, 0 }, true  },
+   // Temperature.
+   { "K",      1.0,                 0.0,    { 0, 0, 0, 0, 1, 0, 0, 0 }, false },
+   { "degC",   1.0,                 273.15, { 0, 0, 0, 0, 1, 0, 0, 0 }, false },
+   { "C",      1.0,                 273.15, { 0, 0, 0, 0, 1, 0, 0, 0 }, false },
+   { "degF",   5.0 / 9.0,           459.67 * 5.0 / 9.0, { 0, 0, 0, 0, 1, 0, 0, 0 }, false },
+   { "F",      5.0 / 9.0,           459.67 * 5.0 / 9.0, { 0, 0, 0, 0, 1, 0, 0, 0 }, false },
+   { "degR",   5.0 / 9.0,           0.0,    { 0, 0, 0, 0, 1, 0, 0, 0 }, false },
+   { "R",      5.0 / 9.0,           0.0,    { 0, 0, 0, 0, 1, 0, 0, 0 }, false },
+   // Electrical and the remaining base units.
+   { "A",      1.0,                 0.0,    { 0, 0, 0, 1, 0, 0, 0, 0 }, true  },
+   { "V",      1.0,                 0.0,    { 1, 2,-3,-1, 0, 0, 0, 0 }, true  },
+   { "ohm",    1.0,                 0.0,    { 1, 2,-3,-2, 0, 0, 0, 0 }, true  },
+   { "mol",    1.0,                 0.0,    { 0, 0, 0, 0, 0, 1, 0, 0 }, true  },
+   { "cd",     1.0,                 0.0,    { 0, 0, 0, 0, 0, 0, 1, 0 }, false },
+   { NULL,     0.0,                 0.0,    { 0, 0, 0, 0, 0, 0, 0, 0 }, false }
+};
+
+//! SI prefixes accepted on prefixed unit symbols.
+static const struct {
+   char   prefix; //!< Prefix character.
+   double factor; //!< Prefix scale factor.
+} unit_prefixes[] = {
+   { 'G', 1.0e9  }, { 'M', 1.0e6  }, { 'k', 1.0e3  }, { 'c', 1.0e-2 },
+   { 'm', 1.0e-3 }, { 'u', 1.0e-6 }, { 'n', 1.0e-9 }, { '\0', 0.0 }
+};
+
+
+/*!
+ * @brief Look up a unit symbol with an optional SI prefix.
+ *
+ * @return Returns the symbol or NULL if the symbol is unknown.
+ * @param [in]  name   Unit symbol.
+ * @param [in]  length Length of the symbol.
+ * @param [out] factor Prefix scale factor.
+ */
+static const UnitSymbol * find_unit_symbol(
+   const char   * name,
+   size_t         length,
+   double       & factor )
+{
+   int iinc, jinc;
+
+   factor = 1.0;
+   for ( iinc = 0 ; unit_symbols[iinc].symbol != NULL ; iinc++ ) {
+      if (    (strlen( unit_symbols[iinc].symbol ) == length)
+           && !strncmp( unit_symbols[iinc].symbol, name, length ) ) {
+         return( &unit_symbols[iinc] );
+      }
+   }
+
+   // Try a prefixed symbol.
+   if ( length < 2 ) { return( NULL ); }
+   for ( jinc = 0 ; unit_prefixes[jinc].prefix != '\0' ; jinc++ ) {
+      if ( unit_prefixes[jinc].prefix == name[0] ) { break; }
+   }
+   if ( unit_prefixes[jinc].prefix == '\0' ) { return( NULL ); }
+   for ( iinc = 0 ; unit_symbols[iinc].symbol != NULL ; iinc++ ) {
+      if (    unit_symbols[iinc].prefixed
+           && (strlen( unit_symbols[iinc].symbol ) == length - 1)
+           && !strncmp( unit_symbols[iinc].symbol, name + 1, length - 1 ) ) {
+         factor = unit_prefixes[jinc].factor;
+         return( &unit_symbols[iinc] );
+      }
+   }
+
+   return( NULL );
+}
+
+
+//! Default constructor.
+TrickFMI::FMI2UnitTable::FMI2UnitTable()
+{
+}
+
+
+//! Destructor.
+TrickFMI::FMI2UnitTable::~FMI2UnitTable()
+{
+}
+
+
+//! Remove all the units and types from the table.
+void TrickFMI::FMI2UnitTable::clear()
+{
+   string_data.clear();
+   unit_name_offsets.clear();
+   unit_definitions.clear();
+   unit_defined.clear();
+   display_name_offsets.clear();
+   display_units.clear();
+   display_factors.clear();
+   display_offsets.clear();
+   type_name_offsets.clear();
+   type_types.clear();
+   type_quantity_offsets.clear();
+   type_units.clear();
+   type_display_units.clear();
+   return;
+}
+
+
+/*!
+ * @brief Add a string to the string storage.
+ *
+ * @return Returns the offset of the string in the string storage.
+ * @param [in] value String to add.
+ */
+size_t TrickFMI::FMI2UnitTable::add_string( const char * value )
+{
+   size_t offset = string_data.size();
+   string_data.insert( string_data.end(), value, value + strlen( value ) + 1 );
+   return( offset );
+}
+
+
+/*!
+ * @brief Add a unit to the table.
+ *
+ * @return Returns the index of the new unit.
+ * @param [in] name       Unit name.
+ * @param [in] definition SI definition of the unit (the BaseUnit element) or
+ *                        NULL if the unit only has a name.
+ */
+int TrickFMI::FMI2UnitTable::add_unit(
+   const char               * name,
+   const FMI2UnitDefinition * definition )
+{
+   FMI2UnitDefinition undefined;
+
+   if ( definition == NULL ) {
+      memset( &undefined, 0, sizeof(undefined) );
+      undefined.factor = 1.0;
+   }
+
+   unit_name_offsets.push_back( add_string( name ) );
+   unit_definitions.push_back( (definition != NULL) ? *definition : undefined );
+   unit_defined.push_back( definition != NULL );
+   return( (int)unit_name_offsets.size() - 1 );
+}
+
+
+/*!
+ * @brief Add a display unit of a unit to the table.
+ *
+ * A value in the unit is shown in the display unit as factor * value +
+ * offset.
+ *
+ * @return Returns the index of the new display unit.
+ * @param [in] unit   Index of the unit.
+ * @param [in] name   Display unit name.
+ * @param [in] factor Display unit factor.
+ * @param [in] offset Display unit offset.
+ */
+int TrickFMI::FMI2UnitTable::add_display_unit(
+   int          unit,
+   const char * name,
+   double       factor,
+   double       offset )
+{
+   display_name_offsets.push_back( add_string( name ) );
+   display_units.push_back( unit );
+   display_factors.push_back( factor );
+   display_offsets.push_back( offset );
+   return( (int)display_units.size() - 1 );
+}
+
+
+/*!
+ * @brief Add a simple type to the table.
+ *
+ * @return Returns the index of the new type.
+ * @param [in] name         Type name.
+ * @param [in] type         Variable type of the type.
+ * @param [in] quantity     Type quantity or NULL.
+ * @param [in] unit         Unit index or -1.
+ * @param [in] display_unit Display unit index or -1.
+ */
+int TrickFMI::FMI2UnitTable::add_type(
+   const char       * name,
+   FMI2VariableType   type,
+   const char       * quantity,
+   int                unit,
+   int                display_unit )
+{
+   type_name_offsets.push_back( add_string( name ) );
+   type_types.push_back( (unsigned char)type );
+   type_quantity_offsets.push_back( (quantity != NULL) ? add_string( quantity ) : no_string );
+   type_units.push_back( unit );
+   type_display_units.push_back( display_unit );
+   return( (int)type_name_offsets.size() - 1 );
+}
+
+
+/*!
+ * @brief Find a unit by name.
+ *
+ * @return Returns the unit index or -1 if there is no such unit.
+ * @param [in] name Unit name.
+ */
+int TrickFMI::FMI2UnitTable::find_unit( const char * name ) const
+{
+   size_t iinc;
+
+   for ( iinc = 0 ; iinc < unit_name_offsets.size() ; iinc++ ) {
+      if ( !strcmp( get_unit_name( iinc ), name ) ) { return( (int)iinc ); }
+   }
+   return( -1 );
+}
+
+
+/*!
+ * @brief Find a display unit of a unit by name.
+ *
+ * @return Returns the display unit index or -1 if there is no such display
+ * unit.
+ * @param [in] unit Unit index.
+ * @param [in] name Display unit name.
+ */
+int TrickFMI::FMI2UnitTable::find_display_unit(
+   int          unit,
+   const char * name ) const
+{
+   size_t iinc;
+
+   for ( iinc = 0 ; iinc < display_units.size() ; iinc++ ) {
+      if (    (display_units[iinc] == unit)
+           && !strcmp( get_display_unit_name( iinc ), name ) ) {
+         return( (int)iinc );
+      }
+   }
+   return( -1 );
+}
+
+
+/*!
+ * @brief Find a simple type by name.
+ *
+ * @return Returns the type index or -1 if there is no such type.
+ * @param [in] name Type name.
+ */
+int TrickFMI::FMI2UnitTable::find_type( const char * name ) const
+{
+   size_t iinc;
+
+   for ( iinc = 0 ; iinc < type_name_offsets.size() ; iinc++ ) {
+      if ( !strcmp( get_type_name( iinc ), name ) ) { return( (int)iinc ); }
+   }
+   return( -1 );
+}
+
+
+/*!
+ * @brief Parse a unit string into its SI definition.
+ *
+ * The string is a product of unit symbols separated by '*' or '.', with
+ * '/' dividing by the next symbol.  A symbol may be followed by an integer
+ * exponent, with or without a '^' ("m/s2", "kg*m^2").  An empty string, "1"
+ * or "--" is dimensionless.  Only a single symbol with no exponent keeps
+ * its offset (degC, degF); compound units are treated as differences.
+ *
+ * @return Returns true if the string was parsed.
+ * @param [in]  units      Unit string.
+ * @param [out] definition SI definition of the units.
+ */
+bool TrickFMI::FMI2UnitTable::parse_units(
+   const char         * units,
+   FMI2UnitDefinition & definition )
+{
+   const UnitSymbol * symbol;
+   const char * ptr = units;
+   const char * name;
+   double prefix;
+   long exponent;
+   char * exponent_end;
+   int sign = 1;
+   int terms = 0;
+   bool single = true;
+   int iinc;
+
+   memset( &definition, 0, sizeof(definition) );
+   definition.factor = 1.0;
+
+   if ( (units == NULL) || !strcmp( units, "1" ) || !strcmp( units, "--" ) ) {
+      return( true );
+   }
+
+   while ( *ptr != '\0' ) {
+
+      while ( isspace( (unsigned char)*ptr ) ) { ptr++; }
+      if ( *ptr == '\0' ) { break; }
+
+      // Get the symbol.
+      name = ptr;
+      while ( isalpha( (unsigned char)*ptr ) || (*ptr == '_') ) { ptr++; }
+      if ( ptr == name ) { return( false ); }
+      symbol = find_unit_symbol( name, ptr - name, prefix );
+      if ( symbol == NULL ) { return( false ); }
+
+      // Get the exponent.
+      exponent = 1;
+      if ( *ptr == '^' ) { ptr++; }
+      if ( isdigit( (unsigned char)*ptr ) || (*ptr == '-') ) {
+         exponent = strtol( ptr, &exponent_end, 10 );
+         if ( exponent_end == ptr ) { return( false ); }
+         ptr = exponent_end;
+         single = false;
+      }
+      exponent *= sign;
+
+      definition.factor *= pow( prefix * symbol->factor, (double)exponent );
+      for ( iinc = 0 ; iinc < FMI2_NUM_BASE_UNITS ; iinc++ ) {
+         definition.exponents[iinc] += (int8_t)(symbol->exponents[iinc] * exponent);
+      }
+      if ( (terms++ == 0) && (sign > 0) ) { definition.offset = symbol->offset; }
+
+      // Get the operator.
+      while ( isspace( (unsigned char)*ptr ) ) { ptr++; }
+      if ( *ptr == '\0' ) { break; }
+      if      ( (*ptr == '*') || (*ptr == '.') ) { sign =  1; }
+      else if ( *ptr == '/' )                    { sign = -1; }
+      else { return( false ); }
+      ptr++;
+   }
+
+   if ( !single || (terms != 1) ) {
+      definition.offset = 0.0;
+   }
+
+   return( terms > 0 );
+}
+
+
+/*!
+ * @brief Get the affine conversion from an FMU unit to a host unit.
+ *
+ * A value in the FMU unit converts to the host unit as scale * value +
+ * offset.  The host unit may be a display unit of the FMU unit, the FMU
+ * unit name itself or any unit string accepted by parse_units() with the
+ * same SI base unit exponents.  FMU units without a BaseUnit definition are
+ * interpreted with parse_units().
+ *
+ * @return Returns true if the units are compatible.
+ * @param [in]  unit       FMU unit index or -1 if the variable has no unit.
+ * @param [in]  host_units Host unit string or NULL for no conversion.
+ * @param [out] scale      Conversion scale factor.
+ * @param [out] offset     Conversion offset.
+ */
+bool TrickFMI::FMI2UnitTable::get_conversion(
+   int          unit,
+   const char * host_units,
+   double     & scale,
+   double     & offset     ) const
+{
+   FMI2UnitDefinition fmu_units;
+   FMI2UnitDefinition to_units;
+   int display;
+   int iinc;
+
+   scale  = 1.0;
+   offset = 0.0;
+
+   if ( (host_units == NULL) || (*host_units == '\0') ) {
+      return( true );
+   }
+
+   // A variable without a unit can only be used as a dimensionless value.
+   if ( (unit < 0) || ((size_t)unit >= unit_name_offsets.size()) ) {
+      if ( !parse_units( host_units, to_units ) ) { return( false ); }
+      for ( iinc = 0 ; iinc < FMI2_NUM_BASE_UNITS ; iinc++ ) {
+         if ( to_units.exponents[iinc] != 0 ) { return( false ); }
+      }
+      return( (to_units.factor == 1.0) && (to_units.offset == 0.0) );
+   }
+
+   // Check the FMU's own names for the unit.
+   if ( !strcmp( get_unit_name( unit ), host_units ) ) {
+      return( true );
+   }
+   display = find_display_unit( unit, host_units );
+   if ( display >= 0 ) {
+      scale  = display_factors[display];
+      offset = display_offsets[display];
+      return( true );
+   }
+
+   // Convert through SI.
+   if ( unit_defined[unit] ) {
+      fmu_units = unit_definitions[unit];
+   }
+   else if ( !parse_units( get_unit_name( unit ), fmu_units ) ) {
+      return( false );
+   }
+   if ( !parse_units( host_units, to_units ) ) {
+      return( false );
+   }
+   for ( iinc = 0 ; iinc < FMI2_NUM_BASE_UNITS ; iinc++ ) {
+      if ( fmu_units.exponents[iinc] != to_units.exponents[iinc] ) {
+         return( false );
+      }
+   }
+
+   scale  = fmu_units.factor / to_units.factor;
+   offset = (fmu_units.offset - to_units.offset) / to_units.factor;
+   return( true );
+}
+
+
+/*!
+ * @brief Write the table to a binary model description cache buffer.
+ *
+ * @param [inout] buffer Buffer to append the table to.
+ */
+void TrickFMI::FMI2UnitTable::write_binary( std::string & buffer ) const
+{
+   write_binary_block( buffer, string_data );
+   write_binary_block( buffer, unit_name_offsets );
+   write_binary_block( buffer, unit_definitions );
+   write_binary_block( buffer, unit_defined );
+   write_binary_block( buffer, display_name_offsets );
+   write_binary_block( buffer, display_units );
+   write_binary_block( buffer, display_factors );
+   write_binary_block( buffer, display_offsets );
+   write_binary_block( buffer, type_name_offsets );
+   write_binary_block( buffer, type_types );
+   write_binary_block( buffer, type_quantity_offsets );
+   write_binary_block( buffer, type_units );
+   write_binary_block( buffer, type_display_units );
+   return;
+}
+
+
+/*!
+ * @brief Restore the table from a binary model description cache buffer.
+ *
+ * @return Returns true on success.  On failure the table is empty.
+ * @param [inout] data Read position, moved past the table.
+ * @param [in]    end  End of the buffer.
+ */
+bool TrickFMI::FMI2UnitTable::read_binary(
+   const char ** data,
+   const char  * end )
+{
+   size_t num_units;
+   size_t num_displays;
+   size_t num_types;
+   size_t iinc;
+   bool valid;
+
+   valid =    read_binary_block( data, end, string_data )
+           && read_binary_block( data, end, unit_name_offsets )
+           && read_binary_block( data, end, unit_definitions )
+           && read_binary_block( data, end, unit_defined )
+           && read_binary_block( data, end, display_name_offsets )
+           && read_binary_block( data, end, display_units )
+           && read_binary_block( data, end, display_factors )
+           && read_binary_block( data, end, display_offsets )
+           && read_binary_block( data, end, type_name_offsets )
+           && read_binary_block( data, end, type_types )
+           && read_binary_block( data, end, type_quantity_offsets )
+           && read_binary_block( data, end, type_units )
+           && read_binary_block( data, end, type_display_units );
+
+   // Check the array sizes.
+   num_units    = unit_name_offsets.size();
+   num_displays = display_units.size();
+   num_types    = type_name_offsets.size();
+   valid = valid
+           && (unit_definitions.size() == num_units)
+           && (unit_defined.size() == num_units)
+           && (display_name_offsets.size() == num_displays)
+           && (display_factors.size() == num_displays)
+           && (display_offsets.size() == num_displays)
+           && (type_types.size() == num_types)
+           && (type_quantity_offsets.size() == num_types)
+           && (type_units.size() == num_types)
+           && (type_display_units.size() == num_types)
+           && (string_data.empty() || (string_data.back() == '\0'));
+
+   // Check the offsets and indices.
+   for ( iinc = 0 ; valid && (iinc < num_units) ; iinc++ ) {
+      valid = (unit_name_offsets[iinc] < string_data.size());
+   }
+   for ( iinc = 0 ; valid && (iinc < num_displays) ; iinc++ ) {
+      valid =    (display_name_offsets[iinc] < string_data.size())
+              && (display_units[iinc] >= 0)
+              && ((size_t)display_units[iinc] < num_units);
+   }
+   for ( iinc = 0 ; valid && (iinc < num_types) ; iinc++ ) {
+      valid =    (type_name_offsets[iinc] < string_data.size())
+              && (    (type_quantity_offsets[iinc] == no_string)
+                   || (type_quantity_offsets[iinc] < string_data.size()) )
+              && (type_units[iinc] >= -1)
+              && (type_units[iinc] < (int)num_units)
+              && (type_display_units[iinc] >= -1)
+              && (type_display_units[iinc] < (int)num_displays);
+   }
+
+   if ( !valid ) { clear(); }
+   return( valid );
+}
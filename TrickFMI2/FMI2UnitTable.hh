@@ -0,0 +1,260 @@
+/*******************************************************************************
+* Things that Trick looks for to trigger parsing and processing:
+* PURPOSE:
+* LIBRARY DEPENDENCY:
+*  ((FMI2UnitTable.o))
+********************************************************************************/
+/*!
+@file FMI2UnitTable.hh
+@ingroup FMITrickInterface
+@brief Definition of the FMI2UnitTable class.
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+
+*/
+
+#ifndef FMI2_UNIT_TABLE_HH_
+#define FMI2_UNIT_TABLE_HH_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "FMI2VariableTable.hh"
+
+// TrickFMI namespace is used for everything in the TrickFMI repo
+namespace TrickFMI {
+
+//! Number of SI base units in a unit definition.
+#define FMI2_NUM_BASE_UNITS 8
+
+/*!
+@brief Definition of a unit in terms of the SI base units.
+
+A value in the unit is converted to SI with factor * value + offset.  The
+exponents of the base units are in the FMI BaseUnit order: kg, m, s, A, K,
+mol, cd and rad.
+*/
+typedef struct {
+   double factor;                             //!< Scale factor to SI.
+   double offset;                             //!< Offset to SI.
+   int8_t exponents[ FMI2_NUM_BASE_UNITS ];   //!< Base unit exponents.
+} FMI2UnitDefinition;
+
+/*!
+@class FMI2UnitTable
+@brief Defines the FMI2UnitTable class.
+
+The FMI2UnitTable class holds the UnitDefinitions and TypeDefinitions
+elements of an FMU model description.  Units, display units and simple
+types are referenced by their index in the table; model variables refer to
+them through FMI2VariableTable::get_unit() and
+FMI2VariableTable::get_declared_type().
+
+The table also computes the affine conversion between an FMU unit and a
+host unit string, for example a Trick @trick_units value such as "m/s2" or
+"kg*m2".  Host unit strings are products and quotients of unit symbols
+with optional integer exponents.
+
+@trick_parse{everything}
+
+@tldh
+@trick_link_dependency{FMI2UnitTable.o}
+
+*/
+
+class FMI2UnitTable {
+
+  public:
+
+   // Default constructor.
+   FMI2UnitTable();
+
+   // Destructor.
+   ~FMI2UnitTable();
+
+   /*
+    * Functions used to build the table.
+    */
+   void clear();
+   int add_unit( const char * name, const FMI2UnitDefinition * definition );
+   int add_display_unit( int unit, const char * name, double factor, double offset );
+   int add_type(
+      const char       * name,
+      FMI2VariableType   type,
+      const char       * quantity,
+      int                unit,
+      int                display_unit );
+
+   /*
+    * Functions used to save and restore the table in the binary model
+    * description cache.
+    */
+   void write_binary( std::string & buffer ) const;
+   bool read_binary( const char ** data, const char * end );
+
+   /*
+    * Functions used to look up units and types.
+    */
+   int find_unit( const char * name ) const;
+   int find_display_unit( int unit, const char * name ) const;
+   int find_type( const char * name ) const;
+
+   /*!
+    * @brief Get the number of units in the table.
+    * @return Number of units.
+    */
+   size_t get_number_of_units() const { return( unit_name_offsets.size() ); }
+
+   /*!
+    * @brief Get the name of a unit.
+    * @return Unit name.
+    * @param [in] unit Unit index.
+    */
+   const char * get_unit_name( size_t unit ) const {
+      return( &string_data[ unit_name_offsets[unit] ] );
+   }
+
+   /*!
+    * @brief Check if a unit has a BaseUnit definition.
+    * @return True if the unit is defined in terms of the SI base units.
+    * @param [in] unit Unit index.
+    */
+   bool has_definition( size_t unit ) const {
+      return( unit_defined[unit] != 0 );
+   }
+
+   /*!
+    * @brief Get the SI definition of a unit.
+    * @return Unit definition (only valid if has_definition() is true).
+    * @param [in] unit Unit index.
+    */
+   const FMI2UnitDefinition & get_definition( size_t unit ) const {
+      return( unit_definitions[unit] );
+   }
+
+   /*!
+    * @brief Get the number of display units in the table.
+    * @return Number of display units.
+    */
+   size_t get_number_of_display_units() const { return( display_units.size() ); }
+
+   /*!
+    * @brief Get the name of a display unit.
+    * @return Display unit name.
+    * @param [in] display Display unit index.
+    */
+   const char * get_display_unit_name( size_t display ) const {
+      return( &string_data[ display_name_offsets[display] ] );
+   }
+
+   /*!
+    * @brief Get the number of simple types in the table.
+    * @return Number of simple types.
+    */
+   size_t get_number_of_types() const { return( type_name_offsets.size() ); }
+
+   /*!
+    * @brief Get the name of a simple type.
+    * @return Type name.
+    * @param [in] type Type index.
+    */
+   const char * get_type_name( size_t type ) const {
+      return( &string_data[ type_name_offsets[type] ] );
+   }
+
+   /*!
+    * @brief Get the variable type of a simple type.
+    * @return Variable type.
+    * @param [in] type Type index.
+    */
+   FMI2VariableType get_type_type( size_t type ) const {
+      return( (FMI2VariableType)type_types[type] );
+   }
+
+   /*!
+    * @brief Get the quantity of a simple type.
+    * @return Quantity or NULL if the type has no quantity.
+    * @param [in] type Type index.
+    */
+   const char * get_type_quantity( size_t type ) const {
+      return( (type_quantity_offsets[type] == no_string) ?
+              NULL : &string_data[ type_quantity_offsets[type] ] );
+   }
+
+   /*!
+    * @brief Get the unit of a simple type.
+    * @return Unit index or -1 if the type has no unit.
+    * @param [in] type Type index.
+    */
+   int get_type_unit( size_t type ) const {
+      return( type_units[type] );
+   }
+
+   /*!
+    * @brief Get the display unit of a simple type.
+    * @return Display unit index or -1 if the type has no display unit.
+    * @param [in] type Type index.
+    */
+   int get_type_display_unit( size_t type ) const {
+      return( type_display_units[type] );
+   }
+
+   /*
+    * Functions used to convert values between units.
+    */
+   bool get_conversion(
+      int          unit,
+      const char * host_units,
+      double     & scale,
+      double     & offset     ) const;
+
+   static bool parse_units( const char * units, FMI2UnitDefinition & definition );
+
+  protected:
+
+   static const size_t no_string = (size_t)-1; //!< @trick_io{**} No string marker.
+
+   std::vector<char>               string_data;           //!< @trick_io{**} Name storage.
+   std::vector<size_t>             unit_name_offsets;     //!< @trick_io{**} Unit name offsets.
+   std::vector<FMI2UnitDefinition> unit_definitions;      //!< @trick_io{**} Unit SI definitions.
+   std::vector<unsigned char>      unit_defined;          //!< @trick_io{**} Unit has a BaseUnit flags.
+   std::vector<size_t>             display_name_offsets;  //!< @trick_io{**} Display unit name offsets.
+   std::vector<int>                display_units;         //!< @trick_io{**} Unit of each display unit.
+   std::vector<double>             display_factors;       //!< @trick_io{**} Display unit factors.
+   std::vector<double>             display_offsets;       //!< @trick_io{**} Display unit offsets.
+   std::vector<size_t>             type_name_offsets;     //!< @trick_io{**} Type name offsets.
+   std::vector<unsigned char>      type_types;            //!< @trick_io{**} FMI2VariableType values.
+   std::vector<size_t>             type_quantity_offsets; //!< @trick_io{**} Type quantity offsets.
+   std::vector<int>                type_units;            //!< @trick_io{**} Type unit indices.
+   std::vector<int>                type_display_units;    //!< @trick_io{**} Type display unit indices.
+
+   size_t add_string( const char * value );
+
+  private:
+
+   /*!
+    * @brief Copy constructor not implemented.
+    *
+    * The copy constructor is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2UnitTable (const FMI2UnitTable &);
+
+   /*!
+    * @brief Assignment operator not implemented.
+    *
+    * The assignment operator is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2UnitTable & operator= (const FMI2UnitTable &);
+
+};
+
+} // End TrickFMI namespace.
+
+#endif /* FMI2_UNIT_TABLE_HH_ */
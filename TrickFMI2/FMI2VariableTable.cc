@@ -0,0 +1,495 @@
+/**
+@file FMI2VariableTable.cc
+@ingroup FMITrickInterface
+@brief Method implementations for the FMI2VariableTable class
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+*/
+
+#include <algorithm>
+#include <iostream>
+#include <string.h>
+
+#include "FMI2BinaryBlock.hh"
+#include "FMI2VariableTable.hh"
+//! Marker for a missing string offset.
+const size_t TrickFMI::FMI2VariableTable::no_string;
+
+
+/*!
+ * @brief Variable index ordering by variable name.
+ *
+ * This is used to sort variable indices to find duplicate names.
+ */
+struct VariableNameLess {
+   const TrickFMI::FMI2VariableTable * table; //!< Table with the names.
+   bool operator()( size_t left, size_t right ) const {
+      return( strcmp( table->get_name( left ), table->get_name( right ) ) < 0 );
+   }
+};
+
+
+/*!
+ * @brief Hash bucket ordering by decreasing bucket size.
+ */
+struct BucketSizeGreater {
+   const std::vector< std::vector<size_t> > * buckets; //!< Hash buckets.
+   bool operator()( size_t left, size_t right ) const {
+      return( (*buckets)[left].size() > (*buckets)[right].size() );
+   }
+};
+
+
+//! Default constructor.
+TrickFMI::FMI2VariableTable::FMI2VariableTable()
+{
+}
+
+
+//! Destructor.
+TrickFMI::FMI2VariableTable::~FMI2VariableTable()
+{
+}
+
+
+//! Remove all the variables from the table.
+void TrickFMI::FMI2VariableTable::clear()
+{
+   string_data.clear();
+   name_offsets.clear();
+   value_references.clear();
+   types.clear();
+   causalities.clear();
+   variabilities.clear();
+   initials.clear();
+   start_flags.clear();
+   start_values.clear();
+   start_string_offsets.clear();
+   derivatives.clear();
+   units.clear();
+   declared_types.clear();
+   hash_displacements.clear();
+   hash_slots.clear();
+   return;
+}
+
+
+/*!
+ * @brief Reserve space for the table.
+ *
+ * Reserving space up front lets the table be built with one allocation per
+ * array.
+ *
+ * @param [in] num_variables Number of variables.
+ * @param [in] string_size   Total size of the names and string start values
+ *                           including the terminating null characters.
+ */
+void TrickFMI::FMI2VariableTable::reserve(
+   size_t num_variables,
+   size_t string_size    )
+{
+   string_data.reserve( string_size );
+   name_offsets.reserve( num_variables );
+   value_references.reserve( num_variables );
+   types.reserve( num_variables );
+   causalities.reserve( num_variables );
+   variabilities.reserve( num_variables );
+   initials.reserve( num_variables );
+   start_flags.reserve( num_variables );
+   start_values.reserve( num_variables );
+   start_string_offsets.reserve( num_variables );
+   derivatives.reserve( num_variables );
+   units.reserve( num_variables );
+   declared_types.reserve( num_variables );
+   return;
+}
+
+
+/*!
+ * @brief Add a string to the string storage.
+ *
+ * @return Returns the offset of the string in the string storage.
+ * @param [in] value String to add.
+ */
+size_t TrickFMI::FMI2VariableTable::add_string( const char * value )
+{
+   size_t offset = string_data.size();
+   string_data.insert( string_data.end(), value, value + strlen( value ) + 1 );
+   return( offset );
+}
+
+
+/*!
+ * @brief Add a variable to the table.
+ *
+ * Variables must be added in ModelVariables order.  The name index is not
+ * updated until build_index() is called.
+ *
+ * @return Returns the index of the new variable.
+ * @param [in] name            Variable name.
+ * @param [in] value_reference Variable value reference.
+ * @param [in] type            Variable type.
+ * @param [in] causality       Variable causality.
+ * @param [in] variability     Variable variability.
+ * @param [in] initial         Variable initial attribute.
+ */
+size_t TrickFMI::FMI2VariableTable::add_variable(
+   const char            * name,
+   fmi2ValueReference      value_reference,
+   FMI2VariableType        type,
+   FMI2Causality           causality,
+   FMI2Variability         variability,
+   FMI2Initial             initial         )
+{
+   name_offsets.push_back( add_string( name ) );
+   value_references.push_back( value_reference );
+   types.push_back( (unsigned char)type );
+   causalities.push_back( (unsigned char)causality );
+   variabilities.push_back( (unsigned char)variability );
+   initials.push_back( (unsigned char)initial );
+   start_flags.push_back( 0 );
+   start_values.push_back( 0.0 );
+   start_string_offsets.push_back( no_string );
+   derivatives.push_back( -1 );
+   units.push_back( -1 );
+   declared_types.push_back( -1 );
+   return( value_references.size() - 1 );
+}
+
+
+/*!
+ * @brief Set the start value of a numeric variable.
+ *
+ * @param [in] index Variable index.
+ * @param [in] value Start value.
+ */
+void TrickFMI::FMI2VariableTable::set_start(
+   size_t index,
+   double value )
+{
+   start_flags[index]  = 1;
+   start_values[index] = value;
+   return;
+}
+
+
+/*!
+ * @brief Set the start value of a String variable.
+ *
+ * @param [in] index Variable index.
+ * @param [in] value Start value.
+ */
+void TrickFMI::FMI2VariableTable::set_start(
+         size_t   index,
+   const char   * value )
+{
+   start_flags[index] = 1;
+   start_string_offsets[index] = add_string( value );
+   return;
+}
+
+
+/*!
+ * @brief Mark a variable as the derivative of a state variable.
+ *
+ * @param [in] index       Variable index.
+ * @param [in] state_index Index of the state variable.
+ */
+void TrickFMI::FMI2VariableTable::set_derivative(
+   size_t index,
+   int    state_index )
+{
+   derivatives[index] = state_index;
+   return;
+}
+
+
+/*!
+ * @brief Set the unit and declared type of a variable.
+ *
+ * @param [in] index         Variable index.
+ * @param [in] unit          Unit index in the FMI2UnitTable or -1.
+ * @param [in] declared_type Declared type index in the FMI2UnitTable or -1.
+ */
+void TrickFMI::FMI2VariableTable::set_unit(
+   size_t index,
+   int    unit,
+   int    declared_type )
+{
+   units[index]          = unit;
+   declared_types[index] = declared_type;
+   return;
+}
+
+
+/*!
+ * @brief Hash a variable name.
+ *
+ * This is a seeded 32-bit FNV-1a hash with a final avalanche step.
+ *
+ * @return Returns the hash of the name.
+ * @param [in] name Variable name.
+ * @param [in] seed Hash seed.
+ */
+uint32_t TrickFMI::FMI2VariableTable::hash_name(
+   const char     * name,
+         uint32_t   seed )
+{
+   uint32_t hash = 2166136261U ^ (seed * 0x9e3779b9U);
+
+   for ( ; *name != '\0' ; name++ ) {
+      hash ^= (unsigned char)*name;
+      hash *= 16777619U;
+   }
+   hash ^= hash >> 16;
+   hash *= 0x85ebca6bU;
+   hash ^= hash >> 13;
+   hash *= 0xc2b2ae35U;
+   hash ^= hash >> 16;
+
+   return( hash );
+}
+
+
+/*!
+ * @brief Build the name index.
+ *
+ * This builds a minimal perfect hash of the variable names using the hash
+ * and displace method.  Names are first hashed into buckets.  Starting with
+ * the largest bucket, each bucket with more than one name is assigned the
+ * first hash seed that places all its names in free slots.  Buckets with a
+ * single name are then placed directly in the remaining free slots.  A look
+ * up is one or two hashes, a slot read and a name comparison.
+ *
+ * Variable names must be unique.  Only the first of a set of variables with
+ * the same name is indexed.
+ *
+ * @return Returns false if there are duplicate variable names.
+ */
+bool TrickFMI::FMI2VariableTable::build_index()
+{
+   std::vector<size_t> sorted;
+   std::vector< std::vector<size_t> > buckets;
+   std::vector<size_t> bucket_order;
+   std::vector<size_t> placed;
+   VariableNameLess name_less;
+   BucketSizeGreater bucket_greater;
+   size_t num_slots;
+   size_t iinc, jinc;
+   size_t free_slot;
+   uint32_t seed;
+   bool unique = true;
+
+   hash_displacements.clear();
+   hash_slots.clear();
+   if ( size() == 0 ) { return( true ); }
+
+   // Find any duplicate names, keeping the first of each.
+   sorted.resize( size() );
+   for ( iinc = 0 ; iinc < size() ; iinc++ ) { sorted[iinc] = iinc; }
+   name_less.table = this;
+   std::stable_sort( sorted.begin(), sorted.end(), name_less );
+   for ( iinc = 1, jinc = 1 ; iinc < sorted.size() ; iinc++ ) {
+      if ( !strcmp( get_name( sorted[iinc] ), get_name( sorted[jinc-1] ) ) ) {
+         std::cerr << "Duplicate model variable name: "
+                   << get_name( sorted[iinc] ) << std::endl;
+         unique = false;
+      }
+      else {
+         sorted[jinc++] = sorted[iinc];
+      }
+   }
+   sorted.resize( jinc );
+
+   // Hash the names into buckets.
+   num_slots = sorted.size();
+   buckets.resize( num_slots );
+   for ( iinc = 0 ; iinc < sorted.size() ; iinc++ ) {
+      buckets[ hash_name( get_name( sorted[iinc] ), 0 ) % num_slots ].push_back( sorted[iinc] );
+   }
+
+   // Place the buckets from largest to smallest.
+   bucket_order.resize( num_slots );
+   for ( iinc = 0 ; iinc < num_slots ; iinc++ ) { bucket_order[iinc] = iinc; }
+   bucket_greater.buckets = &buckets;
+   std::stable_sort( bucket_order.begin(), bucket_order.end(), bucket_greater );
+
+   hash_displacements.assign( num_slots, 0 );
+   hash_slots.assign( num_slots, -1 );
+
+   for ( iinc = 0 ; iinc < num_slots ; iinc++ ) {
+      std::vector<size_t> & bucket = buckets[ bucket_order[iinc] ];
+      if ( bucket.size() <= 1 ) { break; }
+
+      // Find a seed that puts every name in the bucket in a free slot.
+      for ( seed = 1 ; ; seed++ ) {
+         placed.clear();
+         for ( jinc = 0 ; jinc < bucket.size() ; jinc++ ) {
+            size_t slot = hash_name( get_name( bucket[jinc] ), seed ) % num_slots;
+            if (    (hash_slots[slot] != -1)
+                 || (std::find( placed.begin(), placed.end(), slot ) != placed.end()) ) {
+               break;
+            }
+            placed.push_back( slot );
+         }
+         if ( placed.size() == bucket.size() ) { break; }
+      }
+
+      hash_displacements[ bucket_order[iinc] ] = (int)seed;
+      for ( jinc = 0 ; jinc < bucket.size() ; jinc++ ) {
+         hash_slots[ placed[jinc] ] = (int)bucket[jinc];
+      }
+   }
+
+   // Put the single name buckets directly into the free slots.
+   for ( free_slot = 0 ; iinc < num_slots ; iinc++ ) {
+      std::vector<size_t> & bucket = buckets[ bucket_order[iinc] ];
+      if ( bucket.empty() ) { break; }
+      while ( hash_slots[free_slot] != -1 ) { free_slot++; }
+      hash_slots[free_slot] = (int)bucket[0];
+      hash_displacements[ bucket_order[iinc] ] = -(int)free_slot - 1;
+   }
+
+   return( unique );
+}
+
+
+/*!
+ * @brief Find a variable by name.
+ *
+ * @return Returns the variable index or -1 if there is no variable with
+ * the name.
+ * @param [in] name Variable name.
+ */
+int TrickFMI::FMI2VariableTable::find( const char * name ) const
+{
+   size_t num_slots = hash_slots.size();
+   int displacement;
+   size_t slot;
+   int index;
+
+   if ( num_slots == 0 ) { return( -1 ); }
+
+   displacement = hash_displacements[ hash_name( name, 0 ) % num_slots ];
+   if ( displacement < 0 ) {
+      slot = (size_t)(-displacement - 1);
+   }
+   else {
+      slot = hash_name( name, (uint32_t)displacement ) % num_slots;
+   }
+
+   index = hash_slots[slot];
+   if ( (index < 0) || strcmp( get_name( index ), name ) ) {
+      return( -1 );
+   }
+   return( index );
+}
+
+
+/*!
+ * @brief Append the table to a binary model description cache buffer.
+ *
+ * Every array, including the name index, is written as one block so the
+ * table can be restored without rebuilding the index.
+ *
+ * @param [inout] buffer Buffer to append the table to.
+ */
+void TrickFMI::FMI2VariableTable::write_binary( std::string & buffer ) const
+{
+   write_binary_block( buffer, string_data );
+   write_binary_block( buffer, name_offsets );
+   write_binary_block( buffer, value_references );
+   write_binary_block( buffer, types );
+   write_binary_block( buffer, causalities );
+   write_binary_block( buffer, variabilities );
+   write_binary_block( buffer, initials );
+   write_binary_block( buffer, start_flags );
+   write_binary_block( buffer, start_values );
+   write_binary_block( buffer, start_string_offsets );
+   write_binary_block( buffer, derivatives );
+   write_binary_block( buffer, units );
+   write_binary_block( buffer, declared_types );
+   write_binary_block( buffer, hash_displacements );
+   write_binary_block( buffer, hash_slots );
+   return;
+}
+
+
+/*!
+ * @brief Restore the table from a binary model description cache buffer.
+ *
+ * The blocks are checked for consistency so that a damaged cache file
+ * cannot produce out of range look ups.
+ *
+ * @return Returns true on success.  On failure the table is empty.
+ * @param [inout] data Read position, moved past the table.
+ * @param [in]    end  End of the buffer.
+ */
+bool TrickFMI::FMI2VariableTable::read_binary(
+   const char ** data,
+   const char  * end )
+{
+   size_t num_variables;
+   size_t num_slots;
+   size_t iinc;
+   bool valid;
+
+   valid =    read_binary_block( data, end, string_data )
+           && read_binary_block( data, end, name_offsets )
+           && read_binary_block( data, end, value_references )
+           && read_binary_block( data, end, types )
+           && read_binary_block( data, end, causalities )
+           && read_binary_block( data, end, variabilities )
+           && read_binary_block( data, end, initials )
+           && read_binary_block( data, end, start_flags )
+           && read_binary_block( data, end, start_values )
+           && read_binary_block( data, end, start_string_offsets )
+           && read_binary_block( data, end, derivatives )
+           && read_binary_block( data, end, units )
+           && read_binary_block( data, end, declared_types )
+           && read_binary_block( data, end, hash_displacements )
+           && read_binary_block( data, end, hash_slots );
+
+   // Check the array sizes.
+   num_variables = value_references.size();
+   num_slots     = hash_slots.size();
+   valid = valid
+           && (name_offsets.size() == num_variables)
+           && (types.size() == num_variables)
+           && (causalities.size() == num_variables)
+           && (variabilities.size() == num_variables)
+           && (initials.size() == num_variables)
+           && (start_flags.size() == num_variables)
+           && (start_values.size() == num_variables)
+           && (start_string_offsets.size() == num_variables)
+           && (derivatives.size() == num_variables)
+           && (units.size() == num_variables)
+           && (declared_types.size() == num_variables)
+           && (hash_displacements.size() == num_slots)
+           && (num_slots <= num_variables)
+           && ((num_variables == 0) || (num_slots > 0))
+           && (string_data.empty() || (string_data.back() == '\0'));
+
+   // Check the offsets and indices.
+   for ( iinc = 0 ; valid && (iinc < num_variables) ; iinc++ ) {
+      valid =    (name_offsets[iinc] < string_data.size())
+              && (    (start_string_offsets[iinc] == no_string)
+                   || (start_string_offsets[iinc] < string_data.size()) )
+              && (derivatives[iinc] >= -1)
+              && (derivatives[iinc] < (int)num_variables)
+              && (units[iinc] >= -1)
+              && (declared_types[iinc] >= -1);
+   }
+   for ( iinc = 0 ; valid && (iinc < num_slots) ; iinc++ ) {
+      valid =    (hash_slots[iinc] >= -1)
+              && (hash_slots[iinc] < (int)num_variables)
+              && (    (hash_displacements[iinc] >= 0)
+                   || ((size_t)(-(hash_displacements[iinc] + 1)) < num_slots) );
+   }
+
+   if ( !valid ) { clear(); }
+   return( valid );
+}
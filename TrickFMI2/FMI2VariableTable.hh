@@ -0,0 +1,313 @@
+/*******************************************************************************
+* Things that Trick looks for to trigger parsing and processing:
+* PURPOSE:
+* LIBRARY DEPENDENCY:
+*  ((FMI2VariableTable.o))
+********************************************************************************/
+/*!
+@file FMI2VariableTable.hh
+@ingroup FMITrickInterface
+@brief Definition of the FMI2VariableTable class.
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+
+*/
+
+#ifndef FMI2_VARIABLE_TABLE_HH_
+#define FMI2_VARIABLE_TABLE_HH_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "fmi2FunctionTypes.h"
+
+// TrickFMI namespace is used for everything in the TrickFMI repo
+namespace TrickFMI {
+
+//! Model variable type (the ScalarVariable type element).
+typedef enum {
+   FMI2Real,
+   FMI2Integer,
+   FMI2Boolean,
+   FMI2String,
+   FMI2Enumeration
+} FMI2VariableType;
+
+//! Model variable causality.
+typedef enum {
+   FMI2Parameter,
+   FMI2CalculatedParameter,
+   FMI2Input,
+   FMI2Output,
+   FMI2Local,
+   FMI2Independent
+} FMI2Causality;
+
+//! Model variable variability.
+typedef enum {
+   FMI2Constant,
+   FMI2Fixed,
+   FMI2Tunable,
+   FMI2Discrete,
+   FMI2Continuous
+} FMI2Variability;
+
+//! Model variable initial attribute.
+typedef enum {
+   FMI2Exact,
+   FMI2Approx,
+   FMI2Calculated,
+   FMI2InitialUnspecified
+} FMI2Initial;
+
+/*!
+@class FMI2VariableTable
+@brief Defines the FMI2VariableTable class.
+
+The FMI2VariableTable class holds the model variables from the ModelVariables
+element of an FMU model description.  The table is stored as a structure of
+arrays indexed by the variable's position in ModelVariables (0 based), with
+all the names and string start values in a single character buffer.  A
+minimal perfect hash of the variable names is built once all the variables
+have been added, so looking up a variable by name is a constant time
+operation.
+
+@trick_parse{everything}
+
+@tldh
+@trick_link_dependency{FMI2VariableTable.o}
+
+*/
+
+class FMI2VariableTable {
+
+  public:
+
+   // Default constructor.
+   FMI2VariableTable();
+
+   // Destructor.
+   ~FMI2VariableTable();
+
+   /*
+    * Functions used to build the table.
+    */
+   void clear();
+   void reserve( size_t num_variables, size_t string_size );
+   size_t add_variable(
+      const char            * name,
+      fmi2ValueReference      value_reference,
+      FMI2VariableType        type,
+      FMI2Causality           causality,
+      FMI2Variability         variability,
+      FMI2Initial             initial         );
+   void set_start( size_t index, double value );
+   void set_start( size_t index, const char * value );
+   void set_derivative( size_t index, int state_index );
+   void set_unit( size_t index, int unit, int declared_type );
+   bool build_index();
+
+   /*
+    * Functions used to save and restore the table in the binary model
+    * description cache.
+    */
+   void write_binary( std::string & buffer ) const;
+   bool read_binary( const char ** data, const char * end );
+
+   /*
+    * Functions used to look up variables.
+    */
+   int find( const char * name ) const;
+
+   /*!
+    * @brief Get the number of variables in the table.
+    * @return Number of variables.
+    */
+   size_t size() const { return( value_references.size() ); }
+
+   /*!
+    * @brief Get the name of a variable.
+    * @return Variable name.
+    * @param [in] index Variable index.
+    */
+   const char * get_name( size_t index ) const {
+      return( &string_data[ name_offsets[index] ] );
+   }
+
+   /*!
+    * @brief Get the value reference of a variable.
+    * @return Variable value reference.
+    * @param [in] index Variable index.
+    */
+   fmi2ValueReference get_value_reference( size_t index ) const {
+      return( value_references[index] );
+   }
+
+   /*!
+    * @brief Get the type of a variable.
+    * @return Variable type.
+    * @param [in] index Variable index.
+    */
+   FMI2VariableType get_type( size_t index ) const {
+      return( (FMI2VariableType)types[index] );
+   }
+
+   /*!
+    * @brief Get the causality of a variable.
+    * @return Variable causality.
+    * @param [in] index Variable index.
+    */
+   FMI2Causality get_causality( size_t index ) const {
+      return( (FMI2Causality)causalities[index] );
+   }
+
+   /*!
+    * @brief Get the variability of a variable.
+    * @return Variable variability.
+    * @param [in] index Variable index.
+    */
+   FMI2Variability get_variability( size_t index ) const {
+      return( (FMI2Variability)variabilities[index] );
+   }
+
+   /*!
+    * @brief Get the initial attribute of a variable.
+    * @return Variable initial attribute.
+    * @param [in] index Variable index.
+    */
+   FMI2Initial get_initial( size_t index ) const {
+      return( (FMI2Initial)initials[index] );
+   }
+
+   /*!
+    * @brief Check if a variable has a start value.
+    * @return True if the variable has a start value.
+    * @param [in] index Variable index.
+    */
+   bool has_start( size_t index ) const {
+      return( start_flags[index] != 0 );
+   }
+
+   /*!
+    * @brief Get the start value of a Real, Integer, Boolean or Enumeration
+    * variable.
+    * @return Variable start value (0 if there is no start value).
+    * @param [in] index Variable index.
+    */
+   double get_start( size_t index ) const {
+      return( start_values[index] );
+   }
+
+   /*!
+    * @brief Get the start value of a String variable.
+    * @return Variable start value or NULL if there is no start value.
+    * @param [in] index Variable index.
+    */
+   const char * get_start_string( size_t index ) const {
+      return( (start_string_offsets[index] == no_string) ?
+              NULL : &string_data[ start_string_offsets[index] ] );
+   }
+
+   /*!
+    * @brief Get the state variable of a derivative variable.
+    * @return Index of the variable this variable is the derivative of or -1
+    * if it is not a derivative.
+    * @param [in] index Variable index.
+    */
+   int get_derivative( size_t index ) const {
+      return( derivatives[index] );
+   }
+
+   /*!
+    * @brief Get the unit of a variable.
+    * @return Index of the variable unit in the FMI2UnitTable or -1 if the
+    * variable has no unit.  The unit of the declared type is used if the
+    * variable does not declare its own unit.
+    * @param [in] index Variable index.
+    */
+   int get_unit( size_t index ) const {
+      return( units[index] );
+   }
+
+   /*!
+    * @brief Get the declared type of a variable.
+    * @return Index of the variable's declaredType in the FMI2UnitTable or
+    * -1 if the variable has no declared type.
+    * @param [in] index Variable index.
+    */
+   int get_declared_type( size_t index ) const {
+      return( declared_types[index] );
+   }
+
+   /*
+    * Raw views of the table arrays indexed by variable index.
+    */
+   /*!
+    * @brief Get the array of value references.
+    * @return Pointer to the value reference array.
+    */
+   const fmi2ValueReference * get_value_references() const {
+      return( value_references.empty() ? NULL : &value_references[0] );
+   }
+
+   /*!
+    * @brief Get the array of numeric start values.
+    * @return Pointer to the start value array.
+    */
+   const double * get_start_values() const {
+      return( start_values.empty() ? NULL : &start_values[0] );
+   }
+
+  protected:
+
+   static const size_t no_string = (size_t)-1; //!< @trick_io{**} No string marker.
+
+   std::vector<char>               string_data;          //!< @trick_io{**} Name and string start storage.
+   std::vector<size_t>             name_offsets;         //!< @trick_io{**} Name offsets in string_data.
+   std::vector<fmi2ValueReference> value_references;     //!< @trick_io{**} Value references.
+   std::vector<unsigned char>      types;                //!< @trick_io{**} FMI2VariableType values.
+   std::vector<unsigned char>      causalities;          //!< @trick_io{**} FMI2Causality values.
+   std::vector<unsigned char>      variabilities;        //!< @trick_io{**} FMI2Variability values.
+   std::vector<unsigned char>      initials;             //!< @trick_io{**} FMI2Initial values.
+   std::vector<unsigned char>      start_flags;          //!< @trick_io{**} Start value flags.
+   std::vector<double>             start_values;         //!< @trick_io{**} Numeric start values.
+   std::vector<size_t>             start_string_offsets; //!< @trick_io{**} String start offsets in string_data.
+   std::vector<int>                derivatives;          //!< @trick_io{**} State variable indices.
+   std::vector<int>                units;                //!< @trick_io{**} Unit indices.
+   std::vector<int>                declared_types;       //!< @trick_io{**} Declared type indices.
+
+   std::vector<int> hash_displacements; //!< @trick_io{**} Perfect hash bucket displacements.
+   std::vector<int> hash_slots;         //!< @trick_io{**} Perfect hash slot variable indices.
+
+   size_t add_string( const char * value );
+
+   static uint32_t hash_name( const char * name, uint32_t seed );
+
+  private:
+
+   /*!
+    * @brief Copy constructor not implemented.
+    *
+    * The copy constructor is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2VariableTable (const FMI2VariableTable &);
+
+   /*!
+    * @brief Assignment operator not implemented.
+    *
+    * The assignment operator is private and unimplemented to avoid
+    * erroneous copies.
+    */
+   FMI2VariableTable & operator= (const FMI2VariableTable &);
+
+};
+
+} // End TrickFMI namespace.
+
+#endif /* FMI2_VARIABLE_TABLE_HH_ */
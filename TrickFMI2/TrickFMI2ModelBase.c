@@ -1727,6 +1727,8 @@ fmi2Status fmi2DoStep(
    frame_epsilon = frame_size * 1.0e-12;
    for ( frame_count = 1; frame_count <= num_integ_steps; frame_count++ ) {
 
+      TRICK_FMI_TRACE_BEGIN( model_base, TRICK_FMI_TRACE_DO_STEP_FRAME );
+
       /* Compute the time for the next frame. */
       next_frame_time = (frame_count * frame_size) + currentCommunicationPoint;
 
@@ -1745,6 +1747,7 @@ fmi2Status fmi2DoStep(
          /* Take an integration step. */
          status = model_integrate( model_base, dt );
          if ( status != fmi2OK ) {
+            TRICK_FMI_TRACE_END( model_base, TRICK_FMI_TRACE_DO_STEP_FRAME );
             return( status );
          }
 
@@ -1804,6 +1807,8 @@ fmi2Status fmi2DoStep(
 
       } /* End of inner frame propagation loop. */
 
+      TRICK_FMI_TRACE_END( model_base, TRICK_FMI_TRACE_DO_STEP_FRAME );
+
    } /* End of multi-step integration loop. */
 
    return( fmi2OK );
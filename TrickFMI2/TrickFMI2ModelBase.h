@@ -57,6 +57,9 @@ All Other Rights Reserved.
 #include "TrickFMI2ModelMasks.h"
 #include "regula_falsi.h"
 
+/* Include the trace points of the wrapper code. */
+#include "trick_fmi_trace.h"
+
 typedef void * TrickFMIModel; /* Pointer to model specific data. */
 
 #ifdef __cplusplus
@@ -82,6 +82,8 @@ fmi2Boolean process_dynamic_events(
           */
          while (tgo != 0.0) {
 
+            TRICK_FMI_TRACE_BEGIN( model_base, TRICK_FMI_TRACE_EVENT_ITERATION );
+
             /* Integrate to the estimated event time. */
             model_integrate( model_base, tgo );
 
@@ -98,6 +100,8 @@ fmi2Boolean process_dynamic_events(
             // Compute the new time-to-go (tgo) from the Regula Falsi error.
             tgo = regula_falsi( *event_time , &(model_base->rf_events[einc]) );
 
+            TRICK_FMI_TRACE_END( model_base, TRICK_FMI_TRACE_EVENT_ITERATION );
+
          }
 
       }
@@ -0,0 +1,54 @@
+/*!
+@file trick_fmi_trace.h
+@ingroup TrickFMIWrapper
+@brief Trace points inside TrickFMI wrapped FMUs.
+
+The TrickFMI C wrapper code marks the sub-integration frames of fmi2DoStep
+and the event location iterations of process_dynamic_events() with these
+trace points.  The trace functions are defined by the host (see
+FMI2Trace.hh) and referenced weakly by the FMU; so, an FMU loaded by a host
+without them, or by a host that does not export them to shared libraries
+(link the host with -rdynamic), skips the trace points.
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+
+*/
+
+#ifndef TRICK_FMI_TRACE_H_
+#define TRICK_FMI_TRACE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Trace points in the FMU.  The values follow the host FMI call ids. */
+typedef enum {
+   TRICK_FMI_TRACE_DO_STEP_FRAME   = 1000,
+   TRICK_FMI_TRACE_EVENT_ITERATION = 1001
+} TrickFMITracePoint;
+
+#if defined(__GNUC__)
+#define TRICK_FMI_TRACE_HOOK __attribute__((weak, visibility("default")))
+#else
+#define TRICK_FMI_TRACE_HOOK
+#endif
+
+void trick_fmi_trace_begin( const void * instance, int point ) TRICK_FMI_TRACE_HOOK;
+
+void trick_fmi_trace_end( const void * instance, int point ) TRICK_FMI_TRACE_HOOK;
+
+/* Mark the beginning and end of a trace point for an FMU instance. */
+#define TRICK_FMI_TRACE_BEGIN( instance, point ) \
+   do { if ( trick_fmi_trace_begin != NULL ) { trick_fmi_trace_begin( instance, point ); } } while (0)
+
+#define TRICK_FMI_TRACE_END( instance, point ) \
+   do { if ( trick_fmi_trace_end != NULL ) { trick_fmi_trace_end( instance, point ); } } while (0)
+
+#ifdef __cplusplus
+}  /* end of extern "C" { */
+#endif
+
+#endif /* TRICK_FMI_TRACE_H_ */
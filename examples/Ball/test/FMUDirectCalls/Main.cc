@@ -0,0 +1,277 @@
+/*!
+@file
+@brief Program checking the direct FMI calls against the model object calls.
+
+Two instances of the Ball FMU are integrated side by side in Model Exchange
+modality: one through the model object calls and one through
+FMI2DirectCalls.  Their derivatives and model variables must be the same
+at every step.  The program also checks that binding the direct calls
+fails for a model that is not instantiated or is missing a function.
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+*/
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <iomanip>
+
+#include "FMI2ModelExchangeModel.hh"
+#include "FMI2DirectCalls.hh"
+
+using namespace std;
+
+//! Number of continuous states.
+#define NUM_STATES 4
+
+//! Number of model variables checked.
+#define NUM_VARIABLES 12
+
+//! Number of integration steps.
+#define NUM_STEPS 1000
+
+//! Integration step size.
+#define TIME_STEP 0.01
+
+//! FMU file.
+static const char * fmu_path = "../FMUModelExchange/fmu/trickBall.fmu";
+
+extern "C" {
+
+void simple_logger(
+   fmi2ComponentEnvironment env,
+   fmi2String               instance_name,
+   fmi2Status               status,
+   fmi2String               category_name,
+   fmi2String               message,
+                            ...            )
+{
+
+   /* Declare and initialize the variable arguments list: valist. */
+   va_list valist;
+   va_start( valist, message );
+
+   printf( "FMU Model: %s : %d : %s : ", instance_name, status, category_name );
+   vprintf( message, valist );
+   printf( "\n" );
+
+   /* We're done with valist. */
+   va_end(valist);
+
+   return;
+
+}
+
+}  /* end of extern "C" { */
+
+
+/*!
+@class BallModel
+@brief Ball model that can drop its bound fmi2GetDerivatives.
+
+This stands in for an FMU that does not provide a function.
+*/
+class BallModel : public TrickFMI::FMI2ModelExchangeModel {
+
+  public:
+
+   //! Forget the bound fmi2GetDerivatives.
+   void drop_get_derivatives() { get_derivatives = NULL; }
+
+};
+
+
+/*!
+ * @brief Load the Ball FMU.
+ * @return Returns fmi2OK or the failing call status.
+ * @param [inout] fmu        Model object.
+ * @param [in]    unpack_dir Unpacking area.
+ */
+static fmi2Status load_ball(
+   BallModel  & fmu,
+   const char * unpack_dir )
+{
+   fmu.delete_unpacked_fmu = true;
+   fmu.set_unpack_dir( unpack_dir );
+   return( fmu.load_fmu( fmu_path ) );
+}
+
+
+/*!
+ * @brief Instantiate the Ball FMU and bring it into Continuous-Time Mode.
+ * @return Returns fmi2OK or the failing call status.
+ * @param [inout] fmu Loaded model object.
+ */
+static fmi2Status start_ball( BallModel & fmu )
+{
+   static fmi2CallbackFunctions fmu_callbacks = { .logger = simple_logger,
+                                                  .allocateMemory = calloc,
+                                                  .freeMemory = free,
+                                                  .stepFinished = NULL,
+                                                  .componentEnvironment = NULL };
+   fmi2EventInfo event_info;
+
+   if ( fmu.fmi2Instantiate( "trickBall", fmi2ModelExchange,
+                             "{Trick_Ball_Model_Version_0.0.0}", "",
+                             &fmu_callbacks, fmi2False, fmi2False ) == NULL ) {
+      return( fmi2Error );
+   }
+   fmu.fmi2SetupExperiment( fmi2False, 0.0, 0.0, fmi2False, 0.0 );
+   fmu.set_start_value( "x1", 5.0 );
+   fmu.set_start_value( "x2", 5.0 );
+   fmu.set_start_value( "v1", 2.5 );
+   fmu.set_start_value( "v2", 1.5 );
+   fmu.fmi2EnterInitializationMode();
+   fmu.fmi2ExitInitializationMode();
+   event_info.newDiscreteStatesNeeded = fmi2True;
+   while ( event_info.newDiscreteStatesNeeded ) {
+      fmu.fmi2NewDiscreteStates( &event_info );
+   }
+   return( fmu.fmi2EnterContinuousTimeMode() );
+}
+
+
+/*!
+ * @brief Check that binding the direct calls fails for unusable models.
+ * @return Returns the number of errors found.
+ */
+static int check_bind_errors()
+{
+   TrickFMI::FMI2DirectCalls< TrickFMI::FMI2ModelExchangeModel > direct;
+   BallModel fmu;
+   int errors = 0;
+
+   if ( load_ball( fmu, "unpack/bind" ) != fmi2OK ) {
+      std::cerr << "Error loading the FMU: " << fmu_path << std::endl;
+      return( 1 );
+   }
+
+   // Not instantiated.
+   if ( (direct.bind( fmu ) == fmi2OK) || direct.is_bound() ) {
+      std::cerr << "Direct calls bound to a model that is not instantiated!" << std::endl;
+      errors++;
+   }
+
+   // Missing fmi2GetDerivatives.
+   if ( start_ball( fmu ) != fmi2OK ) {
+      std::cerr << "Error starting the FMU!" << std::endl;
+      return( errors + 1 );
+   }
+   if ( direct.bind( fmu ) != fmi2OK ) {
+      std::cerr << "Error binding the direct calls!" << std::endl;
+      errors++;
+   }
+   fmu.drop_get_derivatives();
+   if ( (direct.bind( fmu ) == fmi2OK) || direct.is_bound() ) {
+      std::cerr << "Direct calls bound without fmi2GetDerivatives!" << std::endl;
+      errors++;
+   }
+
+   fmu.fmi2Terminate();
+   fmu.fmi2FreeInstance();
+
+   return( errors );
+}
+
+
+int main( int nargs, char ** args )
+{
+   TrickFMI::FMI2DirectCalls< TrickFMI::FMI2ModelExchangeModel > direct;
+   TrickFMI::FMI2DirectCalls< TrickFMI::FMI2ModelBase > direct_base;
+   BallModel fmu;
+   BallModel fmu_direct;
+   fmi2ValueReference vr[NUM_VARIABLES];
+   fmi2Real values[NUM_VARIABLES];
+   fmi2Real direct_values[NUM_VARIABLES];
+   fmi2Real states[NUM_STATES];
+   fmi2Real derivs[NUM_STATES];
+   fmi2Real direct_states[NUM_STATES];
+   fmi2Real direct_derivs[NUM_STATES];
+   fmi2Real sim_time;
+   fmi2Boolean enter_event_mode;
+   fmi2Boolean terminate;
+   int errors = 0;
+   int iinc, sinc;
+
+   // 1. Binding fails for unusable models.
+   errors += check_bind_errors();
+
+   // 2. Start two instances of the FMU and bind the direct calls to one.
+   if (    (load_ball( fmu, "unpack/object" ) != fmi2OK)
+        || (load_ball( fmu_direct, "unpack/direct" ) != fmi2OK)
+        || (start_ball( fmu ) != fmi2OK)
+        || (start_ball( fmu_direct ) != fmi2OK) ) {
+      std::cerr << "Error starting the FMUs: " << fmu_path << std::endl;
+      return( 1 );
+   }
+   if ( (direct.bind( fmu_direct ) != fmi2OK) || (direct_base.bind( fmu_direct ) != fmi2OK) ) {
+      std::cerr << "Error binding the direct calls!" << std::endl;
+      return( 1 );
+   }
+   for ( iinc = 0 ; iinc < NUM_VARIABLES ; iinc++ ) {
+      vr[iinc] = iinc;
+   }
+
+   // 3. Integrate both with Euler steps and compare them at every step.
+   for ( iinc = 0 ; (iinc < NUM_STEPS) && (errors == 0) ; iinc++ ) {
+
+      fmu.fmi2GetContinuousStates( states, NUM_STATES );
+      fmu.fmi2GetDerivatives( derivs, NUM_STATES );
+      direct.fmi2GetContinuousStates( direct_states, NUM_STATES );
+      direct.fmi2GetDerivatives( direct_derivs, NUM_STATES );
+      fmu.fmi2GetReal( vr, NUM_VARIABLES, values );
+      direct_base.fmi2GetReal( vr, NUM_VARIABLES, direct_values );
+
+      for ( sinc = 0 ; sinc < NUM_STATES ; sinc++ ) {
+         if (    (states[sinc] != direct_states[sinc])
+              || (derivs[sinc] != direct_derivs[sinc]) ) {
+            std::cerr << "Step " << iinc << ": state " << sinc << " differs!" << std::endl;
+            errors++;
+         }
+      }
+      for ( sinc = 0 ; sinc < NUM_VARIABLES ; sinc++ ) {
+         if ( values[sinc] != direct_values[sinc] ) {
+            std::cerr << "Step " << iinc << ": variable " << sinc << " differs!" << std::endl;
+            errors++;
+         }
+      }
+
+      for ( sinc = 0 ; sinc < NUM_STATES ; sinc++ ) {
+         states[sinc]        += TIME_STEP * derivs[sinc];
+         direct_states[sinc] += TIME_STEP * direct_derivs[sinc];
+      }
+      sim_time = (iinc + 1) * TIME_STEP;
+      fmu.fmi2SetTime( sim_time );
+      fmu.fmi2SetContinuousStates( states, NUM_STATES );
+      fmu.fmi2CompletedIntegratorStep( fmi2True, &enter_event_mode, &terminate );
+      fmu_direct.fmi2SetTime( sim_time );
+      direct.fmi2SetContinuousStates( direct_states, NUM_STATES );
+      fmu_direct.fmi2CompletedIntegratorStep( fmi2True, &enter_event_mode, &terminate );
+
+   }
+
+   // 4. A value set through the direct calls reads back through the model.
+   if ( errors == 0 ) {
+      values[0] = 1.25;
+      direct_base.fmi2SetReal( vr, 1, values );
+      fmu_direct.fmi2GetReal( vr, 1, direct_values );
+      if ( direct_values[0] != values[0] ) {
+         std::cerr << "Direct fmi2SetReal value not set!" << std::endl;
+         errors++;
+      }
+      std::cout << "Final position: " << setprecision( 15 )
+                << states[0] << ", " << states[1] << std::endl;
+   }
+
+   fmu.fmi2Terminate();
+   fmu.fmi2FreeInstance();
+   fmu_direct.fmi2Terminate();
+   fmu_direct.fmi2FreeInstance();
+
+   return( (errors == 0) ? 0 : 1 );
+
+}
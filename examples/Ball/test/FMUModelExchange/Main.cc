@@ -258,7 +258,10 @@ int main( int nargs, char ** args )
    const size_t num_var = 12;
    const size_t num_states = 4;
    const size_t num_events = 0;
-   fmi2ValueReference vr[ num_var ] = {0,1,2,3,4,5,6,7,8,9,10,11};
+   const char * var_names[ num_var ] = { "x1", "x2", "v1", "v2", "a1", "a2",
+                                         "m", "force1", "force2",
+                                         "origin1", "origin2", "env_force" };
+   fmi2ValueReference vr[ num_var ];
    fmi2Real values[ num_var ];
    fmi2Real states[ num_states ];
    fmi2Real nominals[ num_states ];
@@ -293,6 +296,13 @@ int main( int nargs, char ** args )
       exit( 1 );
    }
 
+   // Look up the model variables by name.
+   if ( fmu.get_value_references( var_names, num_var, vr ) != fmi2OK ) {
+      cout << "Missing model variables in the FMU: ";
+      cout << "\"" << fmupath << "\"!" << endl;
+      exit( 1 );
+   }
+
    std::cout << "Library loaded: " << fmu.get_library_path() << std::endl;
    std::cout << "Platform: " << fmu.fmi2GetTypesPlatform() << std::endl;
    std::cout << "FMI Version: " << fmu.fmi2GetVersion() << std::endl;
@@ -339,13 +349,12 @@ int main( int nargs, char ** args )
    fmu.fmi2SetupExperiment( fmi2False, 0.0, start_time, fmi2True, stop_time );
 
    // Override the default set in the XML file.
-   // Set all variable start values (of "ScalarVariable / <type> / start") and
-   // set the input values at time = start_time.
-   values[0] = 5.0;
-   values[1] = 5.0;
-   values[2] = 3.5 * cos( 45.0 * DTR );
-   values[3] = 3.5 * sin( 45.0 * DTR );
-   fmu.fmi2SetReal( vr, 4, values );
+   // The start value overrides are set in one batch when the model enters
+   // initialization mode.
+   fmu.set_start_value( "x1", 5.0 );
+   fmu.set_start_value( "x2", 5.0 );
+   fmu.set_start_value( "v1", 3.5 * cos( 45.0 * DTR ) );
+   fmu.set_start_value( "v2", 3.5 * sin( 45.0 * DTR ) );
 
 
    // 7. Initialize the simulation state.
@@ -0,0 +1,300 @@
+/*!
+@file
+@brief Program swapping the Ball FMU while it runs in Model Exchange modality.
+
+The Ball FMU is run twice with the same start values.  The second run
+first tries to swap in an FMU that does not exist, which must keep the
+running FMU, and then swaps in a new copy of the Ball FMU halfway through.
+The model variables are checked right after each swap and at the end of
+the run against the run that was not swapped.
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+*/
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+#include "FMI2ModelExchangeModel.hh"
+
+using namespace std;
+
+//! Number of continuous states.
+#define NUM_STATES 4
+
+//! Number of model variables checked.
+#define NUM_VARIABLES 12
+
+//! Number of integration steps.
+#define NUM_STEPS 500
+
+//! Step at which the FMU is swapped.
+#define SWAP_STEP 250
+
+//! Integration step size.
+#define TIME_STEP 0.01
+
+//! FMU file.
+static const char * fmu_path = "../FMUModelExchange/fmu/trickBall.fmu";
+
+//! FMU file that does not exist.
+static const char * missing_fmu_path = "fmu/missing.fmu";
+
+extern "C" {
+
+void simple_logger(
+   fmi2ComponentEnvironment env,
+   fmi2String               instance_name,
+   fmi2Status               status,
+   fmi2String               category_name,
+   fmi2String               message,
+                            ...            )
+{
+
+   /* Declare and initialize the variable arguments list: valist. */
+   va_list valist;
+   va_start( valist, message );
+
+   printf( "FMU Model: %s : %d : %s : ", instance_name, status, category_name );
+   vprintf( message, valist );
+   printf( "\n" );
+
+   /* We're done with valist. */
+   va_end(valist);
+
+   return;
+
+}
+
+}  /* end of extern "C" { */
+
+
+/*!
+ * @brief Get the values of all the checked model variables.
+ * @return Returns the fmi2GetReal status.
+ * @param [inout] fmu    Running model.
+ * @param [out]   values Values of value references 0 to NUM_VARIABLES - 1.
+ */
+static fmi2Status get_variables(
+   TrickFMI::FMI2ModelExchangeModel & fmu,
+   fmi2Real                           values[NUM_VARIABLES] )
+{
+   fmi2ValueReference vr[NUM_VARIABLES];
+   int iinc;
+
+   for ( iinc = 0 ; iinc < NUM_VARIABLES ; iinc++ ) {
+      vr[iinc] = iinc;
+   }
+   return( fmu.fmi2GetReal( vr, NUM_VARIABLES, values ) );
+}
+
+
+/*!
+ * @brief Compare model variable values.
+ * @return Returns the number of values that differ.
+ * @param [in] what     Name of the comparison.
+ * @param [in] values   Values to check.
+ * @param [in] expected Expected values.
+ */
+static int compare_variables(
+   const char     * what,
+   const fmi2Real   values[NUM_VARIABLES],
+   const fmi2Real   expected[NUM_VARIABLES] )
+{
+   int errors = 0;
+   int iinc;
+
+   for ( iinc = 0 ; iinc < NUM_VARIABLES ; iinc++ ) {
+      if ( values[iinc] != expected[iinc] ) {
+         std::cerr << what << ": variable " << iinc << " is "
+                   << setprecision( 15 ) << values[iinc] << "; expected "
+                   << expected[iinc] << "!" << std::endl;
+         errors++;
+      }
+   }
+   return( errors );
+}
+
+
+/*!
+ * @brief Check if a path exists.
+ * @return Returns true if the path exists.
+ * @param [in] path Path to check.
+ */
+static bool path_exists( const std::string & path )
+{
+   struct stat path_stat;
+   return( stat( path.c_str(), &path_stat ) == 0 );
+}
+
+
+/*!
+ * @brief Swap FMUs in the running model and check the swaps.
+ * @return Returns the number of errors found.
+ * @param [inout] fmu Running model.
+ */
+static int swap_ball( TrickFMI::FMI2ModelExchangeModel & fmu )
+{
+   fmi2Real before[NUM_VARIABLES];
+   fmi2Real after[NUM_VARIABLES];
+   std::string unpack_path = fmu.get_unpack_path();
+   int errors = 0;
+
+   get_variables( fmu, before );
+
+   // A failed swap keeps the running FMU.
+   if ( fmu.swap_fmu( missing_fmu_path ) != fmi2Error ) {
+      std::cerr << "Swapping in a missing FMU did not fail!" << std::endl;
+      return( errors + 1 );
+   }
+   if (    strcmp( fmu.get_fmu_path(), fmu_path )
+        || (unpack_path != fmu.get_unpack_path())
+        || !path_exists( unpack_path ) ) {
+      std::cerr << "Failed swap did not keep the running FMU!" << std::endl;
+      errors++;
+   }
+   if ( (get_variables( fmu, after ) != fmi2OK) ) {
+      std::cerr << "Running FMU does not respond after the failed swap!" << std::endl;
+      return( errors + 1 );
+   }
+   errors += compare_variables( "After the failed swap", after, before );
+
+   // A new version is unpacked beside the running one, which is released.
+   if ( fmu.swap_fmu( fmu_path ) != fmi2OK ) {
+      std::cerr << "Error swapping in FMU: " << fmu_path << std::endl;
+      return( errors + 1 );
+   }
+   std::cout << "Swapped in " << fmu.get_fmu_path() << " unpacked in "
+             << fmu.get_unpack_path() << std::endl;
+   if ( (unpack_path == fmu.get_unpack_path()) || path_exists( unpack_path ) ) {
+      std::cerr << "Swapped in FMU did not replace the unpacked FMU: "
+                << unpack_path << std::endl;
+      errors++;
+   }
+   if ( get_variables( fmu, after ) != fmi2OK ) {
+      std::cerr << "Swapped in FMU does not respond!" << std::endl;
+      return( errors + 1 );
+   }
+   errors += compare_variables( "After the swap", after, before );
+
+   return( errors );
+}
+
+
+/*!
+ * @brief Run the Ball FMU and optionally swap it halfway.
+ * @return Returns the number of errors found.
+ * @param [in]  swap   Swap the FMU halfway through the run.
+ * @param [out] values Values of the model variables at the end.
+ */
+static int run_ball(
+   bool     swap,
+   fmi2Real values[NUM_VARIABLES] )
+{
+   fmi2CallbackFunctions fmu_callbacks = { .logger = simple_logger,
+                                           .allocateMemory = calloc,
+                                           .freeMemory = free,
+                                           .stepFinished = NULL,
+                                           .componentEnvironment = NULL };
+   TrickFMI::FMI2ModelExchangeModel fmu;
+   fmi2Real states[NUM_STATES];
+   fmi2Real derivs[NUM_STATES];
+   fmi2Real sim_time = 0.0;
+   fmi2Boolean enter_event_mode;
+   fmi2Boolean terminate;
+   fmi2EventInfo event_info;
+   int errors = 0;
+   int iinc, sinc;
+
+   fmu.delete_unpacked_fmu = true;
+   fmu.set_unpack_dir( "unpack" );
+   if ( fmu.load_fmu( fmu_path ) != fmi2OK ) {
+      std::cerr << "Error loading the FMU: " << fmu_path << std::endl;
+      return( 1 );
+   }
+   if ( fmu.fmi2Instantiate( "trickBall", fmi2ModelExchange,
+                             "{Trick_Ball_Model_Version_0.0.0}", "",
+                             &fmu_callbacks, fmi2False, fmi2False ) == NULL ) {
+      std::cerr << "Error instantiating the FMU!" << std::endl;
+      return( 1 );
+   }
+   fmu.fmi2SetupExperiment( fmi2False, 0.0, sim_time, fmi2False, 0.0 );
+
+   // Start values away from the model defaults, so that a swapped in FMU
+   // only matches if the values are carried across.
+   fmu.set_start_value( "x1", 5.0 );
+   fmu.set_start_value( "x2", 5.0 );
+   fmu.set_start_value( "v1", 2.5 );
+   fmu.set_start_value( "v2", 1.5 );
+   fmu.set_start_value( "m", 5.0 );
+   fmu.set_start_value( "env_force", 6.0 );
+   fmu.fmi2EnterInitializationMode();
+   fmu.fmi2ExitInitializationMode();
+
+   event_info.newDiscreteStatesNeeded = fmi2True;
+   while ( event_info.newDiscreteStatesNeeded ) {
+      fmu.fmi2NewDiscreteStates( &event_info );
+   }
+   fmu.fmi2EnterContinuousTimeMode();
+
+   // Integrate with Euler steps, getting the states from the model so
+   // that a swapped in FMU picks up where the old one was.
+   for ( iinc = 0 ; (iinc < NUM_STEPS) && (errors == 0) ; iinc++ ) {
+      if ( swap && (iinc == SWAP_STEP) ) {
+         errors += swap_ball( fmu );
+      }
+      fmu.fmi2GetContinuousStates( states, NUM_STATES );
+      fmu.fmi2GetDerivatives( derivs, NUM_STATES );
+      for ( sinc = 0 ; sinc < NUM_STATES ; sinc++ ) {
+         states[sinc] += TIME_STEP * derivs[sinc];
+      }
+      sim_time = (iinc + 1) * TIME_STEP;
+      fmu.fmi2SetTime( sim_time );
+      fmu.fmi2SetContinuousStates( states, NUM_STATES );
+      fmu.fmi2CompletedIntegratorStep( fmi2True, &enter_event_mode, &terminate );
+   }
+
+   if ( get_variables( fmu, values ) != fmi2OK ) {
+      std::cerr << "Error getting the model variables!" << std::endl;
+      errors++;
+   }
+   fmu.fmi2Terminate();
+   fmu.fmi2FreeInstance();
+
+   return( errors );
+}
+
+
+int main( int nargs, char ** args )
+{
+   fmi2Real values[NUM_VARIABLES];
+   fmi2Real swapped_values[NUM_VARIABLES];
+   int errors = 0;
+
+   // 1. Run the FMU without swapping it.
+   errors += run_ball( false, values );
+
+   // 2. Run it again with the swaps.
+   if ( errors == 0 ) {
+      errors += run_ball( true, swapped_values );
+   }
+
+   // 3. The swapped run must end where the run without swaps did.
+   if ( errors == 0 ) {
+      std::cout << "Final position: " << setprecision( 15 )
+                << swapped_values[0] << ", " << swapped_values[1] << std::endl;
+      errors += compare_variables( "At the end", swapped_values, values );
+   }
+
+   return( (errors == 0) ? 0 : 1 );
+
+}
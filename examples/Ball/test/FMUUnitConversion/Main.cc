@@ -0,0 +1,233 @@
+/*!
+@file
+@brief Program checking the unit conversions of the FMI2UnitTable class.
+
+A small unit table, like one read from the UnitDefinitions element of a
+model description, is converted to host unit strings.  The conversions
+must match hand computed values, including the temperature offsets and
+the SI prefixes, and incompatible units must be rejected.
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+*/
+
+#include <math.h>
+#include <string.h>
+#include <iostream>
+#include <iomanip>
+
+#include "FMI2UnitTable.hh"
+
+using namespace std;
+
+//! Relative tolerance of the conversion checks.
+#define TOLERANCE 1.0e-12
+
+//! Index of the kg BaseUnit exponent.
+#define KG  0
+
+//! Index of the m BaseUnit exponent.
+#define M   1
+
+//! Index of the s BaseUnit exponent.
+#define S   2
+
+//! Index of the K BaseUnit exponent.
+#define K   4
+
+//! Index of the rad BaseUnit exponent.
+#define RAD 7
+
+
+/*!
+ * @brief Check if two values agree within the relative tolerance.
+ * @return Returns true if the values agree.
+ * @param [in] value    Value to check.
+ * @param [in] expected Expected value.
+ */
+static bool same_value(
+   double value,
+   double expected )
+{
+   return( fabs( value - expected ) <= TOLERANCE * fmax( 1.0, fabs( expected ) ) );
+}
+
+
+/*!
+ * @brief Check the conversion of a value from an FMU unit to a host unit.
+ * @return Returns the number of errors found.
+ * @param [in] table      Unit table.
+ * @param [in] unit_name  FMU unit name.
+ * @param [in] host_units Host unit string.
+ * @param [in] value      Value in the FMU unit.
+ * @param [in] expected   Expected value in the host unit.
+ */
+static int check_conversion(
+   const TrickFMI::FMI2UnitTable & table,
+   const char                    * unit_name,
+   const char                    * host_units,
+   double                          value,
+   double                          expected )
+{
+   double scale;
+   double offset;
+
+   if ( !table.get_conversion( table.find_unit( unit_name ), host_units, scale, offset ) ) {
+      std::cerr << "Conversion from " << unit_name << " to " << host_units
+                << " rejected!" << std::endl;
+      return( 1 );
+   }
+   std::cout << setprecision( 15 ) << value << " " << unit_name << " = "
+             << scale * value + offset << " " << host_units << std::endl;
+   if ( !same_value( scale * value + offset, expected ) ) {
+      std::cerr << "Conversion from " << unit_name << " to " << host_units
+                << " is " << scale * value + offset << "; expected "
+                << expected << "!" << std::endl;
+      return( 1 );
+   }
+   return( 0 );
+}
+
+
+/*!
+ * @brief Check that a conversion from an FMU unit to a host unit is rejected.
+ * @return Returns the number of errors found.
+ * @param [in] table      Unit table.
+ * @param [in] unit_name  FMU unit name or NULL for a variable without a unit.
+ * @param [in] host_units Host unit string.
+ */
+static int check_rejected(
+   const TrickFMI::FMI2UnitTable & table,
+   const char                    * unit_name,
+   const char                    * host_units )
+{
+   double scale;
+   double offset;
+   int unit = (unit_name != NULL) ? table.find_unit( unit_name ) : -1;
+
+   if ( table.get_conversion( unit, host_units, scale, offset ) ) {
+      std::cerr << "Conversion from " << ((unit_name != NULL) ? unit_name : "no unit")
+                << " to " << host_units << " accepted!" << std::endl;
+      return( 1 );
+   }
+   return( 0 );
+}
+
+
+/*!
+ * @brief Check the SI definition parsed from a host unit string.
+ * @return Returns the number of errors found.
+ * @param [in] units     Unit string.
+ * @param [in] factor    Expected scale factor to SI.
+ * @param [in] offset    Expected offset to SI.
+ * @param [in] exponents Expected base unit exponents.
+ */
+static int check_parse(
+   const char   * units,
+   double         factor,
+   double         offset,
+   const int8_t   exponents[FMI2_NUM_BASE_UNITS] )
+{
+   TrickFMI::FMI2UnitDefinition definition;
+
+   if ( !TrickFMI::FMI2UnitTable::parse_units( units, definition ) ) {
+      std::cerr << "Unit string not parsed: " << units << std::endl;
+      return( 1 );
+   }
+   if (    !same_value( definition.factor, factor )
+        || !same_value( definition.offset, offset )
+        || memcmp( definition.exponents, exponents, sizeof(definition.exponents) ) ) {
+      std::cerr << "Unit string " << units << " parsed as " << setprecision( 15 )
+                << definition.factor << " * value + " << definition.offset
+                << "; expected " << factor << " * value + " << offset << "!" << std::endl;
+      return( 1 );
+   }
+   return( 0 );
+}
+
+
+int main( int nargs, char ** args )
+{
+   static const int8_t acceleration[FMI2_NUM_BASE_UNITS] = { 0, 1,-2, 0, 0, 0, 0, 0 };
+   static const int8_t force[FMI2_NUM_BASE_UNITS]        = { 1, 1,-2, 0, 0, 0, 0, 0 };
+   static const int8_t length[FMI2_NUM_BASE_UNITS]       = { 0, 1, 0, 0, 0, 0, 0, 0 };
+   static const int8_t temperature[FMI2_NUM_BASE_UNITS]  = { 0, 0, 0, 0, 1, 0, 0, 0 };
+   static const int8_t time[FMI2_NUM_BASE_UNITS]         = { 0, 0, 1, 0, 0, 0, 0, 0 };
+   TrickFMI::FMI2UnitTable table;
+   TrickFMI::FMI2UnitDefinition definition;
+   int errors = 0;
+   int unit;
+
+   // 1. Build the unit table.  Units with a BaseUnit element carry their SI
+   //    definition; the others are interpreted from their names.
+   memset( &definition, 0, sizeof(definition) );
+   definition.factor = 1.0;
+   definition.exponents[M] = 1;
+   definition.exponents[S] = -2;
+   table.add_unit( "m/s2", &definition );
+
+   memset( &definition, 0, sizeof(definition) );
+   definition.factor = 1.0;
+   definition.offset = 273.15;
+   definition.exponents[K] = 1;
+   table.add_unit( "degC", &definition );
+
+   memset( &definition, 0, sizeof(definition) );
+   definition.factor = 1.0;
+   definition.exponents[RAD] = 1;
+   unit = table.add_unit( "rad", &definition );
+   table.add_display_unit( unit, "deg", 180.0 / M_PI, 0.0 );
+
+   memset( &definition, 0, sizeof(definition) );
+   definition.factor = 1.0;
+   definition.exponents[KG] = 1;
+   definition.exponents[M] = 1;
+   definition.exponents[S] = -2;
+   table.add_unit( "N", &definition );
+
+   table.add_unit( "km", NULL );
+   table.add_unit( "ms", NULL );
+
+   // 2. Host unit strings.
+   errors += check_parse( "m/s2", 1.0, 0.0, acceleration );
+   errors += check_parse( "ft/s^2", 0.3048, 0.0, acceleration );
+   errors += check_parse( "kg*m/s2", 1.0, 0.0, force );
+   errors += check_parse( "km", 1.0e3, 0.0, length );
+   errors += check_parse( "ms", 1.0e-3, 0.0, time );
+   errors += check_parse( "degC", 1.0, 273.15, temperature );
+   errors += check_parse( "degF", 5.0 / 9.0, 459.67 * 5.0 / 9.0, temperature );
+
+   // 3. Conversions.
+   errors += check_conversion( table, "m/s2", "ft/s2", 9.80665, 9.80665 / 0.3048 );
+   errors += check_conversion( table, "m/s2", "m/s2", 9.80665, 9.80665 );
+   errors += check_conversion( table, "degC", "degF", 100.0, 212.0 );
+   errors += check_conversion( table, "degC", "degF", -40.0, -40.0 );
+   errors += check_conversion( table, "degC", "K", 0.0, 273.15 );
+   errors += check_conversion( table, "rad", "deg", M_PI, 180.0 );
+   errors += check_conversion( table, "N", "lbf", 4.4482216152605, 1.0 );
+   errors += check_conversion( table, "N", "kN", 1500.0, 1.5 );
+   errors += check_conversion( table, "km", "m", 1.5, 1500.0 );
+   errors += check_conversion( table, "km", "mi", 1.609344, 1.0 );
+   errors += check_conversion( table, "ms", "s", 250.0, 0.25 );
+   errors += check_conversion( table, "ms", "us", 1.0, 1000.0 );
+
+   // 4. Incompatible and unknown units are rejected.
+   errors += check_rejected( table, "m/s2", "ft/s" );
+   errors += check_rejected( table, "m/s2", "N" );
+   errors += check_rejected( table, "degC", "m" );
+   errors += check_rejected( table, "km", "s" );
+   errors += check_rejected( table, "ms", "Hz" );
+   errors += check_rejected( table, "N", "kg" );
+   errors += check_rejected( table, "km", "furlong" );
+   errors += check_rejected( table, "km", "m+s" );
+   errors += check_rejected( table, NULL, "m" );
+
+   if ( errors == 0 ) {
+      std::cout << "All unit conversions checked." << std::endl;
+   }
+
+   return( (errors == 0) ? 0 : 1 );
+
+}
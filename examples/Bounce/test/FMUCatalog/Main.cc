@@ -0,0 +1,100 @@
+/*!
+@file
+@brief Program cataloging the example FMUs.
+
+The FMUs below the examples directory are scanned into an FMI2FMUCatalog,
+the catalog is saved to an index file and loaded again, and the loaded
+catalog is queried for the Co-Simulation FMUs with linux64 binaries.
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+*/
+
+#include <string.h>
+#include <iostream>
+#include <vector>
+
+#include "FMI2FMUCatalog.hh"
+
+using namespace std;
+
+//! Directory scanned for FMUs.
+#define EXAMPLES_DIR "../../.."
+
+//! Catalog index file.
+#define INDEX_FILE "RUN_catalog/log_fmu_catalog.idx"
+
+//! GUIDs of the example models.
+static const char * example_guids[] = {
+   "{Trick_Ball_Model_Version_0.0.0}",
+   "{Trick_Bounce_Model_Version_0.0.0}" };
+
+
+int main( int nargs, char ** args )
+{
+   TrickFMI::FMI2FMUCatalog catalog;
+   TrickFMI::FMI2FMUCatalog loaded;
+   std::vector<size_t> matches;
+   size_t iinc;
+   int errors = 0;
+
+   // 1. Scan the example FMUs.
+   if ( catalog.scan_directory( EXAMPLES_DIR ) != fmi2OK ) {
+      std::cerr << "Error scanning the FMUs in " << EXAMPLES_DIR << "!" << std::endl;
+      return( 1 );
+   }
+   std::cout << "Cataloged " << catalog.size() << " FMUs." << std::endl;
+
+   // 2. Save the catalog index and load it again.
+   if ( catalog.save( INDEX_FILE ) != fmi2OK ) {
+      std::cerr << "Error saving the catalog index!" << std::endl;
+      return( 1 );
+   }
+   if ( loaded.load( INDEX_FILE ) != fmi2OK ) {
+      std::cerr << "Error loading the catalog index!" << std::endl;
+      return( 1 );
+   }
+   if ( loaded.size() != catalog.size() ) {
+      std::cerr << "Loaded catalog has " << loaded.size() << " entries; expected "
+                << catalog.size() << "!" << std::endl;
+      errors++;
+   }
+   for ( iinc = 0 ; (iinc < loaded.size()) && (iinc < catalog.size()) ; iinc++ ) {
+      if (    strcmp( loaded.get_path( iinc ), catalog.get_path( iinc ) )
+           || strcmp( loaded.get_guid( iinc ), catalog.get_guid( iinc ) ) ) {
+         std::cerr << "Loaded catalog entry " << iinc << " differs: "
+                   << loaded.get_path( iinc ) << std::endl;
+         errors++;
+      }
+   }
+
+   // 3. Rescanning with the loaded catalog keeps the unchanged entries.
+   if (    (loaded.scan_directory( EXAMPLES_DIR ) != fmi2OK)
+        || (loaded.size() != catalog.size()) ) {
+      std::cerr << "Error rescanning the FMUs!" << std::endl;
+      errors++;
+   }
+
+   // 4. Query the Co-Simulation FMUs with linux64 binaries.
+   loaded.select( TrickFMI::FMI2CatalogCoSimulation, 0,
+                  TrickFMI::FMI2CatalogLinux64, matches );
+   std::cout << matches.size() << " Co-Simulation FMUs with linux64 binaries:" << std::endl;
+   for ( iinc = 0 ; iinc < matches.size() ; iinc++ ) {
+      std::cout << "   " << loaded.get_model_name( matches[iinc] ) << " "
+                << loaded.get_guid( matches[iinc] ) << " "
+                << loaded.get_path( matches[iinc] ) << std::endl;
+   }
+
+   // 5. Both example models must be found.
+   for ( iinc = 0 ; iinc < sizeof(example_guids) / sizeof(example_guids[0]) ; iinc++ ) {
+      if ( loaded.find_guid( example_guids[iinc] ) < 0 ) {
+         std::cerr << "Model not in the catalog: " << example_guids[iinc] << std::endl;
+         errors++;
+      }
+   }
+
+   return( (errors == 0) ? 0 : 1 );
+
+}
@@ -0,0 +1,217 @@
+/*!
+@file
+@brief Program running an ensemble of Bouncing Ball FMU variants.
+
+The Bouncing Ball FMU is loaded and brought into initialization mode once.
+An FMI2Ensemble then runs drop height and restitution variants of it in
+forked processes.  The results are checked against the same variants run
+one at a time in this process.
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+*/
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <iomanip>
+
+#include "FMI2CoSimulationModel.hh"
+#include "FMI2Ensemble.hh"
+
+using namespace std;
+
+//! Number of ensemble runs.
+#define NUM_RUNS 4
+
+//! Number of results of each run: final position and velocity.
+#define NUM_RESULTS 2
+
+//! FMU file.
+static const char * fmu_path = "../../trickBounce.fmu";
+
+//! Drop heights of the runs.
+static const double drop_heights[NUM_RUNS] = { 1.0, 2.0, 1.0, 2.0 };
+
+//! Coefficients of restitution of the runs.
+static const double restitutions[NUM_RUNS] = { 0.7, 0.7, 0.5, 0.5 };
+
+extern "C" {
+
+void simple_logger(
+   fmi2ComponentEnvironment env,
+   fmi2String               instance_name,
+   fmi2Status               status,
+   fmi2String               category_name,
+   fmi2String               message,
+                            ...            )
+{
+
+   /* Declare and initialize the variable arguments list: valist. */
+   va_list valist;
+   va_start( valist, message );
+
+   printf( "FMU Model: %s : %d : %s : ", instance_name, status, category_name );
+   vprintf( message, valist );
+   printf( "\n" );
+
+   /* We're done with valist. */
+   va_end(valist);
+
+   return;
+
+}
+
+}  /* end of extern "C" { */
+
+
+/*!
+ * @brief Load, instantiate and set up the FMU up to initialization mode.
+ * @return Returns fmi2OK or the failing call status.
+ * @param [inout] fmu Model object.
+ */
+static fmi2Status start_bounce( TrickFMI::FMI2CoSimulationModel & fmu )
+{
+   static fmi2CallbackFunctions fmu_callbacks = { .logger = simple_logger,
+                                                  .allocateMemory = calloc,
+                                                  .freeMemory = free,
+                                                  .stepFinished = NULL,
+                                                  .componentEnvironment = NULL };
+
+   fmu.delete_unpacked_fmu = true;
+   fmu.set_unpack_dir( "unpack" );
+   if ( fmu.load_fmu( fmu_path ) != fmi2OK ) {
+      return( fmi2Error );
+   }
+   if ( fmu.fmi2Instantiate( "trickBounce", fmi2CoSimulation,
+                             "{Trick_Bounce_Model_Version_0.0.0}", "",
+                             &fmu_callbacks, fmi2False, fmi2False ) == NULL ) {
+      return( fmi2Error );
+   }
+   fmu.fmi2SetupExperiment( fmi2False, 0.0, 0.0, fmi2True, 2.5 );
+   return( fmu.fmi2EnterInitializationMode() );
+}
+
+
+/*!
+ * @brief Run the Bouncing Ball from initialization mode to 2.5 seconds.
+ *
+ * This is the ensemble run function; it is also used for the check runs.
+ *
+ * @return Returns fmi2OK or the failing call status.
+ * @param [inout] model       Model in initialization mode.
+ * @param [in]    run         Run index.
+ * @param [out]   results     Final position and velocity.
+ * @param [in]    result_size Number of results.
+ * @param [in]    data        Not used.
+ */
+static fmi2Status run_bounce(
+   TrickFMI::FMI2ModelBase & model,
+   size_t                    run,
+   double                    results[],
+   size_t                    result_size,
+   void                    * data        )
+{
+   TrickFMI::FMI2CoSimulationModel & fmu = (TrickFMI::FMI2CoSimulationModel &)model;
+   fmi2ValueReference vr[NUM_RESULTS] = { 0, 1 };
+   fmi2Real sim_time = 0.0;
+   fmi2Real time_step = 0.01;
+   fmi2Status status;
+
+   status = fmu.fmi2ExitInitializationMode();
+   while ( (sim_time < 2.5 - (time_step / 2.0)) && (status == fmi2OK) ) {
+      status = fmu.fmi2DoStep( sim_time, time_step, fmi2True );
+      sim_time += time_step;
+   }
+   if ( status == fmi2OK ) {
+      status = fmu.fmi2GetReal( vr, result_size, results );
+   }
+
+   return( status );
+}
+
+
+int main( int nargs, char ** args )
+{
+   TrickFMI::FMI2Ensemble ensemble;
+   double ensemble_results[NUM_RUNS][NUM_RESULTS];
+   double check_results[NUM_RESULTS];
+   fmi2ValueReference vr[2] = { 0, 5 };
+   fmi2Real value[2];
+   int errors = 0;
+   size_t iinc, jinc;
+
+   // 1. Set up the runs.
+   ensemble.set_result_size( NUM_RESULTS );
+   for ( iinc = 0 ; iinc < NUM_RUNS ; iinc++ ) {
+      ensemble.add_run();
+      ensemble.set_run_value( iinc, "x", drop_heights[iinc] );
+      ensemble.set_run_value( iinc, "e", restitutions[iinc] );
+   }
+
+   // 2. Run the ensemble from one FMU in initialization mode.  The model
+   // removes its unpacked FMU when it goes out of scope.
+   {
+      TrickFMI::FMI2CoSimulationModel fmu;
+
+      if ( start_bounce( fmu ) != fmi2OK ) {
+         std::cerr << "Error starting the FMU: " << fmu_path << std::endl;
+         return( 1 );
+      }
+      if ( ensemble.run( fmu, run_bounce, NULL ) != fmi2OK ) {
+         std::cerr << "Error running the ensemble!" << std::endl;
+         return( 1 );
+      }
+      for ( iinc = 0 ; iinc < NUM_RUNS ; iinc++ ) {
+         for ( jinc = 0 ; jinc < NUM_RESULTS ; jinc++ ) {
+            ensemble_results[iinc][jinc] = ensemble.get_results( iinc )[jinc];
+         }
+      }
+      fmu.fmi2Terminate();
+      fmu.fmi2FreeInstance();
+   }
+
+   // 3. Check each run against the same variant run in this process.
+   for ( iinc = 0 ; iinc < NUM_RUNS ; iinc++ ) {
+      TrickFMI::FMI2CoSimulationModel fmu;
+
+      value[0] = drop_heights[iinc];
+      value[1] = restitutions[iinc];
+      if (    (start_bounce( fmu ) != fmi2OK)
+           || (fmu.fmi2SetReal( vr, 2, value ) != fmi2OK)
+           || (run_bounce( fmu, iinc, check_results, NUM_RESULTS, NULL ) != fmi2OK) ) {
+         std::cerr << "Error running check run " << iinc << "!" << std::endl;
+         return( 1 );
+      }
+      fmu.fmi2Terminate();
+      fmu.fmi2FreeInstance();
+
+      std::cout << "Run " << iinc << ": x0 = " << drop_heights[iinc]
+                << ", e = " << restitutions[iinc]
+                << ", x = " << setprecision( 15 ) << ensemble_results[iinc][0]
+                << ", v = " << ensemble_results[iinc][1]
+                << " (" << ensemble.get_run_time( iinc ) << " s)" << std::endl;
+      for ( jinc = 0 ; jinc < NUM_RESULTS ; jinc++ ) {
+         if ( ensemble_results[iinc][jinc] != check_results[jinc] ) {
+            std::cerr << "Run " << iinc << " result " << jinc << " is "
+                      << ensemble_results[iinc][jinc] << "; expected "
+                      << check_results[jinc] << "!" << std::endl;
+            errors++;
+         }
+      }
+   }
+
+   // 4. The variants must give different results.
+   for ( iinc = 1 ; iinc < NUM_RUNS ; iinc++ ) {
+      if ( ensemble_results[iinc][0] == ensemble_results[0][0] ) {
+         std::cerr << "Run " << iinc << " did not change the result!" << std::endl;
+         errors++;
+      }
+   }
+
+   return( (errors == 0) ? 0 : 1 );
+
+}
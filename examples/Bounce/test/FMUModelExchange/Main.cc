@@ -322,11 +322,10 @@ int main( int nargs, char ** args )
    fmu.fmi2SetupExperiment( fmi2False, 0.0, start_time, fmi2True, stop_time );
 
    // Override the default set in the XML file.
-   // Set all variable start values (of "ScalarVariable / <type> / start") and
-   // set the input values at time = start_time.
-   values[0] = 1.0;
-   values[1] = 0.0;
-   fmu.fmi2SetReal( vr, 2, values );
+   // The start value overrides are set in one batch when the model enters
+   // initialization mode.
+   fmu.set_start_value( "x", 1.0 );
+   fmu.set_start_value( "v", 0.0 );
 
 
    // 7. Initialize the simulation state.
@@ -0,0 +1,178 @@
+/*!
+@file
+@brief Program loading the Ball and Bouncing Ball FMUs in parallel.
+
+The FMUs are loaded by an FMI2FMULoader on two threads, run in
+Co-Simulation modality and checked against the same FMUs loaded one at a
+time.
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+*/
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <iomanip>
+
+#include "FMI2CoSimulationModel.hh"
+#include "FMI2FMULoader.hh"
+
+using namespace std;
+
+//! Number of FMUs loaded.
+#define NUM_FMUS 2
+
+//! FMU files.
+static const char * fmu_paths[NUM_FMUS] = {
+   "../../../Ball/test/FMUCoSimulation/fmu/trickBall.fmu",
+   "../../trickBounce.fmu" };
+
+//! FMU instance names.
+static const char * instance_names[NUM_FMUS] = { "trickBall", "trickBounce" };
+
+//! FMU GUIDs.
+static const char * fmu_guids[NUM_FMUS] = {
+   "{Trick_Ball_Model_Version_0.0.0}",
+   "{Trick_Bounce_Model_Version_0.0.0}" };
+
+extern "C" {
+
+void simple_logger(
+   fmi2ComponentEnvironment env,
+   fmi2String               instance_name,
+   fmi2Status               status,
+   fmi2String               category_name,
+   fmi2String               message,
+                            ...            )
+{
+
+   /* Declare and initialize the variable arguments list: valist. */
+   va_list valist;
+   va_start( valist, message );
+
+   printf( "FMU Model: %s : %d : %s : ", instance_name, status, category_name );
+   vprintf( message, valist );
+   printf( "\n" );
+
+   /* We're done with valist. */
+   va_end(valist);
+
+   return;
+
+}
+
+}  /* end of extern "C" { */
+
+
+/*!
+ * @brief Run a loaded FMU for one second and get its first state.
+ * @return Returns fmi2OK or the failing call status.
+ * @param [inout] fmu   Loaded FMU model.
+ * @param [in]    index Index of the FMU in the FMU lists.
+ * @param [out]   value Value of the first model variable at the end.
+ */
+static fmi2Status run_fmu(
+   TrickFMI::FMI2CoSimulationModel & fmu,
+   int                               index,
+   fmi2Real                        & value )
+{
+   fmi2ValueReference vr = 0;
+   fmi2Real sim_time = 0.0;
+   fmi2Real time_step = 0.01;
+   fmi2Status status = fmi2OK;
+   fmi2CallbackFunctions fmu_callbacks = { .logger = simple_logger,
+                                           .allocateMemory = calloc,
+                                           .freeMemory = free,
+                                           .stepFinished = NULL,
+                                           .componentEnvironment = NULL };
+
+   if ( fmu.fmi2Instantiate( instance_names[index], fmi2CoSimulation,
+                             fmu_guids[index], "", &fmu_callbacks,
+                             fmi2False, fmi2False ) == NULL ) {
+      return( fmi2Error );
+   }
+   fmu.fmi2SetupExperiment( fmi2False, 0.0, 0.0, fmi2True, 1.0 );
+   fmu.fmi2EnterInitializationMode();
+   fmu.fmi2ExitInitializationMode();
+   while ( (sim_time < 1.0 - (time_step / 2.0)) && (status == fmi2OK) ) {
+      status = fmu.fmi2DoStep( sim_time, time_step, fmi2True );
+      sim_time += time_step;
+   }
+   if ( status == fmi2OK ) {
+      status = fmu.fmi2GetReal( &vr, 1, &value );
+   }
+   fmu.fmi2Terminate();
+   fmu.fmi2FreeInstance();
+
+   return( status );
+}
+
+
+int main( int nargs, char ** args )
+{
+   fmi2Real parallel_values[NUM_FMUS];
+   fmi2Real serial_values[NUM_FMUS];
+   int errors = 0;
+   int iinc;
+
+   // 1. Load the FMUs in parallel and run them.  The models remove their
+   // unpacked FMUs when they go out of scope.
+   {
+      TrickFMI::FMI2CoSimulationModel fmus[NUM_FMUS];
+      TrickFMI::FMI2FMULoader loader;
+
+      loader.set_number_of_threads( NUM_FMUS );
+      for ( iinc = 0 ; iinc < NUM_FMUS ; iinc++ ) {
+         fmus[iinc].delete_unpacked_fmu = true;
+         fmus[iinc].set_unpack_dir( "unpack" );
+         loader.add_fmu( &fmus[iinc], fmu_paths[iinc] );
+      }
+      if ( loader.load_fmus() != fmi2OK ) {
+         std::cerr << "Error loading the FMUs in parallel!" << std::endl;
+         return( 1 );
+      }
+
+      for ( iinc = 0 ; iinc < NUM_FMUS ; iinc++ ) {
+         std::cout << "Loaded " << fmus[iinc].get_model_name()
+                   << ": " << fmus[iinc].get_library_path() << std::endl;
+         if ( run_fmu( fmus[iinc], iinc, parallel_values[iinc] ) != fmi2OK ) {
+            std::cerr << "Error running " << instance_names[iinc] << "!" << std::endl;
+            return( 1 );
+         }
+      }
+   }
+
+   // 2. Load and run the FMUs one at a time.
+   for ( iinc = 0 ; iinc < NUM_FMUS ; iinc++ ) {
+      TrickFMI::FMI2CoSimulationModel fmu;
+
+      fmu.delete_unpacked_fmu = true;
+      fmu.set_unpack_dir( "unpack" );
+      if (    (fmu.load_fmu( fmu_paths[iinc] ) != fmi2OK)
+           || (run_fmu( fmu, iinc, serial_values[iinc] ) != fmi2OK) ) {
+         std::cerr << "Error loading and running " << instance_names[iinc]
+                   << "!" << std::endl;
+         return( 1 );
+      }
+   }
+
+   // 3. Check that the parallel loaded FMUs give the same results.
+   for ( iinc = 0 ; iinc < NUM_FMUS ; iinc++ ) {
+      std::cout << instance_names[iinc] << ": parallel = "
+                << setprecision( 15 ) << parallel_values[iinc]
+                << ", serial = " << serial_values[iinc] << std::endl;
+      if ( parallel_values[iinc] != serial_values[iinc] ) {
+         std::cerr << "Parallel and serial results differ for "
+                   << instance_names[iinc] << "!" << std::endl;
+         errors++;
+      }
+   }
+
+   return( (errors == 0) ? 0 : 1 );
+
+}
@@ -0,0 +1,254 @@
+/*!
+@file
+@brief Program sharing one unpacked Bouncing Ball FMU between loaders.
+
+Several model objects load the Bouncing Ball FMU through the shared unpack
+cache: some in parallel on the threads of an FMI2FMULoader and some in
+child processes.  The FMU must be extracted once, every loader must use
+the same cache entry, and the entry must only be removed when its last
+user releases it.
+
+@copyright Copyright 2017 United States Government as represented by the
+Administrator of the National Aeronautics and Space Administration.
+No copyright is claimed in the United States under Title 17, U.S. Code.
+All Other Rights Reserved.
+*/
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+#include "FMI2CoSimulationModel.hh"
+#include "FMI2FMULoader.hh"
+
+using namespace std;
+
+//! Number of model objects loaded in this process.
+#define NUM_MODELS 4
+
+//! Number of child processes loading the FMU.
+#define NUM_CHILDREN 2
+
+//! Child process exit code: the cache entry was reused.
+#define CHILD_REUSED 0
+
+//! Child process exit code: the FMU was extracted again.
+#define CHILD_EXTRACTED 2
+
+//! FMU file.
+static const char * fmu_path = "../../trickBounce.fmu";
+
+extern "C" {
+
+void simple_logger(
+   fmi2ComponentEnvironment env,
+   fmi2String               instance_name,
+   fmi2Status               status,
+   fmi2String               category_name,
+   fmi2String               message,
+                            ...            )
+{
+
+   /* Declare and initialize the variable arguments list: valist. */
+   va_list valist;
+   va_start( valist, message );
+
+   printf( "FMU Model: %s : %d : %s : ", instance_name, status, category_name );
+   vprintf( message, valist );
+   printf( "\n" );
+
+   /* We're done with valist. */
+   va_end(valist);
+
+   return;
+
+}
+
+}  /* end of extern "C" { */
+
+
+/*!
+ * @brief Create a model object that loads through the unpack cache.
+ * @return New model object.
+ */
+static TrickFMI::FMI2CoSimulationModel * new_cached_model()
+{
+   TrickFMI::FMI2CoSimulationModel * fmu = new TrickFMI::FMI2CoSimulationModel;
+
+   fmu->use_unpack_cache    = true;
+   fmu->delete_unpacked_fmu = true;
+   fmu->set_unpack_dir( "unpack" );
+   return( fmu );
+}
+
+
+/*!
+ * @brief Run a loaded Bouncing Ball FMU for one second.
+ * @return Returns fmi2OK or the failing call status.
+ * @param [inout] fmu   Loaded model object.
+ * @param [out]   value Position at the end.
+ */
+static fmi2Status run_bounce(
+   TrickFMI::FMI2CoSimulationModel & fmu,
+   fmi2Real                        & value )
+{
+   static fmi2CallbackFunctions fmu_callbacks = { .logger = simple_logger,
+                                                  .allocateMemory = calloc,
+                                                  .freeMemory = free,
+                                                  .stepFinished = NULL,
+                                                  .componentEnvironment = NULL };
+   fmi2ValueReference vr = 0;
+   fmi2Real sim_time = 0.0;
+   fmi2Real time_step = 0.01;
+   fmi2Status status = fmi2OK;
+
+   if ( fmu.fmi2Instantiate( "trickBounce", fmi2CoSimulation,
+                             "{Trick_Bounce_Model_Version_0.0.0}", "",
+                             &fmu_callbacks, fmi2False, fmi2False ) == NULL ) {
+      return( fmi2Error );
+   }
+   fmu.fmi2SetupExperiment( fmi2False, 0.0, 0.0, fmi2True, 1.0 );
+   fmu.fmi2EnterInitializationMode();
+   fmu.fmi2ExitInitializationMode();
+   while ( (sim_time < 1.0 - (time_step / 2.0)) && (status == fmi2OK) ) {
+      status = fmu.fmi2DoStep( sim_time, time_step, fmi2True );
+      sim_time += time_step;
+   }
+   if ( status == fmi2OK ) {
+      status = fmu.fmi2GetReal( &vr, 1, &value );
+   }
+   fmu.fmi2Terminate();
+   fmu.fmi2FreeInstance();
+
+   return( status );
+}
+
+
+/*!
+ * @brief Check if a path exists.
+ * @return Returns true if the path exists.
+ * @param [in] path Path to check.
+ */
+static bool path_exists( const std::string & path )
+{
+   struct stat path_stat;
+   return( stat( path.c_str(), &path_stat ) == 0 );
+}
+
+
+/*!
+ * @brief Load the FMU through the cache in a child process.
+ * @return Returns the child process id or -1 if it could not be started.
+ * @param [in] cache_path Cache entry the parent process uses.
+ */
+static pid_t start_child( const std::string & cache_path )
+{
+   TrickFMI::FMI2CoSimulationModel * fmu;
+   fmi2Real value;
+   int code;
+   pid_t pid;
+
+   pid = fork();
+   if ( pid != 0 ) {
+      return( pid );
+   }
+
+   fmu = new_cached_model();
+   if (    (fmu->load_fmu( fmu_path ) != fmi2OK)
+        || (cache_path != fmu->get_unpack_path())
+        || (run_bounce( *fmu, value ) != fmi2OK) ) {
+      code = 1;
+   }
+   else {
+      code = (fmu->startup_report.unpacked_bytes > 0.0) ? CHILD_EXTRACTED : CHILD_REUSED;
+   }
+   delete fmu;
+   _exit( code );
+}
+
+
+int main( int nargs, char ** args )
+{
+   TrickFMI::FMI2CoSimulationModel * fmus[NUM_MODELS];
+   TrickFMI::FMI2FMULoader loader;
+   std::string cache_path;
+   fmi2Real values[NUM_MODELS];
+   pid_t pids[NUM_CHILDREN];
+   int wait_status;
+   int extractions = 0;
+   int errors = 0;
+   int iinc;
+
+   // 1. Load the FMU into several model objects in parallel.
+   loader.set_number_of_threads( NUM_MODELS );
+   for ( iinc = 0 ; iinc < NUM_MODELS ; iinc++ ) {
+      fmus[iinc] = new_cached_model();
+      loader.add_fmu( fmus[iinc], fmu_path );
+   }
+   if ( loader.load_fmus() != fmi2OK ) {
+      std::cerr << "Error loading the FMUs in parallel!" << std::endl;
+      return( 1 );
+   }
+
+   // 2. They share one cache entry, which was extracted once.
+   cache_path = fmus[0]->get_unpack_path();
+   std::cout << "Unpack cache entry: " << cache_path << std::endl;
+   for ( iinc = 0 ; iinc < NUM_MODELS ; iinc++ ) {
+      if ( cache_path != fmus[iinc]->get_unpack_path() ) {
+         std::cerr << "Model " << iinc << " uses another cache entry: "
+                   << fmus[iinc]->get_unpack_path() << std::endl;
+         errors++;
+      }
+      if ( fmus[iinc]->startup_report.unpacked_bytes > 0.0 ) {
+         extractions++;
+      }
+      if ( run_bounce( *fmus[iinc], values[iinc] ) != fmi2OK ) {
+         std::cerr << "Error running model " << iinc << "!" << std::endl;
+         errors++;
+      }
+      else if ( values[iinc] != values[0] ) {
+         std::cerr << "Model " << iinc << " result differs!" << std::endl;
+         errors++;
+      }
+   }
+   if ( extractions != 1 ) {
+      std::cerr << "The FMU was extracted " << extractions << " times!" << std::endl;
+      errors++;
+   }
+
+   // 3. Other processes reuse the entry; their release does not remove it.
+   for ( iinc = 0 ; iinc < NUM_CHILDREN ; iinc++ ) {
+      pids[iinc] = start_child( cache_path );
+   }
+   for ( iinc = 0 ; iinc < NUM_CHILDREN ; iinc++ ) {
+      wait_status = -1;
+      if (    (pids[iinc] < 0) || (waitpid( pids[iinc], &wait_status, 0 ) != pids[iinc])
+           || !WIFEXITED( wait_status ) || (WEXITSTATUS( wait_status ) != CHILD_REUSED) ) {
+         std::cerr << "Child process " << iinc << " did not reuse the cache entry!" << std::endl;
+         errors++;
+      }
+   }
+   if ( !path_exists( cache_path ) ) {
+      std::cerr << "Cache entry removed while in use!" << std::endl;
+      errors++;
+   }
+
+   // 4. Only the last release removes the entry.
+   for ( iinc = 0 ; iinc < NUM_MODELS ; iinc++ ) {
+      delete fmus[iinc];
+      if ( path_exists( cache_path ) != (iinc < NUM_MODELS - 1) ) {
+         std::cerr << "Cache entry " << ( path_exists( cache_path ) ? "kept" : "removed" )
+                   << " after releasing model " << iinc << "!" << std::endl;
+         errors++;
+      }
+   }
+
+   return( (errors == 0) ? 0 : 1 );
+
+}
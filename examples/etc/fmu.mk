@@ -43,6 +43,28 @@ endif
 # Set the directory for the FMU library installation.
 FMU_LIB_DIR = $(FMU_DIR)/binaries/$(HOST_ARCH)
 
+# Optional instruction set specific variants of a Linux x86-64 FMU library.
+# Each variant is compiled with -march=<variant> and installed next to the
+# baseline library as <FMU_NAME>.<variant>.so.  At load time FMI2ModelBase
+# picks the best variant the host CPU supports and falls back to the
+# baseline library.  For example:
+#    make FMU_ISA_VARIANTS="x86-64-v2 x86-64-v3 x86-64-v4"
+FMU_ISA_VARIANTS ?=
+ifeq ($(FMU_LIB_SUFFIX), so)
+   FMU_ISA_LIBS = $(addprefix $(FMU_NAME).,$(addsuffix .so,$(FMU_ISA_VARIANTS)))
+endif
+
+# Statically linked FMU object (Linux).  The FMU sources are compiled with
+# the FMI functions named with FMU_STATIC_PREFIX (see FMI2_FUNCTION_PREFIX in
+# fmi2Functions.h) and combined into one relocatable object.  Every other
+# global symbol is made local so the object can be linked into a host next
+# to other FMUs and the model code it was built from.  FMU_STATIC_CFLAGS
+# adds compile options, for example the host optimization flags.  See
+# TrickFMI2/FMI2StaticFMU.hh.
+FMU_STATIC_PREFIX ?= $(FMU_NAME)_
+FMU_STATIC_CFLAGS ?=
+FMU_STATIC_OBJ = $(FMU_NAME)_static.o
+
 # Set the include paths for the source file compilation.
 INCLUDES = -I$(FMU_MODEL_DIR) -I$(TRICK_FMI2_MODEL_DIR) -I$(FMI2_MODEL_DIR)
 
@@ -56,10 +78,14 @@ INCLUDES = -I$(FMU_MODEL_DIR) -I$(TRICK_FMI2_MODEL_DIR) -I$(FMI2_MODEL_DIR)
 # Default FMU build taget.
 default: $(FMU_NAME).fmu
 
+# Statically linked FMU object build target.
+.PHONY: static
+static: $(FMU_STATIC_OBJ)
+
 
 # Principal FMU build rule.
 # This zips up the FMU directory into the FMU file.
-%.fmu: %.$(FMU_LIB_SUFFIX)
+%.fmu: %.$(FMU_LIB_SUFFIX) $(FMU_ISA_LIBS)
 	@ echo ""
 	@ echo "[32mCleaning up files that should not be in the FMU.[00m"
 	(cd $(FMU_DIR); rm -rf *.o */*.o *~ \#*)
@@ -89,6 +115,19 @@ $(FMU_LIB_DIR):
 	@ echo "[32mBuilding the Linux FMU library: $@.[00m"
 	$(CC) $(LDFLAGS) -shared -Wl,-soname,$@ $(INCLUDES) -o $(FMU_LIB_DIR)/$@ $< $(FMU_MODEL_SRC) $(USERLIBS)
 
+# Linux shared object instruction set variants.
+$(FMU_NAME).%.so: $(FMU_NAME).c $(FMU_LIB_DIR)
+	@ echo ""
+	@ echo "[32mBuilding the Linux FMU library variant: $@.[00m"
+	$(CC) $(CFLAGS) -march=$* $(LDFLAGS) -shared -Wl,-soname,$@ $(INCLUDES) -o $(FMU_LIB_DIR)/$@ $< $(FMU_MODEL_SRC) $(USERLIBS)
+
+# Statically linked FMU object.
+$(FMU_STATIC_OBJ): $(FMU_NAME).c $(FMU_MODEL_SRC)
+	@ echo ""
+	@ echo "[32mBuilding the statically linked FMU object: $@.[00m"
+	$(CC) $(CFLAGS) $(FMU_STATIC_CFLAGS) -DFMI2_FUNCTION_PREFIX=$(FMU_STATIC_PREFIX) $(INCLUDES) -nostdlib -r -o $@ $< $(FMU_MODEL_SRC)
+	objcopy --wildcard --keep-global-symbol='$(FMU_STATIC_PREFIX)fmi2*' $@
+
 # Windows dynamic link library.
 %.dll: %.c $(FMU_LIB_DIR)
 	# Make users should try mingw32.  build_fmu.bat will run cl
@@ -20,7 +20,7 @@
 ##                        FILE DEFINITIONS                         ##
 #####################################################################
 TEST_PROGRAM_SRC = $(TEST_DIR)/$(TEST_PROGRAM).cc
-FMI_CLASSES = FMI2ModelBase FMI2FMUModelDescription
+FMI_CLASSES = FMI2ModelBase FMI2FMUModelDescription FMI2FMUImage FMI2StartupReport FMI2VariableTable FMI2DependencyGraph FMI2UnitTable FMI2RealBinding FMI2TransferPlan FMI2CallProfile FMI2Trace FMI2FMULoader FMI2FMUCatalog FMI2Ensemble
 ifeq ($(FMU_MODALITY), MODEL_EXCHANGE)
    FMI_CLASSES += FMI2ModelExchangeModel
 else
@@ -59,7 +59,10 @@ else
    endif
 endif
 
-LDFLAGS += -larchive -lxml2 -ldl
+LDFLAGS += -larchive -lxml2 -ldl -lpthread
+
+# Export the program symbols so FMUs find the trace hooks.
+LDFLAGS += -rdynamic
 
 
 #####################################################################